@@ -0,0 +1,88 @@
+// compile with
+// g++ -O2 -I../include ../build/liboscit.a mapper_bench.cpp -o mapper_bench
+
+/** Measure Mapper lookup cost with 10k exact rules or 10k pattern rules.
+ *
+ * Usage: mapper_bench [rules] [lookups per run]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>  // atoi
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "oscit/oscit.h"
+#include "oscit/mapper.h"
+
+using namespace oscit;
+
+/** Returns the time in [ns] per lookup.
+ */
+static double bench(Mapper *mapper, const std::vector<std::string> &sources, size_t lookups, size_t *found) {
+  TimeRef time_ref;
+  const std::string *target;
+  Real value;
+  size_t count = sources.size();
+  *found = 0;
+
+  time_ref.reset();
+  for (size_t i = 0; i < lookups; ++i) {
+    if (mapper->map(sources[i % count], 64.0, &target, &value)) ++*found;
+  }
+  return (double)time_ref.elapsed_ns() / lookups;
+}
+
+static void run(const char *name, const std::string &script, size_t rules,
+                const std::vector<std::string> &sources, size_t lookups) {
+  Mapper mapper(rules * 2);
+  TimeRef time_ref;
+  if (!mapper.parse(script)) {
+    printf("%-26s parse error: %s\n", name, mapper.error().c_str());
+    return;
+  }
+  double parse_ms = time_ref.elapsed();
+  size_t found;
+  double ns = bench(&mapper, sources, lookups, &found);
+  printf("%-26s %10.1f %12.1f %10lu\n", name, parse_ms, ns, (unsigned long)found);
+}
+
+int main(int argc, char * argv[]) {
+  size_t rules   = argc > 1 ? atoi(argv[1]) : 10000;
+  size_t lookups = argc > 2 ? atoi(argv[2]) : 1000000;
+
+  std::ostringstream exact, folders, single_folder;
+  std::vector<std::string> exact_sources, folder_sources, single_folder_sources, misses;
+
+  for (size_t i = 0; i < rules; ++i) {
+    // one exact rule per control
+    exact << "/ctrl/" << i << " [0,127] --> /synth/voice" << i << "/gain [0,1]\n";
+    // one pattern per device (one folder each)
+    folders << "/dev" << i << "/ctrl/{n} [0,127] --> /synth" << i << "/voice{n}/gain [0,1]\n";
+    // all patterns in the same folder
+    single_folder << "/ctrl/{n}/param" << i << " [0,127] --> /synth/voice{n}/param" << i << " [0,1]\n";
+
+    std::ostringstream source;
+    source << "/ctrl/" << i;
+    exact_sources.push_back(source.str());
+    source.str("");
+    source << "/dev" << i << "/ctrl/" << (i % 128);
+    folder_sources.push_back(source.str());
+    source.str("");
+    source << "/ctrl/" << (i % 128) << "/param" << i;
+    single_folder_sources.push_back(source.str());
+    source.str("");
+    source << "/unknown/" << i;
+    misses.push_back(source.str());
+  }
+
+  printf("%lu rules, %lu lookups per run\n", (unsigned long)rules, (unsigned long)lookups);
+  printf("%-26s %10s %12s %10s\n", "rules", "parse ms", "ns/lookup", "found");
+  run("exact", exact.str(), rules, exact_sources, lookups);
+  run("exact (miss)", exact.str(), rules, misses, lookups);
+  run("patterns", folders.str(), rules, folder_sources, lookups);
+  run("patterns (miss)", folders.str(), rules, misses, lookups);
+  run("patterns in one folder", single_folder.str(), rules, single_folder_sources, lookups);
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+// compile with
+// g++ -O2 -I../include ../build/liboscit.a object_alloc_bench.cpp -o object_alloc_bench
+
+/** Measure the memory and allocations needed to build a tree of objects
+ * (empty leaves grouped in folders, as in a RootProxy mirror).
+ *
+ * Usage: object_alloc_bench [folders] [leaves per folder]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>  // atoi, malloc
+#include <new>
+
+#include "oscit/oscit.h"
+
+using namespace oscit;
+
+static size_t gAllocCount = 0;
+static size_t gAllocBytes = 0;
+
+void *operator new(size_t size) throw(std::bad_alloc) {
+  ++gAllocCount;
+  gAllocBytes += size;
+  void *ptr = malloc(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) throw() {
+  free(ptr);
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc) {
+  return operator new(size);
+}
+
+void operator delete[](void *ptr) throw() {
+  free(ptr);
+}
+
+template<class T>
+static void run(const char *name, Object *root, size_t folders, size_t leaves) {
+  size_t nodes = folders * (leaves + 1);
+  size_t count = gAllocCount;
+  size_t bytes = gAllocBytes;
+  char buffer[24];
+
+  TimeRef time_ref;
+  for (size_t i = 0; i < folders; ++i) {
+    snprintf(buffer, sizeof(buffer), "f%lu", (unsigned long)i);
+    Object *folder = root->adopt(new T(buffer, gNilValue));
+    for (size_t j = 0; j < leaves; ++j) {
+      snprintf(buffer, sizeof(buffer), "l%lu", (unsigned long)j);
+      folder->adopt(new T(buffer, gNilValue));
+    }
+  }
+  double build_ms = time_ref.elapsed();
+
+  time_ref.reset();
+  root->clear();
+  double clear_ms = time_ref.elapsed();
+
+  printf("%-12s %8lu %10.1f %10.1f %10.1f %10.1f\n", name, (unsigned long)nodes,
+         (double)(gAllocBytes - bytes) / nodes, (double)(gAllocCount - count) / nodes,
+         build_ms, clear_ms);
+}
+
+int main(int argc, char * argv[]) {
+  size_t folders = argc > 1 ? atoi(argv[1]) : 300;
+  size_t leaves  = argc > 2 ? atoi(argv[2]) : 100;
+
+  printf("sizeof(Object) = %lu, sizeof(ObjectProxy) = %lu\n",
+         (unsigned long)sizeof(Object), (unsigned long)sizeof(ObjectProxy));
+
+  // empty leaf (after the first allocation which creates the slabs)
+  Object *first = new Object("first", gNilValue);
+  size_t count = gAllocCount;
+  size_t bytes = gAllocBytes;
+  Object *leaf = new Object("leaf", gNilValue);
+  size_t block = (sizeof(Object) + SLAB_ALLOCATOR_GRANULARITY - 1) / SLAB_ALLOCATOR_GRANULARITY * SLAB_ALLOCATOR_GRANULARITY;
+  printf("empty leaf: %lu bytes (%lu bytes slab block + %lu bytes in %lu allocations)\n\n",
+         (unsigned long)(block + gAllocBytes - bytes), (unsigned long)block,
+         (unsigned long)(gAllocBytes - bytes), (unsigned long)(gAllocCount - count));
+  leaf->release();
+  first->release();
+
+  printf("%-12s %8s %10s %10s %10s %10s\n", "node", "nodes", "bytes/node", "allocs/node", "build [ms]", "clear [ms]");
+  Root root(false);
+  run<Object>("Object", &root, folders, leaves);
+  RootProxy proxy(Location("osc", "bench"));
+  run<ObjectProxy>("ObjectProxy", &proxy, folders, leaves);
+  return 0;
+}
@@ -0,0 +1,85 @@
+// compile with
+// g++ -O2 -I../include ../build/liboscit.a patch_load_bench.cpp -o patch_load_bench
+
+/** Measure the time needed to load a patch (a large tree of objects) in a
+ * root with an observing command: objects adopted one by one in the live
+ * tree versus a detached tree attached with Object::adopt_tree.
+ *
+ * usage: patch_load_bench [folders] [leaves]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>  // atoi
+
+#include "oscit/oscit.h"
+
+using namespace oscit;
+
+/** Counts notifications and the size of their json encoding (a real command
+ * encodes each notification for every observer).
+ */
+class NotifyCounter : public Command {
+ public:
+  NotifyCounter() : Command("bench"), count_(0), bytes_(0) {}
+
+  virtual void notify_observers(const char *path, const Value &val) {
+    ++count_;
+    bytes_ += val.to_json().size();
+  }
+
+  virtual void send_message(const Location &remote_endpoint, const char *path, const Value &val) {}
+
+  virtual bool build_remote_object(const Url &remote_url, Value *error, ObjectHandle *handle) {
+    return false;
+  }
+
+  virtual void listen() {}
+
+  size_t count_;
+  size_t bytes_;
+};
+
+static void build(Object *parent, size_t folders, size_t leaves) {
+  char buffer[24];
+  for (size_t i = 0; i < folders; ++i) {
+    snprintf(buffer, sizeof(buffer), "f%lu", (unsigned long)i);
+    Object *folder = parent->adopt(new Object(buffer, gNilValue));
+    for (size_t j = 0; j < leaves; ++j) {
+      snprintf(buffer, sizeof(buffer), "l%lu", (unsigned long)j);
+      folder->adopt(new Object(buffer, gNilValue));
+    }
+  }
+}
+
+static void report(const char *name, size_t nodes, double ms, NotifyCounter *counter) {
+  printf("%-12s %8lu %10.1f %14lu %14lu\n", name, (unsigned long)nodes, ms,
+         (unsigned long)counter->count_, (unsigned long)counter->bytes_);
+  counter->count_ = 0;
+  counter->bytes_ = 0;
+}
+
+int main(int argc, char * argv[]) {
+  size_t folders = argc > 1 ? atoi(argv[1]) : 200;
+  size_t leaves  = argc > 2 ? atoi(argv[2]) : 100;
+  size_t nodes   = folders * (leaves + 1) + 1;
+
+  printf("%-12s %8s %10s %14s %14s\n", "load", "nodes", "time [ms]", "notifications", "notified [B]");
+
+  { Root root(false);
+    NotifyCounter *counter = root.adopt_command(new NotifyCounter, false);
+    TimeRef time_ref;
+    build(root.adopt(new Object("patch")), folders, leaves);
+    report("adopt", nodes, time_ref.elapsed(), counter);
+  }
+
+  { Root root(false);
+    NotifyCounter *counter = root.adopt_command(new NotifyCounter, false);
+    TimeRef time_ref;
+    Object *patch = new Object("patch");
+    build(patch, folders, leaves);
+    root.adopt_tree(patch);
+    report("adopt_tree", nodes, time_ref.elapsed(), counter);
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+// compile with
+// g++ -O2 -I../include ../build/liboscit.a signal_bench.cpp -o signal_bench
+
+/** Measure Signal::send throughput with 1 to 64 receivers.
+ *
+ * Usage: signal_bench [sends per run] [sending threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>  // atoi
+#include <vector>
+
+#include "oscit/oscit.h"
+
+using namespace oscit;
+
+#define MAX_RECEIVERS 64
+
+class Receiver : public Observer {
+public:
+  Receiver() : count_(0) {}
+
+  void receive(const Value &val) {
+    ++count_;
+  }
+
+  size_t count_;
+};
+
+struct Run {
+  Signal *signal_;
+  size_t sends_;
+  Thread thread_;
+
+  void send(Thread *runner) {
+    runner->thread_ready();
+    Value val(1.0);
+    for (size_t i = 0; i < sends_; ++i) {
+      signal_->send(val);
+    }
+  }
+};
+
+/** Returns the time in [ns] to send 'sends' messages in each thread.
+ */
+static int64_t bench(Signal *signal, size_t sends, size_t thread_count) {
+  std::vector<Run*> runs;
+  TimeRef time_ref;
+
+  for (size_t i = 0; i < thread_count; ++i) {
+    Run *run = new Run;
+    run->signal_ = signal;
+    run->sends_  = sends;
+    runs.push_back(run);
+  }
+
+  time_ref.reset();
+  for (size_t i = 0; i < thread_count; ++i) {
+    runs[i]->thread_.start_thread<Run, &Run::send>(runs[i]);
+  }
+
+  for (size_t i = 0; i < thread_count; ++i) {
+    runs[i]->thread_.join();
+    delete runs[i];
+  }
+  return time_ref.elapsed_ns();
+}
+
+int main(int argc, char * argv[]) {
+  size_t sends        = argc > 1 ? atoi(argv[1]) : 1000000;
+  size_t thread_count = argc > 2 ? atoi(argv[2]) : 1;
+  Receiver receivers[MAX_RECEIVERS];
+
+  printf("%lu sends per thread, %lu thread(s)\n", (unsigned long)sends, (unsigned long)thread_count);
+  printf("%9s  %-13s %12s %12s %14s\n", "receivers", "connection", "ns/send", "ns/call", "calls/s");
+
+  for (size_t count = 1; count <= MAX_RECEIVERS; count *= 2) {
+    for (int compile_time = 0; compile_time < 2; ++compile_time) {
+      Signal signal;
+      for (size_t i = 0; i < count; ++i) {
+        if (compile_time) {
+          signal.connect<Receiver, &Receiver::receive>(&receivers[i]);
+        } else {
+          signal.connect(&receivers[i], &Receiver::receive);
+        }
+      }
+
+      int64_t ns = bench(&signal, sends, thread_count);
+      double total_sends = (double)sends * thread_count;
+      double total_calls = total_sends * count;
+      printf("%9lu  %-13s %12.2f %12.2f %14.0f\n",
+        (unsigned long)count,
+        compile_time ? "compile time" : "runtime",
+        ns / total_sends,
+        ns / total_calls,
+        total_calls * 1000000000.0 / ns);
+    }
+  }
+
+  return 0;
+}
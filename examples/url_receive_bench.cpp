@@ -0,0 +1,57 @@
+// compile with
+// g++ -O2 -I../include ../build/liboscit.a url_receive_bench.cpp -o url_receive_bench
+
+/** Measure the per-packet cost of the Url built for every received message
+ * (see OscCommand ProcessMessage) and of the work done with it on the
+ * receive path (path lookup, observer registration). The last line
+ * measures the cost of formatting the url when it is actually printed.
+ *
+ * usage: url_receive_bench [packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>  // atoi
+
+#include "oscit/oscit.h"
+
+using namespace oscit;
+
+#define SENDER_IP ((192ul << 24) + (168ul << 16) + (1ul << 8) + 12ul)
+
+static void report(const char *name, size_t packets, const TimeRef &time_ref, size_t check) {
+  printf("%-26s %10.1f ns/packet   (%lu)\n", name,
+         (double)time_ref.elapsed_us() * 1000.0 / packets, (unsigned long)check);
+}
+
+int main(int argc, char * argv[]) {
+  size_t packets = argc > 1 ? atoi(argv[1]) : 1000000;
+  size_t check = 0;
+  THash<Location, time_t> observers(20);
+
+  { TimeRef time_ref;
+    for (size_t i = 0; i < packets; ++i) {
+      Url url(SENDER_IP, 7000 + (i & 3), "/synth/cutoff");
+      check += url.path().size();
+    }
+    report("Url(ip, port, path)", packets, time_ref, check);
+  }
+
+  { TimeRef time_ref;
+    for (size_t i = 0; i < packets; ++i) {
+      Url url(SENDER_IP, 7000 + (i & 3), "/synth/cutoff");
+      observers.set(url.location(), 10);
+      check += url.is_meta();
+    }
+    report("receive (observers.set)", packets, time_ref, check);
+  }
+
+  { TimeRef time_ref;
+    for (size_t i = 0; i < packets; ++i) {
+      Url url(SENDER_IP, 7000 + (i & 3), "/synth/cutoff");
+      check += url.str().size();
+    }
+    report("Url + str()", packets, time_ref, check);
+  }
+
+  return 0;
+}
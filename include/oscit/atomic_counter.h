@@ -64,6 +64,32 @@ private:
 
 #elif defined(__linux__)
 /* ================================= Linux   ========== */
+class AtomicCounter {
+public:
+  AtomicCounter(int32_t value = 0) : count_(value) {}
+
+  /** Increment the counter by one and return the resulting
+   * value.
+   */
+  inline int32_t increment() {
+    return __sync_add_and_fetch(&count_, 1);
+  }
+
+  /** Decrement the counter by one and return the resulting
+   * value.
+   */
+  inline int32_t decrement() {
+    return __sync_sub_and_fetch(&count_, 1);
+  }
+
+  int32_t count() {
+    return count_;
+  }
+
+private:
+  // gcc 'aligned' attribute
+  __attribute__((__aligned__(4))) volatile int32_t count_;
+};
 
 #elif defined(__win32__)
 /* ================================= Win32   ========== */
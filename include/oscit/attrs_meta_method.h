@@ -29,34 +29,22 @@
 
 #ifndef OSCIT_INCLUDE_OSCIT_TYPE_META_METHOD_H_
 #define OSCIT_INCLUDE_OSCIT_TYPE_META_METHOD_H_
-#include "oscit/root.h"
+#include "oscit/path_meta_method.h"
 
 namespace oscit {
 
-class AttrsMetaMethod : public Object
+class AttrsMetaMethod : public PathMetaMethod
 {
 public:
   /** Class signature. */
-  TYPED("Object.AttrsMetaMethod")
+  TYPED("Object.PathMetaMethod.AttrsMetaMethod")
 
-  AttrsMetaMethod(const char *name)        : Object(name, Oscit::string_io("Return the attributes of the given path.")) {}
-  AttrsMetaMethod(const std::string &name) : Object(name, Oscit::string_io("Return the attributes of the given path.")) {}
+  AttrsMetaMethod(const char *name)        : PathMetaMethod(name, "Return the attributes of the given path (or list of paths).") {}
+  AttrsMetaMethod(const std::string &name) : PathMetaMethod(name, "Return the attributes of the given path (or list of paths).") {}
 
-  virtual const Value trigger(const Value &val) {
-    if (!val.is_string()) return gNilValue;
-
-    Value error;
-    ObjectHandle object;
-    Value reply = val;
-
-    if (root_->find_or_build_object_at(val.c_str(), &error, &object)) {
-      reply.push_back(object->attributes());
-    } else {
-      reply.push_back(error);
-    }
-
-
-    return reply;
+protected:
+  virtual const Value result(Object *object) {
+    return object->attributes();
   }
 };
 
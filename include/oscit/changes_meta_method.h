@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_CHANGES_META_METHOD_H_
+#define OSCIT_INCLUDE_OSCIT_CHANGES_META_METHOD_H_
+#include "oscit/root.h"
+#include "oscit/tree_journal.h"
+
+namespace oscit {
+
+/** Maximal number of changes in a /.changes reply.
+ */
+#define CHANGES_PAGE_SIZE 128
+
+/** Returns the changes in the tree since a given version (see TreeJournal).
+ * Without argument, returns the current version. A mirror keeps the version
+ * reached and asks for the next page until the list of changes is empty:
+ *
+ * <pre>
+ * /.changes            --> "4f2a01c3:42"
+ * /.changes "4f2a01c3:40" --> ["4f2a01c3:42", ["adopt", "/a", {...}, "value", "/b", 3]]
+ * /.changes "4f2a01c3:42" --> ["4f2a01c3:42", []]
+ * /.changes "4f2a01c3:7"  --> ["4f2a01c3:42", nil]   (too old: walk the tree again)
+ * /.changes "9b0e77d2:40" --> ["4f2a01c3:42", nil]   (another tree instance)
+ * </pre>
+ */
+class ChangesMetaMethod : public Object
+{
+public:
+  /** Class signature. */
+  TYPED("Object.ChangesMetaMethod")
+
+  ChangesMetaMethod(const char *name)        : Object(name, Oscit::any_io("Returns the changes since the given tree version")) {}
+  ChangesMetaMethod(const std::string &name) : Object(name, Oscit::any_io("Returns the changes since the given tree version")) {}
+
+  virtual const Value trigger(const Value &val) {
+    TreeJournal &journal = root_->journal();
+    if (val.is_nil()) return journal.version_value(journal.version());
+    if (!val.is_string()) return gNilValue;
+
+    uint64_t since;
+    ListValue changes;
+    uint64_t reached;
+    if (!journal.version_from_value(val, &since) ||
+        !journal.changes_since(since, CHANGES_PAGE_SIZE, &changes, &reached)) {
+      Value reply(journal.version_value(journal.version()));
+      reply.push_back(gNilValue);
+      return reply;
+    }
+
+    Value reply(journal.version_value(reached));
+    reply.push_back(changes);
+    return reply;
+  }
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_CHANGES_META_METHOD_H_
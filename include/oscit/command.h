@@ -36,6 +36,8 @@
 #include "oscit/thread.h"
 #include "oscit/url.h"
 #include "oscit/thash.h"
+#include "oscit/observer_leases.h"
+#include "oscit/remote_call.h"
 
 namespace oscit {
 
@@ -46,6 +48,8 @@ class ZeroConfRegistration;
 class RootProxy;
 class CommandTest;
 class ObjectHandle;
+class ReceiveTask;
+class CommandReplyStream;
 
 /** This class is responsible for listening to any kind of incoming command (implemented by subclasses in do_listen)
  *  and passing these commands to the root object.
@@ -83,6 +87,10 @@ class Command : public Thread {
 
   const std::string &protocol() { return protocol_; }
 
+  /** Interned protocol (see Location::intern_protocol).
+   */
+  uint protocol_id() const { return protocol_id_; }
+
   /** Send a notification to all observers of this command. */
   virtual void notify_observers(const char *path, const Value &val) = 0;
 
@@ -98,6 +106,13 @@ class Command : public Thread {
     send_message(url.location(), url.path().c_str(), val);
   }
 
+  /** Send a value to a remote object without waiting for the reply. The
+   * request carries a correlation id and 'remote_call' completes when the
+   * matching reply or error comes back (or after 'timeout' [ms]).
+   */
+  void call_async(const Url &remote_url, const Value &val, RemoteCall *remote_call,
+                  Real timeout = REMOTE_CALL_TIMEOUT);
+
   /** Returns a pointer to an object that can be used to send values to a remote object.
    *  The receiver should create an alias for the remote_object (do not keep the pointer).
    *  @param remote_url should contain the full url with protocol and domain: osc://video.local/vid/contrast.
@@ -136,10 +151,25 @@ class Command : public Thread {
     return root_proxies_vector_[index];
   }
 
+  /** Leases of the observers of this command (live count, expired and
+   * evicted observers for monitoring, lease duration).
+   */
+  ObserverLeases &observer_leases() {
+    return observer_leases_;
+  }
+
+  /** Calls sent with 'call_async' waiting for a reply.
+   */
+  RemoteCalls &remote_calls() {
+    return remote_calls_;
+  }
+
  protected:
   friend class Root;       // set_root
   friend class RootProxy;  // register_proxy, unregister_proxy
   friend class CommandTest;
+  friend class ReceiveTask;        // send_result
+  friend class CommandReplyStream; // send_result
 
   /** Used by sub-classes when they finally know the port.
    */
@@ -204,23 +234,73 @@ class Command : public Thread {
    */
   uint16_t port_;
 
-  /** Return the list of locations observing through this command.
+  /** Return a copy of the list of locations observing through this command.
    */
-  const std::list<Location> &observers() const {
-    return observers_.keys();
+  std::list<Location> observers() {
+    return observer_leases_.observers();
   }
 
+  /** Fill 'locations' with the observers interested in a notification. Value
+   * notifications (["/path", value] sent to '/.reply') only go to the observers
+   * subscribed to the path, other notifications go to all observers.
+   */
+  void observers_of(const char *path, const Value &val, std::list<Location> *locations);
+
   /** Handle '/.register' messages. This method should be called from within 'receive'.
-   * The method adds a new satellite to the list of observers.
+   * The method adds a new satellite to the list of observers (with optional path
+   * subscriptions). Any other message renews the lease of the sender.
    */
   bool handle_register_message(const Url &url, const Value &val);
 
-  /** Handle '/.reply' messages. This method should be called from within 'receive'.
+  /** Handle '/.reply' and '/.call_reply' messages. This method should be called
+  * from within 'receive'. Call replies (["/path", value, id] sent to
+  * '/.call_reply') complete the matching remote call.
   * @return true if the message was a '/.reply' and it does not need any further processing
   */
   bool handle_reply_message(const Url &url, const Value &val);
 
+  /** Handle '/.error' messages with a correlation id ([code, "message", id]).
+   * This method should be called from within 'receive'.
+   * @return true if the error completed a remote call.
+   */
+  bool handle_error_message(const Url &url, const Value &val);
+
+  /** Handle '/.call' messages ([id, "/path", value]): call the object and
+   * send the result back with the correlation id. This method should be
+   * called from within 'receive'.
+   * @return true if the message was a '/.call'.
+   */
+  bool handle_call_message(const Url &url, const Value &val);
+
+  /** Call the object at url.path() for a received message and send the
+   * result. 'call_id' is the correlation id of a '/.call' (nil otherwise).
+   */
+  void receive_call(const Url &url, const Value &val, const Value &call_id);
+
+  /** Send the result of a call received from 'url'. Errors and results of
+   * meta methods are sent to the caller, other results are notified to all
+   * observers. A call with a correlation id also gets its own reply (sent to
+   * '/.call_reply').
+   */
+  void send_result(const Url &url, const Value &res, const Value &call_id);
+
+  /** Wait for the messages posted to strands (see receive_call). Sub-classes
+   * call this from their destructor once the command is killed so that the
+   * last replies still go through their 'send_message' (~Command waits but
+   * drops the replies).
+   */
+  void wait_for_strand_tasks();
+
  private:
+  void init_strand_tasks();
+
+  /** A message has been posted to a strand (see ReceiveTask).
+   */
+  void strand_task_posted();
+
+  /** Send the result of a message posted to a strand.
+   */
+  void strand_task_done(const Url &url, const Value &res, const Value &call_id);
 
   /** Type of protocol this command is responsible for. For example if
    *  a command has 'http' protocol, then all urls starting with 'http://' will
@@ -228,6 +308,10 @@ class Command : public Thread {
    */
   const std::string protocol_;
 
+  /** Interned protocol_ (compared with Location::protocol_id).
+   */
+  const uint protocol_id_;
+
   /** Service type published by this command.
    *  If this value is empty, no service will be published.
    */
@@ -249,7 +333,27 @@ class Command : public Thread {
 
   /** List of satellites that have registered to get return values.
    */
-  THash<Location, unsigned int> observers_;
+  ObserverLeases observer_leases_;
+
+  /** Calls waiting for a reply (indexed by correlation id).
+   */
+  RemoteCalls remote_calls_;
+
+  /** Protects the count of messages posted to strands.
+   */
+  pthread_mutex_t strand_tasks_mutex_;
+
+  /** Signaled when the last message posted to a strand is done.
+   */
+  pthread_cond_t strand_tasks_cond_;
+
+  /** Messages posted to strands and not done yet.
+   */
+  size_t strand_tasks_;
+
+  /** Set in ~Command: results of strand tasks are no longer sent.
+   */
+  bool strand_replies_closed_;
 };
 
 } // oscit
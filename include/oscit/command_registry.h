@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_COMMAND_REGISTRY_H_
+#define OSCIT_INCLUDE_OSCIT_COMMAND_REGISTRY_H_
+
+#include <string>
+#include <vector>
+
+#include "oscit/location.h"
+#include "oscit/non_copyable.h"
+
+namespace oscit {
+
+class Command;
+
+/** Immutable list of commands. Root builds a new registry when a command is
+ * adopted or unregistered and swaps a pointer. Readers are counted by Root
+ * (see Root::ScopedCommands) and the swap waits for them before deleting the
+ * previous registry or the commands it removed.
+ */
+class CommandRegistry : private NonCopyable {
+public:
+  CommandRegistry() {}
+
+  /** Copy of 'other' with 'added' and without 'removed' (either can be NULL).
+   */
+  CommandRegistry(const CommandRegistry *other, Command *added, Command *removed);
+
+  /** Command handling the location's protocol (NULL if none).
+   */
+  Command *command(const Location &location) const {
+    return command(location.protocol_id());
+  }
+
+  /** Command handling an interned protocol (NULL if none).
+   */
+  Command *command(uint protocol_id) const {
+    // a root has one or two commands: a scan beats any index
+    for (size_t i = 0; i < protocol_ids_.size(); ++i) {
+      if (protocol_ids_[i] == protocol_id) return commands_[i];
+    }
+    return NULL;
+  }
+
+  /** All the commands (in adoption order).
+   */
+  const std::vector<Command*> &commands() const {
+    return commands_;
+  }
+
+private:
+  std::vector<Command*> commands_;
+
+  /** Interned protocol of each command.
+   */
+  std::vector<uint> protocol_ids_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_COMMAND_REGISTRY_H_
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_DELIVERY_QUEUE_H_
+#define OSCIT_INCLUDE_OSCIT_DELIVERY_QUEUE_H_
+
+#include <pthread.h>
+#include <stdint.h>  // int64_t
+
+#include "oscit/conf.h"
+#include "oscit/values.h"
+#include "oscit/non_copyable.h"
+
+namespace oscit {
+
+/** Default number of pending values in an observer's delivery queue.
+ */
+#define DELIVERY_QUEUE_DEFAULT_CAPACITY 256
+
+/** Queue of signal values waiting to be delivered to an observer. Values
+ * are coalesced by connection: if a signal sends a new value before the
+ * previous one was delivered, only the last value is kept.
+ *
+ * Signal::send pushes values and returns immediately. The observer's thread
+ * calls 'drain' to run the callbacks. See Observer::set_async_delivery.
+ */
+class DeliveryQueue : private NonCopyable {
+public:
+  typedef void (*delivery_method_t)(void *data, const Value &val);
+
+  /** Delivery state for one connection (owned by the signal).
+   */
+  struct Slot {
+    Slot(DeliveryQueue *queue, delivery_method_t function, void *data)
+      : queue_(queue), function_(function), data_(data),
+        pending_(false), next_(NULL) {}
+
+    DeliveryQueue *queue_;
+    delivery_method_t function_;
+    void *data_;
+
+    /** Last value sent (valid if pending_ is true).
+     */
+    Value value_;
+    bool pending_;
+    Slot *next_;
+  };
+
+  DeliveryQueue(size_t capacity = DELIVERY_QUEUE_DEFAULT_CAPACITY);
+
+  ~DeliveryQueue();
+
+  /** Deliver all pending values in the current thread. Returns the number
+   * of callbacks executed.
+   */
+  size_t drain();
+
+  /** Block until values are pending or 'timeout' [ms] is elapsed (a
+   * negative timeout waits forever). Returns true if values are pending.
+   */
+  bool wait(Real timeout = -1);
+
+  /** Number of pending values.
+   */
+  size_t depth();
+
+  /** Largest depth seen since creation.
+   */
+  size_t max_depth();
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  /** Number of callbacks executed by 'drain'.
+   */
+  int64_t delivered_count();
+
+  /** Number of values replaced by a newer value from the same signal
+   * before they could be delivered.
+   */
+  int64_t coalesced_count();
+
+  /** Number of values dropped because the queue was full.
+   */
+  int64_t dropped_count();
+
+  /** Return depth and counters in a HashValue.
+   */
+  const Value stats();
+
+  /** Store a value for the slot (called by Signal::send).
+   */
+  void push(Slot *slot, const Value &val);
+
+  /** Remove a slot from the queue. After this call, the slot is not used
+   * by 'drain' anymore. Called by the signal on disconnection.
+   */
+  void detach(Slot *slot);
+
+private:
+  /** Protects the list and counters.
+   */
+  pthread_mutex_t mutex_;
+
+  /** Signaled when a value is pushed.
+   */
+  pthread_cond_t pending_cond_;
+
+  /** Signaled when a callback returns (used by detach).
+   */
+  pthread_cond_t done_cond_;
+
+  /** FIFO of pending slots.
+   */
+  Slot *head_;
+  Slot *tail_;
+
+  size_t capacity_;
+  size_t depth_;
+  size_t max_depth_;
+  int64_t delivered_count_;
+  int64_t coalesced_count_;
+  int64_t dropped_count_;
+
+  /** Slot being delivered by 'drain' (NULL if none).
+   */
+  Slot *running_;
+  pthread_t runner_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_DELIVERY_QUEUE_H_
@@ -40,8 +40,10 @@ namespace oscit {
 typedef uint TypeTagID;
 
 enum ErrorCode {
+  ACCEPTED_ERROR    = 202, // posted, no result
   BAD_REQUEST_ERROR = 400,
   NOT_FOUND_ERROR   = 404,
+  REQUEST_TIMEOUT_ERROR = 408,
   INTERNAL_SERVER_ERROR = 500,
   UNKNOWN_ERROR = 0,
 };
@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_EXECUTOR_H_
+#define OSCIT_INCLUDE_OSCIT_EXECUTOR_H_
+
+#include <pthread.h>
+#include <vector>
+
+#include "oscit/non_copyable.h"
+#include "oscit/thread.h"
+
+namespace oscit {
+
+/** Number of workers in the shared executor (0 = one per processor).
+ */
+#define EXECUTOR_WORKER_COUNT 0
+
+/** Maximal number of tasks run by a worker for a strand before serving
+ * other strands.
+ */
+#define STRAND_BATCH_SIZE 16
+
+class Executor;
+class Strand;
+
+/** Work posted to a Strand. Sub-classes implement 'run'.
+ */
+class StrandTask : private NonCopyable {
+public:
+  StrandTask() : next_(NULL), owned_(false), done_(false), done_cond_(NULL) {}
+
+  virtual ~StrandTask() {}
+
+  virtual void run() = 0;
+
+private:
+  friend class Executor;
+  friend class Strand;
+
+  StrandTask *next_;
+
+  /** Posted task (deleted once it has run).
+   */
+  bool owned_;
+
+  /** Set when a task passed to Strand::run has finished.
+   */
+  bool done_;
+
+  /** Signaled when done_ is set (owned by the thread waiting in Strand::run).
+   */
+  pthread_cond_t *done_cond_;
+};
+
+/** Call a member method from a Strand.
+ */
+template<class T, void(T::*Tmethod)()>
+class TStrandTask : public StrandTask {
+public:
+  TStrandTask(T *owner) : owner_(owner) {}
+
+  virtual void run() {
+    (owner_->*Tmethod)();
+  }
+
+private:
+  T *owner_;
+};
+
+/** Pool of worker threads running the tasks of any number of strands.
+ *
+ * Thread safe.
+ */
+class Executor : private NonCopyable {
+public:
+  /** Start 'worker_count' workers (one per processor if 0).
+   */
+  Executor(size_t worker_count = EXECUTOR_WORKER_COUNT);
+
+  /** All strands must have been deleted before the executor.
+   */
+  ~Executor();
+
+  /** Executor used by strands created without one (created on first use,
+   * never deleted).
+   */
+  static Executor *shared();
+
+  size_t worker_count() const {
+    return workers_.size();
+  }
+
+  /** Returns true if the current thread is a worker (of any executor).
+   */
+  static bool in_worker();
+
+private:
+  friend class Strand;
+
+  /** Hand a strand with pending tasks to the workers. Must be called with
+   * the lock.
+   */
+  void schedule(Strand *strand);
+
+  /** Run the tasks of a strand in the current thread (at most 'max', 0 = no
+   * limit). Must be called with the lock (unlocks while tasks run).
+   */
+  void run_tasks(Strand *strand, size_t max);
+
+  /** Worker thread: run strands from the ready queue.
+   */
+  void run_worker(Thread *runner);
+
+  /** Protects the ready queue and the strands' tasks.
+   */
+  pthread_mutex_t mutex_;
+
+  /** Signaled when strands are ready for the workers.
+   */
+  pthread_cond_t work_cond_;
+
+  /** Strands waiting for a worker (intrusive list).
+   */
+  Strand *ready_head_;
+  Strand *ready_tail_;
+
+  bool should_run_;
+
+  std::vector<Thread*> workers_;
+};
+
+/** Serial queue of tasks: the tasks of a strand never run concurrently and
+ * they run in the order they were posted, but tasks from different strands
+ * run in parallel on the executor's workers. A strand can be bound to an
+ * object subtree (see Object::set_strand) so that independent subtrees do not
+ * wait for each other.
+ *
+ * Thread safe.
+ */
+class Strand : private NonCopyable {
+public:
+  /** Run tasks on 'executor' (the shared executor if NULL).
+   */
+  Strand(Executor *executor = NULL);
+
+  /** Waits for pending tasks.
+   */
+  ~Strand();
+
+  /** Run the task later from a worker. The strand takes ownership of the
+   * task and deletes it once it has run.
+   */
+  void post(StrandTask *task);
+
+  /** Run the task in the strand and wait for it to finish. If the strand is
+   * idle (or if the current thread is already running the strand), the task
+   * runs in the calling thread. Workers never wait: if the strand is busy
+   * and the caller is a worker, the task is not run.
+   * @return false if the task was not run.
+   */
+  bool run(StrandTask *task);
+
+  /** Wait until all posted tasks have run. Must not be called from a task.
+   */
+  void wait();
+
+  /** Returns true if the current thread is running a task of the strand.
+   */
+  bool running_in_this_thread();
+
+  /** Number of tasks waiting to run.
+   */
+  size_t pending();
+
+private:
+  friend class Executor;
+
+  /** Must be called with the executor's lock.
+   */
+  void push(StrandTask *task);
+
+  /** Must be called with the executor's lock.
+   */
+  StrandTask *pop();
+
+  /** The strand has no more tasks: wake up threads in 'wait'. Must be called
+   * with the executor's lock.
+   */
+  void idle();
+
+  Executor *executor_;
+
+  /** Pending tasks (intrusive list).
+   */
+  StrandTask *head_;
+  StrandTask *tail_;
+  size_t pending_;
+
+  /** The strand is in the executor's ready queue or running.
+   */
+  bool active_;
+
+  /** A thread is running the strand's tasks (see runner_).
+   */
+  bool running_;
+  pthread_t runner_;
+
+  /** Threads in 'wait' (idle_cond_ is only signaled if there are some).
+   */
+  size_t waiters_;
+  pthread_cond_t idle_cond_;
+
+  /** Next strand in the executor's ready queue.
+   */
+  Strand *next_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_EXECUTOR_H_
@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_FILE_WATCHER_H_
+#define OSCIT_INCLUDE_OSCIT_FILE_WATCHER_H_
+
+#include <time.h>  // time_t
+
+#include <string>
+
+#include "oscit/conf.h"
+#include "oscit/non_copyable.h"
+#include "oscit/thread.h"
+
+namespace oscit {
+
+/** Delay in [ms] during which successive modifications are merged into a
+ * single notification (editors often write a file in several steps).
+ */
+#define FILE_WATCHER_SETTLE_MS 20
+
+/** First delay in [ms] before waiting again after an error. The delay is
+ * doubled on each consecutive error up to FILE_WATCHER_MAX_RETRY_MS.
+ */
+#define FILE_WATCHER_RETRY_MS 100
+
+/** Longest delay in [ms] between two attempts on persistent errors.
+ */
+#define FILE_WATCHER_MAX_RETRY_MS 10000
+
+/** Watch a file for modifications from a background thread. On linux, the
+ * file's folder is watched with inotify (this also catches editors replacing
+ * the file). On Mac OS X, the file and its folder are watched with kqueue.
+ * Other platforms poll the modification time.
+ *
+ * 'file_changed' is called from the watcher thread.
+ */
+class FileWatcher : private NonCopyable {
+public:
+  FileWatcher();
+
+  /** Sub-classes must call 'stop' in their destructor.
+   */
+  virtual ~FileWatcher();
+
+  /** Start watching a file (stops watching the previous file).
+   * @return false if the file's folder cannot be watched.
+   */
+  bool watch(const std::string &path);
+
+  /** Stop watching. Waits for the end of a running 'file_changed'.
+   */
+  void stop();
+
+  bool is_watching() const {
+    return watching_;
+  }
+
+  const std::string &path() const {
+    return path_;
+  }
+
+  /** Interval in [ms] between two modification time verifications (only
+   * used when neither inotify nor kqueue is available).
+   */
+  void set_poll_interval(Real interval) {
+    poll_interval_ = interval;
+  }
+
+protected:
+  /** Executed from the watcher thread when the file was written, replaced
+   * or created.
+   */
+  virtual void file_changed() = 0;
+
+private:
+  enum WaitResult {
+    WaitStopped,
+    WaitChanged,
+    WaitFailed
+  };
+
+  void run(Thread *thread);
+
+  /** Sleep for 'delay' [ms] unless woken up by 'stop'.
+   */
+  void retry_after(int delay);
+
+  /** Platform specific setup.
+   */
+  bool start_watching();
+
+  /** Platform specific cleanup.
+   */
+  void stop_watching();
+
+  /** Platform specific wait. Returns WaitFailed with errno set if the
+   * change notifications cannot be read.
+   */
+  WaitResult wait_for_change();
+
+  std::string path_;
+  bool watching_;
+  Real poll_interval_;
+
+  /** Used to wake up the watcher thread.
+   */
+  int wake_pipe_[2];
+
+  /** inotify (or kqueue) file descriptor and watch (or watched folder).
+   */
+  int notify_fd_;
+  int watch_id_;
+
+  /** Watched file descriptor (kqueue).
+   */
+  int file_fd_;
+
+  /** Last modification time (polling).
+   */
+  time_t mod_time_;
+
+  Thread thread_;
+};
+
+/** FileWatcher calling a method on an owner.
+ */
+template<class T, void(T::*Tmethod)()>
+class TFileWatcher : public FileWatcher {
+public:
+  TFileWatcher(T *owner) : owner_(owner) {}
+
+  virtual ~TFileWatcher() {
+    stop();
+  }
+
+protected:
+  virtual void file_changed() {
+    (owner_->*Tmethod)();
+  }
+
+private:
+  T *owner_;
+};
+
+}  // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_FILE_WATCHER_H_
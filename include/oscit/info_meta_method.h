@@ -29,33 +29,22 @@
 
 #ifndef OSCIT_INCLUDE_OSCIT_INFO_META_METHOD_H_
 #define OSCIT_INCLUDE_OSCIT_INFO_META_METHOD_H_
-#include "oscit/root.h"
+#include "oscit/path_meta_method.h"
 
 namespace oscit {
 
-class InfoMetaMethod : public Object
+class InfoMetaMethod : public PathMetaMethod
 {
 public:
   /** Class signature. */
-  TYPED("Object.InfoMetaMethod")
+  TYPED("Object.PathMetaMethod.InfoMetaMethod")
 
-  InfoMetaMethod(const char *name)        : Object(name, Oscit::string_io("Return information on the given path.")) {}
-  InfoMetaMethod(const std::string &name) : Object(name, Oscit::string_io("Return information on the given path.")) {}
+  InfoMetaMethod(const char *name)        : PathMetaMethod(name, "Return information on the given path (or list of paths).") {}
+  InfoMetaMethod(const std::string &name) : PathMetaMethod(name, "Return information on the given path (or list of paths).") {}
 
-  virtual const Value trigger(const Value &val) {
-    if (!val.is_string()) return gNilValue;
-
-    Value error;
-    ObjectHandle object;
-    Value reply = val;
-
-    if (root_->find_or_build_object_at(val.c_str(), &error, &object)) {
-      reply.push_back(object->info());
-    } else {
-      reply.push_back(error);
-    }
-
-    return reply;
+protected:
+  virtual const Value result(Object *object) {
+    return object->info();
   }
 };
 
@@ -29,32 +29,22 @@
 
 #ifndef OSCIT_INCLUDE_OSCIT_LIST_META_METHOD_H_
 #define OSCIT_INCLUDE_OSCIT_LIST_META_METHOD_H_
-#include "oscit/root.h"
+#include "oscit/path_meta_method.h"
 
 namespace oscit {
 
-class ListMetaMethod : public Object
+class ListMetaMethod : public PathMetaMethod
 {
 public:
   /** Class signature. */
-  TYPED("Object.ListMetaMethod")
+  TYPED("Object.PathMetaMethod.ListMetaMethod")
 
-  ListMetaMethod(const char *name)        : Object(name, Oscit::string_io("List all children under the given path.")) {}
-  ListMetaMethod(const std::string &name) : Object(name, Oscit::string_io("List all children under the given path.")) {}
+  ListMetaMethod(const char *name)        : PathMetaMethod(name, "List all children under the given path (or list of paths).") {}
+  ListMetaMethod(const std::string &name) : PathMetaMethod(name, "List all children under the given path (or list of paths).") {}
 
-  virtual const Value trigger(const Value &val) {
-    if (!val.is_string()) return gNilValue;
-
-    Value error;
-    ObjectHandle object;
-    Value reply = val;
-
-    if (root_->find_or_build_object_at(val.c_str(), &error, &object)) {
-      reply.push_back(object->list());
-    } else {
-      reply.push_back(error);
-    }
-    return reply;
+protected:
+  virtual const Value result(Object *object) {
+    return object->list();
   }
 };
 
@@ -29,33 +29,45 @@
 
 #ifndef OSCIT_INCLUDE_OSCIT_LIST_WITH_TYPE_META_METHOD_H_
 #define OSCIT_INCLUDE_OSCIT_LIST_WITH_TYPE_META_METHOD_H_
-#include "oscit/root.h"
+#include "oscit/path_meta_method.h"
+#include "oscit/reply_stream.h"
 
 namespace oscit {
 
-class ListWithOscitsMetaMethod : public Object
+/** Number of children (name and attributes) in a streamed /.list_att reply chunk.
+ */
+#define LIST_WITH_ATTRIBUTES_CHUNK_SIZE 16
+
+class ListWithOscitsMetaMethod : public PathMetaMethod
 {
 public:
   /** Class signature. */
-  TYPED("Object.ListWithOscitsMetaMethod")
+  TYPED("Object.PathMetaMethod.ListWithOscitsMetaMethod")
 
-  ListWithOscitsMetaMethod(const char *name)        : Object(name, Oscit::string_io("List all children under the given path with their current value and type.")) {}
-  ListWithOscitsMetaMethod(const std::string &name) : Object(name, Oscit::string_io("List all children under the given path with their current value and type.")) {}
+  ListWithOscitsMetaMethod(const char *name)        : PathMetaMethod(name, "List all children under the given path (or list of paths) with their current value and type.") {}
+  ListWithOscitsMetaMethod(const std::string &name) : PathMetaMethod(name, "List all children under the given path (or list of paths) with their current value and type.") {}
 
-  virtual const Value trigger(const Value &val) {
-    if (!val.is_string()) return gNilValue;
+  /** Send the children of a single path in chunks (lists of paths are batched
+   * queries replied in pages, see PathMetaMethod).
+   */
+  virtual bool trigger_stream(const Value &val, ReplyStream *stream) {
+    if (!val.is_string()) return PathMetaMethod::trigger_stream(val, stream);
 
     Value error;
     ObjectHandle object;
-    Value reply = val;
 
-    if (root_->find_or_build_object_at(val.c_str(), &error, &object)) {
-      reply.push_back(object->list_with_attributes());
-    } else {
-      reply.push_back(error);
-    }
+    // errors are returned by 'trigger'
+    if (!root_->find_or_build_object_at(val.c_str(), &error, &object)) return false;
+
+    stream->begin(val, 2 * LIST_WITH_ATTRIBUTES_CHUNK_SIZE);
+    object->list_with_attributes(stream);
+    stream->close();
+    return true;
+  }
 
-    return reply;
+protected:
+  virtual const Value result(Object *object) {
+    return object->list_with_attributes();
   }
 };
 
@@ -38,6 +38,15 @@ namespace oscit {
 
 #define DEFAULT_PROTOCOL "oscit"
 
+/** Number of distinct protocol names (see Location::intern_protocol).
+ */
+#define LOCATION_MAX_PROTOCOLS 64
+
+/** Name shared by the protocols seen once the table of protocols is full
+ * (no command handles it).
+ */
+#define LOCATION_UNKNOWN_PROTOCOL "?"
+
 class ZeroConfBrowser;
 
 class Location
@@ -52,37 +61,40 @@ public:
   static const unsigned long LOOPBACK = (127<<24) + 1; // 127.0.0.1
   static const uint NO_PORT = 0;
 
-  Location() : reference_by_hostname_(false), ip_(NO_IP), port_(NO_PORT) {}
+  /** Id of the empty protocol (local urls).
+   */
+  static const uint NO_PROTOCOL = 0;
+  /** Id of DEFAULT_PROTOCOL.
+   */
+  static const uint DEFAULT_PROTOCOL_ID = 1;
+
+  Location() : protocol_id_(NO_PROTOCOL), reference_by_hostname_(false), ip_(NO_IP), port_(NO_PORT) {}
   Location(const char *protocol, const char *service_name) :
-                      protocol_(protocol), name_(service_name),
+                      protocol_id_(intern_protocol(protocol)), name_(service_name),
                       reference_by_hostname_(false), ip_(NO_IP), port_(NO_PORT) {}
   Location(const char *protocol, const char *service_name, const char *hostname, uint port) :
-                      protocol_(protocol), name_(service_name),
+                      protocol_id_(intern_protocol(protocol)), name_(service_name),
                       reference_by_hostname_(false), ip_(NO_IP), port_(port){
     ip_ = ip_from_hostname(hostname);
   }
   Location(const char *protocol, const char *hostname, uint port) :
-                      protocol_(protocol), name_(hostname),
+                      protocol_id_(intern_protocol(protocol)), name_(hostname),
                       reference_by_hostname_(true), ip_(NO_IP), port_(port) {}
   Location(const char *protocol, unsigned long ip, uint port) :
-                      protocol_(protocol),
-                      reference_by_hostname_(true), ip_(ip), port_(port) {
-    name_ = name_from_ip(ip_);
-  }
+                      protocol_id_(intern_protocol(protocol)),
+                      reference_by_hostname_(true), ip_(ip), port_(port) {}
   Location(const char *service_name) :
-                      protocol_(DEFAULT_PROTOCOL), name_(service_name),
+                      protocol_id_(DEFAULT_PROTOCOL_ID), name_(service_name),
                       reference_by_hostname_(false), ip_(NO_IP), port_(NO_PORT) {}
   Location(const char *hostname, uint port) :
-                      protocol_(DEFAULT_PROTOCOL), name_(hostname),
+                      protocol_id_(DEFAULT_PROTOCOL_ID), name_(hostname),
                       reference_by_hostname_(true), ip_(NO_IP), port_(port) {}
   Location(unsigned long ip, uint port) :
-                      protocol_(DEFAULT_PROTOCOL),
-                      reference_by_hostname_(true), ip_(ip), port_(port) {
-    name_ = name_from_ip(ip_);
-  }
+                      protocol_id_(DEFAULT_PROTOCOL_ID),
+                      reference_by_hostname_(true), ip_(ip), port_(port) {}
 
   void clear() {
-    protocol_ = "";
+    protocol_id_ = NO_PROTOCOL;
     name_ = "";
     reference_by_hostname_ = false;
     ip_   = NO_IP;
@@ -94,19 +106,31 @@ public:
   }
 
   bool operator==(const Location &other) const {
-    return protocol_ == other.protocol_ &&
-           (
-             (ip_ != Location::NO_IP && ip_ == other.ip_ && port_ == other.port_) ||
-             (reference_by_hostname_ == other.reference_by_hostname_ && name_ == other.name_)
-           );
+    if (protocol_id_ != other.protocol_id_) return false;
+    if (ip_ != Location::NO_IP && ip_ == other.ip_ && port_ == other.port_) return true;
+    if (reference_by_hostname_ != other.reference_by_hostname_) return false;
+    if (is_named_from_ip() && other.is_named_from_ip()) {
+      // same names without building them
+      return ip_ == other.ip_;
+    }
+    return name() == other.name();
   }
 
-  const std::string &name() const {
-    return name_;
+  /** Hostname or service name. The dotted ip of locations built from an ip
+   * is formatted on each call (received messages never need it).
+   */
+  const std::string name() const {
+    return is_named_from_ip() ? name_from_ip(ip_) : name_;
   }
 
   const std::string &protocol() const {
-    return protocol_;
+    return protocol_name(protocol_id_);
+  }
+
+  /** Interned protocol (see intern_protocol).
+   */
+  uint protocol_id() const {
+    return protocol_id_;
   }
 
   const unsigned long &ip() const {
@@ -125,23 +149,53 @@ public:
    */
   const std::string inspect() const;
 
+  /** Append the location as written in urls ("oscit://10.0.0.5:7000") to
+   * 'str'.
+   */
+  void append_to(std::string *str) const;
+
   void resolve_with(const ZeroConfBrowser *browser);
 
+  /** Return the id of a protocol name. The same name always gets the same
+   * id so that protocols are compared without comparing strings. Ids are
+   * never released: once LOCATION_MAX_PROTOCOLS names are known, new names
+   * share the id of LOCATION_UNKNOWN_PROTOCOL.
+   * Thread safe (lock free).
+   */
+  static uint intern_protocol(const char *protocol);
+
+  static uint intern_protocol(const std::string &protocol) {
+    return intern_protocol(protocol.c_str());
+  }
+
+  /** Name of an interned protocol.
+   */
+  static const std::string &protocol_name(uint protocol_id);
+
   static unsigned long ip_from_hostname(const char *hostname);
   static const std::string name_from_ip(unsigned long ip);
 
 private:
   friend std::ostream &operator<<(std::ostream &out_stream, const Location &location);
+
+  /** Locations built from an ip keep name_ empty.
+   */
+  bool is_named_from_ip() const {
+    return reference_by_hostname_ && name_.empty();
+  }
+
   friend class Url;
   friend uint hashId(const Location &location);
 
 
-  /** Protocol used (oscit, http, ...)
+  /** Protocol used (oscit, http, ...) as an interned id (see
+   *  intern_protocol).
    */
-  std::string protocol_;
+  uint protocol_id_;
 
   /** This can contain either a hostname (example.com) or a service
-   *  name ("stage camera").
+   *  name ("stage camera"). Empty for locations built from an ip (see
+   *  name).
    */
   std::string name_;
 
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_MAP_CURVE_H_
+#define OSCIT_INCLUDE_OSCIT_MAP_CURVE_H_
+
+#include <string>
+#include <vector>
+
+#include "oscit/conf.h"
+
+namespace oscit {
+
+/** Number of segments in the lookup tables used to evaluate expensive
+ * curves (exp, log, pow) and inverted tables.
+ */
+#define MAP_CURVE_LUT_SIZE 1024
+
+/** Maximal interpolation error (on the normalized [0,1] range) accepted for
+ * a lookup table. Curves that are too steep are evaluated directly.
+ */
+#define MAP_CURVE_LUT_TOLERANCE 0.00001
+
+/** Nonlinear scaling between a source and a target range. The source value
+ * is normalized to [0,1], shaped by the curve and then scaled to the target
+ * range:
+ *
+ * <pre>
+ * exp       geometric target range (frequency): t_min * (t_max/t_min)^x
+ * exp(k)    (e^(k x) - 1) / (e^k - 1)
+ * log       geometric source range, inverse of 'exp'
+ * log(k)    log(1 + x (e^k - 1)) / k, inverse of 'exp(k)'
+ * pow(k)    x^k
+ * table(y0, y1, ..., yn)  piecewise linear, yi in [0,1] are equally spaced
+ * </pre>
+ *
+ * Curves are compiled into a lookup table with linear interpolation when the
+ * interpolation error is small enough so that scaling costs the same for most
+ * shapes. The inverse curve is used for reverse mapping.
+ */
+class MapCurve {
+ public:
+  enum Type {
+    Linear,
+    Exp,
+    Log,
+    Pow,
+    Table
+  };
+
+  MapCurve() : type_(Linear), param_(0), exp_param_(0), source_min_(0), source_range_(1),
+               target_min_(0), target_range_(1) {}
+
+  /** Compile a curve from its definition ("exp", "pow(2)", "table(0,0.2,1)").
+   * @return false and set 'error' if the definition is invalid.
+   */
+  static bool parse(const std::string &definition, Real source_min, Real source_max,
+                    Real target_min, Real target_max, MapCurve *curve, std::string *error);
+
+  Type type() const {
+    return type_;
+  }
+
+  bool is_linear() const {
+    return type_ == Linear;
+  }
+
+  /** Curve parameter (k for exp, log and pow).
+   */
+  Real param() const {
+    return param_;
+  }
+
+  /** Scale and clamp a source value.
+   */
+  Real scale(Real source_value) const {
+    Real x = (source_value - source_min_) / source_range_;
+    return target_min_ + (lut_.empty() ? shape(x) : interpolate(lut_, x)) * target_range_;
+  }
+
+  /** Returns true if the curve is evaluated with a lookup table.
+   */
+  bool uses_lut() const {
+    return !lut_.empty();
+  }
+
+  /** Scale and clamp 'count' contiguous values ('source' and 'target' can be
+   * the same array).
+   */
+  void scale(const Real *source, Real *target, size_t count) const;
+
+  /** Curve going from the target range back to the source range.
+   */
+  MapCurve inverse() const;
+
+ private:
+  /** Evaluate the normalized shape with linear interpolation in 'lut'.
+   */
+  static Real interpolate(const std::vector<Real> &lut, Real x) {
+    if (x <= 0) return lut.front();
+    size_t segments = lut.size() - 1;
+    if (x >= 1) return lut[segments];
+    Real pos = x * segments;
+    size_t i = (size_t)pos;
+    Real frac = pos - i;
+    return lut[i] + frac * (lut[i + 1] - lut[i]);
+  }
+
+  /** Evaluate the normalized shape directly (clamped).
+   */
+  Real shape(Real x) const;
+
+  /** Set ranges and build the lookup table if it is precise enough.
+   */
+  void compile(Type type, Real param, Real source_min, Real source_max,
+               Real target_min, Real target_max);
+
+  /** Invert a monotonic table.
+   */
+  static void invert(const std::vector<Real> &table, std::vector<Real> *inverse);
+
+  Type type_;
+  Real param_;
+
+  /** e^param - 1 (exp and log curves).
+   */
+  Real exp_param_;
+  Real source_min_;
+  Real source_range_;
+  Real target_min_;
+  Real target_range_;
+
+  /** Normalized shape sampled on [0,1] (empty if the shape is computed).
+   */
+  std::vector<Real> lut_;
+
+  /** Normalized inverse shape for tables.
+   */
+  std::vector<Real> inverse_lut_;
+};
+
+}  // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_MAP_CURVE_H_
@@ -30,17 +30,78 @@
 #ifndef OSCIT_INCLUDE_OSCIT_MAPPER_H_
 #define OSCIT_INCLUDE_OSCIT_MAPPER_H_
 
+#include "oscit/map_curve.h"
 #include "oscit/scale_real.h"
 #include "oscit/thash.h"
+#include "oscit/values.h"
+
+#include <vector>
 
 namespace oscit {
 
+/** Maximal number of captures in a pattern.
+ */
+#define MAPPER_MAX_CAPTURES 8
+
 /** The Mapper class helps transform some input data
  * into something else based on strings for mapping and
  * on Real numbers for scaling.
+ *
+ * A source url can select elements in list values (multi-value messages
+ * from fader banks, XY pads, etc):
+ *
+ * <pre>
+ * /pad[0]      [0,1] --> /synth/cutoff [20,2000]
+ * /pad[1]      [0,1] --> /synth/res    [0,1]
+ * /bank[0..15] [0,1] --> /mixer/gains  [0,127]
+ * </pre>
+ *
+ * A single selected element is sent as a Real, a range as a list. Without
+ * selector, the mapping applies to all the values received.
+ *
+ * Numeric url segments can be captured and used in the target url. Exact
+ * urls are always looked up first, patterns are only tried on a miss (most
+ * specific folder first):
+ *
+ * <pre>
+ * /ctrl/{n}        [0,127] --> /synth/voice{n}/gain [0,1]
+ * /mix/{bus}/{ch}  [0,1]   --> /mixer/{bus}/{ch}/level [-60,0]
+ * </pre>
+ *
+ * A curve can follow the target range for perceptual controls (see MapCurve).
+ * The reverse mapping uses the inverse curve:
+ *
+ * <pre>
+ * /knob  [0,1] --> /synth/freq [20,20000] exp
+ * /fader [0,1] --> /mixer/gain [0,1]      pow(3)
+ * /slide [0,1] --> /fx/mix     [0,100]    table(0, 0.1, 0.3, 1)
+ * </pre>
  */
 class Mapper {
 public:
+  /** Result of a mapping. The url is owned by the mapper (valid until the
+   * next call to 'parse').
+   */
+  struct Target {
+    Target() : url_(NULL) {}
+
+    /** Target url (owned by the mapper or built from a pattern).
+     */
+    const std::string &url() const {
+      return url_ ? *url_ : expanded_url_;
+    }
+
+    /** Url owned by the mapper (NULL if the url was built from a pattern).
+     */
+    const std::string *url_;
+
+    /** Url built from a pattern.
+     */
+    std::string expanded_url_;
+
+    Value value_;
+  };
+
   Mapper();
 
   Mapper(size_t hash_table_size);
@@ -54,38 +115,230 @@ public:
   }
 
   /** Find a mapping for the given source.
-   * If the mapping is found, scale value.
+   * If the mapping is found, scale value. A url built from a pattern is valid
+   * until the next call.
    * @return false if no mapping is found.
    */
-  bool map(const std::string &source, Real value, std::string *target, Real *target_value);
+  bool map(const std::string &source, Real value, const std::string **target, Real *target_value) {
+    return map(source, value, target, &expanded_url_, target_value);
+  }
+
+  /** Same as above but copies the target url.
+   */
+  bool map(const std::string &source, Real value, std::string *target, Real *target_value) {
+    const std::string *url;
+    if (!map(source, value, &url, target, target_value)) return false;
+    if (url != target) *target = *url;
+    return true;
+  }
+
+  /** Map a real or a list of reals with all the rules defined for the
+   * source. Matching targets are appended to 'targets'.
+   * @return number of targets found.
+   */
+  size_t map(const std::string &source, const Value &values, std::vector<Target> *targets);
 
   /** Find a reverse mapping for the given target (find source from target).
-   * If the mapping is found, reverse scale value.
+   * If the mapping is found, reverse scale value. A url built from a pattern
+   * is valid until the next call.
    * @return false if no mapping is found.
    */
-  bool reverse_map(const std::string &source, Real value, std::string *target, Real *target_value);
+  bool reverse_map(const std::string &source, Real value, const std::string **target, Real *target_value) {
+    return reverse_map(source, value, target, &reverse_expanded_url_, target_value);
+  }
+
+  /** Same as above but copies the target url (can be used concurrently with
+   * other calls to this method).
+   */
+  bool reverse_map(const std::string &source, Real value, std::string *target, Real *target_value) {
+    const std::string *url;
+    if (!reverse_map(source, value, &url, target, target_value)) return false;
+    if (url != target) *target = *url;
+    return true;
+  }
+
+  /** Number of pattern rules.
+   */
+  size_t pattern_count() const {
+    return patterns_.rules_.size();
+  }
 
 private:
   struct MapElement : public ScaleReal {
 
-    MapElement(const std::string &target_url, Real source_min, Real source_max, Real target_min, Real target_max) :
-                ScaleReal(source_min, source_max, target_min, target_max), target_url_(target_url) {}
+    MapElement(const std::string &target_url, Real source_min, Real source_max, Real target_min, Real target_max,
+               size_t first = 0, size_t count = 0, const MapCurve &curve = MapCurve()) :
+                ScaleReal(source_min, source_max, target_min, target_max), target_url_(target_url),
+                first_(first), count_(count), curve_(curve) {}
+
+    Real scale(Real source_value) const {
+      return curve_.is_linear() ? ScaleReal::scale(source_value) : curve_.scale(source_value);
+    }
+
+    void scale(const Real *source, Real *target, size_t count) const {
+      if (curve_.is_linear()) {
+        ScaleReal::scale(source, target, count);
+      } else {
+        curve_.scale(source, target, count);
+      }
+    }
 
     const std::string &target_url() const {
       return target_url_;
     }
 
+    /** Returns true if the element maps all values (no selector).
+     */
+    bool all() const {
+      return count_ == 0;
+    }
+
   private:
+    friend class Mapper;
     std::string target_url_;
+
+    /** First selected element.
+     */
+    size_t first_;
+
+    /** Number of selected elements (0 = all).
+     */
+    size_t count_;
+
+    /** Nonlinear scaling (linear by default).
+     */
+    MapCurve curve_;
+  };
+
+  /** All the rules for a given source url.
+   */
+  typedef std::vector<MapElement> MapElements;
+
+  /** Url with numeric captures ("/ctrl/{n}" or "/synth/voice{n}/gain").
+   */
+  struct UrlPattern {
+    /** Parse a url. Returns false if the captures are invalid.
+     */
+    bool parse(const std::string &url);
+
+    bool is_pattern() const {
+      return !names_.empty();
+    }
+
+    /** Index key made of the folder before the first capture and the text
+     * after the last capture ("/ctrl/\n/gain" for "/ctrl/{n}/gain").
+     */
+    std::string key() const {
+      size_t pos = literals_[0].rfind('/');
+      std::string key(pos == std::string::npos ? std::string("") : literals_[0].substr(0, pos + 1));
+      return key.append("\n").append(literals_.back());
+    }
+
+    /** Match the url and store captures as (position, length) pairs.
+     */
+    bool match(const std::string &url, size_t *captures) const;
+
+    /** Build a url with the values captured in 'url'. 'indices' gives the
+     * capture used for each of our captures.
+     */
+    void expand(const std::string &url, const size_t *captures, const std::vector<size_t> &indices,
+                std::string *result) const;
+
+    /** Literal parts (one more than the number of captures).
+     */
+    std::vector<std::string> literals_;
+
+    /** Capture names.
+     */
+    std::vector<std::string> names_;
+  };
+
+  struct PatternRule {
+    PatternRule(const std::string &source, const UrlPattern &source_pattern, const UrlPattern &target_pattern,
+                const std::vector<size_t> &indices, const MapElement &element) :
+                source_(source), source_pattern_(source_pattern), target_pattern_(target_pattern),
+                indices_(indices), element_(element) {}
+
+    /** Source pattern as written (without selector).
+     */
+    std::string source_;
+    UrlPattern source_pattern_;
+    UrlPattern target_pattern_;
+
+    /** Source capture used for each target capture.
+     */
+    std::vector<size_t> indices_;
+    MapElement element_;
+  };
+
+  /** Pattern rules indexed by folder and end of url.
+   */
+  struct PatternRules {
+    PatternRules(size_t hash_table_size);
+
+    /** Add a rule or replace a redefined rule.
+     */
+    void add(const PatternRule &rule);
+
+    void clear() {
+      rules_.clear();
+      index_.clear();
+    }
+
+    /** Find the rules matching 'url' in the most specific folder (and longest
+     * end). Fills 'matches' with rule positions and 'captures' with
+     * MAPPER_MAX_CAPTURES pairs per match.
+     * @return number of matching rules (at most 'max').
+     */
+    size_t find(const std::string &url, size_t *matches, size_t *captures, size_t max) const;
+
+    std::vector<PatternRule> rules_;
+    THash<std::string, std::vector<size_t> > index_;
   };
 
   void clear();
 
+  bool map(const std::string &source, Real value, const std::string **target, std::string *buffer,
+           Real *target_value);
+
+  bool reverse_map(const std::string &source, Real value, const std::string **target, std::string *buffer,
+                   Real *target_value);
+
+  /** Scale the values selected by the element into 'output' and append a
+   * target to 'targets'.
+   * @return false if the element does not select any value.
+   */
+  bool push_target(const MapElement &element, const Real *input, Real *output, size_t size,
+                   bool is_real, std::vector<Target> *targets);
+
+  bool set_pattern_map(const std::string &source, const UrlPattern &source_pattern,
+                       const std::string &target_url, const UrlPattern &target_pattern,
+                       const MapElement &element, const MapElement &reverse_element);
+
+  /** Define a mapping. 'curve_definition' is the curve following the target
+   * range ("exp", "pow(3)", ...) or an empty string for a linear map.
+   */
   bool set_map(const std::string &source_url, Real source_min, Real source_max,
-               const std::string &target_url, Real target_min, Real target_max);
+               const std::string &target_url, Real target_min, Real target_max,
+               const std::string &curve_definition = "");
+
+  /** Parse an element selector ("/bank[2]" or "/bank[0..15]") at the end of
+   * the url. Removes the selector from the url.
+   * @return false if the selector is invalid.
+   */
+  bool parse_selector(std::string *url, size_t *first, size_t *count);
 
-  THash<std::string, MapElement> map_;
+  THash<std::string, MapElements> map_;
   THash<std::string, MapElement> reverse_map_;
+
+  PatternRules patterns_;
+  PatternRules reverse_patterns_;
+
+  /** Urls built from patterns (see 'map' and 'reverse_map').
+   */
+  std::string expanded_url_;
+  std::string reverse_expanded_url_;
+
   std::string error_;
 };
 
@@ -30,11 +30,14 @@
 #ifndef OSCIT_INCLUDE_OSCIT_MIDI_MESSAGE_H_
 #define OSCIT_INCLUDE_OSCIT_MIDI_MESSAGE_H_
 
+#include <string.h> // memcpy, memcmp
+#include <time.h>   // time_t
+
 #include <vector>
 #include <iostream>
 #include <sstream>
 
-#include "oscit/reference_counted.h"
+#include "oscit/slab_allocator.h"
 
 namespace oscit {
 
@@ -46,6 +49,19 @@ typedef unsigned int uint;
 
 #define MIDI_NOTE_C0 24
 
+/** Number of bytes stored without allocation (SysEx messages are
+ * stored on the heap).
+ */
+#define MIDI_MESSAGE_INLINE_SIZE 4
+
+/** Value of size_ when the data is on the heap.
+ */
+#define MIDI_MESSAGE_LONG 0xff
+
+/** Maximal note length in milliseconds (about 4h30).
+ */
+#define MIDI_MESSAGE_MAX_LENGTH 0xffffff
+
 /** Midi messages types. */
 enum MidiMessageType {   /*   event name        data1               data2              */
   NoteOff        = 0x80, /**< Note Off        | note number       | velocity           */
@@ -63,28 +79,64 @@ enum MidiMessageType {   /*   event name        data1               data2
   RawMidi        = 0xff,    /**< Other midi message. */
 };
 
-/** This class encapsulates midi messages. */
-class MidiMessage : public ReferenceCounted {
+/** This class encapsulates midi messages. Messages of up to
+ * MIDI_MESSAGE_INLINE_SIZE bytes are stored inline so that creating or
+ * copying a channel message does not allocate (16 bytes on 64 bit
+ * systems). Longer messages (SysEx) are copied on the heap.
+ * The message type is read from the status byte.
+ */
+class MidiMessage {
  public:
-  MidiMessage() : type_(RawMidi), wait_(0), length_(0), data_(3) {
+  MidiMessage() : wait_(0), length_(0), size_(0) {
+    resize(3);
     set_as_note(60);
   }
 
-  explicit MidiMessage(unsigned int data_size) : type_(RawMidi), wait_(0), length_(0), data_(data_size) {}
+  explicit MidiMessage(unsigned int data_size) : wait_(0), length_(0), size_(0) {
+    memset(resize(data_size), 0, data_size);
+  }
 
   explicit MidiMessage(const Value &message, time_t wait = 0);
 
-  explicit MidiMessage(char data1, char data2, char data3, float length = 0) : type_(RawMidi), wait_(0), length_(0), data_(3) {
-    std::vector<unsigned char> message(3);
-    message[0] = data1;
-    message[1] = data2;
-    message[2] = data3;
-    data_   = message;
-    length_ = length;
-    set_type_from_data();
+  explicit MidiMessage(char data1, char data2, char data3, float length = 0) : wait_(0), length_(0), size_(0) {
+    unsigned char *data = resize(3);
+    data[0] = data1;
+    data[1] = data2;
+    data[2] = data3;
+    set_length(length);
+  }
+
+  MidiMessage(const MidiMessage &other) : size_(0) {
+    *this = other;
   }
 
-  virtual ~MidiMessage () {}
+  ~MidiMessage() {
+    resize(0);
+  }
+
+  /** Values keep SysEx messages on the heap: allocate them from the
+   * shared slabs (see SlabAllocator).
+   */
+  static void *operator new(size_t size) {
+    return SlabAllocator::allocate(size);
+  }
+
+  static void operator delete(void *ptr, size_t size) {
+    SlabAllocator::deallocate(ptr, size);
+  }
+
+  MidiMessage &operator=(const MidiMessage &other) {
+    if (&other == this) return *this;
+    if (other.size_ == MIDI_MESSAGE_LONG || size_ == MIDI_MESSAGE_LONG) {
+      memcpy(resize(other.size()), other.data(), other.size());
+    } else {
+      memcpy(bytes_, other.bytes_, MIDI_MESSAGE_INLINE_SIZE);
+      size_ = other.size_;
+    }
+    wait_   = other.wait_;
+    length_ = other.length_;
+    return *this;
+  }
 
   /** Set message from raw midi data. Return false if message could not be set.
    */
@@ -95,10 +147,24 @@ class MidiMessage : public ReferenceCounted {
   bool set(std::vector<unsigned char> &message, time_t wait = 0) {
     if (message.size() == 0) return false;  // no message
 
-    data_ = message;
-    wait_ = wait;
+    return set(&message[0], message.size(), wait);
+  }
+
+  /** Set message from raw midi data (only allocates for messages longer
+   * than MIDI_MESSAGE_INLINE_SIZE).
+   */
+  bool set(const unsigned char *message, size_t size, time_t wait = 0) {
+    if (size == 0) return false;  // no message
+
+    if (is_long() && message >= data() && message < data() + this->size()) {
+      // 'message' points into our heap block, which resize may free.
+      std::vector<unsigned char> copy(message, message + size);
+      return set(&copy[0], size, wait);
+    }
 
-    return set_type_from_data();
+    memmove(resize(size), message, size);
+    wait_ = wait;
+    return true;
   }
 
   /** Create a new midi note on message.
@@ -117,7 +183,6 @@ class MidiMessage : public ReferenceCounted {
   }
 
   /** Set a midi message to NoteOn or NoteOff.
-   * @todo optimize object creation with a pool ?
    * @param note the midi note number from 0-127.
    * @param velocity the note velocity from 0-127 (0 = NoteOff).
    * @param length the note length in milliseconds.
@@ -126,13 +191,9 @@ class MidiMessage : public ReferenceCounted {
    * @return new NoteOn MidiMessage.
    */
   void set_as_note(int note, int velocity = 80, int length = 500, int channel = 1, time_t wait = 0) {
-    if (velocity != 0) {
-      type_ = NoteOn;
-    } else {
-      type_ = NoteOff;
-    }
+    resize(3);
+    set_status(velocity != 0 ? NoteOn : NoteOff, channel);
     set_key(note);
-    set_channel(channel);
     set_value(velocity);
     set_length(length);
     wait_   = wait;
@@ -140,27 +201,26 @@ class MidiMessage : public ReferenceCounted {
 
   void set_as_ctrl (int ctrl, int ctrl_value,
     unsigned int channel = 1, time_t wait = 0) {
-    type_ = CtrlChange;
+    resize(3);
+    set_status(CtrlChange, channel);
     set_key(ctrl);
-    set_channel(channel);
     set_value(ctrl_value);
+    length_ = 0;
     wait_   = wait;
   }
 
   inline void note_on_to_off() {
-    if (type_ == NoteOn) {
-      data_[0] -= 0x10;
-      type_   = NoteOff;
+    if (type() == NoteOn) {
+      mutable_data()[0] -= 0x10;
     }
   }
 
   void set_type(MidiMessageType type) {
     if (type > 0xf0) {
-      data_[0] = (int)type;
+      mutable_data()[0] = (int)type;
     } else {
-      data_[0] = (int)type + channel() - 1;
+      set_status(type, this->type() > 0xf0 ? 1 : channel());
     }
-    type_ = type;
   }
 
   inline void set_note(int note) {
@@ -182,25 +242,14 @@ class MidiMessage : public ReferenceCounted {
   }
 
   inline void set_key(int note)  {
-    if (note > 127) {
-      data_[1] = 127;
-    } else if (note < 0) {
-      data_[1] = 0;
-    } else {
-      data_[1] = note;
-    }
+    mutable_data()[1] = clamp(note);
   }
 
   inline void set_channel(int channel) {
-    if (type_ > 0xf0) {
-      std::cerr << "Cannot set channel for type " << type_ << "\n";
+    if (type() > 0xf0) {
+      std::cerr << "Cannot set channel for type " << type() << "\n";
     } else {
-      if (channel > 16) {
-        channel = 16;
-      } else if (channel < 1) {
-        channel = 1;
-      }
-      data_[0] = type_ + channel - 1;
+      set_status(type(), channel);
     }
   }
 
@@ -208,56 +257,82 @@ class MidiMessage : public ReferenceCounted {
     set_value(velocity);
   }
 
-  inline void set_length(int length) {
+  inline void set_length(time_t length) {
     if (length < 0) {
       length_ = 0;
+    } else if (length > MIDI_MESSAGE_MAX_LENGTH) {
+      length_ = MIDI_MESSAGE_MAX_LENGTH;
     } else {
       length_ = length;
     }
   }
 
   inline void set_value(int value) {
-    if (value > 127) {
-      data_[2] = 127;
-    } else if (value < 0) {
-      data_[2] = 0;
+    mutable_data()[2] = clamp(value);
+  }
+
+  /** Message type (read from the status byte).
+   */
+  inline int type() const {
+    unsigned char status = size_ ? data()[0] : 0;
+    if (status < 0x80) {
+      return RawMidi;
+    } else if (status < 0xf0) {
+      return status & 0xf0;
     } else {
-      data_[2] = value;
+      return status;
     }
   }
 
-  inline int type() const { return type_; }
-
-  inline unsigned int note() const { return data_[1]; }
+  inline unsigned int note() const { return data()[1]; }
 
-  inline unsigned int ctrl() const { return data_[1]; }
+  inline unsigned int ctrl() const { return data()[1]; }
 
-  inline unsigned int value() const { return data_[2]; }
+  inline unsigned int value() const { return data()[2]; }
 
   inline unsigned int channel() const {
-    if (type_ > 0xf0) {
-      std::cerr << "Cannot get channel for type " << type_ << "\n";
+    if (type() > 0xf0) {
+      std::cerr << "Cannot get channel for type " << type() << "\n";
       return 0;
     }
 
-    return data_[0] - type_ + 1;
+    return data()[0] - type() + 1;
   }
 
-  inline unsigned int velocity() const { return data_[2]; }
+  inline unsigned int velocity() const { return data()[2]; }
 
   inline time_t length() const { return length_; }
 
   inline time_t wait() const { return wait_; }
 
-  inline const std::vector<unsigned char> &data() const { return data_; }
+  /** Raw midi data (see size).
+   */
+  inline const unsigned char *data() const {
+    return size_ == MIDI_MESSAGE_LONG ? long_data_ + sizeof(size_t) : bytes_;
+  }
+
+  /** Number of bytes in the raw midi data.
+   */
+  inline size_t size() const {
+    if (size_ != MIDI_MESSAGE_LONG) return size_;
+    size_t size;
+    memcpy(&size, long_data_, sizeof(size_t));
+    return size;
+  }
+
+  /** Returns true if the data is stored on the heap.
+   */
+  inline bool is_long() const {
+    return size_ == MIDI_MESSAGE_LONG;
+  }
 
   /** Write the note name (as C2#, D-1, E3) into the buffer. The buffer must be min 5 chars large (C-3#\0). */
   inline void get_note_name(char buffer[]) const {
     unsigned int i = 0;
-    int octave = (data_[1] - MIDI_NOTE_C0) / 12;
-    int note   = data_[1] % 12;
+    int octave = (data()[1] - MIDI_NOTE_C0) / 12;
+    int note   = data()[1] % 12;
 
-    if (type_ != NoteOn && type_ != NoteOff) {
+    if (type() != NoteOn && type() != NoteOff) {
       buffer[0] = '?';
       buffer[1] = '?';
       buffer[2] = '\0';
@@ -320,7 +395,7 @@ class MidiMessage : public ReferenceCounted {
 
   /** Return midi message type as a const char. */
   const char * type_name() const {
-    switch (type_)
+    switch (type())
     {
       case NoteOn:
         return "NoteOn";
@@ -342,12 +417,10 @@ class MidiMessage : public ReferenceCounted {
   }
 
   bool operator==(const MidiMessage &other) const {
-    return type_    == other.type_ &&
-           wait_    == other.wait_ &&
+    return wait_    == other.wait_ &&
            length_  == other.length_ &&
-           data_[0] == other.data_[0] &&
-           data_[1] == other.data_[1] &&
-           data_[2] == other.data_[2];
+           size()   == other.size() &&
+           memcmp(data(), other.data(), size()) == 0;
   }
 
   std::string to_s() const {
@@ -360,48 +433,97 @@ class MidiMessage : public ReferenceCounted {
     std::ostringstream oss;
     oss << "{\"=m\":[";
 
-    size_t sz = data_.size();
+    const unsigned char *bytes = data();
+    size_t sz = size();
     for(size_t i = 0; i < sz; ++i) {
       if (i != 0) oss << ", ";
-      oss << (int)data_[i];
+      oss << (int)bytes[i];
     }
 
-    oss << ", " << length_;
+    oss << ", " << length();
     oss << "]" << "}";
 
     return oss.str();
   }
 
  private:
+  friend class Value;
   friend std::ostream &operator<<(std::ostream &out_stream,
     const MidiMessage &midi_message);
 
-  /** Set message type from raw data.
+  /** Used by Value to rebuild an inline message.
+   */
+  MidiMessage(const unsigned char bytes[], unsigned int size, int wait, unsigned int length)
+      : wait_(wait), length_(length), size_(size) {
+    memcpy(bytes_, bytes, MIDI_MESSAGE_INLINE_SIZE);
+  }
+
+  inline unsigned char *mutable_data() {
+    return size_ == MIDI_MESSAGE_LONG ? long_data_ + sizeof(size_t) : bytes_;
+  }
+
+  /** Set the number of bytes and return a pointer to the data. The content
+   * is kept if the storage does not change.
    */
-  bool set_type_from_data() {
-    if (data_[0] < 0xf0) {
-      type_ = data_[0] & 0xf0;
+  unsigned char *resize(size_t size) {
+    if (size_ == MIDI_MESSAGE_LONG) {
+      if (size == this->size()) return long_data_ + sizeof(size_t);
+      delete[] long_data_;
+      size_ = 0;
+      memset(bytes_, 0, MIDI_MESSAGE_INLINE_SIZE);
+    }
+
+    if (size <= MIDI_MESSAGE_INLINE_SIZE) {
+      size_ = size;
+      return bytes_;
+    }
+
+    long_data_ = new unsigned char[sizeof(size_t) + size];
+    memcpy(long_data_, &size, sizeof(size_t));
+    size_ = MIDI_MESSAGE_LONG;
+    return long_data_ + sizeof(size_t);
+  }
+
+  void set_status(int type, int channel) {
+    if (channel > 16) {
+      channel = 16;
+    } else if (channel < 1) {
+      channel = 1;
+    }
+    mutable_data()[0] = type + channel - 1;
+  }
+
+  static unsigned char clamp(int value) {
+    if (value > 127) {
+      return 127;
+    } else if (value < 0) {
+      return 0;
     } else {
-      type_ = data_[0];
+      return value;
     }
-    return true;
   }
 
-  /** Type of midi messate (NoteOn, NoteOff, etc).
-   */
-  int type_;
+  union {
+    /** Raw midi message when it fits inline.
+     */
+    unsigned char bytes_[MIDI_MESSAGE_INLINE_SIZE];
+
+    /** Size (size_t) followed by the raw midi message for long messages.
+     */
+    unsigned char *long_data_;
+  };
 
-  /** Number of milliseconds (?) to wait before sending the midi event out.
+  /** Number of milliseconds to wait before sending the midi event out.
    */
-  time_t wait_;
+  int wait_;
 
   /** Duration of note in milliseconds.
    */
-  time_t length_;
+  unsigned int length_ : 24;
 
-  /** Raw midi message as a vector of unsigned char (compatible with RtMidi).
+  /** Number of bytes in bytes_ or MIDI_MESSAGE_LONG.
    */
-  std::vector<unsigned char> data_;
+  unsigned int size_ : 8;
 };
 
 std::ostream &operator<<(std::ostream &out_stream,
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_MIDI_SCHEDULER_H_
+#define OSCIT_INCLUDE_OSCIT_MIDI_SCHEDULER_H_
+
+#include <pthread.h>
+#include <stdint.h>  // int64_t
+#include <vector>
+
+#include "oscit/midi_message.h"
+#include "oscit/non_copyable.h"
+#include "oscit/thread.h"
+
+namespace oscit {
+
+/** Default number of pending events.
+ */
+#define MIDI_SCHEDULER_CAPACITY 4096
+
+/** Number of bytes stored in the event itself (longer messages such as
+ * SysEx are copied on the heap).
+ */
+#define MIDI_SCHEDULER_INLINE_BYTES 3
+
+/** Sends midi messages at the right time from a single thread. Messages are
+ * delayed by their 'wait' value and a NoteOff is generated for NoteOn
+ * messages with a 'length'. Pending events are kept in a binary heap with a
+ * fixed capacity so scheduling a note does not allocate memory.
+ *
+ * Generated NoteOff messages are counted per channel and key: if a note is
+ * played again before the end of the previous one, the key is only released
+ * at the end of the last note.
+ *
+ * Times are in [ns] on the TimeRef::now() clock.
+ */
+class MidiScheduler : private NonCopyable {
+public:
+  MidiScheduler(size_t capacity = MIDI_SCHEDULER_CAPACITY);
+
+  /** Sub-classes must call 'stop' in their destructor.
+   */
+  virtual ~MidiScheduler();
+
+  /** Send the message after message.wait() [ms] (and the NoteOff after
+   * message.length() [ms]).
+   * @return false if the scheduler is full.
+   */
+  bool schedule(const MidiMessage &message);
+
+  /** Send the message at the given time in [ns] (see TimeRef::now()). The
+   * message's wait value is ignored.
+   * @return false if the scheduler is full.
+   */
+  bool schedule_at(const MidiMessage &message, int64_t time);
+
+  /** Remove all pending events and send a NoteOff for every note playing
+   * (NoteOn sent with a length and not released yet).
+   */
+  void all_notes_off();
+
+  /** Stop the scheduler thread and call 'all_notes_off'.
+   */
+  void stop();
+
+  /** Number of pending events.
+   */
+  size_t pending();
+
+  /** Number of messages rejected because the scheduler was full.
+   */
+  size_t dropped();
+
+protected:
+  /** Executed from the scheduler thread.
+   */
+  virtual void send(const MidiMessage &message) = 0;
+
+private:
+  struct Event {
+    int64_t time_;
+
+    /** Keeps events scheduled at the same time in order.
+     */
+    uint64_t sequence_;
+
+    unsigned char data_[MIDI_SCHEDULER_INLINE_BYTES];
+    unsigned char size_;
+
+    /** Generated NoteOn/NoteOff (counted per key).
+     */
+    bool counted_;
+
+    /** Message data when it does not fit in data_.
+     */
+    std::vector<unsigned char> *long_data_;
+
+    /** Heap order: earliest event first.
+     */
+    bool operator<(const Event &other) const {
+      if (time_ != other.time_) return time_ > other.time_;
+      return sequence_ > other.sequence_;
+    }
+  };
+
+  /** Must be called with the lock.
+   */
+  void push(int64_t time, const unsigned char *data, size_t size, bool counted);
+
+  bool schedule(const MidiMessage &message, int64_t time, bool use_wait);
+
+  /** Send an event and free its data. Must be called with the lock (unlocks
+   * during 'send'). 'message' is used to build the message.
+   */
+  void fire(Event &event, MidiMessage *message);
+
+  void run(Thread *runner);
+
+  void wait_until(int64_t time);
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+
+  std::vector<Event> events_;
+  size_t capacity_;
+  uint64_t sequence_;
+  size_t dropped_;
+  bool should_run_;
+
+  /** Number of counted notes playing per channel and key.
+   */
+  unsigned short playing_[16 * 128];
+
+  /** Reused to deliver messages.
+   */
+  MidiMessage message_;
+
+  Thread thread_;
+};
+
+/** MidiScheduler calling a method on an owner.
+ */
+template<class T, void(T::*Tmethod)(const MidiMessage&)>
+class TMidiScheduler : public MidiScheduler {
+public:
+  TMidiScheduler(T *owner, size_t capacity = MIDI_SCHEDULER_CAPACITY) :
+                 MidiScheduler(capacity), owner_(owner) {}
+
+  virtual ~TMidiScheduler() {
+    stop();
+  }
+
+protected:
+  virtual void send(const MidiMessage &message) {
+    (owner_->*Tmethod)(message);
+  }
+
+private:
+  T *owner_;
+};
+
+}  // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_MIDI_SCHEDULER_H_
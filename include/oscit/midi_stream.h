@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_MIDI_STREAM_H_
+#define OSCIT_INCLUDE_OSCIT_MIDI_STREAM_H_
+
+#include <string>
+
+namespace oscit {
+
+class MidiMessage;
+class Value;
+
+/** Events carry a wait time in [ms].
+ */
+#define MIDI_STREAM_WAIT    0x01
+
+/** NoteOn events carry a length in [ms].
+ */
+#define MIDI_STREAM_LENGTH  0x02
+
+/** Events were sent as a list (even with a single event).
+ */
+#define MIDI_STREAM_LIST    0x04
+
+/** Maximal number of bytes in a wait or length value.
+ */
+#define MIDI_STREAM_NUMBER_BYTES 4
+
+/** Largest wait or length value (in [ms], about 74 hours).
+ */
+#define MIDI_STREAM_MAX_NUMBER 0x0fffffff
+
+/** Encodes midi messages as a compact byte stream (sent as an OSC blob) so
+ * that SysEx messages and bursts of events fit in a single packet.
+ *
+ * The stream starts with a flags byte followed by the events:
+ *
+ * <pre>
+ * event := [wait] status data* [length]
+ * </pre>
+ *
+ * 'wait' (present with MIDI_STREAM_WAIT) and 'length' (with
+ * MIDI_STREAM_LENGTH, NoteOn only) are variable length quantities as in
+ * standard midi files. Channel messages use running status (the status byte
+ * is omitted when it does not change). SysEx messages end with 0xf7.
+ */
+class MidiStream {
+public:
+  /** Encode a MidiValue or a list of MidiValue into 'stream'. If 'keep_list'
+   * is false, the list flag is not set (used when the list is the argument
+   * list of an OSC message).
+   * @return false if the value contains something else than midi messages.
+   */
+  static bool encode(const Value &value, std::string *stream, bool keep_list = true);
+
+  /** Decode a stream into a MidiValue (or a list of MidiValue if more than
+   * one event was encoded or if a list was encoded).
+   * @return false if the stream is invalid.
+   */
+  static bool decode(const unsigned char *stream, size_t size, Value *result);
+
+  /** Returns true if the value is a non-empty list of MidiValue.
+   */
+  static bool is_midi_list(const Value &value);
+
+private:
+  static void encode(const MidiMessage &message, int flags, unsigned char *running_status, std::string *stream);
+
+  /** Number of data bytes following a status byte (-1 for SysEx).
+   */
+  static int data_size(unsigned char status);
+
+  static void write_number(size_t number, std::string *stream);
+
+  static bool read_number(const unsigned char **stream, const unsigned char *end, size_t *number);
+};
+
+}  // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_MIDI_STREAM_H_
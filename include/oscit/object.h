@@ -45,7 +45,7 @@
 #include "oscit/location.h"
 #include "oscit/c_reference_counted.h"
 #include "oscit/c_tvector.h"
-#include "oscit/c_thash.h"
+#include "oscit/slab_allocator.h"
 
 namespace oscit {
 
@@ -53,77 +53,101 @@ namespace oscit {
  */
 #define OSC_NEXT_NAME_BUFFER_SIZE 20
 
+/** Children are found by linear search until there are more than this
+ * number of children. Past this threshold, a hash index is built.
+ */
+#define OBJECT_CHILDREN_INDEX_THRESHOLD 16
+
+/** Size of the hash table used to index children (see
+ * OBJECT_CHILDREN_INDEX_THRESHOLD).
+ */
+#define OBJECT_CHILDREN_INDEX_SIZE 64
+
 class Root;
 class Alias;
 class ObjectProxy;
 class ObjectHandle;
+class Strand;
+class ReplyStream;
 
 class Object : public Typed, public Observer, public CReferenceCounted {
  public:
   /** Class signature. */
   TYPED("Object")
 
-  explicit Object() : root_(NULL), parent_(NULL), children_(20), context_(NULL), keep_last_(false),
-    attributes_(Oscit::default_io()) {
+  explicit Object() : root_(NULL), parent_(NULL), children_index_(NULL), context_(NULL), strand_(NULL),
+    keep_last_(false), owns_strand_(false), attributes_(Oscit::default_io()) {
     sync_type_id();
     name_ = "";
     url_  = name_;
   }
 
   explicit Object(const char *name) : root_(NULL), parent_(NULL),
-    children_(20), name_(name), url_(name), context_(NULL), keep_last_(false),
-    attributes_(Oscit::default_io()) {
+    children_index_(NULL), name_(name), url_(name), context_(NULL), strand_(NULL), keep_last_(false),
+    owns_strand_(false), attributes_(Oscit::default_io()) {
     sync_type_id();
   }
 
   explicit Object(const std::string &name) : root_(NULL), parent_(NULL),
-    children_(20), name_(name), url_(name), context_(NULL), keep_last_(false),
-    attributes_(Oscit::default_io()) {
+    children_index_(NULL), name_(name), url_(name), context_(NULL), strand_(NULL), keep_last_(false),
+    owns_strand_(false), attributes_(Oscit::default_io()) {
     sync_type_id();
   }
 
   explicit Object(const Value &attrs) : root_(NULL), parent_(NULL),
-    children_(20), context_(NULL), keep_last_(false), attributes_(attrs) {
+    children_index_(NULL), context_(NULL), strand_(NULL), keep_last_(false), owns_strand_(false),
+    attributes_(attrs) {
     sync_type_id();
     name_ = "";
     url_  = name_;
   }
 
   Object(const char *name, const Value &attrs, bool keep_last = false) : root_(NULL), parent_(NULL),
-    children_(20), name_(name), url_(name), context_(NULL), keep_last_(keep_last),
-    attributes_(attrs) {
+    children_index_(NULL), name_(name), url_(name), context_(NULL), strand_(NULL), keep_last_(keep_last),
+    owns_strand_(false), attributes_(attrs) {
     sync_type_id();
   }
 
   Object(const std::string &name, const Value &attrs, bool keep_last = false) : root_(NULL),
-    parent_(NULL), children_(20), name_(name), url_(name), context_(NULL),
-    keep_last_(keep_last), attributes_(attrs) {
+    parent_(NULL), children_index_(NULL), name_(name), url_(name), context_(NULL),
+    strand_(NULL), keep_last_(keep_last), owns_strand_(false), attributes_(attrs) {
     sync_type_id();
   }
 
   Object(Object *parent, const char *name) : root_(NULL), parent_(NULL),
-    children_(20), name_(name), context_(NULL), keep_last_(false),
-    attributes_(Oscit::default_io()) {
+    children_index_(NULL), name_(name), context_(NULL), strand_(NULL), keep_last_(false),
+    owns_strand_(false), attributes_(Oscit::default_io()) {
     sync_type_id();
     parent->adopt(this);
   }
 
   Object(Object *parent, const char *name, const Value &attrs) : root_(NULL),
-    parent_(NULL), children_(20), name_(name), context_(NULL), keep_last_(false),
-    attributes_(attrs) {
+    parent_(NULL), children_index_(NULL), name_(name), context_(NULL), strand_(NULL), keep_last_(false),
+    owns_strand_(false), attributes_(attrs) {
     sync_type_id();
     parent->adopt(this);
   }
 
   Object(Object *parent, const std::string &name, const Value &attrs) :
-    root_(NULL), parent_(NULL), children_(20), name_(name), context_(NULL),
-    keep_last_(false), attributes_(attrs) {
+    root_(NULL), parent_(NULL), children_index_(NULL), name_(name), context_(NULL),
+    strand_(NULL), keep_last_(false), owns_strand_(false), attributes_(attrs) {
     sync_type_id();
     parent->adopt(this);
   }
 
   virtual ~Object();
 
+  /** Objects are allocated in slabs shared by all objects of the same size
+   * (see SlabAllocator).
+   */
+  static void *operator new(size_t size) {
+    return SlabAllocator::allocate(size);
+  }
+
+  static void operator delete(void *ptr, size_t size) {
+    SlabAllocator::deallocate(ptr, size);
+  }
+
   /** Clear all children (delete).
    * TODO: make thread safe
    */
@@ -138,6 +162,14 @@ class Object : public Typed, public Observer, public CReferenceCounted {
     return gNilValue;
   }
 
+  /** Send a large reply in bounded chunks instead of returning it from 'trigger'
+   * (used by commands for remote callers, see ReplyStream).
+   * @return false if the reply is not streamed ('trigger' is then used).
+   */
+  virtual bool trigger_stream(const Value &val, ReplyStream *stream) {
+    return false;
+  }
+
   /** Dynamically build a child from the given name. This method is called whenever
    * a sub-node or branch is not found and this is the last found object along
    * the path.
@@ -218,6 +250,11 @@ class Object : public Typed, public Observer, public CReferenceCounted {
     return !result.contains_error();
   }
 
+  /** Notify observers and record in the root's journal that the attributes
+   * of this object changed (called by 'set' with '@' keys).
+   */
+  void attributes_changed();
+
   /** This is the prefered way to insert new objects in the tree since it clearly
    * highlights ownership in the parent.
    * TODO: make sure a parent is not adopted by it's child.
@@ -229,6 +266,23 @@ class Object : public Typed, public Observer, public CReferenceCounted {
     return object;
   }
 
+  /** Attach a subtree built while detached (without root). All the objects
+   * in the subtree are registered in the root in a single pass with one
+   * aggregated notification. Every object in the subtree receives
+   * 'adopted' once attached.
+   *
+   * <pre>
+   * Object *patch = new Object("patch");
+   * patch->adopt(new Object("osc"));  // ... build thousands of objects
+   * root.adopt_tree(patch);
+   * </pre>
+   */
+  template<class T>
+  T *adopt_tree(T *tree) {
+    attach_tree(tree);
+    return tree;
+  }
+
   /** Return a hash representing the current object. If the current object is a container
    * (no_io type), the default behavior is to build a hash by sending 'to_hash'
    * on the children objects and merge the current attributes. If the object is a method
@@ -246,6 +300,11 @@ class Object : public Typed, public Observer, public CReferenceCounted {
    */
   const Value list_with_attributes() const;
 
+  /** Same as above but pushes the names and attributes to a stream
+   * (without building the list).
+   */
+  void list_with_attributes(ReplyStream *stream) const;
+
   /** List full tree under this node.
    *  @param base_length is the length of the url for the initial call
    *                     (removed from results).
@@ -253,6 +312,10 @@ class Object : public Typed, public Observer, public CReferenceCounted {
    */
   void tree(size_t base_length, Value *tree) const;
 
+  /** Same as above but pushes the urls to a stream (without building the list).
+   */
+  void tree(size_t base_length, ReplyStream *stream) const;
+
   /** Human readable information method.
    *  Called as a response to "/.info '/this/url'".
    */
@@ -292,13 +355,6 @@ class Object : public Typed, public Observer, public CReferenceCounted {
   //   }
   // }
 
-  /** Return the list of children as a hash.
-   * FIXME: if this is a const how does the user of this method RW lock ?
-   */
-  const CTHash<std::string, Object *> &children() const {
-    return children_;
-  }
-
   /** Return first child.
    */
   bool first_child(ObjectHandle *handle) {
@@ -317,8 +373,8 @@ class Object : public Typed, public Observer, public CReferenceCounted {
   /** Return the number of children objects.
    */
   size_t children_count() {
-    ScopedRead lock(children_vector_);
-    return children_vector_.size();
+    ScopedRead lock(children_);
+    return children_.size();
   }
 
 
@@ -338,6 +394,20 @@ class Object : public Typed, public Observer, public CReferenceCounted {
   /** Parent changed, set new context. */
   virtual void set_context(Mutex *context) { context_ = context; }
 
+  /** Run the calls to this object and to its children in 'strand' (see
+   * Root::call). Children bound to their own strand keep it. Passing NULL
+   * uses the parent's strand again. The strand is not owned and must outlive
+   * the subtree. Should be called while building the tree.
+   */
+  void set_strand(Strand *strand);
+
+  /** Strand running the calls to this object (NULL if calls run in the
+   * caller's thread).
+   */
+  Strand *strand() const {
+    return strand_;
+  }
+
   /** Return the type tag signature id (uint) of the trigger method of this
    * object (what it wants to receive as arguments).
    *
@@ -405,6 +475,30 @@ class Object : public Typed, public Observer, public CReferenceCounted {
    */
   void moved();
 
+  /** Same as 'moved' but instead of registering in the root, the objects
+   * are appended to 'registered' (see Root::register_objects).
+   */
+  void moved(std::vector<Object*> *registered);
+
+  /** Implementation of 'adopt_tree'.
+   */
+  void attach_tree(Object *tree);
+
+  /** Call 'adopted' on this object and all its descendants.
+   */
+  void subtree_adopted();
+
+  /** Find a child by name. The children_ lock must be held.
+   */
+  Object *find_child(const std::string &name) const;
+
+  /** Hold the children (taking the children_ lock only while copying them) so
+   * that a tree walk can recurse and send replies without holding the lock.
+   * Returns the number of children. The handles must be deleted with
+   * 'delete[]'.
+   */
+  size_t hold_children(ObjectHandle **handles) const;
+
   /** Add '-1', '-2', ... at the end of the current name. bob --> bob-1
    */
   void find_next_name() {
@@ -424,6 +518,11 @@ class Object : public Typed, public Observer, public CReferenceCounted {
   friend class ObjectProxy;
   friend class Alias;
 
+  /** Use 'strand' for this object and the children without their own
+   * strand.
+   */
+  void inherit_strand(Strand *strand);
+
   /** Keep type_id_ in sync with type_.
    */
   void sync_type_id() {
@@ -447,16 +546,17 @@ class Object : public Typed, public Observer, public CReferenceCounted {
    */
   Object *parent_;
 
-  /** Hash with pointers to children objects or methods.
-   * The children objects unregister themselves when they die or change
-   * their parent by calling 'unregister_child'.
+  /** Children objects or methods in listing order. The children objects
+   * unregister themselves when they die or change their parent by calling
+   * 'unregister_child'. The lock also protects 'children_index_'.
    */
-  CTHash<std::string, Object *> children_;
+  CTVector<Object*> children_;
 
-  /** List of children as a vector for faster enumeration type of access.
-   * FIXME: remove, bad optimization.
+  /** Hash index on children names. NULL until there are more than
+   * OBJECT_CHILDREN_INDEX_THRESHOLD children (most objects have none or
+   * just a few).
    */
-  CTVector<Object*> children_vector_;
+  THash<std::string, Object*> *children_index_;
 
   /** Unique name in parent's context.
    */
@@ -472,12 +572,21 @@ class Object : public Typed, public Observer, public CReferenceCounted {
    */
   Mutex *context_;
 
+  /** Serial executor for calls to this object (inherited from the parent
+   * unless owns_strand_ is true).
+   */
+  Strand *strand_;
+
   /** Flag to force this object at the end of the children list.
    * If more then one child has this setting, they are kept in insertion order at
    * the end.
    */
   bool keep_last_;
 
+  /** True if the strand was set with 'set_strand' (not inherited).
+   */
+  bool owns_strand_;
+
 
   /** Signal to notify destruction.
    * Thread safe.
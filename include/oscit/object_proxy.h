@@ -90,7 +90,7 @@ public:
    */
   void sync_children(bool forced = false) {
     if (need_sync_ || forced) {
-      root_proxy_->send_to_remote(LIST_WITH_ATTRIBUTES_PATH, Value(url()));
+      root_proxy_->query(LIST_WITH_ATTRIBUTES_PATH, url());
     }
     need_sync_ = false;
   }
@@ -132,15 +132,16 @@ public:
    */
   virtual bool build_child(const std::string &name, const Value &attrs, Value *error, ObjectHandle *handle);
 
-  /** "Current" time relative to this object's creation.
+  /** "Current" time in [ms] relative to this object's creation (with
+   * microsecond resolution).
    */
-  time_t elapsed() {
-    return time_ref_.elapsed();
+  Real elapsed() {
+    return time_ref_.elapsed_us() / 1000.0;
   }
 
-  /** Measured network latency between action and reply.
+  /** Measured network latency in [ms] between action and reply.
    */
-  time_t latency() {
+  Real latency() {
     return latency_;
   }
 
@@ -190,14 +191,13 @@ protected:
   Value value_;
 
   /** We have sent a notification out and the reply has not come back yet, we need to slow
-   * down in order to avoid flooding.
+   * down in order to avoid flooding (time in [ms]).
    */
-  time_t wait_until_;
+  Real wait_until_;
 
-  /** We have sent a notification out and the reply has not come back yet, we need to slow
-   * down in order to avoid flooding.
+  /** Measured latency in [ms] between a value change and the reply from the remote.
    */
-  time_t latency_;
+  Real latency_;
 
   Value to_send_;
 
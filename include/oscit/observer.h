@@ -34,6 +34,7 @@
 #include <iostream>
 
 #include "oscit/c_tlist.h"
+#include "oscit/delivery_queue.h"
 
 namespace oscit {
 
@@ -44,10 +45,33 @@ class Signal;
  */
 class Observer {
 public:
-  Observer() {}
+  Observer() : delivery_queue_(NULL) {}
 
   ~Observer() {
     disconnect_all();
+    delete delivery_queue_;
+  }
+
+  /** Receive notifications through a queue instead of being called from the
+   * sending thread. The observer's thread must call 'deliver_pending' to run
+   * the callbacks. Only connections made after this call are queued.
+   */
+  void set_async_delivery(size_t capacity = DELIVERY_QUEUE_DEFAULT_CAPACITY) {
+    if (!delivery_queue_) delivery_queue_ = new DeliveryQueue(capacity);
+  }
+
+  /** Queue used for asynchronous delivery (NULL if the observer is
+   * called synchronously).
+   */
+  DeliveryQueue *delivery_queue() {
+    return delivery_queue_;
+  }
+
+  /** Run the callbacks for all pending notifications. Returns the number
+   * of callbacks executed.
+   */
+  size_t deliver_pending() {
+    return delivery_queue_ ? delivery_queue_->drain() : 0;
   }
 
 private:
@@ -71,6 +95,10 @@ private:
   /** Signals connected.
    */
   CTList<Signal*> observed_signals_;
+
+  /** Pending notifications (asynchronous delivery).
+   */
+  DeliveryQueue *delivery_queue_;
 };
 
 } // oscit
@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_OBSERVER_LEASES_H_
+#define OSCIT_INCLUDE_OSCIT_OBSERVER_LEASES_H_
+
+#include <stdint.h>  // int64_t
+#include <list>
+#include <string>
+#include <vector>
+
+#include "oscit/location.h"
+#include "oscit/mutex.h"
+#include "oscit/non_copyable.h"
+#include "oscit/thash.h"
+#include "oscit/timer_wheel.h"
+
+namespace oscit {
+
+/** Default lease duration in [ms] (4 minutes).
+ */
+#define OBSERVER_LEASE_TTL 240000
+
+/** Number of consecutive failed sends before an observer is evicted.
+ */
+#define OBSERVER_LEASE_MAX_FAILURES 3
+
+#define OBSERVER_LEASES_HASH_SIZE 100
+
+#define OBSERVER_SUBSCRIPTIONS_HASH_SIZE 100
+
+/** Remote locations observing a command. Each observer holds a lease that is
+ * renewed by any message received from it. Leases that are not renewed
+ * expire on a TimerWheel deadline and observers whose sends keep failing
+ * are evicted.
+ *
+ * Renewing a lease only stores the new expiry time: the wheel event is
+ * scheduled for the earliest deadline and looks for other expired leases
+ * when it fires.
+ *
+ * Observers can subscribe to path prefixes ("/synth" gets "/synth" and
+ * "/synth/cutoff" but not "/synthesis"). Notifications are then routed with
+ * an index from prefix to subscribers: the cost only depends on the depth of
+ * the path and on the number of interested observers. Observers without
+ * subscriptions receive everything.
+ *
+ * Thread safe.
+ */
+class ObserverLeases : private NonCopyable {
+public:
+  typedef void (*remove_method_t)(void *data, const Location &location);
+
+  /** Leases last 'ttl' [ms]. Uses the shared TimerWheel if 'wheel' is NULL.
+   */
+  ObserverLeases(Real ttl = OBSERVER_LEASE_TTL, size_t max_failures = OBSERVER_LEASE_MAX_FAILURES,
+                 TimerWheel *wheel = NULL);
+
+  ~ObserverLeases();
+
+  /** Add an observer or renew its lease (and clear failed sends).
+   * @return true if the observer is new.
+   */
+  bool renew(const Location &location);
+
+  /** Renew the lease of a known observer (does not add new observers).
+   * @return false if the location is not an observer.
+   */
+  bool touch(const Location &location);
+
+  /** Record a failed send to the observer.
+   * @return true if the observer has been evicted.
+   */
+  bool send_failed(const Location &location);
+
+  /** Forget about an observer.
+   */
+  void remove(const Location &location);
+
+  /** Add an observer (or renew its lease) and replace its subscriptions with
+   * 'prefixes'. An empty list of prefixes (or "/") subscribes to all paths.
+   * @return true if the observer is new.
+   */
+  bool subscribe(const Location &location, const std::vector<std::string> &prefixes);
+
+  /** Copy of the list of observers (in registration order).
+   */
+  std::list<Location> observers();
+
+  /** Append the observers interested in 'path' to 'observers': observers
+   * without subscriptions first, then the subscribers of each prefix of the
+   * path (each observer appears once).
+   */
+  void observers_of(const std::string &path, std::list<Location> *observers);
+
+  /** Number of live observers.
+   */
+  size_t count();
+
+  /** Number of leases that expired since creation.
+   */
+  size_t expired_count();
+
+  /** Number of observers evicted because of failed sends.
+   */
+  size_t evicted_count();
+
+  /** Change the lease duration [ms] (used for new and renewed leases).
+   */
+  void set_ttl(Real ttl);
+
+  /** Call 'method' with 'data' whenever an observer expires, is evicted or
+   * removed (called with the lock: the method must not use the leases).
+   * Once this returns, the previous method is no longer running. Pass NULL
+   * to stop the notifications.
+   */
+  void set_on_remove(remove_method_t method, void *data);
+
+private:
+  struct Lease {
+    Lease() : expires_at_(0), failures_(0), subscriptions_(0) {}
+
+    explicit Lease(int64_t expires_at) : expires_at_(expires_at), failures_(0), subscriptions_(0) {}
+
+    /** Expiry time in [ns] (TimeRef::now() base).
+     */
+    int64_t expires_at_;
+
+    /** Consecutive failed sends.
+     */
+    size_t failures_;
+
+    /** Number of subscribed prefixes (0 = all paths).
+     */
+    size_t subscriptions_;
+  };
+
+  /** Add or renew a lease. Must be called with the lock.
+   * @return true if the observer is new.
+   */
+  bool renew_lease(const Location &location);
+
+  /** Remove a lease and its subscriptions and call the 'on_remove' method.
+   * Must be called with the lock.
+   */
+  void forget(const Location &location);
+
+  /** Remove all subscriptions of an observer. Must be called with the lock.
+   */
+  void unsubscribe(const Location &location, Lease *lease);
+
+  /** Remove expired leases (called from the wheel).
+   */
+  void expire();
+
+  /** Schedule the expiry event if needed. Must be called with the lock.
+   */
+  void schedule(int64_t time);
+
+  Mutex mutex_;
+  THash<Location, Lease> leases_;
+
+  /** Observers without subscriptions (in registration order).
+   */
+  std::list<Location> unfiltered_;
+
+  /** Subscribers by prefix (without trailing slash).
+   */
+  THash<std::string, std::list<Location> > subscribers_;
+
+  /** Lease duration in [ns].
+   */
+  int64_t ttl_;
+
+  size_t max_failures_;
+  size_t expired_count_;
+  size_t evicted_count_;
+
+  remove_method_t on_remove_;
+  void *on_remove_data_;
+
+  TimerWheel *wheel_;
+  TTimerEvent<ObserverLeases, &ObserverLeases::expire> expire_event_;
+
+  /** Time at which the expiry event fires (0 = not scheduled).
+   */
+  int64_t next_expiry_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_OBSERVER_LEASES_H_
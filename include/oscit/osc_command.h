@@ -52,8 +52,16 @@ public:
 
   virtual void kill();
 
+  /** Queue a notification for the interested observers. The message is
+   * encoded once and sent from a separate thread.
+   */
   virtual void notify_observers(const char *path, const Value &val);
 
+  /** Notification queue metrics (pending, dropped and sent packets, per
+   * observer depth).
+   */
+  const Value send_queue_stats();
+
 protected:
   /** Create a reference to a remote object. */
   virtual bool build_remote_object(const Url &url, Value *error, ObjectHandle *handle);
@@ -30,17 +30,24 @@
 #ifndef OSCIT_INCLUDE_OSCIT_OSC_MAP_COMMAND_H_
 #define OSCIT_INCLUDE_OSCIT_OSC_MAP_COMMAND_H_
 
+#include <pthread.h>
+
 #include <list>
 #include <stdexcept> // runtime_error
 
+#include "oscit/atomic_counter.h"
 #include "oscit/osc_command.h"
 #include "oscit/script.h"
 #include "oscit/mapper.h"
 #include "oscit/values.h"
-#include "oscit/time_ref.h"
 
 namespace oscit {
 
+/** OSC command translating messages with a Mapper. The mapping script is
+ * reloaded by a file watcher: a new Mapper is built outside of the command
+ * lock and swapped in so that 'receive' never waits for a parse or touches
+ * the file system.
+ */
 class OscMapCommand : public Script, public OscCommand {
 public:
   OscMapCommand();
@@ -80,26 +87,43 @@ public:
    */
   virtual void notify_observers(const char *path, const Value &val);
 
-  /** Mappings compilation.
+  /** Mappings compilation (parse in a new Mapper and swap).
    */
-  virtual const Value eval_script() {
-    Value res;
-    lock();
-      if (mapper_.parse(script_.c_str())) {
-        res = Value(script_);
-      } else {
-        res = Value(BAD_REQUEST_ERROR, mapper_.error());
-      }
-    unlock();
-    return res;
-  }
+  virtual const Value eval_script();
 
  private:
 
   uint16_t reply_port_;
 
-  Mapper mapper_;
-  TimeRef time_ref_;
+  /** Current mappings. Only changed with the command lock.
+   */
+  Mapper *mapper_;
+
+  void init_mapper_users();
+
+  /** Stop using mapper_ outside of the command lock and wake up
+   * eval_script if it waits to delete the previous mapper.
+   */
+  void release_mapper();
+
+  /** Number of threads using mapper_ without the command lock
+   * (notify_observers).
+   */
+  AtomicCounter mapper_users_;
+
+  /** Set while eval_script waits for mapper_users_ to reach zero.
+   */
+  volatile bool retiring_mapper_;
+
+  /** Used by eval_script to sleep until the last user of the old mapper
+   * is gone.
+   */
+  pthread_mutex_t mapper_users_mutex_;
+  pthread_cond_t mapper_users_cond_;
+
+  /** Mapping results (reused between calls to avoid allocations).
+   */
+  std::vector<Mapper::Target> targets_;
 };
 
 }  // oscit
@@ -46,6 +46,16 @@
 #include "oscit/proxy_factory.h"
 #include "oscit/file_method.h"
 #include "oscit/hash_file_method.h"
+#include "oscit/timer_wheel.h"
+#include "oscit/timer_stats.h"
+#include "oscit/timer_stats_method.h"
 #include "oscit/timer.h"
+#include "oscit/midi_scheduler.h"
+#include "oscit/midi_stream.h"
+#include "oscit/observer_leases.h"
+#include "oscit/send_queue.h"
+#include "oscit/executor.h"
+#include "oscit/remote_call.h"
+#include "oscit/reply_stream.h"
 
 #endif // OSCIT_INCLUDE_OSCIT_H_
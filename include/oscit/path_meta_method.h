@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_PATH_META_METHOD_H_
+#define OSCIT_INCLUDE_OSCIT_PATH_META_METHOD_H_
+#include "oscit/root.h"
+#include "oscit/reply_stream.h"
+
+namespace oscit {
+
+/** Base class for meta methods returning some information on a path. A list
+ * of paths can be queried in a single request: the reply contains the path
+ * followed by its result for each path.
+ *
+ * <pre>
+ * /.attr "/a"          --> ["/a", {...}]
+ * /.attr ["/a", "/b"]  --> ["/a", {...}, "/b", {...}]
+ * </pre>
+ *
+ * Unknown paths are followed by an error. Sent by a command, the reply to a
+ * list of paths is split in pages of at most ATTRS_PAGE_BYTES, each page being
+ * a complete reply:
+ *
+ * <pre>
+ * /.attr ["/a", "/b"]  --> ["/a", {...}] ["/b", {...}]
+ * </pre>
+ */
+class PathMetaMethod : public Object
+{
+public:
+  /** Class signature. */
+  TYPED("Object.PathMetaMethod")
+
+  PathMetaMethod(const std::string &name, const char *info) : Object(name, Oscit::any_io(info)) {}
+
+  virtual const Value trigger(const Value &val) {
+    if (val.is_string()) {
+      Value reply = val;
+      push_result(val.str(), &reply);
+      return reply;
+    } else if (!val.is_list()) {
+      return gNilValue;
+    }
+
+    ListValue reply;
+    for (size_t i = 0; i < val.size(); ++i) {
+      if (!val[i].is_string()) continue;
+      reply.push_back(val[i]);
+      push_result(val[i].str(), &reply);
+    }
+    return reply;
+  }
+
+  /** Reply to a list of paths in pages so that a batched query (see
+   * RootProxy::query) never builds a message too big to be sent.
+   */
+  virtual bool trigger_stream(const Value &val, ReplyStream *stream) {
+    if (!val.is_list()) return false;
+
+    ListValue page;
+    size_t page_size = 0;
+    for (size_t i = 0; i < val.size(); ++i) {
+      if (!val[i].is_string()) continue;
+      Value reply(val[i]);
+      push_result(val[i].str(), &reply);
+      size_t size = Root::osc_size(reply);
+      if (page_size + size > ATTRS_PAGE_BYTES && page.size() > 0) {
+        stream->send_page(page, false);
+        page.set_type(LIST_VALUE); // clear
+        page_size = 0;
+      }
+      page.push_back(reply[0]);
+      page.push_back(reply[1]);
+      page_size += size;
+    }
+    stream->send_page(page, true);
+    return true;
+  }
+
+protected:
+  /** Information returned for the given object.
+   */
+  virtual const Value result(Object *object) = 0;
+
+private:
+  void push_result(const std::string &path, Value *reply) {
+    Value error;
+    ObjectHandle object;
+
+    if (root_->find_or_build_object_at(path, &error, &object)) {
+      reply->push_back(result(object.ptr()));
+    } else {
+      reply->push_back(error);
+    }
+  }
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_PATH_META_METHOD_H_
@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_REMOTE_CALL_H_
+#define OSCIT_INCLUDE_OSCIT_REMOTE_CALL_H_
+
+#include <pthread.h>
+#include <stdint.h>  // int64_t
+#include <map>
+
+#include "oscit/c_reference_counted.h"
+#include "oscit/location.h"
+#include "oscit/mutex.h"
+#include "oscit/timer_wheel.h"
+#include "oscit/values.h"
+
+namespace oscit {
+
+/** Default time to wait for a reply in [ms].
+ */
+#define REMOTE_CALL_TIMEOUT 2000
+
+/** Correlation ids are sent as osc floats: they must stay below 2^24 to be
+ * transmitted exactly.
+ */
+#define REMOTE_CALL_MAX_ID 0xffffff
+
+/** Result of a call to a remote object. The call completes with the value
+ * of the reply, with the error sent back by the remote end or with a
+ * timeout error.
+ *
+ * Sub-classes can implement 'done' to be notified instead of waiting (see
+ * TRemoteCall). 'done' is executed from the command's listening thread (or
+ * from the timer wheel on timeout) and must not block.
+ *
+ * Thread safe.
+ */
+class RemoteCall : public CReferenceCounted {
+public:
+  RemoteCall();
+
+  virtual ~RemoteCall();
+
+  /** Returns true once the reply (or an error) has been received.
+   */
+  bool is_done();
+
+  /** Wait for the reply and return its value (or an error).
+   */
+  const Value wait();
+
+  /** Value of the reply (nil until the call is done).
+   */
+  const Value result();
+
+protected:
+  /** Called once when the call completes.
+   */
+  virtual void done(const Value &result) {}
+
+private:
+  friend class RemoteCalls;
+  friend class Root;  // local calls
+
+  /** Store the result, call 'done' and wake up waiting threads.
+   */
+  void complete(const Value &result);
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t done_cond_;
+  bool done_;
+  Value result_;
+};
+
+/** Call a member method with the result of a remote call. The owner must
+ * outlive the call.
+ */
+template<class T, void(T::*Tmethod)(const Value&)>
+class TRemoteCall : public RemoteCall {
+public:
+  TRemoteCall(T *owner) : owner_(owner) {}
+
+protected:
+  virtual void done(const Value &result) {
+    (owner_->*Tmethod)(result);
+  }
+
+private:
+  T *owner_;
+};
+
+/** Calls waiting for a reply, indexed by correlation id. Many calls can be
+ * in flight at the same time. Deadlines are kept sorted and a single
+ * TimerWheel event fires for the earliest one.
+ *
+ * Thread safe.
+ */
+class RemoteCalls : private NonCopyable {
+public:
+  /** Uses the shared TimerWheel if 'wheel' is NULL.
+   */
+  RemoteCalls(TimerWheel *wheel = NULL);
+
+  /** Pending calls complete with an error.
+   */
+  ~RemoteCalls();
+
+  /** Register a call to 'remote' (the call is retained until it completes).
+   * @return correlation id to send with the request.
+   */
+  uint32_t start(const Location &remote, RemoteCall *call, Real timeout = REMOTE_CALL_TIMEOUT);
+
+  /** Complete the call with the given id with the result received from
+   * 'remote' (ip and port must match the location the call was sent to).
+   * @return false if no such call is pending (late or foreign reply).
+   */
+  bool complete(const Location &remote, uint32_t id, const Value &result);
+
+  /** Complete the call with an error (used when the request could not be sent).
+   */
+  bool fail(uint32_t id, const Value &error);
+
+  /** Number of calls waiting for a reply.
+   */
+  size_t pending();
+
+  /** Number of calls that timed out since creation.
+   */
+  size_t timeout_count();
+
+private:
+  struct Pending {
+    Pending() : call_(NULL), expires_at_(0) {}
+
+    Pending(const Location &remote, RemoteCall *call, int64_t expires_at)
+        : remote_(remote), call_(call), expires_at_(expires_at) {}
+
+    Location remote_;
+    RemoteCall *call_;
+
+    /** Deadline in [ns] (TimeRef::now() base).
+     */
+    int64_t expires_at_;
+  };
+
+  /** Remove a pending call. Must be called with the lock.
+   * @return the call (to be completed and released without the lock).
+   */
+  RemoteCall *take(std::map<uint32_t, Pending>::iterator it);
+
+  /** Time out expired calls (called from the wheel).
+   */
+  void expire();
+
+  /** Schedule the expiry event for the earliest deadline. Must be called with
+   * the lock.
+   */
+  void schedule();
+
+  Mutex mutex_;
+  std::map<uint32_t, Pending> calls_;
+
+  /** Pending ids by deadline.
+   */
+  std::multimap<int64_t, uint32_t> deadlines_;
+
+  uint32_t next_id_;
+  size_t timeout_count_;
+
+  TimerWheel *wheel_;
+  TTimerEvent<RemoteCalls, &RemoteCalls::expire> expire_event_;
+
+  /** Time at which the expiry event fires (0 = not scheduled).
+   */
+  int64_t next_expiry_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_REMOTE_CALL_H_
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_REPLY_STREAM_H_
+#define OSCIT_INCLUDE_OSCIT_REPLY_STREAM_H_
+
+#include "oscit/non_copyable.h"
+#include "oscit/values.h"
+
+namespace oscit {
+
+/** Default number of elements in a streamed reply chunk.
+ */
+#define REPLY_STREAM_CHUNK_SIZE 64
+
+/** Sends a large reply in bounded chunks instead of one big message (see
+ * Object::trigger_stream). Each chunk is sent as [head, [elements...]] and all
+ * chunks but the last one end with 'true' (more to come):
+ *
+ * <pre>
+ * ["/synth", ["voice1", "voice1/gain", ...], true]
+ * ["/synth", ["voice9/gain"]]
+ * </pre>
+ *
+ * Each chunk is sent as soon as it is full: tree walks do not hold the
+ * children locks while pushing elements (see Object::hold_children) so at most
+ * one chunk is kept in memory.
+ */
+class ReplyStream : private NonCopyable {
+public:
+  ReplyStream() : chunk_(ListValue()), chunk_size_(REPLY_STREAM_CHUNK_SIZE), chunk_count_(0) {}
+
+  virtual ~ReplyStream() {}
+
+  /** Start the reply. 'head' is the first element of every chunk.
+   */
+  void begin(const Value &head, size_t chunk_size = REPLY_STREAM_CHUNK_SIZE) {
+    head_ = head;
+    chunk_size_ = chunk_size;
+  }
+
+  void push_back(const Value &element) {
+    chunk_.push_back(element);
+    if (chunk_.size() >= chunk_size_) send_chunk(false);
+  }
+
+  /** Push two elements that must stay in the same chunk (name and attributes).
+   */
+  void push_back(const Value &first, const Value &second) {
+    chunk_.push_back(first);
+    chunk_.push_back(second);
+    if (chunk_.size() >= chunk_size_) send_chunk(false);
+  }
+
+  /** Send the last chunk.
+   */
+  void close() {
+    send_chunk(true);
+  }
+
+  /** Send a complete reply right away (without head). Used by replies paged
+   * without walking the tree (see PathMetaMethod::trigger_stream).
+   */
+  void send_page(const Value &page, bool last) {
+    send_reply(page, last);
+    ++chunk_count_;
+  }
+
+  /** Number of chunks sent.
+   */
+  size_t chunk_count() const {
+    return chunk_count_;
+  }
+
+protected:
+  /** Send a chunk to the caller.
+   */
+  virtual void send_reply(const Value &reply, bool last) = 0;
+
+private:
+  void send_chunk(bool last) {
+    Value reply(head_);
+    reply.push_back(chunk_);
+    if (!last) reply.push_back(gTrueValue);
+    chunk_.set_type(LIST_VALUE); // clear
+    ++chunk_count_;
+    send_reply(reply, last);
+  }
+
+  Value head_;
+  Value chunk_;
+  size_t chunk_size_;
+  size_t chunk_count_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_REPLY_STREAM_H_
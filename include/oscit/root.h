@@ -30,13 +30,17 @@
 #ifndef OSCIT_INCLUDE_OSCIT_ROOT_H_
 #define OSCIT_INCLUDE_OSCIT_ROOT_H_
 
+#include <string.h>  // strcmp
+
 #include "oscit/object.h"
 #include "oscit/command.h"
+#include "oscit/command_registry.h"
+#include "oscit/atomic_counter.h"
 #include "oscit/mutex.h"
 #include "oscit/c_thash.h"
 #include "oscit/signal.h"
-#include "oscit/c_tlist.h"
 #include "oscit/object_handle.h"
+#include "oscit/tree_journal.h"
 
 namespace oscit {
 
@@ -46,14 +50,23 @@ namespace oscit {
 /** Size of the on register callbacks hash. */
 #define CALLBACKS_ON_REGISTER_HASH_SIZE 100
 
+/** Maximal encoded size (in bytes) of a /.attr notification sent when a
+ * tree is adopted or of a batched path query reply (see PathMetaMethod).
+ * Bigger replies are sent in several pages so that each message fits in an
+ * OSC packet (oscpack reads up to 4098 bytes). */
+#define ATTRS_PAGE_BYTES 3072
+
 #define ERROR_PATH "/.error"
 #define INFO_PATH "/.info"
 #define LIST_PATH "/.list"
 #define LIST_WITH_ATTRIBUTES_PATH "/.list_att"
 #define REPLY_PATH "/.reply"
 #define REGISTER_PATH "/.register"
+#define CALL_PATH "/.call"
+#define CALL_REPLY_PATH "/.call_reply"
 #define ATTRS_PATH "/.attr"
 #define TREE_PATH "/.tree"
+#define CHANGES_PATH "/.changes"
 #define VIEWS_PATH "/views"
 
 class Signal;
@@ -132,10 +145,7 @@ class Root : public Object {
     init();
   }
 
-  virtual ~Root() {
-    clear();
-    root_ = NULL; // avoid call to unregister_object in ~Object
-  }
+  virtual ~Root();
 
   /** Clear (remove all objects).
    * Thread safe.
@@ -147,16 +157,11 @@ class Root : public Object {
    */
   template<class T>
   T * adopt_command(T *command, bool start = true) {
-    if (command_for_protocol(command->protocol()) != NULL) {
+    if (!register_command(command)) {
       // we already have a command for this protocol. Do not adopt.
       delete command;
       return NULL;
     }
-    command->set_root(this);
-
-    { ScopedWrite lock(commands_);
-      commands_.push_back(command);
-    }
 
     if (start) {
       command->start_command();
@@ -169,10 +174,7 @@ class Root : public Object {
    * TODO: clarify who should use this.
    * Thread safe.
    */
-  void unregister_command(Command *command) {
-    ScopedWrite lock(commands_);
-    commands_.remove(command);
-  }
+  void unregister_command(Command *command);
 
   /** Return (create if necessary) the "/views" container.
    * Thread safe.
@@ -245,11 +247,16 @@ class Root : public Object {
     return call(handle, val, &url.location());
   }
 
-  /** Call an object's trigger method.
+  /** Call an object's trigger method. If the object is bound to a strand (see
+   * Object::set_strand), the call runs in the strand: calls to independent
+   * subtrees can run in parallel. A task running in a strand does not wait
+   * for another busy strand: the call is posted and the result is an
+   * ACCEPTED_ERROR.
    */
   inline const Value call(ObjectHandle &target, const Value &val, const Location *origin) {
     if (val.is_empty()) return call(target, gNilValue, origin);
     if (target->can_receive(val)) {
+      if (target->strand()) return call_in_strand(target.ptr(), val);
       return target->trigger(val);
     } else {
       return ErrorValue(BAD_REQUEST_ERROR, std::string("'").append(
@@ -258,12 +265,20 @@ class Root : public Object {
     }
   }
 
+  /** Trigger the object located at the given path from its strand without
+   * waiting for the result. The object is triggered in the calling thread if it
+   * is not bound to a strand.
+   * Thread safe.
+   * @return false if the object could not be found or cannot receive the value.
+   */
+  bool post(const std::string &path, const Value &val);
+
   /** Send a message to a given location.
    * (Thread safe).
    */
   void send(const Location &remote, const char *path, const Value &val) {
-    // FIXME: CommandHandle
-    Command *cmd = command_for_protocol(remote.protocol());
+    ScopedCommands commands(this);
+    Command *cmd = commands->command(remote);
     if (cmd) {
       cmd->send(remote, path, val);
     } else {
@@ -286,6 +301,24 @@ class Root : public Object {
     return call(handle, val, &url.location());
   }
 
+  /** Call an object without waiting for the result. Remote objects get the
+   * request with a correlation id and the call completes when the reply comes
+   * back (or with an error after 'timeout' [ms]). Local objects are called
+   * right away. The caller must release the returned call.
+   * Thread safe.
+   */
+  RemoteCall *call_async(const Url &url, const Value &val, Real timeout = REMOTE_CALL_TIMEOUT) {
+    RemoteCall *remote_call = new RemoteCall;
+    call_async(url, val, remote_call, timeout);
+    return remote_call;
+  }
+
+  /** Same as above with a call provided by the caller (see TRemoteCall).
+   * Thread safe.
+   */
+  void call_async(const Url &url, const Value &val, RemoteCall *remote_call,
+                  Real timeout = REMOTE_CALL_TIMEOUT);
+
   /** Find any object (local or remoate).
    * Thread safe.
    */
@@ -294,13 +327,14 @@ class Root : public Object {
       // bad url
       error->set(BAD_REQUEST_ERROR, std::string("Could not parse url '").append(url.str()).append("'."));
       return false;
-    } else if (url.protocol() == "") {
+    } else if (url.protocol_id() == Location::NO_PROTOCOL) {
       // local object
       return find_or_build_object_at(url.str(), error, handle);
     } else {
       // remote
       // find command for given protocol
-      Command * cmd = command_for_protocol(url.protocol());
+      ScopedCommands commands(this);
+      Command * cmd = commands->command(url.location());
       if (cmd) {
         // what is this ? Why do we need 'remote_object' and not just ObjectProxy ?
         return cmd->remote_object(url, error, handle);
@@ -337,6 +371,14 @@ class Root : public Object {
    */
   void register_object(Object *obj);
 
+  /** Register many objects at once (see Object::adopt_tree). The objects
+   * hash is locked once and observers receive /.attr notifications with
+   * the new urls and types ("url", type, "url", type, ...), one per
+   * ATTRS_PAGE_BYTES page.
+   * Thread safe.
+   */
+  void register_objects(const std::vector<Object*> &objects);
+
   /** Unregister an object from tree (forget about it).
    * Thread safe.
    */
@@ -399,31 +441,48 @@ class Root : public Object {
    * TODO: make private
    */
   void notify_observers(const char *path, const Value &val) {
-    ScopedRead lock(commands_);
-    std::list<Command*>::iterator it;
-    std::list<Command*>::iterator end = commands_.end();
-    for (it = commands_.begin(); it != end; ++it) {
+    if (strcmp(path, REPLY_PATH) == 0 && val.size() >= 2 && val[0].is_string() &&
+        !Url::is_meta(val[0].str())) {
+      // ["/path", value]
+      journal_.record(TreeJournal::Update, val[0].str(), val[1]);
+    }
+
+    ScopedCommands registry(this);
+    const std::vector<Command*> &commands = registry->commands();
+    std::vector<Command*>::const_iterator it, end = commands.end();
+    for (it = commands.begin(); it != end; ++it) {
       (*it)->notify_observers(path, val);
     }
   }
 
+  /** Record an attributes change in the journal and notify observers
+   * (see Object::attributes_changed).
+   * Thread safe.
+   */
+  void attributes_changed(Object *object);
+
+  /** Changes in the tree (see ChangesMetaMethod).
+   */
+  TreeJournal &journal() {
+    return journal_;
+  }
+
   /** Find a command handling a given protocol.
    * TODO: make private ?
-   * (Thread safe).
+   * (Thread safe but the command is only guaranteed to live until the root
+   * is cleared or the command is unregistered).
    * TODO: use a CommandHandle with reference counting.
    */
   Command *command_for_protocol(const std::string& protocol) {
-    ScopedRead lock(commands_);
-    std::list<Command*>::iterator it;
-    std::list<Command*>::iterator end = commands_.end();
-    for (it = commands_.begin(); it != end; ++it) {
-      if ((*it)->protocol() == protocol) {
-        return *it;
-      }
-    }
-    return NULL;
+    ScopedCommands commands(this);
+    return commands->command(Location::intern_protocol(protocol));
   }
 
+  /** Upper bound of the number of bytes used by 'val' in an OSC message
+   * (type tags and arguments).
+   */
+  static size_t osc_size(const Value &val);
+
  protected:
   /** Hash to find any object in the tree from its path.
    */
@@ -441,6 +500,10 @@ class Root : public Object {
    */
   void trigger_and_clear_on_register(const std::string &url);
 
+  /** Notify observers with a /.attr reply ("url", attributes, ...).
+   */
+  void notify_attrs(const Value &attributes);
+
   bool do_find_or_build_object_at(const std::string &path, Value *error, ObjectHandle *handle) {
     if (get_object_at(path, handle)) {
       return true;
@@ -471,9 +534,84 @@ class Root : public Object {
 
   void init(bool should_build_meta = true);
 
-  /** Listening commands (only one allowed per protocol).
+  /** Run 'trigger' in the target's strand and wait for the result (post
+   * and return an ACCEPTED_ERROR if the caller is a worker and the strand is
+   * busy).
+   */
+  const Value call_in_strand(Object *target, const Value &val);
+
+  /** Add a command unless we already have one for its protocol.
+   * Thread safe.
+   */
+  bool register_command(Command *command);
+
+  /** Keeps the current command registry (and its commands) alive while in
+   * scope. Readers are only counted (by epoch, as in Signal): this does not
+   * take any lock.
+   */
+  class ScopedCommands : private oscit::NonCopyable {
+  public:
+    explicit ScopedCommands(Root *root) : root_(root) {
+      epoch_ = root->commands_epoch_;
+      root->command_readers_[epoch_].increment();
+      // swap_commands must see the increment before we read the registry
+      __sync_synchronize();
+      registry_ = root->commands_;
+    }
+
+    ~ScopedCommands() {
+      root_->release_commands(epoch_);
+    }
+
+    const CommandRegistry *operator->() const {
+      return registry_;
+    }
+
+  private:
+    Root *root_;
+    CommandRegistry *registry_;
+
+    /** Epoch in which the reader is counted.
+     */
+    int epoch_;
+  };
+
+  /** Stop counting a reader (wakes up a swap waiting for it).
+   */
+  void release_commands(int epoch);
+
+  /** Replace the command registry, wait for the readers that could still use
+   * the previous registry and delete it. Must be called with commands_mutex_
+   * and without holding a registry (ScopedCommands) in this thread.
+   */
+  void swap_commands(CommandRegistry *registry);
+
+  /** Wait until no reader is counted in the given epoch.
+   */
+  void wait_for_command_readers(int epoch);
+
+  /** Listening commands (only one allowed per protocol). The registry is
+   * replaced on changes so that it can be read without holding a lock.
+   */
+  CommandRegistry * volatile commands_;
+
+  /** Number of threads using the registry (by epoch).
+   */
+  AtomicCounter command_readers_[2];
+
+  /** Epoch of new readers (0 or 1). swap_commands flips it so that it does
+   * not wait for readers starting after the swap.
+   */
+  volatile int commands_epoch_;
+
+  /** Serializes changes to the command registry.
+   */
+  Mutex commands_mutex_;
+
+  /** Latest changes in the tree (adopted and removed objects, attributes and
+   * values).
    */
-  CTList<Command *> commands_;
+  TreeJournal journal_;
 
   /** List of callbacks to trigger on object registration.
    */
@@ -34,11 +34,33 @@
 #ifndef OSCIT_INCLUDE_OSCIT_ROOT_PROXY_H_
 #define OSCIT_INCLUDE_OSCIT_ROOT_PROXY_H_
 
+#include <map>
+#include <string>
+#include <vector>
+
 #include "oscit/root.h"
 #include "oscit/location.h"
+#include "oscit/mutex.h"
+#include "oscit/observer_leases.h"
+#include "oscit/timer_wheel.h"
 
 namespace oscit {
 
+/** Time during which meta queries are collected before being sent as a
+ * single request [ms].
+ */
+#define ROOT_PROXY_BATCH_WINDOW 2
+
+/** Maximal number of paths in a single request (larger batches are sent in
+ * pages).
+ */
+#define ROOT_PROXY_BATCH_SIZE 32
+
+/** Interval between two registrations with the remote tree [ms] so that our
+ * observer lease (OBSERVER_LEASE_TTL) does not expire while we are idle.
+ */
+#define ROOT_PROXY_REGISTER_INTERVAL (OBSERVER_LEASE_TTL / 2)
+
 class ObjectProxy;
 class ProxyFactory;
 
@@ -55,11 +77,15 @@ public:
    */
   RootProxy(const Location &remote_location) :
             Root(false), remote_location_(remote_location),
-            command_(NULL), proxy_factory_(NULL) {}
+            command_(NULL), proxy_factory_(NULL),
+            queries_scheduled_(false), flush_event_(this),
+            register_interval_(ROOT_PROXY_REGISTER_INTERVAL), register_event_(this) {}
 
   RootProxy(const Location &remote_location, ProxyFactory *proxy_factory) :
             Root(false), remote_location_(remote_location),
-            command_(NULL), proxy_factory_(NULL) {
+            command_(NULL), proxy_factory_(NULL),
+            queries_scheduled_(false), flush_event_(this),
+            register_interval_(ROOT_PROXY_REGISTER_INTERVAL), register_event_(this) {
     set_proxy_factory(proxy_factory);
   }
 
@@ -76,6 +102,22 @@ public:
     }
   }
 
+  /** Query a remote path with a meta method (ATTRS_PATH, LIST_WITH_ATTRIBUTES_PATH, ...).
+   * Queries are collected during ROOT_PROXY_BATCH_WINDOW and sent with the list
+   * of paths in a single request (see PathMetaMethod).
+   * Thread safe.
+   */
+  void query(const char *meta_path, const std::string &path);
+
+  /** Send the collected queries now.
+   */
+  void flush_queries();
+
+  /** Change the interval between two registrations with the remote tree
+   * [ms]. This should be about half the remote lease duration.
+   */
+  void set_register_interval(Real interval);
+
   /** Keep proxy in sync by parsing replies and sending new queries.
    */
   void handle_reply(const std::string &path, const Value &val);
@@ -129,11 +171,27 @@ private:
    *
    */
   void sync_children(bool forced = true) {
-    send_to_remote(LIST_WITH_ATTRIBUTES_PATH, Value(url()));
+    query(LIST_WITH_ATTRIBUTES_PATH, url());
   }
 
   void build_children_from_attributes(Object *base, const Value &attrss);
 
+  /** Register (or renew our lease) as an observer of the remote tree and
+   * fetch the changes since our version so that it stays recent while we are
+   * connected (a reconnection then only needs the latest changes).
+   */
+  void register_with_remote();
+
+  /** Ask for the changes since our version (or for the remote version and
+   * walk the tree if we do not have a mirror yet).
+   */
+  void fetch_changes();
+
+  /** Apply a page of changes from the remote tree's journal (CHANGES_PATH
+   * reply) and ask for the next page.
+   */
+  void apply_changes(const Value &changes);
+
   /** Reference to the original tree this root proxies. When the RootProxy is adopted
    *  by a command, this is used as key to route 'reply' messages.
    */
@@ -147,6 +205,38 @@ private:
   /** The link to the proxy factory is used by the RootProxy when it needs to create
    *  new ObjectProxies. */
   ProxyFactory *proxy_factory_;
+
+  /** Protects the collected queries.
+   */
+  Mutex queries_mutex_;
+
+  /** Paths to query by meta method.
+   */
+  std::map<std::string, std::vector<std::string> > queries_;
+
+  /** Set when the flush is scheduled (until it takes the queries).
+   */
+  bool queries_scheduled_;
+
+  TTimerEvent<RootProxy, &RootProxy::flush_queries> flush_event_;
+
+  /** Interval between two registrations [ms].
+   */
+  Real register_interval_;
+
+  /** Renews the registration while the proxy has a command.
+   */
+  TTimerEvent<RootProxy, &RootProxy::register_with_remote> register_event_;
+
+  /** Protects version_ (replies and timer events run in different threads).
+   */
+  Mutex version_mutex_;
+
+  /** Version of the remote tree mirrored as sent by the remote (see
+   * ChangesMetaMethod), nil until known. When the proxy is connected again,
+   * only the changes since this version are fetched.
+   */
+  Value version_;
 };
 
 
@@ -43,18 +43,28 @@ class ScaleReal {
                        target_max_(target_max) {
     assert(source_min != source_max);
     scale_ = (target_max - target_min) / (source_max - source_min);
+    // clamp bounds (target_max can be smaller then target_min)
+    low_  = target_min < target_max ? target_min : target_max;
+    high_ = target_min < target_max ? target_max : target_min;
   }
-  
+
   Real scale(Real source_value) const {
     Real res = target_min_ + ( (source_value - source_min_) * scale_);
-    return res < target_min_ ? target_min_ : (res > target_max_ ? target_max_ : res);
+    return res < low_ ? low_ : (res > high_ ? high_ : res);
   }
- 
+
+  /** Scale and clamp 'count' contiguous values from 'source' into 'target'
+   * (both arrays can be the same). Uses SSE2 when available.
+   */
+  void scale(const Real *source, Real *target, size_t count) const;
+
  private:
   Real source_min_;
   Real target_min_;
   Real target_max_;
   Real scale_;
+  Real low_;
+  Real high_;
 };
 
 }  // oscit
@@ -32,6 +32,8 @@
 #include <string>
 
 #include "oscit/conf.h"
+#include "oscit/file_watcher.h"
+#include "oscit/mutex.h"
 #include "oscit/values.h"
 
 namespace oscit {
@@ -57,7 +59,8 @@ public:
 
   /** Reload time in seconds.
    * This is the value for the minimum amount of time between
-   * two file modification time verifications.
+   * two file modification time verifications (when the file is
+   * not watched with inotify).
    */
   const Value reload(const Value &val);
 
@@ -77,6 +80,16 @@ public:
 
  protected:
 
+  /** Reload the script from a background thread when the file changes
+   * instead of relying on 'reload_script'. Sub-classes using this must call
+   * 'stop_watching_script' in their destructor.
+   */
+  void watch_script_file();
+
+  /** Stop the file watcher (waits for a running reload to finish).
+   */
+  void stop_watching_script();
+
   /** Ask for a script reload.
    * If reload_every_ time has not elapsed, the call is ignored.
    * If the file's modification time has not changed, nothing
@@ -129,8 +142,21 @@ public:
   /** Current logical time.
    */
   time_t current_time_;
+
+  /** Protects script content and file state (the file watcher reloads from
+   * its own thread).
+   */
+  Mutex script_mutex_;
 private:
 
+  /** Called by the file watcher.
+   */
+  void script_file_changed();
+
+  /** Watches script_file_ (NULL if the file is not watched).
+   */
+  TFileWatcher<Script, &Script::script_file_changed> *watcher_;
+
   /** Load script and evaluate content.
    */
   const Value load_script_from_file(bool is_new);
@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_SEND_QUEUE_H_
+#define OSCIT_INCLUDE_OSCIT_SEND_QUEUE_H_
+
+#include <pthread.h>
+#include <deque>
+#include <list>
+
+#include "oscit/c_reference_counted.h"
+#include "oscit/location.h"
+#include "oscit/non_copyable.h"
+#include "oscit/thash.h"
+#include "oscit/thread.h"
+#include "oscit/values.h"
+
+namespace oscit {
+
+/** Default number of pending packets per observer.
+ */
+#define SEND_QUEUE_DEPTH 64
+
+#define SEND_QUEUE_HASH_SIZE 100
+
+/** Encoded message shared by all the observers it is sent to. The
+ * packet is released by the SendQueue once it has been sent to everyone.
+ */
+class SendPacket : public CReferenceCounted {
+public:
+  /** Copy 'size' bytes of encoded data.
+   */
+  SendPacket(const char *data, size_t size);
+
+  virtual ~SendPacket() {
+    delete[] data_;
+  }
+
+  const char *data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  char *data_;
+  size_t size_;
+};
+
+/** Sends packets to observers from a single thread. Each observer has a
+ * bounded queue: when an observer does not keep up, its oldest packet is
+ * dropped and other observers are not affected. Observers with pending
+ * packets are served in turn (one packet each).
+ *
+ * Thread safe.
+ */
+class SendQueue : private NonCopyable {
+public:
+  SendQueue(size_t depth = SEND_QUEUE_DEPTH);
+
+  /** Sub-classes must call 'stop' in their destructor.
+   */
+  virtual ~SendQueue();
+
+  /** Queue the packet for each location (the packet is retained for each
+   * location).
+   */
+  void push(const std::list<Location> &locations, SendPacket *packet);
+
+  void push(const Location &location, SendPacket *packet);
+
+  /** Drop pending packets and metrics for an observer.
+   */
+  void remove(const Location &location);
+
+  /** Stop the sender thread (pending packets are dropped).
+   */
+  void stop();
+
+  /** Number of packets waiting to be sent.
+   */
+  size_t pending();
+
+  /** Number of packets waiting to be sent to an observer.
+   */
+  size_t depth(const Location &location);
+
+  /** Number of packets dropped because an observer's queue was full.
+   */
+  size_t dropped_count();
+
+  /** Number of packets sent.
+   */
+  size_t sent_count();
+
+  /** Return counters and per observer metrics (depth, max_depth, dropped,
+   * sent) in a HashValue.
+   */
+  const Value stats();
+
+  size_t max_depth() const {
+    return max_depth_;
+  }
+
+protected:
+  /** Executed from the sender thread.
+   */
+  virtual void send(const Location &location, const SendPacket &packet) = 0;
+
+private:
+  struct Peer {
+    Peer(const Location &location)
+      : location_(location), max_depth_(0), dropped_(0), sent_(0),
+        ready_(false), removed_(false) {}
+
+    Location location_;
+    std::deque<SendPacket*> packets_;
+    size_t max_depth_;
+    size_t dropped_;
+    size_t sent_;
+
+    /** The peer is in ready_ (or being served).
+     */
+    bool ready_;
+
+    /** Removed while a packet was being sent: deleted by the sender.
+     */
+    bool removed_;
+  };
+
+  /** Must be called with the lock.
+   */
+  void push(Peer *peer, SendPacket *packet);
+
+  /** Release pending packets. Must be called with the lock.
+   */
+  void clear(Peer *peer);
+
+  /** Release pending packets and delete the peer. Must be called with the lock.
+   */
+  void destroy(Peer *peer);
+
+  void run(Thread *runner);
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+
+  THash<Location, Peer*> peers_;
+
+  /** Peers with pending packets (in turn).
+   */
+  std::deque<Peer*> ready_;
+
+  /** Peer being served by the sender thread (NULL if none).
+   */
+  Peer *sending_;
+
+  size_t max_depth_;
+  size_t pending_;
+  size_t dropped_;
+  size_t sent_;
+  bool should_run_;
+
+  Thread thread_;
+};
+
+/** SendQueue calling a method on an owner.
+ */
+template<class T, void(T::*Tmethod)(const Location&, const SendPacket&)>
+class TSendQueue : public SendQueue {
+public:
+  TSendQueue(T *owner, size_t depth = SEND_QUEUE_DEPTH) :
+             SendQueue(depth), owner_(owner) {}
+
+  virtual ~TSendQueue() {
+    stop();
+  }
+
+protected:
+  virtual void send(const Location &location, const SendPacket &packet) {
+    (owner_->*Tmethod)(location, packet);
+  }
+
+private:
+  T *owner_;
+};
+
+}  // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_SEND_QUEUE_H_
@@ -33,20 +33,34 @@
 #include "oscit/values.h"
 #include "oscit/c_tlist.h"
 #include "oscit/observer.h"
+#include "oscit/mutex.h"
+#include "oscit/atomic_counter.h"
+#include "oscit/non_copyable.h"
 
-#include <list>
+#include <vector>
 
 namespace oscit {
 
 /** A Signal is a callback slot where observers can connect in order to receive
  * notifications. When the either end is deleted, the connection is automatically
  * removed.
+ *
+ * Connections are stored in an immutable array: connect and disconnect publish
+ * a new copy so that 'send' is a plain loop without any lock. Senders are
+ * counted by epoch: disconnect only waits for the senders that started before
+ * it and removed connections are reclaimed once no other thread is sending.
+ *
+ * If the observer uses asynchronous delivery (Observer::set_async_delivery),
+ * 'send' only pushes the value in the observer's queue.
  * Thread safe.
  */
-class Signal {
+class Signal : private NonCopyable {
 public:
+  Signal() : callbacks_(NULL), epoch_(0) {}
+
   ~Signal() {
     disconnect_all();
+    free_retired();
   }
 
   /** Use this method to connect an observer's method to this signal.
@@ -55,39 +69,39 @@ public:
    */
   template<class T>
   void connect(T *receiver, void (T::*Tmethod)(const Value&)) {
-    SignalCallback *callback = new TSignalCallback<T>(receiver, Tmethod);
-
-    { ScopedWrite lock(callbacks_);
-      callbacks_.push_back(callback);
-    }
+    TSignalCallback<T> *callback = new TSignalCallback<T>(receiver, Tmethod);
+    add_connection(build_connection(receiver, &TSignalCallback<T>::call, callback, callback));
+    receiver->connect_signal(this);
+  }
 
+  /** Connect an observer's method known at compile time. This avoids the
+   * allocation of a callback object and the indirection through the
+   * pointer to member.
+   */
+  template<class T, void (T::*Tmethod)(const Value&)>
+  void connect(T *receiver) {
+    add_connection(build_connection(receiver, &cast_method<T, Tmethod>, receiver, NULL));
     receiver->connect_signal(this);
   }
 
   /** Send a message to all connected observers.
    */
   void send(const Value &val) {
-    ScopedRead lock(callbacks_);
-    CTList<SignalCallback*>::iterator it, end = callbacks_.end();
-
-    for(it = callbacks_.begin(); it != end; ++it) {
-      (*it)->trigger(val);
+    Sender sender(this);
+    CallbackArray *callbacks = sender.callbacks();
+    if (!callbacks) return;
+
+    Connection *it  = callbacks->connections_;
+    Connection *end = it + callbacks->size_;
+    for(; it != end; ++it) {
+      (*it->function_)(it->data_, val);
     }
   }
 
-  /** Send a message to all connected observers and disconnect them.
+  /** Send a message to all connected observers and disconnect them. Since
+   * the connections are removed, observers are always called synchronously.
    */
-  void send_once(const Value &val) {
-    ScopedRead lock(callbacks_);
-    CTList<SignalCallback*>::iterator it, end = callbacks_.end();
-
-    for(it = callbacks_.begin(); it != end;) {
-      (*it)->receiver_->disconnect_signal(this);
-      (*it)->trigger(val);
-      delete *it;
-      it = callbacks_.erase(it);
-    }
-  }
+  void send_once(const Value &val);
 
   /** Disconnect a specific observer.
    */
@@ -96,21 +110,34 @@ public:
     receiver->disconnect_signal(this);
   }
 
+  /** Number of connections.
+   */
+  size_t connection_count() {
+    Sender sender(this);
+    CallbackArray *callbacks = sender.callbacks();
+    return callbacks ? callbacks->size_ : 0;
+  }
+
 private:
   friend class Observer;
 
-  typedef void (*signal_method_t)(Observer *receiver, const Value &val);
+  typedef void (*signal_method_t)(void *data, const Value &val);
 
+  /** Holds a pointer to member for connections made at runtime.
+   */
   struct SignalCallback {
-
     SignalCallback(Observer *receiver) : receiver_(receiver) {}
 
-    virtual void trigger(const Value &val) = 0;
+    virtual ~SignalCallback() {}
+
+    /** Called when the connection is removed (once no other thread
+     * can use it).
+     */
+    virtual void detach() {}
 
     /** Object containing the method.
      */
     Observer *receiver_;
-
   };
 
   /** Connection that stores the pointer to member and receiver.
@@ -120,48 +147,180 @@ private:
     TSignalCallback(Observer *receiver, void (T::*Tmethod)(const Value &))
       : SignalCallback(receiver), member_method_(Tmethod) {}
 
-    virtual void trigger(const Value &val) {
-      ((T*)receiver_->*member_method_)(val);
+    static void call(void *data, const Value &val) {
+      TSignalCallback *callback = (TSignalCallback*)data;
+      ((T*)callback->receiver_->*callback->member_method_)(val);
     }
 
     /** Pointer to member method.
      */
-		void (T::*member_method_)(const Value &);
+    void (T::*member_method_)(const Value &);
   };
 
-  /** Remove all connections to an observer.
-   * This method is only called by disconnect.
+  /** Connection delivering through the observer's queue. Owns the
+   * callback used for the actual delivery.
    */
-  void disconnect_observer(Observer *observer) {
-    ScopedWrite lock(callbacks_);
-    CTList<SignalCallback*>::iterator it, end = callbacks_.end();
-
-    for(it = callbacks_.begin(); it != end;) {
-      if ((*it)->receiver_ == observer) {
-        delete *it;
-        it = callbacks_.erase(it);
-      } else {
-        ++it;
-      }
+  struct QueuedCallback : public SignalCallback {
+    QueuedCallback(Observer *receiver, DeliveryQueue *queue, signal_method_t function, void *data, SignalCallback *inner)
+      : SignalCallback(receiver), slot_(queue, function, data), inner_(inner) {}
+
+    virtual ~QueuedCallback() {
+      delete inner_;
     }
+
+    static void push(void *data, const Value &val) {
+      QueuedCallback *callback = (QueuedCallback*)data;
+      DeliveryQueue *queue = callback->slot_.queue_;
+      if (queue) queue->push(&callback->slot_, val);
+    }
+
+    virtual void detach() {
+      if (slot_.queue_) slot_.queue_->detach(&slot_);
+    }
+
+    DeliveryQueue::Slot slot_;
+    SignalCallback *inner_;
+  };
+
+  /** Make a plain function from a member method.
+   */
+  template<class T, void (T::*Tmethod)(const Value&)>
+  static void cast_method(void *data, const Value &val) {
+    (((T*)data)->*Tmethod)(val);
   }
 
+  /** An entry in the array of connections.
+   */
+  struct Connection {
+    Connection() {}
+
+    Connection(Observer *receiver, signal_method_t function, void *data, SignalCallback *callback)
+      : receiver_(receiver), function_(function), data_(data), callback_(callback),
+        direct_function_(function), direct_data_(data) {}
+
+    Observer *receiver_;
+    signal_method_t function_;
+    void *data_;
+
+    /** Owned callback object (NULL for compile time connections).
+     */
+    SignalCallback *callback_;
+
+    /** Synchronous call (same as function_/data_ if the connection is
+     * not queued).
+     */
+    signal_method_t direct_function_;
+    void *direct_data_;
+  };
+
+  /** Immutable array of connections (never changed once published).
+   */
+  struct CallbackArray {
+    CallbackArray(size_t size) : size_(size), connections_(new Connection[size]) {}
+
+    ~CallbackArray() {
+      delete[] connections_;
+    }
+
+    size_t size_;
+    Connection *connections_;
+  };
+
+  /** Marks the current thread as sending during its lifetime so that
+   * writers do not reclaim an array that is still in use.
+   */
+  class Sender {
+  public:
+    Sender(Signal *signal);
+    ~Sender();
+
+    CallbackArray *callbacks() {
+      return callbacks_;
+    }
+
+  private:
+    friend class Signal;
+    Signal *signal_;
+    Sender *previous_;
+    CallbackArray *callbacks_;
+
+    /** Epoch in which the sender is counted.
+     */
+    int epoch_;
+  };
+
+  /** Create a connection (queued if the receiver uses asynchronous delivery).
+   */
+  Connection build_connection(Observer *receiver, signal_method_t function, void *data, SignalCallback *callback);
+
+  void add_connection(const Connection &connection);
+
+  /** Remove all connections to an observer.
+   * This method is only called by disconnect.
+   */
+  void disconnect_observer(Observer *observer);
+
   /** Remove all connections.
    * This method is called on Signal destruction.
    */
-  void disconnect_all() {
-    ScopedWrite lock(callbacks_);
-    CTList<SignalCallback*>::iterator it, end = callbacks_.end();
+  void disconnect_all();
 
-    for(it = callbacks_.begin(); it != end;) {
-      (*it)->receiver_->disconnect_signal(this);
-      it = callbacks_.erase(it);
-    }
-  }
+  /** Publish a new array and retire the old one. Must be called with
+   * write_mutex_ locked.
+   */
+  void publish(CallbackArray *callbacks);
+
+  /** Wait for senders in other threads that started before this call to
+   * finish. Must be called with write_mutex_ locked, after publish.
+   */
+  void wait_for_senders();
+
+  /** Wait until the senders counted in the given epoch are only the ones of
+   * the current thread.
+   */
+  void wait_for_epoch(int epoch);
+
+  /** Retire removed callbacks: detach them (no other thread can use them
+   * once publish and wait_for_senders are done) and free them later. Must be
+   * called without write_mutex_ locked.
+   */
+  void retire_callbacks(std::vector<SignalCallback*> &callbacks);
+
+  /** Free retired arrays and callbacks if no other thread is sending.
+   * Must be called with write_mutex_ locked.
+   */
+  void reclaim();
+
+  /** Delete retired arrays and callbacks.
+   */
+  void free_retired();
+
+  /** Number of active senders in the current thread for this signal in the
+   * given epoch.
+   */
+  size_t own_senders(int epoch);
+
+  /** Current array of connections (NULL if there are no connections).
+   */
+  CallbackArray * volatile callbacks_;
+
+  /** Number of threads currently in 'send' (by epoch).
+   */
+  AtomicCounter senders_[2];
+
+  /** Epoch of new senders (0 or 1). Writers flip it so that they do not
+   * wait for senders starting after them.
+   */
+  volatile int epoch_;
+
+  /** Serializes connect/disconnect.
+   */
+  Mutex write_mutex_;
 
-  /** List of connections through which the signal will be sent.
+  /** Arrays and callbacks waiting for all senders to finish.
    */
-  CTList<SignalCallback*> callbacks_;
+  std::vector<CallbackArray*> retired_arrays_;
+  std::vector<SignalCallback*> retired_callbacks_;
 };
 
 
@@ -177,4 +336,4 @@ inline void Observer::disconnect_all() {
 
 } // oscit
 
-#endif // OSCIT_INCLUDE_OSCIT_SIGNAL_H_
\ No newline at end of file
+#endif // OSCIT_INCLUDE_OSCIT_SIGNAL_H_
@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_SLAB_ALLOCATOR_H_
+#define OSCIT_INCLUDE_OSCIT_SLAB_ALLOCATOR_H_
+
+#include <stddef.h> // size_t
+#include <vector>
+
+#include "oscit/mutex.h"
+#include "oscit/non_copyable.h"
+
+namespace oscit {
+
+/** Block sizes of the shared allocators are rounded up to this value.
+ */
+#define SLAB_ALLOCATOR_GRANULARITY 16
+
+/** Larger blocks are allocated with operator new.
+ */
+#define SLAB_ALLOCATOR_MAX_SIZE 2048
+
+/** Size of a slab in bytes.
+ */
+#define SLAB_ALLOCATOR_SLAB_SIZE 65536
+
+/** Allocates fixed size blocks carved from large slabs so that building a
+ * big tree does not call malloc for every node and nodes stay close in
+ * memory. Freed blocks are kept in a free list for reuse: slabs are only
+ * released when the allocator is destroyed.
+ *
+ * Object uses the shared allocators (one per size class) through 'allocate'
+ * and 'deallocate'.
+ */
+class SlabAllocator : private NonCopyable {
+public:
+  explicit SlabAllocator(size_t block_size, size_t slab_size = SLAB_ALLOCATOR_SLAB_SIZE);
+
+  ~SlabAllocator();
+
+  void *alloc();
+
+  void free(void *ptr);
+
+  size_t block_size() const {
+    return block_size_;
+  }
+
+  /** Number of blocks in use.
+   */
+  size_t used();
+
+  /** Number of slabs allocated.
+   */
+  size_t slab_count();
+
+  /** Allocate 'size' bytes from the shared allocator of the matching size
+   * class (thread-safe).
+   */
+  static void *allocate(size_t size);
+
+  /** Free memory obtained with 'allocate' ('size' must be the same).
+   */
+  static void deallocate(void *ptr, size_t size);
+
+private:
+  static SlabAllocator *size_class(size_t size);
+
+  Mutex mutex_;
+  size_t block_size_;
+  size_t blocks_per_slab_;
+
+  /** Freed blocks (each block starts with a pointer to the next one).
+   */
+  void *free_list_;
+
+  /** Next never used block in the last slab.
+   */
+  char *next_;
+  char *end_;
+
+  std::vector<char*> slabs_;
+  size_t used_;
+};
+
+}  // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_SLAB_ALLOCATOR_H_
@@ -31,10 +31,13 @@
 #define OSCIT_INCLUDE_OSCIT_THASH_H_
 
 #include <cstdio>
+#include <new> // placement new
 #include <string>
 #include <list>
 #include <iostream>
 
+#include "oscit/slab_allocator.h"
+
 typedef unsigned int uint;
 
 namespace oscit {
@@ -47,14 +50,29 @@ struct THashElement
 {
   THashElement() : obj(0), next(0) {}
   ~THashElement() { if (obj) delete obj; }
+
+  /** Collision elements are allocated from the shared slabs (see
+   * SlabAllocator).
+   */
+  static void *operator new(size_t size) {
+    return SlabAllocator::allocate(size);
+  }
+
+  static void operator delete(void *ptr, size_t size) {
+    SlabAllocator::deallocate(ptr, size);
+  }
+
   K     key;
   T*    obj;
   /// lookup collision chain
   THashElement<K,T> * next;
+  /// position in the list of keys
+  typename std::list<K>::iterator position;
 };
 
 /** Dictionary. The dictionary stores a copy of the data. Pointers to the copy are returned.
   * We return pointers so that we can return NULL if the value is not found.
+  * The table is only allocated when the first element is set.
   * K is the key class, T is the object class
   */
 template <class K, class T>
@@ -63,9 +81,7 @@ public:
   typedef typename std::list<K>::const_iterator ConstIterator;
   typedef typename std::list<K>::iterator Iterator;
 
-  THash(unsigned int size) : size_(size) {
-    thash_table_ = new THashElement<K,T>[size];
-  }
+  THash(unsigned int size) : thash_table_(NULL), size_(size) {}
 
   // copy constructor (even if we do not use it, we need it for object instantiation: explicit not possible)
   THash(const THash& other) {
@@ -74,6 +90,7 @@ public:
 
   virtual ~THash() {
     THashElement<K,T> * current, * next;
+    if (!thash_table_) return;
     // remove collisions
     for(size_t i=0;i<size_;i++) {
       current = thash_table_[i].next;
@@ -84,7 +101,7 @@ public:
       }
     }
     // remove table
-    delete[] thash_table_;
+    free_table(thash_table_, size_);
   }
 
   THash& operator=(const THash& other) {
@@ -98,7 +115,7 @@ public:
     T value;
 
     size_ = other.size_;
-    thash_table_ = new THashElement<K,T>[size_];
+    thash_table_ = NULL;
 
     for(it = other.begin(); it != end; it++) {
       if (other.get(*it, &value)) {
@@ -138,16 +155,10 @@ public:
 
   /** Remove object with the given key. */
   void remove(const K &key) {
-    if (remove_keeping_key(key)) {
-      // object has been removed, remove key
-      Iterator it  = keys_.begin();
-      Iterator end = keys_.end();
-      while (it != end) {
-        if (*it == key)
-          it = keys_.erase(it);
-        else
-          it++;
-      }
+    THashElement<K,T> *found = find(key);
+    if (found) {
+      keys_.erase(found->position);
+      remove_keeping_key(key);
     }
   }
 
@@ -207,6 +218,35 @@ public:
 protected:
   bool remove_keeping_key(const K &key);
 
+  /** Find the element for the given key (NULL if not found).
+   */
+  THashElement<K,T> *find(const K &key) const {
+    if (!thash_table_) return NULL;
+    THashElement<K,T> *found = &(thash_table_[hashId(key) % size_]);
+    while (found && found->obj && found->key != key)
+      found = found->next;
+
+    return (found && found->obj) ? found : NULL;
+  }
+
+  /** Allocate the table from the shared slabs (see SlabAllocator).
+   */
+  static THashElement<K,T> *alloc_table(size_t size) {
+    THashElement<K,T> *table = static_cast<THashElement<K,T>*>(
+        SlabAllocator::allocate(size * sizeof(THashElement<K,T>)));
+    for (size_t i = 0; i < size; ++i) {
+      ::new(table + i) THashElement<K,T>();
+    }
+    return table;
+  }
+
+  static void free_table(THashElement<K,T> *table, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      table[i].~THashElement<K,T>();
+    }
+    SlabAllocator::deallocate(table, size * sizeof(THashElement<K,T>));
+  }
+
   /* data */
   THashElement<K,T> * thash_table_;
   std::list<K>        keys_;
@@ -219,6 +259,7 @@ void THash<K,Te>::set(const K& key, const Te& pElement) {
   THashElement<K,Te> *  found;
   THashElement<K,Te> ** set_next;
   uint id = hashId(key) % size_;
+  if (!thash_table_) thash_table_ = alloc_table(size_);
   found    = &(thash_table_[id]);  // pointer to found element
   set_next = &(found->next);      // where to write the new inserted value if there is one
 
@@ -244,6 +285,7 @@ void THash<K,Te>::set(const K& key, const Te& pElement) {
   } else {
     // new key
     keys_.push_back(key);
+    found->position = --keys_.end();
   }
   found->obj  = new Te(pElement); // new T(pElement) does not compile in mimas with libjuce...
   found->key  = key;              // T is a macro to create juce String elements...
@@ -254,7 +296,7 @@ bool THash<K,T>::get(const K &key, T *retval) const {
   THashElement<K,T> *found;
   uint id = hashId(key) % size_;
 
-  found = &(thash_table_[id]);
+  found = thash_table_ ? &(thash_table_[id]) : NULL;
   while (found && found->obj && found->key != key)
     found = found->next;
 
@@ -271,7 +313,7 @@ bool THash<K,T>::has_key(const K &key) const {
   THashElement<K,T> *found;
   uint id = hashId(key) % size_;
 
-  found = &(thash_table_[id]);
+  found = thash_table_ ? &(thash_table_[id]) : NULL;
   while (found && found->obj && found->key != key)
     found = found->next;
 
@@ -287,7 +329,7 @@ bool THash<K,T>::get(const K &key, const T **retval) const {
   THashElement<K,T> *found;
   uint id = hashId(key) % size_;
 
-  found = &(thash_table_[id]);
+  found = thash_table_ ? &(thash_table_[id]) : NULL;
   while (found && found->obj && found->key != key)
     found = found->next;
 
@@ -304,7 +346,7 @@ bool THash<K,T>::get(const K &key, T **retval) {
   THashElement<K,T> *found;
   uint id = hashId(key) % size_;
 
-  found = &(thash_table_[id]);
+  found = thash_table_ ? &(thash_table_[id]) : NULL;
   while (found && found->obj && found->key != key)
     found = found->next;
 
@@ -339,7 +381,7 @@ bool THash<K,T>::remove_keeping_key(const K& key) {
   THashElement<K,T> *  found, * next;
   THashElement<K,T> ** set_next;
   uint id = hashId(key) % size_;
-  found    = &(thash_table_[id]);  // pointer to found element
+  found    = thash_table_ ? &(thash_table_[id]) : NULL;  // pointer to found element
   set_next = NULL;                // where to write removed element's next if there is one
 
   while (found && found->obj && found->key != key) {
@@ -362,6 +404,7 @@ bool THash<K,T>::remove_keeping_key(const K& key) {
         found->obj  = next->obj;
         next->obj   = NULL;  // to avoid Real delete
         found->key  = next->key;
+        found->position = next->position;
         found->next = next->next;
         delete next;
       } else {
@@ -465,9 +508,11 @@ inline uint hashId(const unsigned long key) {
 /** Hashing function null terminated character strings.
  * sdbm function: taken from http://www.cse.yorku.ca/~oz/hash.html
  * This is *not* the same as the Hash macro !
+ * Hashing can continue from the hash of a prefix:
+ * hashId(str, hashId(prefix)) == hashId(prefix + str).
  */
-inline uint hashId(const char *str) {
-  unsigned long h = 0;
+inline uint hashId(const char *str, uint prefix_id) {
+  unsigned long h = prefix_id;
   int c;
 
   while ( (c = *str++) ) {
@@ -477,6 +522,12 @@ inline uint hashId(const char *str) {
   return h;
 }
 
+/** Hashing function null terminated character strings (see above).
+ */
+inline uint hashId(const char *str) {
+  return hashId(str, 0);
+}
+
 // We use the simpler hash to avoid too long compile times in the static string hash macro.
 inline uint hashId(const char c) {
   return (uint)c;
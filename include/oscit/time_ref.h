@@ -31,22 +31,61 @@
 #define OSCIT_INCLUDE_OSCIT_TIME_REF_H_
 
 #include <sys/types.h>  // time_t
+#include <stdint.h>     // int64_t
 
 #include "oscit/non_copyable.h"
 
 namespace oscit {
 
+/** Monotonic time reference. All times are relative to the moment
+ * the TimeRef object was created (or last reset).
+ */
 class TimeRef : private NonCopyable {
 public:
-  TimeRef();
-  ~TimeRef();
+  TimeRef() : reference_(now()) {}
 
   /** Get current real time in [ms] since the time ref object was created.
    */
-  time_t elapsed();
+  time_t elapsed() const {
+    return (time_t)((now() - reference_) / 1000000);
+  }
+
+  /** Get current real time in [us] since the time ref object was created.
+   */
+  int64_t elapsed_us() const {
+    return (now() - reference_) / 1000;
+  }
+
+  /** Get current real time in [ns] since the time ref object was created.
+   */
+  int64_t elapsed_ns() const {
+    return now() - reference_;
+  }
+
+  /** Move the reference point to the current time.
+   */
+  void reset() {
+    reference_ = now();
+  }
+
+  /** Current time of the monotonic clock in [ns]. The origin is arbitrary
+   * so this should only be used to compute durations.
+   */
+  static int64_t now();
+
+  /** Current time in [ns] read from the cpu cycle counter (rdtsc) when
+   * available. The counter is calibrated against now() on first use (this
+   * first call blocks for a few milliseconds). Falls back to now() on
+   * platforms without a usable cycle counter.
+   * Use this to measure short durations: it is cheaper than now() but it
+   * can drift from the monotonic clock over long periods.
+   */
+  static int64_t fast_now();
+
 private:
-  struct TimeRefData;
-  TimeRefData *reference_;
+  /** Monotonic time in [ns] when the object was created.
+   */
+  int64_t reference_;
 };
 
 } // oscit
@@ -30,179 +30,110 @@
 #ifndef OSCIT_INCLUDE_OSCIT_TIMER_H_
 #define OSCIT_INCLUDE_OSCIT_TIMER_H_
 
-#include "oscit/thread.h"
-#include "oscit/mutex.h"
-#include "oscit/time_ref.h"
+#include "oscit/conf.h"
+#include "oscit/timer_wheel.h"
+#include "oscit/timer_stats_method.h"
 
 namespace oscit {
 
+/** Call a method on an object at regular intervals. Intervals are
+ * expressed in [ms] but can be fractional (0.5 = 500us).
+ *
+ * Timers do not own a thread: they are scheduled in a TimerWheel (the
+ * process wide TimerWheel::shared() by default) and the callbacks run in
+ * the wheel's worker threads.
+ */
 template<class T, void(T::*Tmethod)()>
 class Timer {
 public:
-  Timer(T *owner, time_t interval = 0)
-      : owner_(owner),
+  Timer(T *owner, Real interval = 0, TimerWheel *wheel = NULL)
+      : event_(owner),
         interval_(interval),
-        last_interval_(interval),
+        wheel_(wheel ? wheel : TimerWheel::shared()),
         running_(false) {}
 
   ~Timer() {
-    // we could let Thread cancel the loop in ~Thread, but we
-    // prefer to ensure we don't access stale data.
+    // make sure the callback is not running when the owner goes away
     stop();
   }
 
-  void start(time_t interval) {
-    ScopedLock lock(mutex_);
-    last_interval_ = interval_;
+  /** Fire now and then every 'interval' [ms].
+   */
+  void start(Real interval) {
     interval_ = interval;
-    if (running_) {
-      should_run_ = false;
-      interrupt();
-      thread_.join();
-    }
-    thread_.start_thread<Timer, &Timer::start_thread>(this, NULL);
+    start();
   }
 
+  /** Fire now and then every interval() [ms]. If the timer is already
+   * running, this re-anchors the timer.
+   */
   void start() {
-    ScopedLock lock(mutex_);
-    if (running_) {
-      should_run_ = false;
-      interrupt();
-      thread_.join();
-    }
-    thread_.start_thread<Timer, &Timer::start_thread>(this, NULL);
+    running_ = true;
+    wheel_->schedule(&event_, interval_);
   }
 
+  /** Stop the timer. If the callback is running in another thread, this
+   * method waits for it to finish.
+   */
   void stop() {
-    ScopedLock lock(mutex_);
-    if (running_) {
-      should_run_ = false;
-      interrupt();
-      thread_.join();
-    }
+    running_ = false;
+    wheel_->cancel(&event_);
   }
 
-  void set_interval(time_t interval) {
-    ScopedLock lock(mutex_);
-    last_interval_ = interval_;
+  /** Change the interval without firing. The next call happens 'interval'
+   * after the last one (skipping past occurrences).
+   */
+  void set_interval(Real interval) {
     interval_ = interval;
     if (running_) {
-      interrupt();
+      wheel_->set_interval(&event_, interval);
     }
   }
 
-  bool running() const {
-    return running_;
-  }
-
-private:
-  void run() {
-    time_t wait_duration;
-    time_t now;
-    time_t next_fire = time_ref_.elapsed(); // this is our anchor
-    struct timespec sleeper;
-
-    while (should_run_) {
-      { ScopedLock lock(mutex_);
-
-        now = time_ref_.elapsed();
-
-        // This can be used to ensure test...
-        // printf("logical: %li real: %li wait: %li\n", next_fire, now, wait_duration);
-
-        if (next_fire > now) {
-          // interrupted
-          // we do not fire on interval change
-          next_fire -= last_interval_;
-        } else {
-          (owner_->*Tmethod)();
-        }
-
-       /* Timer sync issues:
-        * We compute the new logical fire and sleep to sync real trigger as close as we can.
-        */
-        next_fire += interval_;
-
-        wait_duration = next_fire - now;
-        if (wait_duration < 0) {
-          if (interval_ > 0) {
-            // this can happen if we changed interval_ during sleep
-            // next_fire + k * interval_ > now
-            int k = ((now - next_fire) / interval_) + 1; // +1 because we need to respect '>'
-            // skip 'k' occurences
-            next_fire += k * interval_;
-            wait_duration = next_fire - now;
-          } else {
-            // run as fast as we can
-            // we could limit this to 1ms...
-            wait_duration = 0;
-          }
-        }
-
-        sleeper.tv_sec  = wait_duration / 1000;
-        sleeper.tv_nsec = (wait_duration % 1000) * 1000000; // 1'000'000
-      }
-
-      nanosleep(&sleeper, NULL);
-    }
-
-    running_ = false;
+  /** Current interval in [ms].
+   */
+  Real interval() const {
+    return interval_;
   }
 
-  static void interrupt_sleep(int sig) {
-    // we need to reregister signal
-    signal(SIGUSR1, Timer::interrupt_sleep);
-    // we just interrupted sleep, let the loop continue
-    return;
+  bool running() const {
+    return running_;
   }
 
-  /** Must be called within a loop lock.
+  /** Lateness, callback duration and skipped ticks since the timer
+   * was created (or since the last reset_stats).
    */
-  void interrupt() {
-    thread_.send_signal(SIGUSR1);
+  TimerStats stats() {
+    return wheel_->stats(&event_);
   }
 
-  void start_thread(Thread *runner) {
-    signal(SIGUSR1, Timer::interrupt_sleep);
-    should_run_ = true;
-    running_ = true;
-    runner->high_priority();
-    runner->thread_ready();
-    run();
+  void reset_stats() {
+    wheel_->reset_stats(&event_);
   }
 
-  /** Object to trigger.
+  /** Create a method in 'object' (usually the owner) to query the
+   * statistics over OSC. The timer must live as long as the method.
    */
-  T *owner_;
-
-  /** Loop interval.
-   */
-  time_t interval_;
-
-  /** We need this to anchor next_fire in case interval
-   * changes.
-   */
-  time_t last_interval_;
+  Object *expose_stats(Object *object, const char *name = TIMER_STATS_METHOD) {
+    return object->adopt(new TimerStatsMethod(name, wheel_, &event_));
+  }
 
-  /** We want to hold very precise timing.
+private:
+  /** Event scheduled in the wheel (calls the owner's method).
    */
-  TimeRef time_ref_;
+  TTimerEvent<T, Tmethod> event_;
 
-  /** Protect internals.
+  /** Loop interval in [ms].
    */
-  Mutex mutex_;
+  Real interval_;
 
-  /** Running thread.
+  /** Wheel used to schedule the events.
    */
-  Thread thread_;
+  TimerWheel *wheel_;
 
-  /** Flag indicating if the thread is actually running.
+  /** Flag indicating if the timer is scheduled.
    */
   bool running_;
-
-  /** Flag indicating that we want the timer to fire or die.
-   */
-  bool should_run_;
 };
 
 } // oscit
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_TIMER_STATS_H_
+#define OSCIT_INCLUDE_OSCIT_TIMER_STATS_H_
+
+#include <stdint.h>  // int64_t
+
+#include "oscit/conf.h"
+#include "oscit/values.h"
+
+namespace oscit {
+
+/** Number of buckets in the lateness and duration histograms.
+ */
+#define TIMER_STATS_BUCKETS 12
+
+/** Upper bound of the first histogram bucket in [ns] (16us). Each following
+ * bucket doubles the bound (the last bucket holds everything above ~16ms).
+ */
+#define TIMER_STATS_FIRST_BUCKET_NS 16000
+
+/** Drift and jitter statistics for a periodic event (see Timer::stats).
+ *
+ * 'lateness' is the delay between the logical fire time and the actual start
+ * of the callback. 'jitter' is the change of lateness between two successive
+ * calls. 'skipped' counts the occurrences dropped because the callback
+ * overran its interval.
+ */
+class TimerStats {
+public:
+  TimerStats() {
+    reset();
+  }
+
+  void reset();
+
+  /** Record one call. Times are in [ns].
+   */
+  void record(int64_t lateness, int64_t duration);
+
+  /** Record occurrences skipped because of an overrun.
+   */
+  void record_skipped(int64_t count) {
+    skipped_count_ += count;
+  }
+
+  /** Number of calls recorded.
+   */
+  int64_t fire_count() const {
+    return fire_count_;
+  }
+
+  /** Number of ticks skipped.
+   */
+  int64_t skipped_count() const {
+    return skipped_count_;
+  }
+
+  /** Maximal lateness in [ms].
+   */
+  Real max_lateness() const {
+    return max_lateness_ / 1000000.0;
+  }
+
+  /** Mean lateness in [ms].
+   */
+  Real mean_lateness() const {
+    return fire_count_ ? (total_lateness_ / fire_count_) / 1000000.0 : 0;
+  }
+
+  /** Maximal callback duration in [ms].
+   */
+  Real max_duration() const {
+    return max_duration_ / 1000000.0;
+  }
+
+  /** Mean callback duration in [ms].
+   */
+  Real mean_duration() const {
+    return fire_count_ ? (total_duration_ / fire_count_) / 1000000.0 : 0;
+  }
+
+  /** Maximal jitter in [ms].
+   */
+  Real max_jitter() const {
+    return max_jitter_ / 1000000.0;
+  }
+
+  /** Number of calls with a lateness in the given histogram bucket.
+   */
+  int64_t lateness_histogram(size_t bucket) const {
+    return bucket < TIMER_STATS_BUCKETS ? lateness_histogram_[bucket] : 0;
+  }
+
+  /** Number of calls with a duration in the given histogram bucket.
+   */
+  int64_t duration_histogram(size_t bucket) const {
+    return bucket < TIMER_STATS_BUCKETS ? duration_histogram_[bucket] : 0;
+  }
+
+  /** Histogram bucket for a duration in [ns].
+   */
+  static size_t bucket_for(int64_t ns);
+
+  /** Upper bound of a histogram bucket in [ms] (last bucket has no bound).
+   */
+  static Real bucket_limit(size_t bucket);
+
+  /** Return all the statistics in a HashValue (times in [ms]). The
+   * histograms are lists of counts with bounds in "buckets".
+   */
+  const Value to_value() const;
+
+private:
+  int64_t fire_count_;
+  int64_t skipped_count_;
+  int64_t total_lateness_;
+  int64_t max_lateness_;
+  int64_t total_duration_;
+  int64_t max_duration_;
+  int64_t max_jitter_;
+  int64_t last_lateness_;
+  int64_t lateness_histogram_[TIMER_STATS_BUCKETS];
+  int64_t duration_histogram_[TIMER_STATS_BUCKETS];
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_TIMER_STATS_H_
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_TIMER_STATS_METHOD_H_
+#define OSCIT_INCLUDE_OSCIT_TIMER_STATS_METHOD_H_
+
+#include "oscit/object.h"
+#include "oscit/timer_wheel.h"
+
+namespace oscit {
+
+/** Default name of the timer statistics method (see Timer::expose_stats).
+ */
+#define TIMER_STATS_METHOD ".stats"
+
+/** Return the drift and jitter statistics of a timer as a HashValue. Sending
+ * "reset" clears the statistics (and returns the cleared values).
+ */
+class TimerStatsMethod : public Object
+{
+public:
+  /** Class signature. */
+  TYPED("Object.TimerStatsMethod")
+
+  TimerStatsMethod(const char *name, TimerWheel *wheel, TimerEvent *event)
+      : Object(name, Oscit::string_io("Timer statistics (lateness, duration, skipped ticks, jitter). Send 'reset' to clear.")),
+        wheel_(wheel),
+        event_(event) {}
+
+  virtual const Value trigger(const Value &val) {
+    if (val.is_string() && val.str() == "reset") {
+      wheel_->reset_stats(event_);
+    }
+    return wheel_->stats(event_).to_value();
+  }
+
+private:
+  TimerWheel *wheel_;
+  TimerEvent *event_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_TIMER_STATS_METHOD_H_
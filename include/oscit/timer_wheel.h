@@ -0,0 +1,389 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_TIMER_WHEEL_H_
+#define OSCIT_INCLUDE_OSCIT_TIMER_WHEEL_H_
+
+#include <pthread.h>
+#include <stdint.h>  // int64_t
+#include <vector>
+
+#include "oscit/conf.h"
+#include "oscit/non_copyable.h"
+#include "oscit/thread.h"
+#include "oscit/time_ref.h"
+#include "oscit/timer_stats.h"
+
+namespace oscit {
+
+/** Number of workers used to run callbacks in the shared timer wheel.
+ */
+#define TIMER_WHEEL_WORKER_COUNT 2
+
+/** Duration of a wheel tick is 2^TIMER_WHEEL_TICK_SHIFT [ns] (~131us).
+ * Events are bucketed by tick but fire at their exact time.
+ */
+#define TIMER_WHEEL_TICK_SHIFT 17
+
+/** Maximal time during which the wheel thread sleeps when no event is
+ * waiting [ms].
+ */
+#define TIMER_WHEEL_IDLE_WAIT 1000
+
+/** The first level has 2^8 slots (one per tick, ~33ms), the three upper
+ * levels have 2^6 slots each (~2.1s, ~137s and ~2.4h).
+ */
+#define TIMER_WHEEL_ROOT_BITS  8
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_LEVELS     3
+
+class TimerWheel;
+struct EventList;
+
+/** A callback that can be registered in a TimerWheel. Sub-classes implement
+ * 'trigger'. The event stores all the scheduling information so registering
+ * or removing an event does not allocate memory.
+ *
+ * An event must be cancelled (or must have fired if it is a one-shot event)
+ * before it is destroyed.
+ */
+class TimerEvent : private NonCopyable {
+public:
+  TimerEvent() : wheel_(NULL), list_(NULL), next_(NULL), prev_(NULL),
+                 fire_at_(0), interval_(0), periodic_(false), state_(Idle),
+                 cancelled_(false), rescheduled_(false) {}
+
+  virtual ~TimerEvent() {}
+
+  /** Executed from one of the wheel's workers.
+   */
+  virtual void trigger() = 0;
+
+  /** Returns true if the event is registered in a wheel (waiting, queued
+   * or running).
+   */
+  bool is_scheduled() const {
+    return state_ != Idle;
+  }
+
+private:
+  friend class TimerWheel;
+  friend struct EventList;
+
+  enum State {
+    Idle,      /**< Not registered. */
+    Waiting,   /**< Stored in a wheel slot. */
+    Ready,     /**< Expired, waiting for a worker. */
+    Running,   /**< Callback in progress. */
+  };
+
+  /** Wheel owning the event when it is scheduled.
+   */
+  TimerWheel *wheel_;
+
+  /** Intrusive list (slot or ready queue) holding the event.
+   */
+  EventList *list_;
+  TimerEvent *next_;
+  TimerEvent *prev_;
+
+  /** Logical (anchored) time of the next fire in [ns] (TimeRef::now() base).
+   */
+  int64_t fire_at_;
+
+  /** Interval between calls in [ns] (0 = one-shot).
+   */
+  int64_t interval_;
+
+  /** Set to true when the event is periodic.
+   */
+  bool periodic_;
+
+  State state_;
+
+  /** Set when the event is cancelled while running so that it is not
+   * scheduled again.
+   */
+  bool cancelled_;
+
+  /** Set when the event is scheduled again from within its own callback.
+   */
+  bool rescheduled_;
+
+  /** Worker running the callback (used to detect cancel from within the callback).
+   */
+  pthread_t runner_;
+
+  /** Lateness, duration and skipped ticks (updated by the workers).
+   */
+  TimerStats stats_;
+};
+
+/** Call a member method from a TimerWheel.
+ */
+template<class T, void(T::*Tmethod)()>
+class TTimerEvent : public TimerEvent {
+public:
+  TTimerEvent(T *owner) : owner_(owner) {}
+
+  virtual void trigger() {
+    (owner_->*Tmethod)();
+  }
+
+private:
+  T *owner_;
+};
+
+/** Intrusive list of events (one per wheel slot).
+ */
+struct EventList {
+  EventList() : head_(NULL), tail_(NULL) {}
+
+  bool empty() const {
+    return head_ == NULL;
+  }
+
+  void push_back(TimerEvent *event);
+
+  void remove(TimerEvent *event);
+
+  TimerEvent *pop_front() {
+    TimerEvent *event = head_;
+    if (event) remove(event);
+    return event;
+  }
+
+  TimerEvent *head_;
+  TimerEvent *tail_;
+};
+
+/** A hierarchical timer wheel (Varghese & Lauck) running in a single thread
+ * and dispatching expired events to a small pool of high priority workers.
+ * Any number of periodic or one-shot events can be registered. Periodic events
+ * are anchored on their logical fire time so they do not drift: if a callback
+ * overruns, the missed ticks are skipped.
+ *
+ * Thread safe.
+ */
+class TimerWheel : private NonCopyable {
+public:
+  TimerWheel(size_t worker_count = TIMER_WHEEL_WORKER_COUNT);
+
+  /** All events must have been cancelled before the wheel is deleted.
+   */
+  ~TimerWheel();
+
+  /** Wheel shared by all Timers (created on first use, never deleted).
+   */
+  static TimerWheel *shared();
+
+  /** Fire the event every 'interval' [ms] (fractional values allowed). The first
+   * call happens after 'delay' [ms]. If the event is already scheduled, it is
+   * restarted with the new settings. Intervals shorter than a wheel tick are
+   * raised to one tick.
+   */
+  void schedule(TimerEvent *event, Real interval, Real delay = 0) {
+    schedule_at(event, TimeRef::now() + ms_to_ns(delay), ms_to_ns(interval), true);
+  }
+
+  /** Fire the event once after 'delay' [ms].
+   */
+  void schedule_once(TimerEvent *event, Real delay) {
+    schedule_at(event, TimeRef::now() + ms_to_ns(delay), 0, false);
+  }
+
+  /** Register an event to fire at the given absolute time [ns] (TimeRef::now() base).
+   * If 'periodic' is true, the event is then called every 'interval' [ns].
+   */
+  void schedule_at(TimerEvent *event, int64_t time, int64_t interval, bool periodic);
+
+  /** Change the interval of a periodic event without changing its anchor: the next
+   * call happens at 'last logical fire + interval' (skipping occurrences in
+   * the past). The event does not fire because of the change.
+   */
+  void set_interval(TimerEvent *event, Real interval);
+
+  /** Remove an event from the wheel. If the callback is running in another thread, this
+   * method waits for the callback to finish. It is safe to call cancel from within
+   * the callback.
+   */
+  void cancel(TimerEvent *event);
+
+  /** Number of events registered in this wheel (waiting, queued or running).
+   */
+  size_t event_count() {
+    pthread_mutex_lock(&mutex_);
+    size_t count = event_count_;
+    pthread_mutex_unlock(&mutex_);
+    return count;
+  }
+
+  /** Return a copy of the statistics recorded for the event.
+   */
+  TimerStats stats(const TimerEvent *event) {
+    pthread_mutex_lock(&mutex_);
+    TimerStats stats(event->stats_);
+    pthread_mutex_unlock(&mutex_);
+    return stats;
+  }
+
+  /** Clear the statistics recorded for the event.
+   */
+  void reset_stats(TimerEvent *event) {
+    pthread_mutex_lock(&mutex_);
+    event->stats_.reset();
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  static int64_t ms_to_ns(Real ms) {
+    return (int64_t)(ms * 1000000.0);
+  }
+
+private:
+  /** Wheel thread: advance time and move expired events to the ready queue.
+   */
+  void run_wheel(Thread *runner);
+
+  /** Worker thread: run callbacks from the ready queue.
+   */
+  void run_worker(Thread *runner);
+
+  /** Store a waiting event in the slot corresponding to its fire time.
+   * Must be called with the mutex locked.
+   */
+  void add_to_wheel(TimerEvent *event);
+
+  /** Move the current tick to 'now' if no event is waiting (the tick is not
+   * updated while the wheel is idle). Must be called with the mutex locked
+   * before adding an event from outside the wheel thread.
+   */
+  void sync_tick(int64_t now) {
+    int64_t now_tick = now >> TIMER_WHEEL_TICK_SHIFT;
+    if (waiting_count_ == 0 && now_tick > current_tick_) current_tick_ = now_tick;
+  }
+
+  /** Periodic events cannot fire more than once per tick.
+   */
+  static int64_t clamp_interval(int64_t interval, bool periodic) {
+    if (interval < 0) interval = 0;
+    if (periodic && interval < ((int64_t)1 << TIMER_WHEEL_TICK_SHIFT)) {
+      interval = (int64_t)1 << TIMER_WHEEL_TICK_SHIFT;
+    }
+    return interval;
+  }
+
+  /** Remove an event from the wheel or ready queue.
+   * Must be called with the mutex locked.
+   */
+  void unlink(TimerEvent *event);
+
+  /** Move all events from a slot of an upper level back into the wheel.
+   * Returns the slot index.
+   */
+  size_t cascade(size_t level);
+
+  /** Process all ticks up to 'now'. Must be called with the mutex locked.
+   */
+  void advance(int64_t now);
+
+  /** Compute next time the wheel thread must wake up (-1 = no event).
+   * Must be called with the mutex locked.
+   */
+  int64_t next_wake();
+
+  /** Skip missed occurrences of a periodic event so that fire_at_ > now.
+   * Returns the number of skipped occurrences.
+   */
+  static int64_t skip_missed(TimerEvent *event, int64_t now) {
+    if (event->fire_at_ <= now && event->interval_ > 0) {
+      int64_t k = ((now - event->fire_at_) / event->interval_) + 1;
+      event->fire_at_ += k * event->interval_;
+      return k;
+    }
+    return 0;
+  }
+
+  /** Wait on a condition until the given absolute time [ns].
+   */
+  void wait_until(pthread_cond_t *cond, int64_t time);
+
+  /** Protects all wheel data and events.
+   */
+  pthread_mutex_t mutex_;
+
+  /** Signaled to wake the wheel thread when a new event is added.
+   */
+  pthread_cond_t wheel_cond_;
+
+  /** Signaled when events are ready for the workers.
+   */
+  pthread_cond_t work_cond_;
+
+  /** Signaled when a callback finishes (used by cancel).
+   */
+  pthread_cond_t done_cond_;
+
+  /** First level (one slot per tick).
+   */
+  EventList root_[1 << TIMER_WHEEL_ROOT_BITS];
+
+  /** Upper levels.
+   */
+  EventList levels_[TIMER_WHEEL_LEVELS][1 << TIMER_WHEEL_LEVEL_BITS];
+
+  /** Expired events waiting for a worker.
+   */
+  EventList ready_;
+
+  /** Tick currently processed by the wheel.
+   */
+  int64_t current_tick_;
+
+  /** Number of events stored in the wheel slots.
+   */
+  size_t waiting_count_;
+
+  /** Number of events registered (all states but Idle).
+   */
+  size_t event_count_;
+
+  /** Time at which the wheel thread plans to wake up (-1 = not planned yet).
+   */
+  int64_t planned_wake_;
+
+  bool should_run_;
+
+  Thread wheel_thread_;
+
+  std::vector<Thread*> workers_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_TIMER_WHEEL_H_
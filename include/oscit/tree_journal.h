@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#ifndef OSCIT_INCLUDE_OSCIT_TREE_JOURNAL_H_
+#define OSCIT_INCLUDE_OSCIT_TREE_JOURNAL_H_
+
+#include <stdint.h>  // uint64_t, uint32_t
+#include <map>
+#include <string>
+#include <vector>
+
+#include "oscit/mutex.h"
+#include "oscit/non_copyable.h"
+#include "oscit/values.h"
+
+namespace oscit {
+
+/** Number of structural changes (and of coalesced value updates) kept in the
+ * journal of a Root.
+ */
+#define TREE_JOURNAL_SIZE 1024
+
+/** Bounded journal of the latest changes in a tree (adopted and removed
+ * objects, attributes and values). Each change increments the tree version so
+ * that a mirror can ask for the changes since the version it has seen instead
+ * of walking the whole tree again.
+ *
+ * Structural changes (adopt, remove, attrs) are kept in a ring buffer. Value
+ * updates are coalesced by path: only the latest value of each path is kept
+ * (with the version of that update) so that a busy parameter does not push the
+ * structural changes out of the ring.
+ *
+ * Versions are sent as "epoch:version" strings. The epoch is drawn when the
+ * journal is created: a mirror of a previous instance of the tree (restarted
+ * remote) is told to walk the tree again.
+ *
+ * Thread safe.
+ */
+class TreeJournal : private NonCopyable {
+public:
+  enum Operation {
+    Adopt,   /**< Object registered (value is the attributes). */
+    Remove,  /**< Object unregistered (value is nil). */
+    Attrs,   /**< Attributes changed (value is the attributes). */
+    Update,  /**< Value changed. */
+  };
+
+  TreeJournal(size_t capacity = TREE_JOURNAL_SIZE);
+
+  /** Record a change.
+   * @return the new version.
+   */
+  uint64_t record(Operation operation, const std::string &path, const Value &value);
+
+  /** Current version (number of changes recorded).
+   */
+  uint64_t version();
+
+  /** Append at most 'max' changes recorded after version 'since' to 'changes'
+   * as a flat list of (operation name, path, value) and set 'reached' to the
+   * version of the last change appended (or to the current version if there is
+   * none).
+   * @return false if changes after 'since' have been dropped (or 'since'
+   *         is not a version of this journal): the mirror must sync again.
+   */
+  bool changes_since(uint64_t since, size_t max, Value *changes, uint64_t *reached);
+
+  /** Name of an operation in the list of changes.
+   */
+  static const char *operation_name(Operation operation);
+
+  /** Version of this journal as sent to mirrors (osc floats cannot hold
+   * them).
+   */
+  const Value version_value(uint64_t version) const;
+
+  /** Read a version sent by 'version_value'.
+   * @return false if the value is not a version of this journal.
+   */
+  bool version_from_value(const Value &value, uint64_t *version) const;
+
+private:
+  struct Change {
+    Change() : operation_(Update), version_(0) {}
+
+    Operation operation_;
+    std::string path_;
+    Value value_;
+    uint64_t version_;
+  };
+
+  /** Append a change to the list of changes.
+   */
+  static void push_change(const Change &change, Value *changes);
+
+  /** Forget the value update recorded with 'version'.
+   */
+  void remove_update(uint64_t version);
+
+  Mutex mutex_;
+
+  /** Ring buffer of the structural changes (the n-th one is at
+   * (n - 1) % size).
+   */
+  std::vector<Change> changes_;
+
+  /** Number of structural changes recorded.
+   */
+  uint64_t structural_count_;
+
+  /** Latest value update of each path (by version).
+   */
+  std::map<uint64_t, Change> updates_;
+
+  /** Version of the latest value update of each path.
+   */
+  std::map<std::string, uint64_t> update_versions_;
+
+  /** Version of the latest change dropped from the journal: mirrors older than
+   * this must sync again.
+   */
+  uint64_t dropped_;
+
+  uint64_t version_;
+
+  /** Identifies this journal in versions.
+   */
+  const uint32_t epoch_;
+};
+
+} // oscit
+
+#endif // OSCIT_INCLUDE_OSCIT_TREE_JOURNAL_H_
@@ -30,9 +30,14 @@
 #ifndef OSCIT_INCLUDE_OSCIT_TREE_META_METHOD_H_
 #define OSCIT_INCLUDE_OSCIT_TREE_META_METHOD_H_
 #include "oscit/root.h"
+#include "oscit/reply_stream.h"
 
 namespace oscit {
 
+/** Number of urls in a streamed /.tree reply chunk.
+ */
+#define TREE_CHUNK_SIZE 128
+
 class TreeMetaMethod : public Object
 {
 public:
@@ -59,6 +64,23 @@ public:
 
     return reply;
   }
+
+  /** Walk the tree and send the urls in chunks (the tree is not built in memory).
+   */
+  virtual bool trigger_stream(const Value &val, ReplyStream *stream) {
+    if (!val.is_string()) return false;
+
+    Value error;
+    ObjectHandle object;
+
+    // errors are returned by 'trigger'
+    if (!root_->find_or_build_object_at(val.c_str(), &error, &object)) return false;
+
+    stream->begin(val, TREE_CHUNK_SIZE);
+    object->tree(object->url().length() + 1, stream);
+    stream->close();
+    return true;
+  }
 };
 
 } // oscit
@@ -39,37 +39,23 @@ namespace oscit {
 class ZeroConfBrowser;
 
 /** The Url is used to access remote locations by wrapping protocol, ip, port and other data.
- *
- * TODO: keep only a reference to the location in case we need this information very often...
+ * Received urls only keep the raw ip, port and path: the hostname and the
+ * full url string are built when asked for (see str).
  */
 class Url
 {
  public:
-  Url(const unsigned long ip, const uint port, const char *path) : path_(path) {
-    location_.protocol_ = DEFAULT_PROTOCOL;
-    location_.reference_by_hostname_ = true;
-    location_.ip_   = ip;
-    location_.port_ = port;
-    location_.name_ = Location::name_from_ip(ip);
-    rebuild_full_url();
-  }
+  Url(const unsigned long ip, const uint port, const char *path) :
+      location_(ip, port), path_(path) {}
 
-  Url(const unsigned long ip, const uint port, const std::string &path) : path_(path) {
-    location_.protocol_ = DEFAULT_PROTOCOL;
-    location_.reference_by_hostname_ = true;
-    location_.ip_   = ip;
-    location_.port_ = port;
-    location_.name_ = Location::name_from_ip(ip);
-    rebuild_full_url();
-  }
+  Url(const unsigned long ip, const uint port, const std::string &path) :
+      location_(ip, port), path_(path) {}
 
-  Url(const Location &location, const std::string &path) : location_(location), path_(path) {
-    rebuild_full_url();
-  }
+  Url(const Location &location, const std::string &path) :
+      location_(location), path_(path) {}
 
   Url(const Location *location, const std::string &path) : path_(path) {
     if (location) location_ = *location;
-    rebuild_full_url();
   }
 
   explicit Url(const std::string &string) {
@@ -82,11 +68,17 @@ class Url
 
   Url() {}
 
-  const std::string &str() const { return full_url_; }
+  /** Full url ("oscit://10.0.0.5:7000/foo/bar"), built on each call.
+   */
+  const std::string str() const {
+    return raw_url_.empty() ? build_str() : raw_url_;
+  }
 
   const Location &location() const { return location_; }
 
-  const std::string &protocol() const { return location_.protocol_; }
+  const std::string &protocol() const { return location_.protocol(); }
+
+  uint protocol_id() const { return location_.protocol_id(); }
 
   bool has_hostname() const { return location_.reference_by_hostname_; }
 
@@ -100,9 +92,9 @@ class Url
     return url.compare(0, 2, "/.") == 0;
   }
 
-  const std::string &hostname() const { return location_.name_; }
+  const std::string hostname() const { return location_.name(); }
 
-  const std::string &service_name() const { return location_.name_; }
+  const std::string service_name() const { return location_.name(); }
 
   void resolve_with(const ZeroConfBrowser *browser) {
     location_.resolve_with(browser);
@@ -133,7 +125,7 @@ class Url
     if (pos != std::string::npos) {
       parent_url->location_ = location_;
       parent_url->path_ = path_.substr(0, pos);
-      parent_url->rebuild_full_url();
+      parent_url->raw_url_ = "";
       return true;
     } else {
       return false;
@@ -152,7 +144,7 @@ class Url
   }
 
   bool operator==(const Url &other) {
-    return full_url_ == other.full_url_;
+    return path_ == other.path_ && str() == other.str();
   }
 
   Url operator+(const std::string &sub_name) {
@@ -172,7 +164,7 @@ class Url
   /** Return true if the url is exactly the same as the other one.
    */
   bool operator==(const Url &other) const {
-    return full_url_ == other.full_url_;
+    return path_ == other.path_ && str() == other.str();
   }
 
 
@@ -180,17 +172,14 @@ class Url
   friend std::ostream &operator<<(std::ostream &out_stream, const Url &url);
   void parse(const char *string);
 
-  void rebuild_full_url();
+  const std::string build_str() const;
 
   void clear() {
+    raw_url_ = "";
     location_.clear();
     path_ = "";
   }
 
-  /** FIXME: document why we this string...
-   */
-  std::string full_url_;
-
   /** Host, ip and other information to reach a remote location.
    *  This can refer to the *target location* if the url is going out
    *  or to the *source location* when the url is received.
@@ -200,6 +189,11 @@ class Url
   /** Path to method on the called location (callee).
    */
   std::string path_;
+
+  /** String given to the parser when it is not a valid url (returned by
+   *  str as is).
+   */
+  std::string raw_url_;
 };
 
 inline uint hashId(const Url &url) {
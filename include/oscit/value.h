@@ -238,7 +238,7 @@ public:
         set(other.matrix_);
         break;
       case MIDI_VALUE:
-        share(other.midi_message_);
+        set(other.midi_message());
         break;
       case ANY_VALUE:
         set_any();
@@ -288,7 +288,7 @@ public:
         set(other.matrix_);
         break;
       case MIDI_VALUE:
-        set(other.midi_message_);
+        set(other.midi_message());
         break;
       case ANY_VALUE:
         set_any();
@@ -330,7 +330,7 @@ public:
       case MATRIX_VALUE: /* not supported */
         std::cerr << "Matrix values cannot be compared.\n";
         assert(false);
-      case MIDI_VALUE:   return *midi_message_ == *(other.midi_message_);
+      case MIDI_VALUE:   return midi_message() == other.midi_message();
       case LIST_VALUE:   return *list_ == *(other.list_);
       case TRUE_VALUE:   /* continue */
       case FALSE_VALUE:  /* continue */
@@ -907,20 +907,31 @@ public:
   /** =========================================================    Midi  */
   bool is_midi() const   { return type_ == MIDI_VALUE; }
 
-  /** Change the Value into a MidiValue by making a reference
-   *  to the argument. */
+  /** Change the Value into a MidiValue by making a copy of the
+   *  argument (only SysEx messages are copied on the heap). */
   Value &set(const MidiMessage *midi_message) {
-    set_type_without_default(MIDI_VALUE);
-    set_midi(midi_message);
+    if (is_midi() && midi_size_ == MIDI_MESSAGE_LONG && midi_message->is_long()) {
+      // reuse the heap message
+      *sysex_ = *midi_message;
+    } else {
+      set_type_without_default(MIDI_VALUE);
+      set_midi(midi_message);
+    }
     return *this;
   }
 
-  /** Change the Value into a MidiMessage by making a reference
-   *  to the argument. */
+  /** Change the Value into a MidiValue by making a copy of the
+   *  argument. */
   Value &set(const MidiMessage &midi_message) {
-    set_type_without_default(MIDI_VALUE);
-    set_midi(&midi_message);
-    return *this;
+    return set(&midi_message);
+  }
+
+  /** Copy of the midi message stored in the value (the value must be a
+   *  MidiValue). Use 'set' to change the message.
+   */
+  MidiMessage midi_message() const {
+    if (midi_size_ == MIDI_MESSAGE_LONG) return *sysex_;
+    return MidiMessage(midi_.bytes, midi_size_, midi_.wait, midi_length_);
   }
 
   /** Change the Value into a Midi note.
@@ -931,16 +942,18 @@ public:
       unsigned int length = 500,
       unsigned int channel = 1,
       time_t wait = 0) {
-    if (!is_midi()) set_type(MIDI_VALUE);
-    midi_message_->set_as_note(note, velocity, length, channel, wait);
+    MidiMessage midi_message(3);
+    midi_message.set_as_note(note, velocity, length, channel, wait);
+    set(&midi_message);
   }
 
   /** Change the Value into a Midi control change.
    */
   void set_as_ctrl(unsigned char ctrl, unsigned char ctrl_value,
     unsigned int channel = 1, time_t wait = 0) {
-    if (!is_midi()) set_type(MIDI_VALUE);
-    midi_message_->set_as_ctrl(ctrl, ctrl_value, channel, wait);
+    MidiMessage midi_message(3);
+    midi_message.set_as_ctrl(ctrl, ctrl_value, channel, wait);
+    set(&midi_message);
   }
 
   /** =========================================================    Any     */
@@ -1024,7 +1037,8 @@ public:
      matrix_ = NULL;
      break;
    case MIDI_VALUE:
-     midi_message_ = ReferenceCounted::release(midi_message_);
+     if (midi_size_ == MIDI_MESSAGE_LONG) delete sysex_;
+     midi_size_ = 0;
      break;
    default:
      ; // nothing to clear
@@ -1060,7 +1074,10 @@ public:
         matrix_ = build_matrix();
         break;
       case MIDI_VALUE:
-        midi_message_ = new MidiMessage;
+        {
+          MidiMessage midi_message;
+          set_midi(&midi_message);
+        }
         break;
       default:
         ; // nothing to set
@@ -1149,21 +1166,29 @@ public:
   void delete_matrix();
 
   /** =========================================================    Midi    */
-  void share(const MidiMessage *midi_message) {
-    if (type_ == MIDI_VALUE && midi_message_ == midi_message) return;
-    set_type_without_default(MIDI_VALUE);
-    // FIXME: there should be a way to deal with shared content
-    // that is protected from changes... Any solution welcome !!
-    midi_message_ = ReferenceCounted::acquire(const_cast<MidiMessage*>(midi_message));
-  }
-
-  /** Set hash content. */
+  /** Set midi content (copy). Only SysEx messages are allocated.
+   */
   void set_midi(const MidiMessage *midi_message) {
-    midi_message_ = new MidiMessage(*midi_message);
+    if (midi_message->is_long()) {
+      sysex_ = new MidiMessage(*midi_message);
+      midi_size_ = MIDI_MESSAGE_LONG;
+    } else {
+      memcpy(midi_.bytes, midi_message->bytes_, MIDI_MESSAGE_INLINE_SIZE);
+      midi_.wait   = midi_message->wait_;
+      midi_length_ = midi_message->length_;
+      midi_size_   = midi_message->size_;
+    }
   }
 
   ValueType type_;
 
+  /** Note length and number of bytes of an inline midi message (or
+   *  MIDI_MESSAGE_LONG for SysEx). This uses the padding after type_ so
+   *  that a Value stays 16 bytes.
+   */
+  unsigned int midi_length_ : 24;
+  unsigned int midi_size_ : 8;
+
  public:
   union {
     /** Store a single Real number.
@@ -1195,9 +1220,18 @@ public:
      */
     Matrix *matrix_;
 
-    /** Pointer to a reference counted MidiMessage.
+    /** Raw bytes and wait of a midi message of up to
+     *  MIDI_MESSAGE_INLINE_SIZE bytes (see midi_size_). Copying such a
+     *  value does not allocate.
+     */
+    struct {
+      unsigned char bytes[MIDI_MESSAGE_INLINE_SIZE];
+      int wait;
+    } midi_;
+
+    /** SysEx message owned by the value (copied, not shared).
      */
-    MidiMessage *midi_message_;
+    MidiMessage *sysex_;
   };
 };
 
@@ -49,6 +49,10 @@ typedef unsigned long long uint64;
 
 
 
+#if (defined(__x86_64__) || defined(__LP64__)) && !defined(x86_64)
+#define x86_64
+#endif
+
 #ifdef x86_64
 
 typedef signed int int32;
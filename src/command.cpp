@@ -29,12 +29,16 @@
 
 #include "oscit/command.h"
 
+#include <string.h>  // strcmp
 #include <string>
 #include <iostream>
 #include <list>
+#include <vector>
 
+#include "oscit/executor.h"
 #include "oscit/root.h"
 #include "oscit/object.h"
+#include "oscit/reply_stream.h"
 #include "oscit/zeroconf_registration.h"
 #include "oscit/root_proxy.h"
 
@@ -42,51 +46,122 @@ namespace oscit {
 
 #define REMOTE_OBJECTS_HASH_SIZE 10000
 #define ROOT_PROXY_HASH_SIZE     100
-#define OBSERVERS_HASH_SIZE      100
-#define DEFAULT_TTL              240 // 4 minutes
+
+/** Message received for an object bound to a strand. The call and the reply
+ * happen in the strand so that the command can process other messages. The
+ * target is held and the command waits for its tasks before it is deleted
+ * (the root deletes its commands before anything else).
+ */
+class ReceiveTask : public StrandTask {
+public:
+  ReceiveTask(Command *command, Root *root, Object *target, const Url &url, const Value &val,
+              const Value &call_id)
+      : command_(command), root_(root), target_(target), url_(url), val_(val), call_id_(call_id) {
+    command_->strand_task_posted();
+  }
+
+  virtual void run() {
+    command_->strand_task_done(url_, root_->call(target_, val_, &url_.location()), call_id_);
+  }
+
+private:
+  Command *command_;
+  Root *root_;
+  ObjectHandle target_;
+  Url url_;
+  Value val_;
+  Value call_id_;
+};
+
+/** Chunks of a streamed reply to a meta method (see ReplyStream). The last
+ * chunk carries the correlation id of a '/.call'.
+ */
+class CommandReplyStream : public ReplyStream {
+public:
+  CommandReplyStream(Command *command, const Url &url, const Value &call_id)
+      : command_(command), url_(url), call_id_(call_id) {}
+
+protected:
+  virtual void send_reply(const Value &reply, bool last) {
+    command_->send_result(url_, reply, last ? call_id_ : gNilValue);
+  }
+
+private:
+  Command *command_;
+  const Url &url_;
+  const Value &call_id_;
+};
 
 Command::Command(const char *protocol) :
                                 remote_objects_(REMOTE_OBJECTS_HASH_SIZE),
                                 root_(NULL),
                                 port_(0),
                                 protocol_(protocol),
+                                protocol_id_(Location::intern_protocol(protocol)),
                                 service_type_(""),
                                 zeroconf_registration_(NULL),
                                 root_proxies_(ROOT_PROXY_HASH_SIZE),
-                                observers_(OBSERVERS_HASH_SIZE) {}
+                                observer_leases_(),
+                                strand_tasks_(0),
+                                strand_replies_closed_(false) {
+  init_strand_tasks();
+}
 
 Command::Command(const char *protocol, const char *service_type, uint16_t port) :
                                 remote_objects_(REMOTE_OBJECTS_HASH_SIZE),
                                 root_(NULL),
                                 port_(port),
                                 protocol_(protocol),
+                                protocol_id_(Location::intern_protocol(protocol)),
                                 service_type_(service_type),
                                 zeroconf_registration_(NULL),
                                 root_proxies_(ROOT_PROXY_HASH_SIZE),
-                                observers_(OBSERVERS_HASH_SIZE) {}
+                                observer_leases_(),
+                                strand_tasks_(0),
+                                strand_replies_closed_(false) {
+  init_strand_tasks();
+}
 
 Command::Command(Root *root, const char *protocol) :
                                 remote_objects_(REMOTE_OBJECTS_HASH_SIZE),
                                 root_(NULL),
                                 port_(0),
                                 protocol_(protocol),
+                                protocol_id_(Location::intern_protocol(protocol)),
                                 service_type_(""),
                                 zeroconf_registration_(NULL),
                                 root_proxies_(ROOT_PROXY_HASH_SIZE),
-                                observers_(OBSERVERS_HASH_SIZE) {}
+                                observer_leases_(),
+                                strand_tasks_(0),
+                                strand_replies_closed_(false) {
+  init_strand_tasks();
+}
 
 Command::Command(Root *root, const char *protocol, const char *service_type, uint16_t port) :
                                 remote_objects_(REMOTE_OBJECTS_HASH_SIZE),
                                 root_(NULL),
                                 port_(port),
                                 protocol_(protocol),
+                                protocol_id_(Location::intern_protocol(protocol)),
                                 service_type_(service_type),
                                 zeroconf_registration_(NULL),
                                 root_proxies_(ROOT_PROXY_HASH_SIZE),
-                                observers_(OBSERVERS_HASH_SIZE) {}
+                                observer_leases_(),
+                                strand_tasks_(0),
+                                strand_replies_closed_(false) {
+  init_strand_tasks();
+}
 
 Command::~Command() {
   kill();
+  // sub-classes should have waited (their 'send_message' is gone)
+  pthread_mutex_lock(&strand_tasks_mutex_);
+    strand_replies_closed_ = true;
+  pthread_mutex_unlock(&strand_tasks_mutex_);
+  wait_for_strand_tasks();
+  pthread_cond_destroy(&strand_tasks_cond_);
+  pthread_mutex_destroy(&strand_tasks_mutex_);
+
   if (zeroconf_registration_ != NULL) delete zeroconf_registration_;
 
   if (root_) {
@@ -138,55 +213,205 @@ void Command::publish_service() {
 }
 
 void Command::receive(const Url &url, const Value &val) {
-  if (!handle_reply_message(url, val) && !handle_register_message(url, val)) {
-    Value res = root_->call(url, val);
+  if (!handle_reply_message(url, val) && !handle_error_message(url, val) &&
+      !handle_register_message(url, val) && !handle_call_message(url, val)) {
+    receive_call(url, val, gNilValue);
+  }
+}
+
+void Command::receive_call(const Url &url, const Value &val, const Value &call_id) {
+  Value res;
+  if (url.is_meta()) {
+    ObjectHandle method;
+    const Value &arg = val.is_empty() ? gNilValue : val;
+    // large replies are sent in chunks (same checks as Root::call)
+    if (root_->get_object_at(url.path(), &method) && method->can_receive(arg) &&
+        !method->strand()) {
+      CommandReplyStream stream(this, url, call_id);
+      if (method->trigger_stream(arg, &stream)) return;
+    }
+    res = root_->call(url, val);
+  } else {
+    ObjectHandle target;
+    if (!root_->find_or_build_object_at(url.path(), &res, &target)) {
+      // res contains the error
+    } else if (target->strand()) {
+      // do not wait for the object
+      target->strand()->post(new ReceiveTask(this, root_, target.ptr(), url, val, call_id));
+      return;
+    } else {
+      res = root_->call(target, val, &url.location());
+    }
+  }
+  send_result(url, res, call_id);
+}
+
+void Command::wait_for_strand_tasks() {
+  pthread_mutex_lock(&strand_tasks_mutex_);
+    while (strand_tasks_ > 0) {
+      pthread_cond_wait(&strand_tasks_cond_, &strand_tasks_mutex_);
+    }
+  pthread_mutex_unlock(&strand_tasks_mutex_);
+}
+
+void Command::init_strand_tasks() {
+  pthread_mutex_init(&strand_tasks_mutex_, NULL);
+  pthread_cond_init(&strand_tasks_cond_, NULL);
+}
+
+void Command::strand_task_posted() {
+  pthread_mutex_lock(&strand_tasks_mutex_);
+    ++strand_tasks_;
+  pthread_mutex_unlock(&strand_tasks_mutex_);
+}
+
+void Command::strand_task_done(const Url &url, const Value &res, const Value &call_id) {
+  pthread_mutex_lock(&strand_tasks_mutex_);
+    bool closed = strand_replies_closed_;
+  pthread_mutex_unlock(&strand_tasks_mutex_);
+
+  if (!closed) send_result(url, res, call_id);
+
+  pthread_mutex_lock(&strand_tasks_mutex_);
+    if (--strand_tasks_ == 0) pthread_cond_broadcast(&strand_tasks_cond_);
+  pthread_mutex_unlock(&strand_tasks_mutex_);
+}
 
-    if (res.is_error()) {
-      // only send reply to caller
+void Command::send_result(const Url &url, const Value &res, const Value &call_id) {
+  if (res.is_error()) {
+    // only send reply to caller
+    if (call_id.is_nil()) {
       send(url.location(), ERROR_PATH, res);
     } else {
-      // prepare reply
-      Value reply(url.path());
-      reply.push_back(res);
-      if (url.is_meta()) {
-        // only send to caller
-        send(url.location(), REPLY_PATH, reply);
-      } else {
-        // notify all
-        // FIXME: since notifications always go to '/.reply', why not transform this into
-        // root_->notify_observers(url.path(), res) ?
-        root_->notify_observers(REPLY_PATH, reply);
-      }
+      // [code, "message", id]
+      Value error((Real)res.error_code());
+      error.push_back(res.error_message());
+      error.push_back(call_id);
+      send(url.location(), ERROR_PATH, error);
     }
+    return;
+  }
+
+  // prepare reply
+  Value reply(url.path());
+  reply.push_back(res);
+  if (!url.is_meta()) {
+    // notify all
+    // FIXME: since notifications always go to '/.reply', why not transform this into
+    // root_->notify_observers(url.path(), res) ?
+    root_->notify_observers(REPLY_PATH, reply);
+  }
+
+  if (!call_id.is_nil()) {
+    // ["/path", value, id] to the caller
+    Value answer(url.path());
+    answer.push_back(res.is_empty() ? gNilValue : res);
+    answer.push_back(call_id);
+    send(url.location(), CALL_REPLY_PATH, answer);
+  } else if (url.is_meta()) {
+    // only send to caller
+    send(url.location(), REPLY_PATH, reply);
+  }
+}
+
+void Command::call_async(const Url &remote_url, const Value &val, RemoteCall *remote_call, Real timeout) {
+  uint32_t id = remote_calls_.start(remote_url.location(), remote_call, timeout);
+  // [id, "/path", value]
+  Value request((Real)id);
+  request.push_back(remote_url.path());
+  if (!val.is_empty()) request.push_back(val);
+  send_message(remote_url.location(), CALL_PATH, request);
+}
+
+bool Command::handle_call_message(const Url &url, const Value &val) {
+  if (url.path() != CALL_PATH) return false;
+
+  if (val.size() < 2 || !val[0].is_real() || !val[1].is_string()) {
+    send(url.location(), ERROR_PATH, ErrorValue(BAD_REQUEST_ERROR, std::string("Bad arguments to '").append(
+      CALL_PATH).append("' (should be [id, \"/path\", value]).")));
+    return true;
   }
+
+  receive_call(Url(url.location(), val[1].str()), val.size() > 2 ? val[2] : gNilValue, val[0]);
+  return true;
+}
+
+bool Command::handle_error_message(const Url &url, const Value &val) {
+  if (url.path() != ERROR_PATH) return false;
+  if (val.size() != 3 || !val[0].is_real() || !val[1].is_string() || !val[2].is_real()) return false;
+
+  // [code, "message", id]
+  return remote_calls_.complete(url.location(), (uint32_t)val[2].r,
+                                ErrorValue((ErrorCode)(int)val[0].r, val[1].str()));
 }
 
 /** Add a new satellite to the list of observers. Explicit registration is only needed if the
  * observer does not interact to keep link alive (usually as a response to TTL going down).
+ * The argument can be another port, a path prefix or a list with an optional port and
+ * path prefixes ([7010, "/synth", "/mixer/1"]). Prefixes replace previous subscriptions.
  */
 bool Command::handle_register_message(const Url &url, const Value &val) {
   if (url.path() == REGISTER_PATH) {
+    Location remote(url.location());
+    std::vector<std::string> prefixes;
+    bool subscribe = false;
+
     if (val.is_real()) {
       // other port
-      Location remote(url.location());
       remote.set_port((uint)val.r);
-      observers_.set(remote, DEFAULT_TTL);
+    } else if (val.is_string()) {
+      prefixes.push_back(val.str());
+      subscribe = true;
+    } else if (val.is_list()) {
+      for (size_t i = 0; i < val.size(); ++i) {
+        if (val[i].is_real()) {
+          remote.set_port((uint)val[i].r);
+        } else if (val[i].is_string()) {
+          prefixes.push_back(val[i].str());
+          subscribe = true;
+        }
+      }
+    }
+
+    if (subscribe) {
+      observer_leases_.subscribe(remote, prefixes);
     } else {
-      observers_.set(url.location(), DEFAULT_TTL);
+      observer_leases_.renew(remote);
     }
     return true;
   } else {
-    observers_.set(url.location(), DEFAULT_TTL);
+    observer_leases_.renew(url.location());
     return false;
   }
 }
 
+void Command::observers_of(const char *path, const Value &val, std::list<Location> *locations) {
+  if (val.is_list() && val.size() > 0 && val[0].is_string() && !Url::is_meta(val[0].str()) &&
+      strcmp(path, REPLY_PATH) == 0) {
+    // ["/path", value] notification
+    observer_leases_.observers_of(val[0].str(), locations);
+  } else {
+    *locations = observer_leases_.observers();
+  }
+}
+
 bool Command::handle_reply_message(const Url &url, const Value &val) {
-  if (url.path() == REPLY_PATH) {
+  bool call_reply = url.path() == CALL_REPLY_PATH;
+  if (call_reply || url.path() == REPLY_PATH) {
+    // replies do not register the sender but renew its lease
+    observer_leases_.touch(url.location());
+    if (call_reply) {
+      if (val.size() != 3 || !val[2].is_real()) {
+        std::cerr << "Bad argument to " << CALL_REPLY_PATH << " :" << val << "\n";
+        return true;
+      }
+      // ["/path", value, id]: reply to 'call_async'
+      remote_calls_.complete(url.location(), (uint32_t)val[2].r, val[1]);
+    }
     RootProxy *proxy = find_proxy(url.location());
     if (proxy) {
       if (val.size() < 2 || !val[0].is_string()) {
-        std::cerr << "Bad argument to " << REPLY_PATH << " :" << val << "\n";
+        std::cerr << "Bad argument to " << url.path() << " :" << val << "\n";
         return true;
       }
       proxy->handle_reply(val[0].str(), val[1]);
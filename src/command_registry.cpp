@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/command_registry.h"
+
+#include "oscit/command.h"
+
+namespace oscit {
+
+CommandRegistry::CommandRegistry(const CommandRegistry *other, Command *added, Command *removed) {
+  if (other) {
+    std::vector<Command*>::const_iterator it, end = other->commands_.end();
+    for (it = other->commands_.begin(); it != end; ++it) {
+      if (*it != removed) commands_.push_back(*it);
+    }
+  }
+  if (added) commands_.push_back(added);
+
+  std::vector<Command*>::iterator it, end = commands_.end();
+  for (it = commands_.begin(); it != end; ++it) {
+    protocol_ids_.push_back((*it)->protocol_id());
+  }
+}
+
+} // oscit
@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/delivery_queue.h"
+
+#include <time.h>
+
+#include "oscit/time_ref.h"
+
+namespace oscit {
+
+DeliveryQueue::DeliveryQueue(size_t capacity)
+    : head_(NULL),
+      tail_(NULL),
+      capacity_(capacity),
+      depth_(0),
+      max_depth_(0),
+      delivered_count_(0),
+      coalesced_count_(0),
+      dropped_count_(0),
+      running_(NULL) {
+  pthread_mutex_init(&mutex_, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+#ifndef __macosx__
+  // timed waits use the monotonic clock (see wait)
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+  pthread_cond_init(&pending_cond_, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&done_cond_, NULL);
+}
+
+DeliveryQueue::~DeliveryQueue() {
+  pthread_cond_destroy(&done_cond_);
+  pthread_cond_destroy(&pending_cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void DeliveryQueue::push(Slot *slot, const Value &val) {
+  pthread_mutex_lock(&mutex_);
+    if (slot->pending_) {
+      // coalesce: only keep the last value
+      slot->value_ = val;
+      ++coalesced_count_;
+    } else if (depth_ >= capacity_) {
+      ++dropped_count_;
+    } else {
+      slot->value_   = val;
+      slot->pending_ = true;
+      slot->next_    = NULL;
+      if (tail_) {
+        tail_->next_ = slot;
+      } else {
+        head_ = slot;
+      }
+      tail_ = slot;
+
+      if (++depth_ > max_depth_) max_depth_ = depth_;
+      pthread_cond_signal(&pending_cond_);
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+size_t DeliveryQueue::drain() {
+  size_t count = 0;
+
+  pthread_mutex_lock(&mutex_);
+    while (head_) {
+      Slot *slot = head_;
+      head_ = slot->next_;
+      if (!head_) tail_ = NULL;
+      --depth_;
+
+      Value val(slot->value_);
+      slot->value_.set_empty();
+      slot->pending_ = false;
+      running_ = slot;
+      runner_  = pthread_self();
+
+      pthread_mutex_unlock(&mutex_);
+        (*slot->function_)(slot->data_, val);
+      pthread_mutex_lock(&mutex_);
+
+      running_ = NULL;
+      ++delivered_count_;
+      ++count;
+      pthread_cond_broadcast(&done_cond_);
+    }
+  pthread_mutex_unlock(&mutex_);
+
+  return count;
+}
+
+bool DeliveryQueue::wait(Real timeout) {
+  // TimeRef::now() uses the monotonic clock
+  int64_t deadline = timeout < 0 ? -1 : TimeRef::now() + (int64_t)(timeout * 1000000.0);
+
+  pthread_mutex_lock(&mutex_);
+    // loop to ignore spurious wakeups
+    while (!head_) {
+      if (deadline < 0) {
+        pthread_cond_wait(&pending_cond_, &mutex_);
+        continue;
+      }
+
+      int64_t remaining = deadline - TimeRef::now();
+      if (remaining <= 0) break;
+#ifdef __macosx__
+      struct timespec wait;
+      wait.tv_sec  = remaining / 1000000000;
+      wait.tv_nsec = remaining % 1000000000;
+      pthread_cond_timedwait_relative_np(&pending_cond_, &mutex_, &wait);
+#else
+      struct timespec time;
+      time.tv_sec  = deadline / 1000000000;
+      time.tv_nsec = deadline % 1000000000;
+      pthread_cond_timedwait(&pending_cond_, &mutex_, &time);
+#endif
+    }
+    bool pending = head_ != NULL;
+  pthread_mutex_unlock(&mutex_);
+  return pending;
+}
+
+void DeliveryQueue::detach(Slot *slot) {
+  pthread_mutex_lock(&mutex_);
+    if (slot->pending_) {
+      Slot *previous = NULL;
+      for (Slot *it = head_; it; previous = it, it = it->next_) {
+        if (it == slot) {
+          if (previous) {
+            previous->next_ = it->next_;
+          } else {
+            head_ = it->next_;
+          }
+          if (tail_ == it) tail_ = previous;
+          --depth_;
+          break;
+        }
+      }
+      slot->pending_ = false;
+      slot->value_.set_empty();
+    }
+
+    // do not return while the callback is running in another thread
+    while (running_ == slot && !pthread_equal(runner_, pthread_self())) {
+      pthread_cond_wait(&done_cond_, &mutex_);
+    }
+    slot->queue_ = NULL;
+  pthread_mutex_unlock(&mutex_);
+}
+
+size_t DeliveryQueue::depth() {
+  pthread_mutex_lock(&mutex_);
+  size_t depth = depth_;
+  pthread_mutex_unlock(&mutex_);
+  return depth;
+}
+
+size_t DeliveryQueue::max_depth() {
+  pthread_mutex_lock(&mutex_);
+  size_t max_depth = max_depth_;
+  pthread_mutex_unlock(&mutex_);
+  return max_depth;
+}
+
+int64_t DeliveryQueue::delivered_count() {
+  pthread_mutex_lock(&mutex_);
+  int64_t count = delivered_count_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+int64_t DeliveryQueue::coalesced_count() {
+  pthread_mutex_lock(&mutex_);
+  int64_t count = coalesced_count_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+int64_t DeliveryQueue::dropped_count() {
+  pthread_mutex_lock(&mutex_);
+  int64_t count = dropped_count_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+const Value DeliveryQueue::stats() {
+  Value res;
+  pthread_mutex_lock(&mutex_);
+    res.set("depth", (Real)depth_);
+    res.set("max_depth", (Real)max_depth_);
+    res.set("capacity", (Real)capacity_);
+    res.set("delivered", (Real)delivered_count_);
+    res.set("coalesced", (Real)coalesced_count_);
+    res.set("dropped", (Real)dropped_count_);
+  pthread_mutex_unlock(&mutex_);
+  return res;
+}
+
+} // oscit
@@ -0,0 +1,292 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/executor.h"
+
+#include <assert.h>
+#include <unistd.h> // sysconf
+
+namespace oscit {
+
+static pthread_once_t sSharedOnce = PTHREAD_ONCE_INIT;
+static Executor *sSharedExecutor = NULL;
+
+/** Set to the executor in its worker threads.
+ */
+static pthread_key_t sWorkerKey;
+static pthread_once_t sWorkerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void create_shared_executor() {
+  sSharedExecutor = new Executor();
+}
+
+static void create_worker_key() {
+  pthread_key_create(&sWorkerKey, NULL);
+}
+
+Executor *Executor::shared() {
+  pthread_once(&sSharedOnce, create_shared_executor);
+  return sSharedExecutor;
+}
+
+bool Executor::in_worker() {
+  pthread_once(&sWorkerKeyOnce, create_worker_key);
+  return pthread_getspecific(sWorkerKey) != NULL;
+}
+
+Executor::Executor(size_t worker_count)
+    : ready_head_(NULL),
+      ready_tail_(NULL),
+      should_run_(true) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&work_cond_, NULL);
+  pthread_once(&sWorkerKeyOnce, create_worker_key);
+
+  if (worker_count == 0) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    worker_count = cpu_count > 0 ? cpu_count : 1;
+  }
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    Thread *worker = new Thread;
+    workers_.push_back(worker);
+    worker->start_thread<Executor, &Executor::run_worker>(this);
+  }
+}
+
+Executor::~Executor() {
+  pthread_mutex_lock(&mutex_);
+    should_run_ = false;
+    pthread_cond_broadcast(&work_cond_);
+  pthread_mutex_unlock(&mutex_);
+
+  std::vector<Thread*>::iterator it, end = workers_.end();
+  for (it = workers_.begin(); it != end; ++it) {
+    (*it)->join();
+    delete *it;
+  }
+
+  pthread_cond_destroy(&work_cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void Executor::schedule(Strand *strand) {
+  strand->next_ = NULL;
+  if (ready_tail_) {
+    ready_tail_->next_ = strand;
+  } else {
+    ready_head_ = strand;
+  }
+  ready_tail_ = strand;
+  pthread_cond_signal(&work_cond_);
+}
+
+void Executor::run_tasks(Strand *strand, size_t max) {
+  strand->running_ = true;
+  strand->runner_  = pthread_self();
+
+  StrandTask *task;
+  size_t count = 0;
+  while ((max == 0 || count < max) && (task = strand->pop())) {
+    ++count;
+    bool owned = task->owned_;
+    pthread_mutex_unlock(&mutex_);
+      task->run();
+      if (owned) delete task;
+    pthread_mutex_lock(&mutex_);
+
+    if (!owned) {
+      // the caller waiting in Strand::run deletes the task
+      task->done_ = true;
+      pthread_cond_signal(task->done_cond_);
+    }
+  }
+
+  strand->running_ = false;
+}
+
+void Executor::run_worker(Thread *runner) {
+  pthread_setspecific(sWorkerKey, this);
+  runner->thread_ready();
+
+  pthread_mutex_lock(&mutex_);
+    while (should_run_) {
+      Strand *strand = ready_head_;
+      if (!strand) {
+        pthread_cond_wait(&work_cond_, &mutex_);
+        continue;
+      }
+      ready_head_ = strand->next_;
+      if (!ready_head_) ready_tail_ = NULL;
+      strand->next_ = NULL;
+
+      run_tasks(strand, STRAND_BATCH_SIZE);
+
+      if (strand->head_) {
+        // let other strands run
+        schedule(strand);
+      } else {
+        strand->idle();
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+Strand::Strand(Executor *executor)
+    : executor_(executor ? executor : Executor::shared()),
+      head_(NULL),
+      tail_(NULL),
+      pending_(0),
+      active_(false),
+      running_(false),
+      waiters_(0),
+      next_(NULL) {
+  pthread_cond_init(&idle_cond_, NULL);
+}
+
+Strand::~Strand() {
+  wait();
+  pthread_cond_destroy(&idle_cond_);
+}
+
+void Strand::post(StrandTask *task) {
+  pthread_mutex_lock(&executor_->mutex_);
+    task->owned_ = true;
+    push(task);
+  pthread_mutex_unlock(&executor_->mutex_);
+}
+
+bool Strand::run(StrandTask *task) {
+  pthread_mutex_lock(&executor_->mutex_);
+    if (running_ && pthread_equal(runner_, pthread_self())) {
+      // called from one of our tasks
+      pthread_mutex_unlock(&executor_->mutex_);
+      task->run();
+      return true;
+    }
+
+    if (!active_) {
+      // idle: run in the calling thread
+      active_  = true;
+      running_ = true;
+      runner_  = pthread_self();
+      pthread_mutex_unlock(&executor_->mutex_);
+        task->run();
+      pthread_mutex_lock(&executor_->mutex_);
+      running_ = false;
+
+      if (head_) {
+        // tasks posted while we were running
+        executor_->schedule(this);
+      } else {
+        idle();
+      }
+      pthread_mutex_unlock(&executor_->mutex_);
+      return true;
+    }
+
+    if (Executor::in_worker()) {
+      // a worker waiting for a busy strand could wait for itself (strands
+      // calling each other) or for strands queued behind it
+      pthread_mutex_unlock(&executor_->mutex_);
+      return false;
+    }
+
+    pthread_cond_t done_cond;
+    pthread_cond_init(&done_cond, NULL);
+    task->owned_ = false;
+    task->done_  = false;
+    task->done_cond_ = &done_cond;
+    push(task);
+    while (!task->done_) {
+      pthread_cond_wait(&done_cond, &executor_->mutex_);
+    }
+  pthread_mutex_unlock(&executor_->mutex_);
+  pthread_cond_destroy(&done_cond);
+  return true;
+}
+
+void Strand::wait() {
+  assert(!running_in_this_thread());
+  pthread_mutex_lock(&executor_->mutex_);
+    ++waiters_;
+    while (active_) {
+      pthread_cond_wait(&idle_cond_, &executor_->mutex_);
+    }
+    --waiters_;
+  pthread_mutex_unlock(&executor_->mutex_);
+}
+
+bool Strand::running_in_this_thread() {
+  pthread_mutex_lock(&executor_->mutex_);
+    bool running = running_ && pthread_equal(runner_, pthread_self());
+  pthread_mutex_unlock(&executor_->mutex_);
+  return running;
+}
+
+size_t Strand::pending() {
+  pthread_mutex_lock(&executor_->mutex_);
+    size_t count = pending_;
+  pthread_mutex_unlock(&executor_->mutex_);
+  return count;
+}
+
+void Strand::push(StrandTask *task) {
+  task->next_ = NULL;
+  if (tail_) {
+    tail_->next_ = task;
+  } else {
+    head_ = task;
+  }
+  tail_ = task;
+  ++pending_;
+
+  if (!active_) {
+    active_ = true;
+    executor_->schedule(this);
+  }
+}
+
+void Strand::idle() {
+  active_ = false;
+  if (waiters_) pthread_cond_broadcast(&idle_cond_);
+}
+
+StrandTask *Strand::pop() {
+  StrandTask *task = head_;
+  if (task) {
+    head_ = task->next_;
+    if (!head_) tail_ = NULL;
+    task->next_ = NULL;
+    --pending_;
+  }
+  return task;
+}
+
+} // oscit
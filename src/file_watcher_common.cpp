@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/file_watcher.h"
+
+#include <poll.h>
+#include <unistd.h> // pipe
+
+#include <algorithm> // min
+
+namespace oscit {
+
+FileWatcher::FileWatcher() : watching_(false), poll_interval_(1000),
+                             notify_fd_(-1), watch_id_(-1), file_fd_(-1),
+                             mod_time_(0) {
+  if (pipe(wake_pipe_)) {
+    wake_pipe_[0] = wake_pipe_[1] = -1;
+    fprintf(stderr, "Could not create pipe for file watcher (%s)\n", strerror(errno));
+  }
+}
+
+FileWatcher::~FileWatcher() {
+  stop();
+  if (wake_pipe_[0] >= 0) {
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+  }
+}
+
+bool FileWatcher::watch(const std::string &path) {
+  stop();
+  path_ = path;
+  if (wake_pipe_[0] < 0 || !start_watching()) return false;
+
+  watching_ = true;
+  thread_.start_thread<FileWatcher, &FileWatcher::run>(this);
+  return true;
+}
+
+void FileWatcher::stop() {
+  if (!watching_) return;
+
+  thread_.quit();
+  char c = 0;
+  if (write(wake_pipe_[1], &c, 1) != 1) {
+    fprintf(stderr, "Could not wake up file watcher (%s)\n", strerror(errno));
+  }
+  thread_.join();
+
+  // empty pipe
+  if (read(wake_pipe_[0], &c, 1) != 1) {
+    fprintf(stderr, "Could not read file watcher pipe (%s)\n", strerror(errno));
+  }
+  stop_watching();
+  watching_ = false;
+}
+
+void FileWatcher::run(Thread *thread) {
+  thread->thread_ready();
+  int retry_delay = 0;
+  while (thread->should_run()) {
+    switch (wait_for_change()) {
+      case WaitChanged:
+        retry_delay = 0;
+        if (thread->should_run()) file_changed();
+        break;
+      case WaitFailed:
+        // do not spin (and flood stderr) on a persistent error
+        if (!retry_delay) {
+          fprintf(stderr, "Could not wait for changes in '%s' (%s)\n", path_.c_str(), strerror(errno));
+          retry_delay = FILE_WATCHER_RETRY_MS;
+        } else if (retry_delay < FILE_WATCHER_MAX_RETRY_MS) {
+          retry_delay = std::min(retry_delay * 2, FILE_WATCHER_MAX_RETRY_MS);
+        }
+        retry_after(retry_delay);
+        break;
+      case WaitStopped:
+        break;
+    }
+  }
+}
+
+void FileWatcher::retry_after(int delay) {
+  struct pollfd fds[1];
+  fds[0].fd = wake_pipe_[0];
+  fds[0].events = POLLIN;
+  fds[0].revents = 0;
+  // the pipe is emptied by 'stop'
+  poll(fds, 1, delay);
+}
+
+}  // oscit
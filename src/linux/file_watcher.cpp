@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/file_watcher.h"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace oscit {
+
+/** Size of the inotify event buffer.
+ */
+#define FILE_WATCHER_BUFFER_SIZE 4096
+
+bool FileWatcher::start_watching() {
+  notify_fd_ = inotify_init();
+  if (notify_fd_ < 0) {
+    fprintf(stderr, "Could not initialize inotify (%s)\n", strerror(errno));
+    return false;
+  }
+
+  // Watch the folder: editors often save by replacing the file.
+  size_t pos = path_.rfind('/');
+  std::string folder(pos == std::string::npos ? "." : (pos == 0 ? "/" : path_.substr(0, pos)));
+  watch_id_ = inotify_add_watch(notify_fd_, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (watch_id_ < 0) {
+    fprintf(stderr, "Could not watch '%s' (%s)\n", folder.c_str(), strerror(errno));
+    stop_watching();
+    return false;
+  }
+  return true;
+}
+
+void FileWatcher::stop_watching() {
+  if (notify_fd_ >= 0) {
+    // closing the descriptor removes the watch
+    close(notify_fd_);
+  }
+  notify_fd_ = -1;
+  watch_id_  = -1;
+}
+
+/** Read pending events and return true if one of them concerns 'name'.
+ */
+static bool read_events(int notify_fd, const std::string &name) {
+  char buffer[FILE_WATCHER_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool changed = false;
+
+  ssize_t length = read(notify_fd, buffer, sizeof(buffer));
+  for (ssize_t i = 0; i < length;) {
+    struct inotify_event *event = (struct inotify_event*)(buffer + i);
+    if (event->len && name == event->name) changed = true;
+    i += sizeof(struct inotify_event) + event->len;
+  }
+  return changed;
+}
+
+FileWatcher::WaitResult FileWatcher::wait_for_change() {
+  size_t pos = path_.rfind('/');
+  std::string name(pos == std::string::npos ? path_ : path_.substr(pos + 1));
+
+  struct pollfd fds[2];
+  fds[0].fd = wake_pipe_[0];
+  fds[0].events = POLLIN;
+  fds[1].fd = notify_fd_;
+  fds[1].events = POLLIN;
+
+  bool changed = false;
+  while (true) {
+    fds[0].revents = fds[1].revents = 0;
+    // once a change is seen, wait a little for more events
+    int count = poll(fds, 2, changed ? FILE_WATCHER_SETTLE_MS : -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      return WaitFailed;
+    }
+    if (fds[0].revents) return WaitStopped;
+    if (count == 0) return WaitChanged; // settled (timeout only after a change)
+    if (fds[1].revents & (POLLERR | POLLNVAL)) {
+      errno = EBADF;
+      return WaitFailed;
+    }
+    if (fds[1].revents && read_events(notify_fd_, name)) changed = true;
+  }
+}
+
+}  // oscit
@@ -62,12 +62,15 @@ void List::set_value_at(size_t pos, const Value &val) {
 
 void List::push_back(const Value &val) {
   values_.push_back(new Value(val));
+  size_t end = type_tag_storage_.size();
   if (val.is_list()) {
     type_tag_storage_.append("[").append(val.type_tag()).append("]");
   } else {
     type_tag_storage_.append(val.type_tag());
   }
-  update_type_tag();
+  // only hash the new type tags (building long lists is linear)
+  type_tag_ = type_tag_storage_.c_str();
+  type_id_ = hashId(type_tag_ + end, type_id_);
 }
 
 void List::push_front(const Value &val) {
@@ -31,6 +31,8 @@
 
 #include <netdb.h>     // gethostbyname
 #include <arpa/inet.h> // inet_addr
+#include <stdio.h>     // snprintf
+#include <pthread.h>
 
 #include <sstream>
 
@@ -40,27 +42,77 @@
 
 namespace oscit {
 
+static pthread_once_t sProtocolsOnce = PTHREAD_ONCE_INIT;
+
+/** Interned protocol names (see Location::intern_protocol). Slots are
+ * filled once with compare-and-swap and never change afterwards. The last
+ * slot is LOCATION_UNKNOWN_PROTOCOL.
+ */
+static std::string * volatile sProtocols[LOCATION_MAX_PROTOCOLS];
+
+static void create_protocols() {
+  sProtocols[Location::NO_PROTOCOL] = new std::string("");
+  sProtocols[Location::DEFAULT_PROTOCOL_ID] = new std::string(DEFAULT_PROTOCOL);
+  sProtocols[LOCATION_MAX_PROTOCOLS - 1] = new std::string(LOCATION_UNKNOWN_PROTOCOL);
+  __sync_synchronize();
+}
+
+uint Location::intern_protocol(const char *protocol) {
+  pthread_once(&sProtocolsOnce, create_protocols);
+  for (uint i = 0; i < LOCATION_MAX_PROTOCOLS - 1; ++i) {
+    std::string *name = sProtocols[i];
+    if (!name) {
+      // free slot: try to publish the name
+      std::string *new_name = new std::string(protocol);
+      name = __sync_val_compare_and_swap(&sProtocols[i], (std::string*)NULL, new_name);
+      if (!name) return i;
+      // another thread was faster
+      delete new_name;
+    }
+    if (*name == protocol) return i;
+  }
+  return LOCATION_MAX_PROTOCOLS - 1;
+}
+
+const std::string &Location::protocol_name(uint protocol_id) {
+  pthread_once(&sProtocolsOnce, create_protocols);
+  return *sProtocols[protocol_id];
+}
+
 std::ostream &operator<<(std::ostream &out_stream, const Location &location) {
-  if (location.name_ == "") return out_stream;
-  if (location.protocol_ != "") {
-    out_stream << location.protocol_ << "://";
+  std::string str;
+  location.append_to(&str);
+  out_stream << str;
+  return out_stream;
+}
+
+void Location::append_to(std::string *str) const {
+  const std::string name(this->name());
+  if (name == "") return;
+  if (protocol_id_ != NO_PROTOCOL) {
+    str->append(protocol()).append("://");
   }
 
-  if (location.reference_by_hostname_) {
-    out_stream << location.name_;
-    if (location.port_ != Location::NO_PORT) {
-      out_stream << ":" << location.port_;
+  if (reference_by_hostname_) {
+    str->append(name);
+    if (port_ != NO_PORT) {
+      char buffer[12];
+      char *p = buffer + sizeof(buffer);
+      for (uint port = port_; port; port /= 10) {
+        *--p = '0' + port % 10;
+      }
+      *--p = ':';
+      str->append(p, buffer + sizeof(buffer) - p);
     }
   } else {
     // TODO: escape double quotes in name_
-    out_stream << "\"" << location.name_ << "\"";
+    str->append("\"").append(name_).append("\"");
   }
-  return out_stream;
 }
 
 const std::string Location::inspect() const {
   std::ostringstream out;
-  out << protocol_ << "://" << name_from_ip(ip_) << ":" << port_;
+  out << protocol() << "://" << name_from_ip(ip_) << ":" << port_;
   return out.str();
 }
 
@@ -70,12 +122,17 @@ const std::string Location::name_from_ip(unsigned long ip) {
 	} else if (ip == ANY_IP) {
     return std::string("localhost");
   } else {
-	  std::ostringstream out;
-    out <<        ((ip >> 24) & 0xFF);
-    out << "." << ((ip >> 16) & 0xFF);
-    out << "." << ((ip >> 8)  & 0xFF);
-    out << "." << ( ip        & 0xFF);
-    return out.str();
+    // formatted by hand: this runs for every received message
+    char buffer[16];
+    char *p = buffer;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      unsigned int byte = (ip >> shift) & 0xFF;
+      if (byte >= 100) *p++ = '0' + byte / 100;
+      if (byte >= 10)  *p++ = '0' + (byte / 10) % 10;
+      *p++ = '0' + byte % 10;
+      if (shift) *p++ = '.';
+    }
+    return std::string(buffer, p - buffer);
   }
 }
 
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/file_watcher.h"
+
+#include <fcntl.h>     // open, O_EVTONLY
+#include <sys/event.h> // kqueue
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace oscit {
+
+/** Number of kqueue events read at once.
+ */
+#define FILE_WATCHER_EVENT_COUNT 8
+
+/** Open 'path' for event notifications only and add it to the kqueue.
+ * Returns -1 if the path does not exist (yet).
+ */
+static int watch_vnode(int kq, const char *path, u_int fflags) {
+  int fd = open(path, O_EVTONLY);
+  if (fd < 0) return -1;
+
+  struct kevent change;
+  EV_SET(&change, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, fflags, 0, NULL);
+  if (kevent(kq, &change, 1, NULL, 0, NULL) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static time_t modification_time(const std::string &path) {
+  struct stat info;
+  return stat(path.c_str(), &info) ? 0 : info.st_mtime;
+}
+
+#define FILE_WATCHER_FILE_EVENTS (NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME)
+
+bool FileWatcher::start_watching() {
+  notify_fd_ = kqueue();
+  if (notify_fd_ < 0) {
+    fprintf(stderr, "Could not initialize kqueue (%s)\n", strerror(errno));
+    return false;
+  }
+
+  // Watch the folder: editors often save by replacing the file.
+  size_t pos = path_.rfind('/');
+  std::string folder(pos == std::string::npos ? "." : (pos == 0 ? "/" : path_.substr(0, pos)));
+  watch_id_ = watch_vnode(notify_fd_, folder.c_str(), NOTE_WRITE);
+  if (watch_id_ < 0) {
+    fprintf(stderr, "Could not watch '%s' (%s)\n", folder.c_str(), strerror(errno));
+    stop_watching();
+    return false;
+  }
+
+  struct kevent change;
+  EV_SET(&change, wake_pipe_[0], EVFILT_READ, EV_ADD, 0, 0, NULL);
+  if (kevent(notify_fd_, &change, 1, NULL, 0, NULL) < 0) {
+    fprintf(stderr, "Could not watch file watcher pipe (%s)\n", strerror(errno));
+    stop_watching();
+    return false;
+  }
+
+  // the file can be created later
+  file_fd_  = watch_vnode(notify_fd_, path_.c_str(), FILE_WATCHER_FILE_EVENTS);
+  mod_time_ = modification_time(path_);
+  return true;
+}
+
+void FileWatcher::stop_watching() {
+  // closing the descriptors removes the events
+  if (file_fd_ >= 0)   close(file_fd_);
+  if (watch_id_ >= 0)  close(watch_id_);
+  if (notify_fd_ >= 0) close(notify_fd_);
+  notify_fd_ = -1;
+  watch_id_  = -1;
+  file_fd_   = -1;
+}
+
+FileWatcher::WaitResult FileWatcher::wait_for_change() {
+  struct kevent events[FILE_WATCHER_EVENT_COUNT];
+  struct timespec settle;
+  settle.tv_sec  = 0;
+  settle.tv_nsec = FILE_WATCHER_SETTLE_MS * 1000000;
+
+  bool changed = false;
+  while (true) {
+    // once a change is seen, wait a little for more events
+    int count = kevent(notify_fd_, NULL, 0, events, FILE_WATCHER_EVENT_COUNT, changed ? &settle : NULL);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      return WaitFailed;
+    }
+    if (count == 0) return WaitChanged; // settled (timeout only after a change)
+
+    bool rewatch = false;
+    for (int i = 0; i < count; ++i) {
+      int fd = (int)events[i].ident;
+      if (events[i].flags & EV_ERROR) {
+        errno = (int)events[i].data;
+        return WaitFailed;
+      } else if (fd == wake_pipe_[0]) {
+        return WaitStopped;
+      } else if (fd == file_fd_) {
+        // written in place, or replaced (the descriptor still points to the
+        // old file)
+        changed = true;
+        if (events[i].fflags & (NOTE_DELETE | NOTE_RENAME)) rewatch = true;
+      } else if (fd == watch_id_) {
+        // an entry was added, renamed or removed in the folder
+        rewatch = true;
+      }
+    }
+
+    if (rewatch) {
+      if (file_fd_ >= 0) close(file_fd_);
+      file_fd_ = watch_vnode(notify_fd_, path_.c_str(), FILE_WATCHER_FILE_EVENTS);
+    }
+    if (changed || rewatch) {
+      time_t mod_time = modification_time(path_);
+      if (mod_time != mod_time_) changed = true;
+      mod_time_ = mod_time;
+    }
+  }
+}
+
+}  // oscit
@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/map_curve.h"
+
+#include <math.h>
+#include <stdlib.h> // strtod
+
+namespace oscit {
+
+/** Parse a list of comma separated reals ("0, 0.5, 1").
+ */
+static bool parse_reals(const std::string &args, std::vector<Real> *values) {
+  const char *p = args.c_str();
+  char *end;
+  while (true) {
+    values->push_back(strtod(p, &end));
+    if (end == p) return false;
+    p = end;
+    while (*p == ' ' || *p == '\t') ++p;
+    if (*p == '\0') return true;
+    if (*p != ',') return false;
+    ++p;
+  }
+}
+
+bool MapCurve::parse(const std::string &definition, Real source_min, Real source_max,
+                     Real target_min, Real target_max, MapCurve *curve, std::string *error) {
+  std::string name(definition);
+  std::vector<Real> args;
+
+  size_t open = definition.find('(');
+  if (open != std::string::npos) {
+    size_t close = definition.rfind(')');
+    if (close != definition.size() - 1 || close < open ||
+        !parse_reals(definition.substr(open + 1, close - open - 1), &args)) {
+      *error = std::string("Invalid curve arguments in '") + definition + "' !";
+      return false;
+    }
+    name = definition.substr(0, open);
+  }
+
+  if (name == "lin" && args.empty()) {
+    curve->compile(Linear, 0, source_min, source_max, target_min, target_max);
+  } else if (name == "exp" || name == "log") {
+    bool is_exp = name == "exp";
+    Real k;
+    if (args.empty()) {
+      // geometric scale on the target (exp) or source (log) range
+      Real min = is_exp ? target_min : source_min;
+      Real max = is_exp ? target_max : source_max;
+      if (min * max <= 0) {
+        *error = std::string("Cannot use '") + name + "' with a range containing zero (use " + name + "(k)) !";
+        return false;
+      }
+      k = log(max / min);
+    } else if (args.size() == 1 && args[0] != 0) {
+      k = args[0];
+    } else {
+      *error = std::string("Invalid curve parameter in '") + definition + "' !";
+      return false;
+    }
+    curve->compile(is_exp ? Exp : Log, k, source_min, source_max, target_min, target_max);
+  } else if (name == "pow") {
+    if (args.size() != 1 || args[0] <= 0) {
+      *error = std::string("Invalid curve parameter in '") + definition + "' (should be > 0) !";
+      return false;
+    }
+    curve->compile(Pow, args[0], source_min, source_max, target_min, target_max);
+  } else if (name == "table") {
+    if (args.size() < 2) {
+      *error = std::string("A table needs at least two values in '") + definition + "' !";
+      return false;
+    }
+    Real direction = args.back() - args.front();
+    for (size_t i = 0; i < args.size(); ++i) {
+      if (args[i] < 0 || args[i] > 1 ||
+          (i > 0 && (args[i] - args[i - 1]) * direction < 0)) {
+        *error = std::string("Table values should be monotonic and in [0,1] in '") + definition + "' !";
+        return false;
+      }
+    }
+    curve->compile(Table, 0, source_min, source_max, target_min, target_max);
+    curve->lut_ = args;
+    invert(curve->lut_, &curve->inverse_lut_);
+  } else {
+    *error = std::string("Unknown curve '") + definition + "' !";
+    return false;
+  }
+
+  return true;
+}
+
+void MapCurve::scale(const Real *source, Real *target, size_t count) const {
+  for (size_t i = 0; i < count; ++i) {
+    target[i] = scale(source[i]);
+  }
+}
+
+MapCurve MapCurve::inverse() const {
+  MapCurve curve;
+  Real source_max = source_min_ + source_range_;
+  Real target_max = target_min_ + target_range_;
+  switch (type_) {
+    case Exp:
+      curve.compile(Log, param_, target_min_, target_max, source_min_, source_max);
+      break;
+    case Log:
+      curve.compile(Exp, param_, target_min_, target_max, source_min_, source_max);
+      break;
+    case Pow:
+      curve.compile(Pow, 1 / param_, target_min_, target_max, source_min_, source_max);
+      break;
+    case Table:
+      curve.compile(Table, 0, target_min_, target_max, source_min_, source_max);
+      curve.lut_         = inverse_lut_;
+      curve.inverse_lut_ = lut_;
+      break;
+    default:
+      curve.compile(Linear, 0, target_min_, target_max, source_min_, source_max);
+  }
+  return curve;
+}
+
+Real MapCurve::shape(Real x) const {
+  if (x < 0) {
+    x = 0;
+  } else if (x > 1) {
+    x = 1;
+  }
+
+  switch (type_) {
+    case Exp:
+      return (exp(param_ * x) - 1) / exp_param_;
+    case Log:
+      return log(1 + x * exp_param_) / param_;
+    case Pow:
+      return pow(x, param_);
+    case Table:
+      return interpolate(lut_, x);
+    default:
+      return x;
+  }
+}
+
+void MapCurve::compile(Type type, Real param, Real source_min, Real source_max,
+                       Real target_min, Real target_max) {
+  type_         = type;
+  param_        = param;
+  exp_param_    = exp(param) - 1;
+  source_min_   = source_min;
+  source_range_ = source_max - source_min;
+  target_min_   = target_min;
+  target_range_ = target_max - target_min;
+  lut_.clear();
+  inverse_lut_.clear();
+
+  if (type == Linear || type == Table) return;
+
+  std::vector<Real> lut(MAP_CURVE_LUT_SIZE + 1);
+  for (size_t i = 0; i <= MAP_CURVE_LUT_SIZE; ++i) {
+    lut[i] = shape((Real)i / MAP_CURVE_LUT_SIZE);
+  }
+
+  // Only use the table if interpolation is precise enough (steep curves
+  // like 'log' or 'pow(0.5)' are computed).
+  for (size_t i = 0; i < MAP_CURVE_LUT_SIZE; ++i) {
+    Real middle = (i + 0.5) / MAP_CURVE_LUT_SIZE;
+    Real error = (lut[i] + lut[i + 1]) / 2 - shape(middle);
+    if (error > MAP_CURVE_LUT_TOLERANCE || error < -MAP_CURVE_LUT_TOLERANCE) return;
+  }
+  lut_.swap(lut);
+}
+
+void MapCurve::invert(const std::vector<Real> &table, std::vector<Real> *inverse) {
+  size_t segments = table.size() - 1;
+  // work on increasing values
+  Real sign = table[segments] < table[0] ? -1 : 1;
+
+  inverse->resize(MAP_CURVE_LUT_SIZE + 1);
+  for (size_t j = 0; j <= MAP_CURVE_LUT_SIZE; ++j) {
+    Real y = sign * j / MAP_CURVE_LUT_SIZE;
+    Real x;
+    if (y <= sign * table[0]) {
+      x = 0;
+    } else if (y >= sign * table[segments]) {
+      x = 1;
+    } else {
+      // sign * table[lo] < y <= sign * table[hi]
+      size_t lo = 0, hi = segments;
+      while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (sign * table[mid] < y) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+      Real delta = sign * (table[hi] - table[lo]);
+      x = (lo + (delta > 0 ? (y - sign * table[lo]) / delta : 0)) / segments;
+    }
+    (*inverse)[j] = x;
+  }
+}
+
+}  // oscit
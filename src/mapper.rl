@@ -38,9 +38,18 @@ namespace oscit {
 
 //#define DEBUG_PARSER
 
-Mapper::Mapper() : map_(200), reverse_map_(200) {}
+/** Number of values scaled without allocating a buffer.
+ */
+#define MAPPER_STACK_VALUES 64
 
-Mapper::Mapper(size_t hash_table_size) : map_(hash_table_size), reverse_map_(hash_table_size) {}
+/** Maximal number of pattern rules matching a single url.
+ */
+#define MAPPER_MAX_MATCHES 16
+
+Mapper::Mapper() : map_(200), reverse_map_(200), patterns_(200), reverse_patterns_(200) {}
+
+Mapper::Mapper(size_t hash_table_size) : map_(hash_table_size), reverse_map_(hash_table_size),
+                                         patterns_(hash_table_size), reverse_patterns_(hash_table_size) {}
 
 Mapper::~Mapper() {
   clear();
@@ -49,10 +58,174 @@ Mapper::~Mapper() {
 void Mapper::clear() {
   map_.clear();
   reverse_map_.clear();
+  patterns_.clear();
+  reverse_patterns_.clear();
+}
+
+static inline bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool Mapper::UrlPattern::parse(const std::string &url) {
+  literals_.clear();
+  names_.clear();
+
+  size_t start = 0;
+  while (true) {
+    size_t open = url.find('{', start);
+    size_t close = url.find('}', start);
+    if (open == std::string::npos) {
+      if (close != std::string::npos) return false;
+      literals_.push_back(url.substr(start));
+      return true;
+    }
+
+    close = url.find('}', open);
+    if (close == std::string::npos || close == open + 1 ||
+        url.find('{', open + 1) < close) return false;
+    // two captures must be separated by some text
+    if (open == start && !names_.empty()) return false;
+    if (names_.size() == MAPPER_MAX_CAPTURES) return false;
+
+    literals_.push_back(url.substr(start, open - start));
+    names_.push_back(url.substr(open + 1, close - open - 1));
+    start = close + 1;
+  }
+}
+
+bool Mapper::UrlPattern::match(const std::string &url, size_t *captures) const {
+  size_t size = url.size();
+  size_t pos = 0;
+  size_t count = names_.size();
+
+  for (size_t i = 0; i < count; ++i) {
+    const std::string &literal = literals_[i];
+    if (url.compare(pos, literal.size(), literal) != 0) return false;
+    pos += literal.size();
+
+    size_t start = pos;
+    while (pos < size && is_digit(url[pos])) ++pos;
+    if (pos == start) return false;
+    captures[2 * i]     = start;
+    captures[2 * i + 1] = pos - start;
+  }
+
+  const std::string &last = literals_[count];
+  return size - pos == last.size() && url.compare(pos, last.size(), last) == 0;
+}
+
+void Mapper::UrlPattern::expand(const std::string &url, const size_t *captures,
+                                const std::vector<size_t> &indices, std::string *result) const {
+  result->assign(literals_[0]);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    result->append(url, captures[2 * indices[i]], captures[2 * indices[i] + 1]);
+    result->append(literals_[i + 1]);
+  }
+}
+
+Mapper::PatternRules::PatternRules(size_t hash_table_size) : index_(hash_table_size) {}
+
+void Mapper::PatternRules::add(const PatternRule &rule) {
+  const MapElement &element = rule.element_;
+  std::string key(rule.source_pattern_.key());
+  std::vector<size_t> *group;
+
+  if (index_.get(key, &group)) {
+    std::vector<size_t>::iterator it, end = group->end();
+    for (it = group->begin(); it != end; ++it) {
+      PatternRule &other = rules_[*it];
+      const MapElement &other_element = other.element_;
+      if (other.source_ == rule.source_ &&
+          ((other_element.all() && element.all()) ||
+           (other_element.first_ == element.first_ && other_element.count_ == element.count_ &&
+            other_element.target_url_ == element.target_url_))) {
+        // redefinition
+        other = rule;
+        return;
+      }
+    }
+    group->push_back(rules_.size());
+  } else {
+    index_.set(key, std::vector<size_t>(1, rules_.size()));
+  }
+  rules_.push_back(rule);
+}
+
+size_t Mapper::PatternRules::find(const std::string &url, size_t *matches, size_t *captures, size_t max) const {
+  if (rules_.empty()) return 0;
+
+  std::string key;
+  key.reserve(url.size() + 1);
+  size_t size = url.size();
+  size_t end = size;
+  // try folders "/a/b/", "/a/", "/" and ""
+  while (true) {
+    size_t pos = end == 0 ? std::string::npos : url.rfind('/', end - 1);
+    size_t folder_size = pos == std::string::npos ? 0 : pos + 1;
+
+    // The last capture is a number after the folder: try all the possible
+    // ends (longest first).
+    for (size_t i = folder_size + 1; i <= size; ++i) {
+      if (!is_digit(url[i - 1]) || (i < size && is_digit(url[i]))) continue;
+      key.assign(url, 0, folder_size);
+      key.push_back('\n');
+      key.append(url, i, std::string::npos);
+
+      const std::vector<size_t> *group;
+      if (!index_.get(key, &group)) continue;
+
+      size_t found = 0;
+      std::vector<size_t>::const_iterator it, group_end = group->end();
+      for (it = group->begin(); it != group_end && found < max; ++it) {
+        if (rules_[*it].source_pattern_.match(url, captures + found * 2 * MAPPER_MAX_CAPTURES)) {
+          matches[found++] = *it;
+        }
+      }
+      if (found) return found;
+    }
+
+    if (pos == std::string::npos) return 0;
+    end = pos;
+  }
+}
+
+bool Mapper::parse_selector(std::string *url, size_t *first, size_t *count) {
+  *first = 0;
+  *count = 0;
+
+  size_t len = url->size();
+  if (len == 0 || (*url)[len - 1] != ']') return true;
+
+  size_t open = url->rfind('[');
+  if (open == std::string::npos) return false;
+
+  std::string selector = url->substr(open + 1, len - open - 2);
+  size_t dots = selector.find("..");
+  char *end;
+
+  if (dots == std::string::npos) {
+    // single element
+    long index = strtol(selector.c_str(), &end, 10);
+    if (selector.empty() || *end != '\0' || index < 0) return false;
+    *first = index;
+    *count = 1;
+  } else {
+    std::string from = selector.substr(0, dots);
+    std::string to   = selector.substr(dots + 2);
+    long start = strtol(from.c_str(), &end, 10);
+    if (from.empty() || *end != '\0' || start < 0) return false;
+    long last  = strtol(to.c_str(), &end, 10);
+    if (to.empty() || *end != '\0' || last < start) return false;
+    *first = start;
+    *count = last - start + 1;
+  }
+
+  url->erase(open);
+  return true;
 }
 
 bool Mapper::set_map(const std::string &source_url, Real source_min, Real source_max,
-             const std::string &target_url, Real target_min, Real target_max) {
+             const std::string &target_url, Real target_min, Real target_max, const std::string &curve_definition) {
   if (source_min == source_max) {
     // TODO: record line, better error reporting
     error_ = std::string("Source min and max cannot be the same value !");
@@ -65,25 +238,227 @@ bool Mapper::set_map(const std::string &source_url, Real source_min, Real source
     return false;
   }
 
-  map_.set(source_url, MapElement(target_url, source_min, source_max, target_min, target_max));
-  reverse_map_.set(target_url, MapElement(source_url, target_min, target_max, source_min, source_max));
+  std::string source(source_url);
+  size_t first, count;
+  if (!parse_selector(&source, &first, &count)) {
+    error_ = std::string("Invalid element selector in '") + source_url + "' !";
+    return false;
+  }
+
+  MapCurve curve;
+  if (!curve_definition.empty() &&
+      !MapCurve::parse(curve_definition, source_min, source_max, target_min, target_max, &curve, &error_)) {
+    return false;
+  }
+
+  MapElement element(target_url, source_min, source_max, target_min, target_max, first, count, curve);
+  MapElement reverse_element(source, target_min, target_max, source_min, source_max, 0, 0, curve.inverse());
+
+  UrlPattern source_pattern, target_pattern;
+  if (!source_pattern.parse(source)) {
+    error_ = std::string("Invalid pattern in '") + source_url + "' !";
+    return false;
+  }
+
+  if (!target_pattern.parse(target_url)) {
+    error_ = std::string("Invalid pattern in '") + target_url + "' !";
+    return false;
+  }
+
+  if (source_pattern.is_pattern() || target_pattern.is_pattern()) {
+    return set_pattern_map(source, source_pattern, target_url, target_pattern, element, reverse_element);
+  }
+
+  MapElements *elements;
+
+  if (map_.get(source, &elements)) {
+    MapElements::iterator it, end = elements->end();
+    for (it = elements->begin(); it != end; ++it) {
+      if ((it->all() && element.all()) ||
+          (it->first_ == first && it->count_ == count && it->target_url_ == target_url)) {
+        // redefinition
+        *it = element;
+        break;
+      }
+    }
+    if (it == end) elements->push_back(element);
+  } else {
+    map_.set(source, MapElements(1, element));
+  }
+
+  if (element.all()) {
+    // Reverse mapping is only possible if all values are mapped.
+    reverse_map_.set(target_url, reverse_element);
+  }
   return true;
 }
 
+bool Mapper::set_pattern_map(const std::string &source, const UrlPattern &source_pattern,
+                             const std::string &target_url, const UrlPattern &target_pattern,
+                             const MapElement &element, const MapElement &reverse_element) {
+  // find source capture for each target capture
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < target_pattern.names_.size(); ++i) {
+    const std::string &name = target_pattern.names_[i];
+    size_t j = 0;
+    while (j < source_pattern.names_.size() && source_pattern.names_[j] != name) ++j;
+    if (j == source_pattern.names_.size()) {
+      error_ = std::string("Unknown capture '{") + name + "}' in '" + target_url + "' !";
+      return false;
+    }
+    indices.push_back(j);
+  }
 
-bool Mapper::map(const std::string &source, Real value, std::string *target, Real *target_value) {
-  const MapElement *res;
-  if (!map_.get(source, &res)) return false;
-  *target       = res->target_url();
-  *target_value = res->scale(value);
+  patterns_.add(PatternRule(source, source_pattern, target_pattern, indices, element));
+
+  if (element.all()) {
+    // Reverse mapping is only possible if the target contains all the source captures.
+    std::vector<size_t> reverse_indices;
+    for (size_t i = 0; i < source_pattern.names_.size(); ++i) {
+      const std::string &name = source_pattern.names_[i];
+      size_t j = 0;
+      while (j < target_pattern.names_.size() && target_pattern.names_[j] != name) ++j;
+      if (j == target_pattern.names_.size()) return true;
+      reverse_indices.push_back(j);
+    }
+    reverse_patterns_.add(PatternRule(target_url, target_pattern, source_pattern, reverse_indices,
+                                      reverse_element));
+  }
   return true;
 }
 
-bool Mapper::reverse_map(const std::string &source, Real value, std::string *target, Real *target_value) {
+bool Mapper::map(const std::string &source, Real value, const std::string **target, std::string *buffer,
+                 Real *target_value) {
+  const MapElements *elements;
+  if (map_.get(source, &elements)) {
+    MapElements::const_iterator it, end = elements->end();
+    for (it = elements->begin(); it != end; ++it) {
+      if (it->all() || it->first_ == 0) {
+        *target       = &it->target_url();
+        *target_value = it->scale(value);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t matches[MAPPER_MAX_MATCHES];
+  size_t captures[MAPPER_MAX_MATCHES * 2 * MAPPER_MAX_CAPTURES];
+  size_t found = patterns_.find(source, matches, captures, MAPPER_MAX_MATCHES);
+  for (size_t i = 0; i < found; ++i) {
+    const PatternRule &rule = patterns_.rules_[matches[i]];
+    if (rule.element_.all() || rule.element_.first_ == 0) {
+      rule.target_pattern_.expand(source, captures + i * 2 * MAPPER_MAX_CAPTURES, rule.indices_, buffer);
+      *target       = buffer;
+      *target_value = rule.element_.scale(value);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Mapper::push_target(const MapElement &element, const Real *input, Real *output, size_t size,
+                         bool is_real, std::vector<Target> *targets) {
+  size_t first = element.first_;
+  if (first >= size) return false;
+  size_t count = element.all() ? size : element.count_;
+  if (first + count > size) count = size - first;
+
+  element.scale(input + first, output, count);
+
+  targets->push_back(Target());
+  Target &target = targets->back();
+  if (element.count_ == 1 || (element.all() && is_real)) {
+    target.value_.set(output[0]);
+  } else {
+    target.value_ = ListValue();
+    for (size_t i = 0; i < count; ++i) {
+      target.value_.push_back(output[i]);
+    }
+  }
+  return true;
+}
+
+size_t Mapper::map(const std::string &source, const Value &values, std::vector<Target> *targets) {
+  const MapElements *elements;
+  size_t matches[MAPPER_MAX_MATCHES];
+  size_t captures[MAPPER_MAX_MATCHES * 2 * MAPPER_MAX_CAPTURES];
+  size_t match_count = 0;
+
+  if (!map_.get(source, &elements)) {
+    elements = NULL;
+    match_count = patterns_.find(source, matches, captures, MAPPER_MAX_MATCHES);
+    if (!match_count) return 0;
+  }
+
+  // gather values in a contiguous array
+  Real stack_buffer[MAPPER_STACK_VALUES * 2];
+  std::vector<Real> heap_buffer;
+  Real *input;
+  size_t size;
+
+  if (values.is_real()) {
+    size = 1;
+    input = stack_buffer;
+    input[0] = values.r;
+  } else if (values.is_list()) {
+    size = values.size();
+    if (size > MAPPER_STACK_VALUES) {
+      heap_buffer.resize(size * 2);
+      input = &heap_buffer[0];
+    } else {
+      input = stack_buffer;
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+      const Value &val = values[i];
+      if (!val.is_real()) return 0;
+      input[i] = val.r;
+    }
+  } else {
+    return 0;
+  }
+  Real *output = input + size;
+
+  size_t found = 0;
+  if (elements) {
+    MapElements::const_iterator it, end = elements->end();
+    for (it = elements->begin(); it != end; ++it) {
+      if (push_target(*it, input, output, size, values.is_real(), targets)) {
+        targets->back().url_ = &it->target_url();
+        ++found;
+      }
+    }
+  } else {
+    for (size_t i = 0; i < match_count; ++i) {
+      const PatternRule &rule = patterns_.rules_[matches[i]];
+      if (push_target(rule.element_, input, output, size, values.is_real(), targets)) {
+        rule.target_pattern_.expand(source, captures + i * 2 * MAPPER_MAX_CAPTURES, rule.indices_,
+                                    &targets->back().expanded_url_);
+        ++found;
+      }
+    }
+  }
+  return found;
+}
+
+bool Mapper::reverse_map(const std::string &source, Real value, const std::string **target, std::string *buffer,
+                         Real *target_value) {
   const MapElement *res;
-  if (!reverse_map_.get(source, &res)) return false;
-  *target        = res->target_url();
-  *target_value  = res->scale(value);
+  if (reverse_map_.get(source, &res)) {
+    *target        = &res->target_url();
+    *target_value  = res->scale(value);
+    return true;
+  }
+
+  size_t matches[MAPPER_MAX_MATCHES];
+  size_t captures[MAPPER_MAX_MATCHES * 2 * MAPPER_MAX_CAPTURES];
+  if (!reverse_patterns_.find(source, matches, captures, MAPPER_MAX_MATCHES)) return false;
+
+  const PatternRule &rule = reverse_patterns_.rules_[matches[0]];
+  rule.target_pattern_.expand(source, captures, rule.indices_, buffer);
+  *target       = buffer;
+  *target_value = rule.element_.scale(value);
   return true;
 }
 
@@ -152,8 +527,10 @@ bool Mapper::reverse_map(const std::string &source, Real value, std::string *tar
      std::cout << "[set_map " << source_url << " [" << source_min << ", " << source_max << "]" << " --> " <<
                                  target_url << " [" << target_min << ", " << target_max << "]" << std::endl;
    #endif
-   if (!set_map(source_url, source_min, source_max, target_url, target_min, target_max)) return false;
+   // str_buf holds the curve definition (empty for a linear map)
+   if (!set_map(source_url, source_min, source_max, target_url, target_min, target_max, str_buf)) return false;
 
+   str_buf    = "";
    source_url = "";
    source_min = 0.0;
    source_max = 0.0;
@@ -196,11 +573,13 @@ bool Mapper::reverse_map(const std::string &source, Real value, std::string *tar
   real      = ws* ([\-+]? $str_a ('0'..'9' digit* '.' digit+) $str_a );
   integer   = ws* ([\-+]? $str_a ('0'..'9' digit*) $str_a );
   number    = real | integer;
+  curve     = (alpha+ ('(' [^)\n]* ')')?) $str_a;
 
   map_entry = string %source_url ws wsc '[' number %source_min ws* ',' number %source_max ws* ']' wsc '-'+ '>'
-              wsc string %target_url ws wsc '[' number %target_min ws* ',' number %target_max ws* ']' %set_map;
+              wsc string %target_url ws wsc '[' number %target_min ws* ',' number %target_max ws* ']'
+              ([ \t]+ curve)? [ \t]*;
 
-  main := (map_entry '\n' | ws+ | ws* ('#' $comment) ws*)+ '\0' $err(error);
+  main := (map_entry %set_map ('\n' | '#' $comment) | ws+ | ws* ('#' $comment) ws*)+ '\0' $err(error);
 
 }%%
 
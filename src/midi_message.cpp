@@ -36,61 +36,67 @@
 
 namespace oscit {
 MidiMessage::MidiMessage(const Value &message, time_t wait)
-  : type_(RawMidi),
-    data_(message.size()) {
+  : wait_(0),
+    length_(0),
+    size_(0) {
   unpack(message, wait);
 }
 
 bool MidiMessage::unpack(const Value &message, time_t wait) {
-  data_.clear();
-  if (message.size() < 2) return false;  // no message
-
-  size_t sz = message.size();
-  for(size_t i = 0; i < sz; ++i) {
-    if (!message[i].is_real()) return false;
+  if (message.size() < 2) {
+    resize(0);
+    return false;  // no message
+  }
 
-    if (i == sz - 1) {
-      // last is length
-      length_ = message[i].r;
-    } else {
-      data_.push_back((unsigned char)message[i].r);
+  size_t sz = message.size() - 1;
+  for(size_t i = 0; i <= sz; ++i) {
+    if (!message[i].is_real()) {
+      resize(0);
+      return false;
     }
   }
 
+  unsigned char *data = resize(sz);
+  for(size_t i = 0; i < sz; ++i) {
+    data[i] = (unsigned char)message[i].r;
+  }
+  // last is length
+  set_length((time_t)message[sz].r);
+
   wait_ = wait;
-  return set_type_from_data();
+  return true;
 }
 
 std::ostream &operator<<(std::ostream &out_stream, const MidiMessage &midi_message) {
-  std::vector<unsigned char>::const_iterator it,begin,end;
   char buffer[10];
+  int type = midi_message.type();
   out_stream << "MidiMessage ";
-  if (midi_message.type_ == NoteOn || midi_message.type_ == NoteOff) {
+  if (type == NoteOn || type == NoteOff) {
     // NoteOn or NoteOff
-    if (midi_message.type_ == NoteOff)
+    if (type == NoteOff)
       out_stream << "-";
     else
       out_stream << "+";
     midi_message.get_note_name(buffer);
     out_stream << midi_message.channel() << ":" << buffer
-               << "(" << (int)midi_message.data_[2] << "), ";
-    out_stream << midi_message.wait_ << "/" << midi_message.length_;
+               << "(" << (int)midi_message.data()[2] << "), ";
+    out_stream << midi_message.wait() << "/" << midi_message.length();
 
-  } else if (midi_message.type_ == CtrlChange) {
+  } else if (type == CtrlChange) {
     // CtrlChange
     out_stream << "~" << (int)midi_message.channel() << ":"
                << (int)midi_message.ctrl() << "("
                << (int)midi_message.value() << "), ";
     out_stream << midi_message.wait_;
 
-  } else if (midi_message.type_ == RawMidi) {
+  } else if (type == RawMidi) {
     // RawMidi
     out_stream << "[";
-    end   = midi_message.data_.end();
-    begin = midi_message.data_.begin();
-    for( it = begin; it < end; it++) {
-      if (it != begin) out_stream << ", ";
-      out_stream << (int)*it << std::endl;
+    const unsigned char *data = midi_message.data();
+    size_t size = midi_message.size();
+    for(size_t i = 0; i < size; ++i) {
+      if (i != 0) out_stream << ", ";
+      out_stream << (int)data[i] << std::endl;
     }
     out_stream << "]";
 
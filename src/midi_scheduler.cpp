@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/midi_scheduler.h"
+
+#include <string.h> // memset, memcpy
+
+#include <algorithm> // push_heap, pop_heap
+
+#include "oscit/time_ref.h"
+
+namespace oscit {
+
+MidiScheduler::MidiScheduler(size_t capacity)
+    : capacity_(capacity),
+      sequence_(0),
+      dropped_(0),
+      should_run_(true) {
+  pthread_mutex_init(&mutex_, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+#ifndef __macosx__
+  // timed waits use the monotonic clock (see wait_until)
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+  pthread_cond_init(&cond_, &attr);
+  pthread_condattr_destroy(&attr);
+
+  memset(playing_, 0, sizeof(playing_));
+  events_.reserve(capacity_);
+
+  thread_.start_thread<MidiScheduler, &MidiScheduler::run>(this);
+}
+
+MidiScheduler::~MidiScheduler() {
+  stop();
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+bool MidiScheduler::schedule(const MidiMessage &message) {
+  return schedule(message, TimeRef::now(), true);
+}
+
+bool MidiScheduler::schedule_at(const MidiMessage &message, int64_t time) {
+  return schedule(message, time, false);
+}
+
+bool MidiScheduler::schedule(const MidiMessage &message, int64_t time, bool use_wait) {
+  const unsigned char *data = message.data();
+  size_t size = message.size();
+  if (size == 0) return false;
+
+  if (use_wait) time += (int64_t)message.wait() * 1000000;
+
+  bool note = message.type() == NoteOn && message.length() > 0 && size == 3;
+
+  pthread_mutex_lock(&mutex_);
+    if (!should_run_ || events_.size() + (note ? 2 : 1) > capacity_) {
+      ++dropped_;
+      pthread_mutex_unlock(&mutex_);
+      return false;
+    }
+
+    bool wake = events_.empty() || time < events_.front().time_;
+    push(time, data, size, note);
+
+    if (note) {
+      unsigned char note_off[3];
+      note_off[0] = data[0] - 0x10;
+      note_off[1] = data[1];
+      note_off[2] = data[2];
+      push(time + (int64_t)message.length() * 1000000, note_off, 3, true);
+    }
+
+    if (wake) pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+  return true;
+}
+
+void MidiScheduler::push(int64_t time, const unsigned char *data, size_t size, bool counted) {
+  Event event;
+  event.time_     = time;
+  event.sequence_ = sequence_++;
+  event.counted_  = counted;
+
+  if (size <= MIDI_SCHEDULER_INLINE_BYTES) {
+    memcpy(event.data_, data, size);
+    event.size_      = size;
+    event.long_data_ = NULL;
+  } else {
+    event.size_      = 0;
+    event.long_data_ = new std::vector<unsigned char>(data, data + size);
+  }
+
+  events_.push_back(event);
+  std::push_heap(events_.begin(), events_.end());
+}
+
+void MidiScheduler::fire(Event &event, MidiMessage *message) {
+  if (event.long_data_) {
+    message->set(&(*event.long_data_)[0], event.long_data_->size());
+    delete event.long_data_;
+  } else {
+    message->set(event.data_, event.size_);
+  }
+
+  if (event.counted_) {
+    unsigned char status = event.data_[0];
+    unsigned short &playing = playing_[(status & 0x0f) * 128 + (event.data_[1] & 0x7f)];
+    if ((status & 0xf0) == NoteOn) {
+      ++playing;
+    } else if (playing > 1) {
+      // the same note was played again: release with the last one
+      --playing;
+      return;
+    } else {
+      playing = 0;
+    }
+  }
+
+  pthread_mutex_unlock(&mutex_);
+    send(*message);
+  pthread_mutex_lock(&mutex_);
+}
+
+void MidiScheduler::all_notes_off() {
+  std::vector<Event> note_offs;
+
+  pthread_mutex_lock(&mutex_);
+    std::vector<Event>::iterator it, end = events_.end();
+    for (it = events_.begin(); it != end; ++it) {
+      delete it->long_data_;
+    }
+    events_.clear();
+
+    for (size_t i = 0; i < 16 * 128; ++i) {
+      if (playing_[i]) {
+        Event event;
+        event.data_[0]   = NoteOff + i / 128;
+        event.data_[1]   = i % 128;
+        event.data_[2]   = 0;
+        event.size_      = 3;
+        event.counted_   = false;
+        event.long_data_ = NULL;
+        note_offs.push_back(event);
+        playing_[i] = 0;
+      }
+    }
+
+    MidiMessage message;
+    for (it = note_offs.begin(), end = note_offs.end(); it != end; ++it) {
+      fire(*it, &message);
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void MidiScheduler::stop() {
+  pthread_mutex_lock(&mutex_);
+    bool running = should_run_;
+    should_run_ = false;
+    pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+
+  if (running) {
+    thread_.join();
+    all_notes_off();
+  }
+}
+
+size_t MidiScheduler::pending() {
+  pthread_mutex_lock(&mutex_);
+    size_t count = events_.size();
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+size_t MidiScheduler::dropped() {
+  pthread_mutex_lock(&mutex_);
+    size_t count = dropped_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+void MidiScheduler::wait_until(int64_t time) {
+  if (time < 0) {
+    pthread_cond_wait(&cond_, &mutex_);
+    return;
+  }
+
+#ifdef __macosx__
+  int64_t delay = time - TimeRef::now();
+  if (delay <= 0) return;
+  struct timespec wait;
+  wait.tv_sec  = delay / 1000000000;
+  wait.tv_nsec = delay % 1000000000;
+  pthread_cond_timedwait_relative_np(&cond_, &mutex_, &wait);
+#else
+  struct timespec wait;
+  wait.tv_sec  = time / 1000000000;
+  wait.tv_nsec = time % 1000000000;
+  pthread_cond_timedwait(&cond_, &mutex_, &wait);
+#endif
+}
+
+void MidiScheduler::run(Thread *runner) {
+  runner->high_priority();
+  runner->thread_ready();
+
+  pthread_mutex_lock(&mutex_);
+    while (should_run_) {
+      if (events_.empty()) {
+        wait_until(-1);
+        continue;
+      }
+
+      int64_t time = events_.front().time_;
+      if (time > TimeRef::now()) {
+        wait_until(time);
+        continue;
+      }
+
+      std::pop_heap(events_.begin(), events_.end());
+      Event event = events_.back();
+      events_.pop_back();
+      fire(event, &message_);
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+}  // oscit
@@ -0,0 +1,219 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/midi_stream.h"
+
+#include "oscit/values.h"
+
+namespace oscit {
+
+bool MidiStream::is_midi_list(const Value &value) {
+  if (!value.is_list() || value.size() == 0) return false;
+  size_t sz = value.size();
+  for (size_t i = 0; i < sz; ++i) {
+    if (!value[i].is_midi()) return false;
+  }
+  return true;
+}
+
+bool MidiStream::encode(const Value &value, std::string *stream, bool keep_list) {
+  int flags = 0;
+  size_t count = 1;
+  if (value.is_list()) {
+    if (!is_midi_list(value)) return false;
+    if (keep_list) flags |= MIDI_STREAM_LIST;
+    count = value.size();
+  } else if (!value.is_midi()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const MidiMessage message(value.is_list() ? value[i].midi_message() : value.midi_message());
+    if (message.wait()) flags |= MIDI_STREAM_WAIT;
+    if (message.type() == NoteOn && message.length()) flags |= MIDI_STREAM_LENGTH;
+  }
+
+  stream->clear();
+  stream->push_back((char)flags);
+
+  unsigned char running_status = 0;
+  for (size_t i = 0; i < count; ++i) {
+    encode(value.is_list() ? value[i].midi_message() : value.midi_message(), flags, &running_status, stream);
+  }
+  return true;
+}
+
+void MidiStream::encode(const MidiMessage &message, int flags, unsigned char *running_status, std::string *stream) {
+  const unsigned char *data = message.data();
+  size_t size = message.size();
+  if (size == 0) return;
+
+  if (flags & MIDI_STREAM_WAIT) {
+    time_t wait = message.wait();
+    write_number(wait < 0 ? 0 : (wait > MIDI_STREAM_MAX_NUMBER ? MIDI_STREAM_MAX_NUMBER : wait), stream);
+  }
+
+  unsigned char status = data[0];
+  if (status < 0xf0) {
+    if (status == *running_status) {
+      ++data;
+      --size;
+    } else {
+      *running_status = status;
+    }
+  } else if (status < 0xf8) {
+    // system common messages cancel running status (real time messages don't)
+    *running_status = 0;
+  }
+  stream->append((const char*)data, size);
+
+  if ((flags & MIDI_STREAM_LENGTH) && message.type() == NoteOn) {
+    write_number(message.length(), stream);
+  }
+}
+
+bool MidiStream::decode(const unsigned char *stream, size_t size, Value *result) {
+  if (size == 0) return false;
+
+  const unsigned char *p = stream;
+  const unsigned char *end = stream + size;
+  int flags = *p++;
+  unsigned char running_status = 0;
+  bool is_list = flags & MIDI_STREAM_LIST;
+  MidiMessage message;
+  Value value;
+
+  result->set_empty();
+
+  while (p < end) {
+    size_t wait = 0, length = 0;
+    if ((flags & MIDI_STREAM_WAIT) && !read_number(&p, end, &wait)) return false;
+    if (p >= end) return false;
+
+    const unsigned char *start = p;
+    unsigned char status = *p;
+    if (status < 0x80) {
+      // running status
+      if (!running_status) return false;
+      status = running_status;
+    } else {
+      ++p;
+      if (status < 0xf0) {
+        running_status = status;
+      } else if (status < 0xf8) {
+        running_status = 0;
+      }
+    }
+
+    int data_bytes = data_size(status);
+    if (data_bytes < 0) {
+      // SysEx
+      while (p < end && *p != 0xf7) ++p;
+      if (p == end) return false;
+      ++p;
+      message.set(start, p - start, wait);
+    } else {
+      if (end - p < data_bytes) return false;
+      unsigned char bytes[3];
+      bytes[0] = status;
+      for (int i = 0; i < data_bytes; ++i) {
+        bytes[i + 1] = *p++;
+      }
+      message.set(bytes, data_bytes + 1, wait);
+    }
+
+    if ((flags & MIDI_STREAM_LENGTH) && message.type() == NoteOn && !read_number(&p, end, &length)) return false;
+    message.set_length(length);
+
+    if (result->is_empty() && !is_list) {
+      result->set(message);
+    } else {
+      if (!result->is_list()) {
+        // second message
+        value = *result;
+        result->set_type(LIST_VALUE);
+        if (value.is_midi()) result->push_back(value);
+      }
+      value.set(message);
+      result->push_back(value);
+    }
+  }
+  return !result->is_empty();
+}
+
+int MidiStream::data_size(unsigned char status) {
+  switch (status & 0xf0) {
+    case ProgramChange:  /* continue */
+    case ChanAftertouch:
+      return 1;
+    case 0xf0:
+      break;
+    default:
+      return 2;
+  }
+
+  switch (status) {
+    case 0xf0: // SysEx
+      return -1;
+    case 0xf1: // time code quarter frame
+    case 0xf3: // song select
+      return 1;
+    case 0xf2: // song position
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+void MidiStream::write_number(size_t number, std::string *stream) {
+  // 7 bits per byte, most significant first, high bit set on all but the last byte
+  char buffer[10];
+  size_t i = sizeof(buffer);
+  buffer[--i] = number & 0x7f;
+  while (number >>= 7) {
+    buffer[--i] = (number & 0x7f) | 0x80;
+  }
+  stream->append(buffer + i, sizeof(buffer) - i);
+}
+
+bool MidiStream::read_number(const unsigned char **stream, const unsigned char *end, size_t *number) {
+  const unsigned char *p = *stream;
+  size_t n = 0;
+  for (int i = 0; i < MIDI_STREAM_NUMBER_BYTES && p < end; ++i) {
+    n = (n << 7) | (*p & 0x7f);
+    if (!(*p++ & 0x80)) {
+      *number = n;
+      *stream = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // oscit
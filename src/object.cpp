@@ -34,6 +34,7 @@
 
 #include "oscit/root.h"
 #include "oscit/object_handle.h"
+#include "oscit/reply_stream.h"
 
 namespace oscit {
 
@@ -57,6 +58,7 @@ const Value Object::set(const Value &hash) {
 
   Value param;
   ObjectHandle handle;
+  bool attributes_set = false;
 
   for (it = hash.begin(); it != end; ++it) {
     Value param;
@@ -66,6 +68,7 @@ const Value Object::set(const Value &hash) {
       // deep merge keys that start with '@' into attributes hash.
       attributes_.deep_merge(HashValue(*it, param));
       result.set(*it, param);
+      attributes_set = true;
     } else {
       if (get_child(*it, &handle)) {
         Value tmp;
@@ -81,33 +84,88 @@ const Value Object::set(const Value &hash) {
     }
   }
 
+  if (attributes_set) attributes_changed();
   return result;
 }
 
+void Object::attributes_changed() {
+  if (root_) root_->attributes_changed(this);
+}
+
 /** Free the child from the list of children. */
 void Object::unregister_child(Object *object) {
-  { ScopedWrite lock(children_);
-    children_.remove_element(object);
-  }
-
-  { ScopedWrite lock(children_vector_);
-    std::vector<Object*>::iterator it, end = children_vector_.end();
-    for(it = children_vector_.begin(); it != end; ++it) {
-      if (*it == object) {
-        it = children_vector_.erase(it);
-        break;
+  ScopedWrite lock(children_);
+  std::vector<Object*>::iterator it, end = children_.end();
+  for(it = children_.begin(); it != end; ++it) {
+    if (*it == object) {
+      children_.erase(it);
+      if (children_index_) {
+        Object *indexed;
+        if (children_index_->get(object->name_, &indexed) && indexed == object) {
+          children_index_->remove(object->name_);
+        } else {
+          // name changed (see set_name)
+          children_index_->remove_element(object);
+        }
       }
+      break;
     }
   }
 }
 
+Object *Object::find_child(const std::string &name) const {
+  if (children_index_) {
+    Object *child;
+    return children_index_->get(name, &child) ? child : NULL;
+  }
+
+  std::vector<Object*>::const_iterator it, end = children_.end();
+  for(it = children_.begin(); it != end; ++it) {
+    if ((*it)->name_ == name) return *it;
+  }
+  return NULL;
+}
+
 void Object::moved() {
-  // 1. get new name from parent, register as child
+  moved(NULL);
+}
+
+void Object::set_strand(Strand *strand) {
+  owns_strand_ = strand != NULL;
+  if (!strand && parent_) strand = parent_->strand_;
+  inherit_strand(strand);
+}
+
+void Object::inherit_strand(Strand *strand) {
+  strand_ = strand;
+
+  ScopedRead lock(children_);
+  std::vector<Object*>::iterator it, end = children_.end();
+  for (it = children_.begin(); it != end; ++it) {
+    if (!(*it)->owns_strand_) (*it)->inherit_strand(strand);
+  }
+}
+
+void Object::moved(std::vector<Object*> *registered) {
+  // 1. unregister with the current url
+  if (root_ && root_ != this) {
+    root_->unregister_object(this);
+    root_ = NULL;
+  }
+
+  // 2. get new name from parent, register as child
   if (parent_) {
     // rebuild fullpath
     url_ = std::string(parent_->url()).append("/").append(name_);
-    set_root(parent_->root_);
+    // 3. register with the new url
+    if (registered) {
+      root_ = parent_->root_;
+      if (root_) registered->push_back(this);
+    } else {
+      set_root(parent_->root_);
+    }
     set_context(parent_->context_);
+    if (!owns_strand_) strand_ = parent_->strand_;
   } else if (root_ == this) {
     // root: url does not contain name
     url_ = "";
@@ -115,52 +173,77 @@ void Object::moved() {
     // no parent
     url_ = name_;
     set_root(NULL);
+    if (!owns_strand_) strand_ = NULL;
   }
 
   { ScopedRead lock(children_);
-    StringIterator it;
-    StringIterator end = children_.end();
-    Object *child;
+    std::vector<Object*>::iterator it, end = children_.end();
 
-    // 3. update children
-    for(it = children_.begin(); it != end; it++) {
-      if (children_.get(*it, &child)) child->moved();
+    // 4. update children
+    for(it = children_.begin(); it != end; ++it) {
+      (*it)->moved(registered);
     }
   }
 }
 
+void Object::attach_tree(Object *tree) {
+  if (tree->parent_) tree->parent_->unregister_child(tree);
+  tree->parent_ = this;
+  register_child(tree);
+
+  std::vector<Object*> objects;
+  tree->moved(&objects);
+  if (root_ && !objects.empty()) root_->register_objects(objects);
+
+  tree->subtree_adopted();
+}
+
+void Object::subtree_adopted() {
+  adopted();
+  ScopedRead lock(children_);
+  std::vector<Object*>::iterator it, end = children_.end();
+  for(it = children_.begin(); it != end; ++it) {
+    (*it)->subtree_adopted();
+  }
+}
+
 void Object::register_child(Object *object) {
   // 1. make sure it is not in dictionary
   unregister_child(object);
 
-  Object *child;
+  ScopedWrite lock(children_);
   // 2. get valid name
-  { ScopedWrite lock(children_);
-    while (children_.get(object->name_, &child)) {
-      object->find_next_name();
-    }
-
-    // 3. add to dictionary with new name
-    children_.set(object->name_, object);
+  while (find_child(object->name_)) {
+    object->find_next_name();
   }
 
-  { ScopedWrite lock(children_vector_);
-    size_t sz = children_vector_.size();
-        // goes last anyway   // empty list   // no keep_last_ object in list
-    if (object->keep_last_    || sz == 0      || !children_vector_[sz-1]->keep_last_) {
-      // just append at the end
-      children_vector_.push_back(object);
-    } else {
-      // insert before the first 'keep_last_' child
-      std::vector<Object*>::iterator it, end = children_vector_.end();
-      for(it = children_vector_.begin(); it != end; ++it) {
-        if ((*it)->keep_last_) {
-          children_vector_.insert(it, object);
-          break;
-        }
+  // 3. add to list with new name
+  size_t sz = children_.size();
+      // goes last anyway   // empty list   // no keep_last_ object in list
+  if (object->keep_last_    || sz == 0      || !children_[sz-1]->keep_last_) {
+    // just append at the end
+    children_.push_back(object);
+  } else {
+    // insert before the first 'keep_last_' child
+    std::vector<Object*>::iterator it, end = children_.end();
+    for(it = children_.begin(); it != end; ++it) {
+      if ((*it)->keep_last_) {
+        children_.insert(it, object);
+        break;
       }
     }
   }
+
+  // 4. update or build index
+  if (children_index_) {
+    children_index_->set(object->name_, object);
+  } else if (children_.size() > OBJECT_CHILDREN_INDEX_THRESHOLD) {
+    children_index_ = new THash<std::string, Object*>(OBJECT_CHILDREN_INDEX_SIZE);
+    std::vector<Object*>::iterator it, end = children_.end();
+    for(it = children_.begin(); it != end; ++it) {
+      children_index_->set((*it)->name_, *it);
+    }
+  }
 }
 
 void Object::set_root(Root *root) {
@@ -179,29 +262,31 @@ void Object::set_parent(Object *parent) {
 
 void Object::clear() {
   ScopedWrite lock(children_);
-  StringIterator it;
-  StringIterator end = children_.end();
+  std::vector<Object*>::iterator it, end = children_.end();
 
   // destroy all children
-  for(it = children_.begin(); it != end; it++) {
-    Object * child;
-    if (children_.get(*it, &child)) {
-      // to avoid 'unregister_child' call (would alter children_)
-      child->parent_ = NULL;
-      if (root_) root_->unregister_object(child);
-      child->release();
-    }
+  for(it = children_.begin(); it != end; ++it) {
+    Object *child = *it;
+    // to avoid 'unregister_child' call (would alter children_)
+    child->parent_ = NULL;
+    if (root_) root_->unregister_object(child);
+    child->release();
   }
   children_.clear();
+
+  if (children_index_) {
+    delete children_index_;
+    children_index_ = NULL;
+  }
 }
 
 
 const Value Object::list() const {
-  ScopedRead lock(children_vector_);
+  ScopedRead lock(children_);
   ListValue list;
 
-  std::vector<Object*>::const_iterator it, end = children_vector_.end();
-  for(it = children_vector_.begin(); it != end; ++it) {
+  std::vector<Object*>::const_iterator it, end = children_.end();
+  for(it = children_.begin(); it != end; ++it) {
     const Object *obj = *it;
     if (obj->children_.empty()) {
       list.push_back(obj->name_);
@@ -217,11 +302,11 @@ const Value Object::list() const {
 const Value Object::to_hash() {
   if (type_id_ == NO_TYPE_TAG_ID) {
     // container
-    { ScopedRead lock(children_vector_);
+    { ScopedRead lock(children_);
       Value result(attributes_); // make a copy (no need for a deep copy)
-      std::vector<Object*>::iterator it, end = children_vector_.end();
+      std::vector<Object*>::iterator it, end = children_.end();
 
-      for(it = children_vector_.begin(); it != end; ++it) {
+      for(it = children_.begin(); it != end; ++it) {
         Object *obj = *it;
         result.set(obj->name(), obj->to_hash());
       }
@@ -235,28 +320,41 @@ const Value Object::to_hash() {
 
 const Value Object::list_with_attributes() const {
   ScopedRead lock(children_);
-  HashIterator it, end = children_.end();
+  std::vector<Object*>::const_iterator it, end = children_.end();
   ListValue list;
-  Object *obj;
 
   for(it = children_.begin(); it != end; ++it) {
-    if (children_.get(*it, &obj)) {
-      if (obj->children_.empty()) {
-        list.push_back(obj->name_);
-      } else {
-        list.push_back(std::string(obj->name_).append("/"));
-      }
-      list.push_back(obj->attributes_);
+    const Object *obj = *it;
+    if (obj->children_.empty()) {
+      list.push_back(obj->name_);
+    } else {
+      list.push_back(std::string(obj->name_).append("/"));
     }
+    list.push_back(obj->attributes_);
   }
 
   return list;
 }
 
+void Object::list_with_attributes(ReplyStream *stream) const {
+  ObjectHandle *children;
+  size_t count = hold_children(&children);
+
+  for (size_t i = 0; i < count; ++i) {
+    const Object *obj = children[i].ptr();
+    if (obj->children_.empty()) {
+      stream->push_back(Value(obj->name_), obj->attributes_);
+    } else {
+      stream->push_back(Value(std::string(obj->name_).append("/")), obj->attributes_);
+    }
+  }
+  delete[] children;
+}
+
 bool Object::get_child(const std::string &name, ObjectHandle *handle) {
-  Object * child;
   ScopedRead lock(children_);
-  if (children_.get(name, &child)) {
+  Object *child = find_child(name);
+  if (child) {
     handle->hold(child);
     return true;
   } else {
@@ -265,25 +363,45 @@ bool Object::get_child(const std::string &name, ObjectHandle *handle) {
 }
 
 bool Object::get_child(size_t index, ObjectHandle *handle) {
-  ScopedRead lock(children_vector_);
-  if (index >= children_vector_.size()) return false;
-  Object *object = children_vector_[index];
+  ScopedRead lock(children_);
+  if (index >= children_.size()) return false;
+  Object *object = children_[index];
   handle->hold(object);
   return true;
 }
 
-// FIXME: 'tree' is bad (locks too much because of recursion) and we do not need it
-// in OSCIT.
 void Object::tree(size_t base_length, Value *tree) const {
-  ConstStringIterator it, end = children_.end();
+  ObjectHandle *children;
+  size_t count = hold_children(&children);
+
+  for (size_t i = 0; i < count; ++i) {
+    const Object *obj = children[i].ptr();
+    tree->push_back(obj->url().substr(base_length));
+    obj->tree(base_length, tree);
+  }
+  delete[] children;
+}
+
+void Object::tree(size_t base_length, ReplyStream *stream) const {
+  ObjectHandle *children;
+  size_t count = hold_children(&children);
+
+  for (size_t i = 0; i < count; ++i) {
+    const Object *obj = children[i].ptr();
+    stream->push_back(Value(obj->url().substr(base_length)));
+    obj->tree(base_length, stream);
+  }
+  delete[] children;
+}
+
+size_t Object::hold_children(ObjectHandle **handles) const {
   ScopedRead lock(children_);
-  for (it = children_.begin(); it != end; ++it) {
-    Object * obj;
-    if (children_.get(*it, &obj)) {
-      tree->push_back(obj->url().substr(base_length));
-      obj->tree(base_length, tree);
-    }
+  size_t count = children_.size();
+  *handles = new ObjectHandle[count];
+  for (size_t i = 0; i < count; ++i) {
+    (*handles)[i].hold(children_[i]);
   }
+  return count;
 }
 
 } // oscit
@@ -37,9 +37,12 @@ namespace oscit {
 
 void ObjectProxy::adopted() {
   root_proxy_ = TYPE_CAST(RootProxy, root_);
-  if (root_proxy_ && type().is_nil()) {
+  // detached (see Object::adopt_tree)
+  if (!root_proxy_) return;
+
+  if (type().is_nil()) {
     // try to find type
-    root_proxy_->send_to_remote(ATTRS_PATH, Value(url()));
+    root_proxy_->query(ATTRS_PATH, url());
   } else if (value_.is_empty()) {
     // only get initial value if type is already there (or we won't receive the value).
     set_value(gNilValue);
@@ -51,7 +54,7 @@ void ObjectProxy::set_value(const Value &val) {
 
   // std::cout << url() << ": set_value(" << val << ")\n";
   if (can_receive(val)) {
-    time_t now = time_ref_.elapsed();
+    Real now = elapsed();
     // only send if value type is correct
     if (latency_ < 0) {
       if (wait_until_ >= 0) {
@@ -82,19 +85,19 @@ void ObjectProxy::handle_value_change(const Value &val) {
     // we guess we are receiving from our own send...
     // TODO: this can lead to latency_ being too short if we receive another
     // notification, but it does not matter
-    latency_ = time_ref_.elapsed() - wait_until_;
+    latency_ = elapsed() - wait_until_;
     wait_until_ = 0;
   } else {
     if (wait_until_) {
       // (gently) update latency
-      latency_ = latency_ + (time_ref_.elapsed() - wait_until_) / 4;
+      latency_ = latency_ + (elapsed() - wait_until_) / 4;
     }
 
     if (!to_send_.is_empty()) {
       // send now
       root_proxy_->send_to_remote(url().c_str(), to_send_);
       to_send_.set_empty();
-      wait_until_ = time_ref_.elapsed() + (latency_ * 1.5);
+      wait_until_ = elapsed() + (latency_ * 1.5);
     } else {
       wait_until_ = 0;
     }
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/observer_leases.h"
+
+#include <vector>
+
+#include "oscit/time_ref.h"
+
+namespace oscit {
+
+ObserverLeases::ObserverLeases(Real ttl, size_t max_failures, TimerWheel *wheel)
+    : leases_(OBSERVER_LEASES_HASH_SIZE),
+      subscribers_(OBSERVER_SUBSCRIPTIONS_HASH_SIZE),
+      ttl_(TimerWheel::ms_to_ns(ttl)),
+      max_failures_(max_failures),
+      expired_count_(0),
+      evicted_count_(0),
+      on_remove_(NULL),
+      on_remove_data_(NULL),
+      wheel_(wheel ? wheel : TimerWheel::shared()),
+      expire_event_(this),
+      next_expiry_(0) {}
+
+ObserverLeases::~ObserverLeases() {
+  // waits for a running 'expire'
+  wheel_->cancel(&expire_event_);
+}
+
+bool ObserverLeases::renew(const Location &location) {
+  ScopedLock lock(mutex_);
+  return renew_lease(location);
+}
+
+bool ObserverLeases::touch(const Location &location) {
+  ScopedLock lock(mutex_);
+  if (!leases_.has_key(location)) return false;
+  renew_lease(location);
+  return true;
+}
+
+bool ObserverLeases::send_failed(const Location &location) {
+  ScopedLock lock(mutex_);
+  Lease *lease;
+  if (!leases_.get(location, &lease)) return false;
+
+  if (++lease->failures_ >= max_failures_) {
+    forget(location);
+    ++evicted_count_;
+    return true;
+  }
+  return false;
+}
+
+void ObserverLeases::remove(const Location &location) {
+  ScopedLock lock(mutex_);
+  forget(location);
+}
+
+bool ObserverLeases::subscribe(const Location &location, const std::vector<std::string> &prefixes) {
+  ScopedLock lock(mutex_);
+  bool is_new = renew_lease(location);
+  Lease *lease;
+  if (!leases_.get(location, &lease)) return is_new;
+
+  unsubscribe(location, lease);
+
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    std::string prefix(prefixes[i]);
+    while (!prefix.empty() && prefix[prefix.size() - 1] == '/') {
+      prefix.resize(prefix.size() - 1);
+    }
+    if (prefix.empty()) {
+      // "/" subscribes to everything
+      keys.clear();
+      break;
+    }
+    keys.push_back(prefix);
+  }
+
+  std::list<Location> *subscribers;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (!subscribers_.get(keys[i], &subscribers)) {
+      subscribers_.set(keys[i], std::list<Location>());
+      subscribers_.get(keys[i], &subscribers);
+    }
+    std::list<Location>::const_iterator it, end = subscribers->end();
+    for (it = subscribers->begin(); it != end; ++it) {
+      if (*it == location) break;
+    }
+    if (it == end) {
+      subscribers->push_back(location);
+      ++lease->subscriptions_;
+    }
+  }
+
+  if (lease->subscriptions_ == 0) unfiltered_.push_back(location);
+  return is_new;
+}
+
+std::list<Location> ObserverLeases::observers() {
+  ScopedLock lock(mutex_);
+  return leases_.keys();
+}
+
+void ObserverLeases::observers_of(const std::string &path, std::list<Location> *observers) {
+  ScopedLock lock(mutex_);
+  observers->insert(observers->end(), unfiltered_.begin(), unfiltered_.end());
+  if (subscribers_.empty()) return;
+
+  // walk up the path: "/a/b/c", "/a/b", "/a"
+  std::string prefix(path);
+  std::list<Location> *subscribers;
+  std::list<Location> found;
+  size_t matches = 0;
+  while (!prefix.empty()) {
+    if (subscribers_.get(prefix, &subscribers)) {
+      found.insert(found.end(), subscribers->begin(), subscribers->end());
+      ++matches;
+    }
+    size_t pos = prefix.rfind('/');
+    if (pos == std::string::npos) break;
+    prefix.resize(pos);
+  }
+
+  // an observer subscribed to "/a" and "/a/b" is found twice
+  if (matches > 1) {
+    std::list<Location>::iterator it, other;
+    for (it = found.begin(); it != found.end(); ++it) {
+      other = it;
+      for (++other; other != found.end();) {
+        if (*other == *it) {
+          other = found.erase(other);
+        } else {
+          ++other;
+        }
+      }
+    }
+  }
+  observers->splice(observers->end(), found);
+}
+
+size_t ObserverLeases::count() {
+  ScopedLock lock(mutex_);
+  return leases_.size();
+}
+
+size_t ObserverLeases::expired_count() {
+  ScopedLock lock(mutex_);
+  return expired_count_;
+}
+
+size_t ObserverLeases::evicted_count() {
+  ScopedLock lock(mutex_);
+  return evicted_count_;
+}
+
+void ObserverLeases::set_ttl(Real ttl) {
+  ScopedLock lock(mutex_);
+  ttl_ = TimerWheel::ms_to_ns(ttl);
+}
+
+void ObserverLeases::set_on_remove(remove_method_t method, void *data) {
+  ScopedLock lock(mutex_);
+  on_remove_ = method;
+  on_remove_data_ = data;
+}
+
+bool ObserverLeases::renew_lease(const Location &location) {
+  int64_t expires_at = TimeRef::now() + ttl_;
+  Lease *lease;
+  bool is_new = !leases_.get(location, &lease);
+  if (is_new) {
+    leases_.set(location, Lease(expires_at));
+    unfiltered_.push_back(location);
+  } else {
+    lease->expires_at_ = expires_at;
+    lease->failures_ = 0;
+  }
+  schedule(expires_at);
+  return is_new;
+}
+
+void ObserverLeases::forget(const Location &location) {
+  Lease *lease;
+  if (!leases_.get(location, &lease)) return;
+  unsubscribe(location, lease);
+  leases_.remove(location);
+  if (on_remove_) (*on_remove_)(on_remove_data_, location);
+}
+
+void ObserverLeases::unsubscribe(const Location &location, Lease *lease) {
+  if (lease->subscriptions_ == 0) {
+    unfiltered_.remove(location);
+    return;
+  }
+
+  std::vector<std::string> empty_keys;
+  std::list<Location> *subscribers;
+  std::list<std::string>::const_iterator it, end = subscribers_.end();
+  for (it = subscribers_.begin(); it != end; ++it) {
+    if (!subscribers_.get(*it, &subscribers)) continue;
+    subscribers->remove(location);
+    if (subscribers->empty()) empty_keys.push_back(*it);
+  }
+
+  for (size_t i = 0; i < empty_keys.size(); ++i) {
+    subscribers_.remove(empty_keys[i]);
+  }
+  lease->subscriptions_ = 0;
+}
+
+void ObserverLeases::schedule(int64_t time) {
+  // A later deadline is found when the event fires. Since the event fires
+  // at next_expiry_, a renewed lease never reschedules a running event
+  // (schedule_at would wait for 'expire' which waits for our lock).
+  if (next_expiry_ == 0 || time < next_expiry_) {
+    next_expiry_ = time;
+    wheel_->schedule_at(&expire_event_, time, 0, false);
+  }
+}
+
+void ObserverLeases::expire() {
+  ScopedLock lock(mutex_);
+  int64_t now = TimeRef::now();
+  int64_t next = 0;
+  std::vector<Location> expired;
+  Lease lease;
+
+  std::list<Location>::const_iterator it, end = leases_.end();
+  for (it = leases_.begin(); it != end; ++it) {
+    if (!leases_.get(*it, &lease)) continue;
+    if (lease.expires_at_ <= now) {
+      expired.push_back(*it);
+    } else if (next == 0 || lease.expires_at_ < next) {
+      next = lease.expires_at_;
+    }
+  }
+
+  for (size_t i = 0; i < expired.size(); ++i) {
+    forget(expired[i]);
+  }
+  expired_count_ += expired.size();
+
+  next_expiry_ = 0;
+  if (next) schedule(next);
+}
+
+} // oscit
@@ -36,7 +36,9 @@
 #include "osc/OscOutboundPacketStream.h"
 #include "ip/UdpSocket.h"
 
+#include "oscit/midi_stream.h"
 #include "oscit/root.h"
+#include "oscit/send_queue.h"
 #include "oscit/zeroconf_registration.h"
 #include "oscit/osc_remote_object.h"
 
@@ -48,6 +50,17 @@ namespace oscit {
 
 //#define DEBUG_OSC_COMMAND
 
+/** Send midi messages as {"=m":blob} (see MidiStream).
+ */
+static void to_midi_stream(osc::OutboundPacketStream &out_stream, const Value &val, bool keep_list = true) {
+  std::string stream;
+  MidiStream::encode(val, &stream, keep_list);
+  out_stream << osc::HashStart;
+  out_stream << "=m";
+  out_stream << osc::Blob(stream.data(), stream.size());
+  out_stream << osc::HashEnd;
+}
+
 static void to_stream(osc::OutboundPacketStream &out_stream, const Value &val, bool in_array = false) {
   switch (val.type()) {
     case REAL_VALUE:
@@ -64,6 +77,11 @@ static void to_stream(osc::OutboundPacketStream &out_stream, const Value &val, b
       out_stream << osc::Nil;
       break;
     case LIST_VALUE:
+      if (MidiStream::is_midi_list(val)) {
+        // batch of midi events in a single blob
+        to_midi_stream(out_stream, val, in_array);
+        break;
+      }
       {
         size_t sz = val.size();
         // do not insert array markers for level 0 type tags: "ff[fs]" not "[ff[fs]]"
@@ -96,19 +114,17 @@ static void to_stream(osc::OutboundPacketStream &out_stream, const Value &val, b
       out_stream << osc::HashEnd;
       break;
     case MIDI_VALUE:
-      out_stream << osc::HashStart;
       {
-        // Send custom types with {"=m":[data]}
-        const std::vector<unsigned char> &data = val.midi_message_->data();
-        out_stream << "=m";
-        out_stream << osc::ArrayStart;
-        out_stream << (float)data[0];
-        out_stream << (float)data[1];
-        out_stream << (float)data[2];
-        out_stream << (float)val.midi_message_->length();
-        out_stream << osc::ArrayEnd;
+        const MidiMessage midi(val.midi_message());
+        const unsigned char *data = midi.data();
+        size_t size = midi.size();
+        if (size == 3 && midi.length() == 0 && midi.wait() == 0) {
+          // 3 byte midi message: use the 'm' type tag (port 0)
+          out_stream << osc::MidiMessage(((osc::uint32)data[0] << 16) | ((osc::uint32)data[1] << 8) | data[2]);
+          break;
+        }
+        to_midi_stream(out_stream, val);
       }
-      out_stream << osc::HashEnd;
       break;
     case MATRIX_VALUE: /* continue */
       // TODO
@@ -126,9 +142,15 @@ static osc::OutboundPacketStream &operator<<(osc::OutboundPacketStream &out_stre
 class OscCommand::Implementation : public osc::OscPacketListener {
 public:
 
-  Implementation(OscCommand *command) : command_(command), socket_(NULL), running_(false) {}
+  Implementation(OscCommand *command) : command_(command), socket_(NULL), running_(false),
+                                        send_queue_(this) {
+    command_->observer_leases().set_on_remove(observer_removed, this);
+  }
 
   virtual ~Implementation() {
+    command_->observer_leases().set_on_remove(NULL, NULL);
+    // the sender thread uses the socket
+    send_queue_.stop();
     kill();
     if (socket_ != NULL) delete socket_;
   }
@@ -144,7 +166,7 @@ public:
   void send_message(const Location &remote_endpoint, const char *path, const Value &val) {
     assert(socket_);
     osc::OutboundPacketStream message( osc_buffer_, OSC_OUT_BUFFER_SIZE );
-    build_message(path, val, &message);
+    if (!build_message(path, val, &message)) return;
     try {
       // FIXME: hack oscpack to accept 'Location' or rewrite this layer using ragel...
       socket_->SendTo(IpEndpointName(remote_endpoint.ip(), remote_endpoint.port()), message.Data(), message.Size());
@@ -201,29 +223,44 @@ public:
     command_->receive(url, val);
   }
 
-  /** Build an osc message and send it to all observers. */
-  void send_to_all(const std::list<Location> locations, const char *path, const Value &val) {
-    std::list<Location>::const_iterator it  = locations.begin();
-    std::list<Location>::const_iterator end = locations.end();
-
-    osc::OutboundPacketStream message( osc_buffer_, OSC_OUT_BUFFER_SIZE );
-    build_message(path, val, &message);
-
-    while (it != end) {
+  /** Build an osc message once and queue it for all observers (sent from
+   * the send queue's thread).
+   */
+  void send_to_all(const std::list<Location> &locations, const char *path, const Value &val) {
+    char buffer[OSC_OUT_BUFFER_SIZE];
+    osc::OutboundPacketStream message(buffer, OSC_OUT_BUFFER_SIZE);
+    if (!build_message(path, val, &message)) return;
+
+    SendPacket *packet = new SendPacket(message.Data(), message.Size());
+    send_queue_.push(locations, packet);
+    packet->release();
+  }
 
+  /** Send a packet to an observer (called by the send queue).
+   */
+  void send_packet(const Location &location, const SendPacket &packet) {
 #ifdef DEBUG_OSC_COMMAND
-      std::cout << "  " << *it << std::endl;
+    std::cout << "  " << location << std::endl;
 #endif
-      try {
-        // FIXME: hack oscpack to use Location or rewrite...
-        socket_->SendTo(IpEndpointName(it->ip(), it->port()), message.Data(), message.Size());
-        ++it;
-      } catch (std::runtime_error &e) {
-        std::cerr << "Could not send to observer " << *it << "\n";
+    if (socket_ == NULL) return;
+    try {
+      // FIXME: hack oscpack to use Location or rewrite...
+      socket_->SendTo(IpEndpointName(location.ip(), location.port()), packet.data(), packet.size());
+    } catch (std::runtime_error &e) {
+      if (command_->observer_leases().send_failed(location)) {
+        // the queue is cleared by 'observer_removed'
+        std::cerr << "Could not send to observer " << location << " (evicted)\n";
       }
     }
   }
 
+  /** Drop queued packets and metrics of an observer that expired, was
+   * evicted or removed (called by the observer leases).
+   */
+  static void observer_removed(void *data, const Location &location) {
+    ((Implementation*)data)->send_queue_.remove(location);
+  }
+
   /** Parse a single value and advance 'arg' and type tags.
    * A single value can be represented by a single element or enclosed in [...] (Array) or {...} (Hash).
    */
@@ -289,9 +326,9 @@ public:
         {
           osc::uint32 m = arg->AsMidiMessageUnchecked();
 
-          // 3 byte midi message
+          // 3 byte midi message (stored inline: no allocation)
           MidiMessage midi((int)((m>>16) & 0xFF), (int)((m >> 8) & 0xFF), (int)(m & 0xFF), 0);
-          *res = Value(midi);
+          res->set(midi);
         }
         break;
       case osc::RGBA_COLOR_TYPE_TAG:
@@ -345,8 +382,18 @@ public:
         if (first_key && key.size() > 1 && key.at(0) == '=') {
           // packed data
           // FIXME: use a Factory
-          if (key.at(1) == 'm') {
-            // midi
+          if (key.at(1) == 'm' && *type_tags == osc::BLOB_TYPE_TAG) {
+            // midi stream
+            const void *data;
+            unsigned long size;
+            arg->AsBlobUnchecked(data, size);
+            if (!MidiStream::decode((const unsigned char*)data, size, res)) {
+              std::cerr << "Could not decode midi stream.\n";
+            }
+            ++type_tags;
+            ++arg;
+          } else if (key.at(1) == 'm') {
+            // midi (old format: {"=m":[data, length]})
             Value tmp;
 
 #ifdef DEBUG_OSC_COMMAND
@@ -387,14 +434,42 @@ public:
   static Value value_from_osc(const osc::ReceivedMessage &message) {
     Value res;
     osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
-    parse_osc_array(message.TypeTags(), arg, &res);
+    if (!parse_midi_stream(message.TypeTags(), arg, &res)) {
+      parse_osc_array(message.TypeTags(), arg, &res);
+    }
     return res;
   }
 
-  /** Build a message from a value. */
-  static void build_message(const char *path, const Value &val, osc::OutboundPacketStream *message) {
-    // *message << osc::BeginBundleImmediate << osc::BeginMessage(path) << val << osc::EndMessage << osc::EndBundle;
-    *message << osc::BeginMessage(path) << val << osc::EndMessage;
+  /** A batch of midi events sent as the only argument ({"=m":blob} without
+   * the list flag) is the argument list itself.
+   */
+  static bool parse_midi_stream(const char *type_tags, osc::ReceivedMessage::const_iterator arg, Value *res) {
+    if (!type_tags || strcmp(type_tags, "{sb}") != 0) return false;
+    if (strcmp((++arg)->AsStringUnchecked(), "=m") != 0) return false;
+
+    const void *data;
+    unsigned long size;
+    (++arg)->AsBlobUnchecked(data, size);
+    if (size == 0 || (((const unsigned char*)data)[0] & MIDI_STREAM_LIST)) return false;
+
+    if (!MidiStream::decode((const unsigned char*)data, size, res)) {
+      std::cerr << "Could not decode midi stream.\n";
+    }
+    return true;
+  }
+
+  /** Build a message from a value. Return false (message dropped) if the
+   * value does not fit in the buffer.
+   */
+  static bool build_message(const char *path, const Value &val, osc::OutboundPacketStream *message) {
+    try {
+      // *message << osc::BeginBundleImmediate << osc::BeginMessage(path) << val << osc::EndMessage << osc::EndBundle;
+      *message << osc::BeginMessage(path) << val << osc::EndMessage;
+    } catch (osc::OutOfBufferMemoryException &e) {
+      std::cerr << "Message " << path << " is too large (" << OSC_OUT_BUFFER_SIZE << " bytes max): dropped.\n";
+      return false;
+    }
+    return true;
   }
   /** Access to OscCommand.
    */
@@ -406,6 +481,10 @@ public:
 
   char osc_buffer_[OSC_OUT_BUFFER_SIZE];     /** Buffer used to build osc packets. */
   bool running_;
+
+  /** Per observer queues for notifications.
+   */
+  TSendQueue<Implementation, &Implementation::send_packet> send_queue_;
 };
 
 
@@ -421,6 +500,8 @@ OscCommand::OscCommand(const char *protocol, const char *service_type, uint16_t
 
 OscCommand::~OscCommand() {
   kill();
+  // replies from strands use the socket
+  wait_for_strand_tasks();
   delete impl_;
 }
 
@@ -433,7 +514,14 @@ void OscCommand::notify_observers(const char *path, const Value &val) {
 #ifdef DEBUG_OSC_COMMAND
   std::cout << "[" << port() << "] - notify -> " << path << "(" << val << ")\n";
 #endif
-  impl_->send_to_all(observers(), path, val);
+  std::list<Location> locations;
+  observers_of(path, val, &locations);
+  if (locations.empty()) return;
+  impl_->send_to_all(locations, path, val);
+}
+
+const Value OscCommand::send_queue_stats() {
+  return impl_->send_queue_.stats();
 }
 
 void OscCommand::listen() {
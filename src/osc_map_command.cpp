@@ -40,39 +40,86 @@ namespace oscit {
 
 //#define DEBUG_MAP_COMMAND
 
+/** Size of the mapper's hash tables.
+ */
+#define MAP_COMMAND_HASH_SIZE 200
+
 OscMapCommand::OscMapCommand() :
                   OscCommand("oscmap", "", Location::NO_PORT),
                   reply_port_(Location::NO_PORT),
-                  mapper_(200) {}
+                  mapper_(new Mapper(MAP_COMMAND_HASH_SIZE)),
+                  retiring_mapper_(false) {
+  init_mapper_users();
+  watch_script_file();
+}
 
 OscMapCommand::OscMapCommand(uint16_t port, uint16_t reply_port) :
                   OscCommand("oscmap", "", port),
                   reply_port_(reply_port),
-                  mapper_(200) {}
+                  mapper_(new Mapper(MAP_COMMAND_HASH_SIZE)),
+                  retiring_mapper_(false) {
+  init_mapper_users();
+  watch_script_file();
+}
 
-OscMapCommand::~OscMapCommand() {}
+OscMapCommand::~OscMapCommand() {
+  // the watcher calls eval_script
+  stop_watching_script();
+  delete mapper_;
+  pthread_cond_destroy(&mapper_users_cond_);
+  pthread_mutex_destroy(&mapper_users_mutex_);
+}
+
+void OscMapCommand::init_mapper_users() {
+  pthread_mutex_init(&mapper_users_mutex_, NULL);
+  pthread_cond_init(&mapper_users_cond_, NULL);
+}
+
+const Value OscMapCommand::eval_script() {
+  // parse without holding the command lock
+  Mapper *mapper = new Mapper(MAP_COMMAND_HASH_SIZE);
+  if (!mapper->parse(script_)) {
+    Value res(BAD_REQUEST_ERROR, mapper->error());
+    delete mapper;
+    return res;
+  }
 
-void OscMapCommand::receive(const Url &ext_url, const Value &ext_val) {
-  unlock();
-    // release lock because we lock again during eval_script
-    reload_script(time_ref_.elapsed());
   lock();
+    Mapper *old_mapper = mapper_;
+    mapper_ = mapper;
+  unlock();
 
-  std::string path;
-  Real  r;
-  Value res;
+  // 'receive' cannot use the old mapper anymore, wait for notifications
+  pthread_mutex_lock(&mapper_users_mutex_);
+    retiring_mapper_ = true;
+    // publish the flag before reading the counter (see release_mapper)
+    __sync_synchronize();
+    while (mapper_users_.count() > 0) {
+      pthread_cond_wait(&mapper_users_cond_, &mapper_users_mutex_);
+    }
+    retiring_mapper_ = false;
+  pthread_mutex_unlock(&mapper_users_mutex_);
+  delete old_mapper;
 
+  return Value(script_);
+}
+
+void OscMapCommand::receive(const Url &ext_url, const Value &ext_val) {
 #ifdef DEBUG_MAP_COMMAND
   std::cout << "resolving from: " << ext_url << "(" << ext_val << ")\n";
 #endif
   // resolve mapping
-  if (ext_val.is_real()) {
-    if (mapper_.map(ext_url.path(), ext_val.r, &path, &r)) {
+  if (ext_val.is_real() || ext_val.is_list()) {
+    targets_.clear();
+    if (mapper_->map(ext_url.path(), ext_val, &targets_)) {
+      std::vector<Mapper::Target>::const_iterator it, end = targets_.end();
+      for (it = targets_.begin(); it != end; ++it) {
 #ifdef DEBUG_MAP_COMMAND
-    std::cout << "to            : " << path << "(" << r << ")\n";
+        std::cout << "to            : " << it->url() << "(" << it->value_ << ")\n";
 #endif
-      Url url(ext_url.location(), path);
-      Command::receive(url, Value(r));
+        Url url(ext_url.location(), it->url());
+        Command::receive(url, it->value_);
+      }
     } else if (ext_url.is_meta()) {
       // meta with real value
       Command::receive(ext_url, ext_val);
@@ -88,6 +135,16 @@ void OscMapCommand::receive(const Url &ext_url, const Value &ext_val) {
   }
 }
 
+void OscMapCommand::release_mapper() {
+  // The decrement is a full barrier: either eval_script sees the counter at
+  // zero or we see its flag and wake it up.
+  if (mapper_users_.decrement() == 0 && retiring_mapper_) {
+    pthread_mutex_lock(&mapper_users_mutex_);
+      pthread_cond_signal(&mapper_users_cond_);
+    pthread_mutex_unlock(&mapper_users_mutex_);
+  }
+}
+
 void OscMapCommand::notify_observers(const char *url, const Value &val) {
 
   if (val.size() < 2 || Url::is_meta(val[0].str())) {
@@ -102,14 +159,18 @@ void OscMapCommand::notify_observers(const char *url, const Value &val) {
 #endif
   std::string ext_url;
   Real ext_val;
-  std::list<unsigned long> to_remove;
   if (val[0].is_string() && val[1].is_real()) {
-    if (mapper_.reverse_map(val[0].c_str(), val[1].r, &ext_url, &ext_val)) {
-      std::list<Location>::const_iterator it  = observers().begin();
-      std::list<Location>::const_iterator end = observers().end();
-      Value reply(ext_url);
-      reply.push_back(ext_val);
-
+    // This can be called from 'receive' (with the lock) or from another
+    // thread: protect the mapper with a counter instead of the lock.
+    mapper_users_.increment();
+    bool found = mapper_->reverse_map(val[0].str(), val[1].r, &ext_url, &ext_val);
+    release_mapper();
+
+    if (found) {
+      std::list<Location> locations;
+      observers_of(url, val, &locations);
+      std::list<Location>::const_iterator it  = locations.begin();
+      std::list<Location>::const_iterator end = locations.end();
 #ifdef DEBUG_MAP_COMMAND
       std::cout << "[" << Command::port() << "] - send -> " << ext_url << "(" << Value(ext_val) << ")\n";
 #endif
@@ -120,7 +181,9 @@ void OscMapCommand::notify_observers(const char *url, const Value &val) {
         try {
           send(*it, ext_url.c_str(), Value(ext_val));
         } catch (std::runtime_error e) {
-          std::cerr << "Could not connect to observer '" << *it << "'.\n";
+          if (observer_leases().send_failed(*it)) {
+            std::cerr << "Could not connect to observer '" << *it << "' (evicted).\n";
+          }
         }
         ++it;
       }
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/remote_call.h"
+
+#include <vector>
+
+#include "oscit/time_ref.h"
+
+namespace oscit {
+
+RemoteCall::RemoteCall() : done_(false) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&done_cond_, NULL);
+}
+
+RemoteCall::~RemoteCall() {
+  pthread_cond_destroy(&done_cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+bool RemoteCall::is_done() {
+  pthread_mutex_lock(&mutex_);
+  bool done = done_;
+  pthread_mutex_unlock(&mutex_);
+  return done;
+}
+
+const Value RemoteCall::wait() {
+  pthread_mutex_lock(&mutex_);
+  while (!done_) {
+    pthread_cond_wait(&done_cond_, &mutex_);
+  }
+  Value result(result_);
+  pthread_mutex_unlock(&mutex_);
+  return result;
+}
+
+const Value RemoteCall::result() {
+  pthread_mutex_lock(&mutex_);
+  Value result(result_);
+  pthread_mutex_unlock(&mutex_);
+  return result;
+}
+
+void RemoteCall::complete(const Value &result) {
+  done(result);
+
+  pthread_mutex_lock(&mutex_);
+  result_ = result;
+  done_ = true;
+  pthread_cond_broadcast(&done_cond_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+RemoteCalls::RemoteCalls(TimerWheel *wheel)
+    : next_id_(0),
+      timeout_count_(0),
+      wheel_(wheel ? wheel : TimerWheel::shared()),
+      expire_event_(this),
+      next_expiry_(0) {}
+
+RemoteCalls::~RemoteCalls() {
+  // waits for a running 'expire'
+  wheel_->cancel(&expire_event_);
+
+  std::map<uint32_t, Pending>::iterator it, end = calls_.end();
+  for (it = calls_.begin(); it != end; ++it) {
+    it->second.call_->complete(ErrorValue(INTERNAL_SERVER_ERROR, "Call cancelled."));
+    it->second.call_->release();
+  }
+}
+
+uint32_t RemoteCalls::start(const Location &remote, RemoteCall *call, Real timeout) {
+  ScopedLock lock(mutex_);
+  // skip ids still in use after a wrap around
+  do {
+    next_id_ = (next_id_ + 1) & REMOTE_CALL_MAX_ID;
+  } while (calls_.find(next_id_) != calls_.end());
+
+  int64_t expires_at = TimeRef::now() + TimerWheel::ms_to_ns(timeout);
+  call->retain();
+  calls_[next_id_] = Pending(remote, call, expires_at);
+  deadlines_.insert(std::pair<int64_t, uint32_t>(expires_at, next_id_));
+  schedule();
+  return next_id_;
+}
+
+bool RemoteCalls::complete(const Location &remote, uint32_t id, const Value &result) {
+  RemoteCall *call;
+  { ScopedLock lock(mutex_);
+    std::map<uint32_t, Pending>::iterator it = calls_.find(id);
+    if (it == calls_.end()) return false;
+    const Location &expected = it->second.remote_;
+    // ids are small counters: make sure the reply comes from the callee
+    if (expected.ip() != remote.ip() || expected.port() != remote.port()) return false;
+    call = take(it);
+  }
+  call->complete(result);
+  call->release();
+  return true;
+}
+
+bool RemoteCalls::fail(uint32_t id, const Value &error) {
+  RemoteCall *call;
+  { ScopedLock lock(mutex_);
+    std::map<uint32_t, Pending>::iterator it = calls_.find(id);
+    if (it == calls_.end()) return false;
+    call = take(it);
+  }
+  call->complete(error);
+  call->release();
+  return true;
+}
+
+size_t RemoteCalls::pending() {
+  ScopedLock lock(mutex_);
+  return calls_.size();
+}
+
+size_t RemoteCalls::timeout_count() {
+  ScopedLock lock(mutex_);
+  return timeout_count_;
+}
+
+RemoteCall *RemoteCalls::take(std::map<uint32_t, Pending>::iterator it) {
+  std::multimap<int64_t, uint32_t>::iterator d_it = deadlines_.lower_bound(it->second.expires_at_);
+  std::multimap<int64_t, uint32_t>::iterator d_end = deadlines_.upper_bound(it->second.expires_at_);
+  for (; d_it != d_end; ++d_it) {
+    if (d_it->second == it->first) {
+      deadlines_.erase(d_it);
+      break;
+    }
+  }
+  RemoteCall *call = it->second.call_;
+  calls_.erase(it);
+  return call;
+}
+
+void RemoteCalls::schedule() {
+  // Same strategy as ObserverLeases: a later deadline is found when the
+  // event fires.
+  if (deadlines_.empty()) return;
+  int64_t time = deadlines_.begin()->first;
+  if (next_expiry_ == 0 || time < next_expiry_) {
+    next_expiry_ = time;
+    wheel_->schedule_at(&expire_event_, time, 0, false);
+  }
+}
+
+void RemoteCalls::expire() {
+  std::vector<RemoteCall*> expired;
+  { ScopedLock lock(mutex_);
+    int64_t now = TimeRef::now();
+    while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+      std::map<uint32_t, Pending>::iterator it = calls_.find(deadlines_.begin()->second);
+      if (it == calls_.end()) {
+        deadlines_.erase(deadlines_.begin());
+      } else {
+        expired.push_back(take(it));
+      }
+    }
+    timeout_count_ += expired.size();
+  }
+
+  // Callbacks run without the lock. Until we are done, next_expiry_ is in
+  // the past so that 'start' does not reschedule the running event.
+  ErrorValue error(REQUEST_TIMEOUT_ERROR, "No reply from remote end.");
+  for (size_t i = 0; i < expired.size(); ++i) {
+    expired[i]->complete(error);
+    expired[i]->release();
+  }
+
+  ScopedLock lock(mutex_);
+  next_expiry_ = 0;
+  schedule();
+}
+
+} // oscit
@@ -36,13 +36,60 @@
 #include "oscit/list_meta_method.h"
 #include "oscit/list_with_attributes_meta_method.h"
 #include "oscit/tree_meta_method.h"
+#include "oscit/changes_meta_method.h"
 
+#include "oscit/executor.h"
 #include "oscit/file.h"
 #include "oscit/hash_file_method.h"
 
 namespace oscit {
 
+/** Registry swaps waiting for readers (all roots). A reader must not use the
+ * root once it is released so the condition cannot live in the root.
+ */
+static pthread_mutex_t sReadersMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sReadersCond  = PTHREAD_COND_INITIALIZER;
+static volatile int32_t sWaitingSwaps = 0;
+
+/** Call run by Root::call in the target's strand.
+ */
+class CallTask : public StrandTask {
+public:
+  CallTask(Object *target, const Value &val) : target_(target), val_(val) {}
+
+  virtual void run() {
+    result_ = target_->trigger(val_);
+  }
+
+  Object *target_;
+  const Value &val_;
+  Value result_;
+};
+
+/** Call posted by Root::post (holds the target and a copy of the value).
+ */
+class PostTask : public StrandTask {
+public:
+  PostTask(Object *target, const Value &val) : target_(target), val_(val) {}
+
+  virtual void run() {
+    target_->trigger(val_);
+  }
+
+  ObjectHandle target_;
+  Value val_;
+};
+
+Root::~Root() {
+  clear();
+  root_ = NULL; // avoid call to unregister_object in ~Object
+
+  delete commands_;
+}
+
 void Root::init(bool should_build_meta) {
+  commands_epoch_ = 0;
+  commands_ = new CommandRegistry;
   url_ = "";
   set_root(this);
 
@@ -54,18 +101,28 @@ void Root::init(bool should_build_meta) {
     adopt(new ListWithOscitsMetaMethod(Url(LIST_WITH_ATTRIBUTES_PATH).name()));
     adopt(new AttrsMetaMethod(Url(ATTRS_PATH).name()));
     adopt(new TreeMetaMethod(Url(TREE_PATH).name()));
+    adopt(new ChangesMetaMethod(Url(CHANGES_PATH).name()));
   }
 }
 
 void Root::clear() {
-  { ScopedWrite lock(commands_);
-    while (!commands_.empty()) {
-      Command *command = commands_.front();
-      command->kill();
+  { ScopedLock lock(commands_mutex_);
+    std::vector<Command*> commands(commands_->commands());
+    std::vector<Command*>::iterator it, end = commands.end();
+    for (it = commands.begin(); it != end; ++it) {
+      (*it)->kill();
+      // replies from strands still reach the observers
+      (*it)->wait_for_strand_tasks();
+    }
+
+    // no other thread can use the commands once this returns
+    swap_commands(new CommandRegistry);
+
+    for (it = commands.begin(); it != end; ++it) {
+      Command *command = *it;
       command->set_root(NULL); // avoid call to unregister_command in ~Command
 
       delete command;
-      commands_.pop_front();
     }
   }
 
@@ -74,6 +131,108 @@ void Root::clear() {
   this->Object::clear();
 }
 
+const Value Root::call_in_strand(Object *target, const Value &val) {
+  CallTask task(target, val);
+  if (target->strand()->run(&task)) return task.result_;
+  // called from another strand's task: do not block the worker
+  target->strand()->post(new PostTask(target, val));
+  return ErrorValue(ACCEPTED_ERROR, "posted, result unavailable");
+}
+
+bool Root::post(const std::string &path, const Value &val) {
+  ObjectHandle target;
+  Value error;
+  if (!find_or_build_object_at(path, &error, &target)) return false;
+
+  const Value &arg = val.is_empty() ? gNilValue : val;
+  if (!target->can_receive(arg)) return false;
+
+  Strand *strand = target->strand();
+  if (strand) {
+    strand->post(new PostTask(target.ptr(), arg));
+  } else {
+    target->trigger(arg);
+  }
+  return true;
+}
+
+void Root::call_async(const Url &url, const Value &val, RemoteCall *remote_call, Real timeout) {
+  if (url.protocol_id() == Location::NO_PROTOCOL) {
+    // local object
+    remote_call->complete(call(url, val));
+    return;
+  }
+
+  ScopedCommands commands(this);
+  Command *cmd = commands->command(url.location());
+  if (cmd) {
+    cmd->call_async(url, val, remote_call, timeout);
+  } else {
+    remote_call->complete(ErrorValue(BAD_REQUEST_ERROR, std::string("No command to handle '").append(
+      url.protocol()).append("' protocol.")));
+  }
+}
+
+bool Root::register_command(Command *command) {
+  ScopedLock lock(commands_mutex_);
+  if (commands_->command(command->protocol_id())) return false;
+
+  command->set_root(this);
+  swap_commands(new CommandRegistry(commands_, command, NULL));
+  return true;
+}
+
+void Root::unregister_command(Command *command) {
+  ScopedLock lock(commands_mutex_);
+  swap_commands(new CommandRegistry(commands_, NULL, command));
+}
+
+void Root::release_commands(int epoch) {
+  // make sure we are done with the registry before releasing it
+  __sync_synchronize();
+  command_readers_[epoch].decrement();
+  // the root can be deleted from now on
+  __sync_synchronize();
+  if (sWaitingSwaps) {
+    pthread_mutex_lock(&sReadersMutex);
+      pthread_cond_broadcast(&sReadersCond);
+    pthread_mutex_unlock(&sReadersMutex);
+  }
+}
+
+void Root::swap_commands(CommandRegistry *registry) {
+  CommandRegistry *previous = commands_;
+  // the registry must be complete before it is visible
+  __sync_synchronize();
+  commands_ = registry;
+  // readers must see the new registry before we check for them
+  __sync_synchronize();
+
+  // A reader can read the epoch just before we flip it and be counted in
+  // the new epoch: flipping twice covers all the readers that could have
+  // read the previous registry.
+  for (int i = 0; i < 2; ++i) {
+    int epoch = commands_epoch_;
+    commands_epoch_ = epoch ^ 1;
+    __sync_synchronize();
+    wait_for_command_readers(epoch);
+  }
+  delete previous;
+}
+
+void Root::wait_for_command_readers(int epoch) {
+  if (command_readers_[epoch].count() == 0) return;
+
+  pthread_mutex_lock(&sReadersMutex);
+    ++sWaitingSwaps;
+    __sync_synchronize();
+    while (command_readers_[epoch].count() > 0) {
+      pthread_cond_wait(&sReadersCond, &sReadersMutex);
+    }
+    --sWaitingSwaps;
+  pthread_mutex_unlock(&sReadersMutex);
+}
+
 void Root::clear_on_register() {
   ScopedWrite lock(on_register_);
 
@@ -111,17 +270,106 @@ void Root::register_object(Object *obj) {
   trigger_and_clear_on_register(obj->url());
 
   if (!Url::is_meta(obj->url())) {
+    journal_.record(TreeJournal::Adopt, obj->url(), obj->attributes());
+
     Value type(obj->url());
     type.push_back(obj->type());
-    Value reply(ATTRS_PATH);
-    reply.push_back(type);
-    notify_observers(REPLY_PATH, reply);
+    notify_attrs(type);
+  }
+}
+
+size_t Root::osc_size(const Value &val) {
+  size_t size = 0;
+  switch (val.type()) {
+    case STRING_VALUE:
+      return val.str().size() + 5;
+    case ERROR_VALUE:
+      return val.error_message().size() + 10;
+    case LIST_VALUE:
+      for (size_t i = 0; i < val.size(); ++i) {
+        size += osc_size(val[i]);
+      }
+      return size + 2;
+    case HASH_VALUE:
+      {
+        HashIterator it, end = val.end();
+        for (it = val.begin(); it != end; ++it) {
+          size += it->size() + 5 + osc_size(val[*it]);
+        }
+      }
+      return size + 2;
+    case MIDI_VALUE:
+      return 2 * val.midi_message().size() + 32;
+    default:
+      return 9;
+  }
+}
+
+void Root::register_objects(const std::vector<Object*> &objects) {
+  std::vector<Object*>::const_iterator it, end = objects.end();
+  // hold the objects during registration (see register_object)
+  for (it = objects.begin(); it != end; ++it) {
+    (*it)->retain();
   }
+
+  { ScopedWrite lock(objects_);
+    for (it = objects.begin(); it != end; ++it) {
+      objects_.set((*it)->url(), *it);
+    }
+  }
+
+  ListValue types;
+  size_t page_size = 0;
+  for (it = objects.begin(); it != end; ++it) {
+    Object *obj = *it;
+    trigger_and_clear_on_register(obj->url());
+
+    if (!Url::is_meta(obj->url())) {
+      journal_.record(TreeJournal::Adopt, obj->url(), obj->attributes());
+
+      Value type(obj->type());
+      size_t size = obj->url().size() + 5 + osc_size(type);
+      if (page_size + size > ATTRS_PAGE_BYTES && types.size() > 0) {
+        notify_attrs(types);
+        types.set_type(LIST_VALUE); // clear
+        page_size = 0;
+      }
+      types.push_back(obj->url());
+      types.push_back(type);
+      page_size += size;
+    }
+  }
+
+  if (types.size() > 0) notify_attrs(types);
+
+  for (it = objects.begin(); it != end; ++it) {
+    (*it)->release();
+  }
+}
+
+void Root::notify_attrs(const Value &attributes) {
+  Value reply(ATTRS_PATH);
+  reply.push_back(attributes);
+  notify_observers(REPLY_PATH, reply);
 }
 
 void Root::unregister_object(Object *obj) {
   ScopedWrite lock(objects_);
-  objects_.remove_element(obj);
+  Object *registered;
+  // objects are unregistered before their url changes (see Object::moved)
+  if (objects_.get(obj->url(), &registered) && registered == obj) {
+    objects_.remove(obj->url());
+    if (!Url::is_meta(obj->url())) journal_.record(TreeJournal::Remove, obj->url(), gNilValue);
+  }
+}
+
+void Root::attributes_changed(Object *object) {
+  if (Url::is_meta(object->url())) return;
+  journal_.record(TreeJournal::Attrs, object->url(), object->attributes());
+
+  Value attrs(object->url());
+  attrs.push_back(object->attributes());
+  notify_attrs(attrs);
 }
 
 bool Root::expose_views(const std::string &path, Value *error) {
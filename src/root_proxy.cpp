@@ -31,6 +31,8 @@
 
 #include <string>
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include "oscit/command.h"
 #include "oscit/object_proxy.h"
@@ -38,16 +40,149 @@
 
 namespace oscit {
 
+/** Paths sent to a meta method: a single path or a list of paths.
+ */
+static Value paths_value(std::vector<std::string>::const_iterator it,
+                         std::vector<std::string>::const_iterator end) {
+  if (end - it == 1) return Value(*it);
+  ListValue paths;
+  for (; it != end; ++it) {
+    paths.push_back(*it);
+  }
+  return paths;
+}
+
 void RootProxy::set_command(Command *command) {
+  // pending queries were for the previous command
+  TimerWheel::shared()->cancel(&flush_event_);
+  TimerWheel::shared()->cancel(&register_event_);
+  { ScopedLock lock(queries_mutex_);
+    queries_.clear();
+    queries_scheduled_ = false;
+  }
+
   if (command_) command_->unregister_proxy(this);
   command_ = command;
   if (command) {
     command->register_proxy(this);
-    command->send(remote_location_, REGISTER_PATH, gNilValue);
+    send_to_remote(REGISTER_PATH, gNilValue);
+    fetch_changes();
+    // renew the lease before it expires
+    TimerWheel::shared()->schedule(&register_event_, register_interval_, register_interval_);
+  }
+}
+
+void RootProxy::set_register_interval(Real interval) {
+  register_interval_ = interval;
+  if (command_) {
+    TimerWheel::shared()->schedule(&register_event_, register_interval_, register_interval_);
+  }
+}
+
+void RootProxy::register_with_remote() {
+  send_to_remote(REGISTER_PATH, gNilValue);
+
+  Value version;
+  { ScopedLock lock(version_mutex_);
+    version = version_;
+  }
+  // keep our version recent (changes received as notifications are applied
+  // again)
+  if (version.is_string()) send_to_remote(CHANGES_PATH, version);
+}
+
+void RootProxy::fetch_changes() {
+  Value version;
+  { ScopedLock lock(version_mutex_);
+    version = version_;
+  }
+
+  if (version.is_string()) {
+    // we have a mirror: only fetch what changed since
+    send_to_remote(CHANGES_PATH, version);
+  } else {
+    // get the version before walking the tree so that we do not miss changes
+    send_to_remote(CHANGES_PATH, gNilValue);
     sync_children();
   }
 }
 
+void RootProxy::query(const char *meta_path, const std::string &path) {
+  Value page;
+  { ScopedLock lock(queries_mutex_);
+    std::vector<std::string> &paths = queries_[meta_path];
+    paths.push_back(path);
+    if (paths.size() < ROOT_PROXY_BATCH_SIZE) {
+      // When the flag is cleared, the flush does not need our lock anymore
+      // so we can wait for it in 'schedule_once'.
+      if (!queries_scheduled_) {
+        queries_scheduled_ = true;
+        TimerWheel::shared()->schedule_once(&flush_event_, ROOT_PROXY_BATCH_WINDOW);
+      }
+      return;
+    }
+    // full page
+    page = paths_value(paths.begin(), paths.end());
+    paths.clear();
+  }
+  send_to_remote(meta_path, page);
+}
+
+void RootProxy::flush_queries() {
+  std::map<std::string, std::vector<std::string> > queries;
+  { ScopedLock lock(queries_mutex_);
+    queries.swap(queries_);
+    queries_scheduled_ = false;
+  }
+
+  std::map<std::string, std::vector<std::string> >::const_iterator it, end = queries.end();
+  for (it = queries.begin(); it != end; ++it) {
+    const std::vector<std::string> &paths = it->second;
+    for (size_t i = 0; i < paths.size(); i += ROOT_PROXY_BATCH_SIZE) {
+      size_t last = i + ROOT_PROXY_BATCH_SIZE < paths.size() ? i + ROOT_PROXY_BATCH_SIZE : paths.size();
+      send_to_remote(it->first.c_str(), paths_value(paths.begin() + i, paths.begin() + last));
+    }
+  }
+}
+
+void RootProxy::apply_changes(const Value &changes) {
+  // "operation", "path", value, "operation", "path", value, ...
+  for (size_t i = 0; i + 2 < changes.size(); i += 3) {
+    if (!changes[i].is_string() || !changes[i + 1].is_string()) continue;
+    const std::string &operation = changes[i].str();
+    const std::string &path = changes[i + 1].str();
+    const Value &value = changes[i + 2];
+    ObjectHandle object;
+
+    if (operation == "adopt") {
+      // only adopt in the parts of the tree we mirror
+      if (get_object_at(path, &object)) continue;
+      size_t pos = path.rfind('/');
+      if (pos == std::string::npos) continue;
+      ObjectHandle parent;
+      if (!get_object_at(path.substr(0, pos), &parent)) continue;
+      Value child(path.substr(pos + 1));
+      child.push_back(value);
+      build_children_from_attributes(parent.ptr(), child);
+    } else if (!get_object_at(path, &object) || object.ptr() == this) {
+      continue;
+    } else if (operation == "remove") {
+      // the handle keeps the object alive until it is out of the tree
+      object->set_parent(NULL);
+      object->release();
+    } else if (operation == "attrs") {
+      ObjectProxy *object_proxy = object.type_cast<ObjectProxy>();
+      if (object_proxy) object_proxy->set_attrs(value);
+    } else if (object->can_receive(value)) {
+      ObjectProxy *object_proxy = object.type_cast<ObjectProxy>();
+      if (object_proxy) object_proxy->handle_value_change(value);
+    }
+  }
+
+  // next page
+  if (changes.size() > 0) fetch_changes();
+}
+
 void RootProxy::set_proxy_factory(ProxyFactory *factory) {
   if (proxy_factory_) proxy_factory_->unregister_proxy(this);
   proxy_factory_ = factory;
@@ -132,34 +267,60 @@ bool RootProxy::build_child(const std::string &name, const Value &attrs, Value *
 void RootProxy::handle_reply(const std::string &path, const Value &val) {
   if (path == LIST_WITH_ATTRIBUTES_PATH) {
     // s[sHsHsH...]
-    // "parent path", ["child name", { attributes }, "child name", { attributes }, ...]
+    // "parent path", ["child name", { attributes }, "child name", { attributes }, ...], "parent path", [...], ...
     if (val.size() < 2 || !val[0].is_string() || !val[1].is_list()) {
       std::cerr << "Invalid argument in " << LIST_WITH_ATTRIBUTES_PATH << " reply: " << val << "\n";
       return;
     }
 
-    ObjectHandle handle;
-    if (!get_object_at(val[0].str(), &handle)) {
-      std::cerr << "Invalid parent path " << val[0].str() << " in " << LIST_WITH_ATTRIBUTES_PATH << " reply: unknown path.\n";
-      return;
-    }
+    for (size_t i = 0; i + 1 < val.size(); i += 2) {
+      if (!val[i].is_string() || !val[i + 1].is_list()) continue;
+      ObjectHandle handle;
+      if (!get_object_at(val[i].str(), &handle)) {
+        std::cerr << "Invalid parent path " << val[i].str() << " in " << LIST_WITH_ATTRIBUTES_PATH << " reply: unknown path.\n";
+        continue;
+      }
 
-    build_children_from_attributes(handle.ptr(), val[1]);
+      build_children_from_attributes(handle.ptr(), val[i + 1]);
+    }
   } else if (path == ATTRS_PATH) {
+    // "url", { attributes }, "url", { attributes }, ...
     if (val.size() < 2 || !val[0].is_string()) {
       std::cerr << "Invalid argument in " << ATTRS_PATH << " reply: " << val << "\n";
       return;
     }
 
-    Value error;
-    ObjectProxy *object_proxy = NULL;
-    ObjectHandle handle;
-    if (find_or_build_object_at(val[0].str(), &error, &handle)) {
-      object_proxy = handle.type_cast<ObjectProxy>();
+    for (size_t i = 0; i + 1 < val.size(); i += 2) {
+      if (!val[i].is_string()) continue;
+      Value error;
+      ObjectProxy *object_proxy = NULL;
+      ObjectHandle handle;
+      if (find_or_build_object_at(val[i].str(), &error, &handle)) {
+        object_proxy = handle.type_cast<ObjectProxy>();
+      }
+
+      if (object_proxy) {
+        object_proxy->set_attrs(val[i + 1]);
+      }
+    }
+  } else if (path == CHANGES_PATH) {
+    // "version" or ["version", [changes]] or ["version", nil] (must walk the tree again)
+    const Value &version = val.is_list() && val.size() > 0 ? val[0] : val;
+    if (version.is_string()) {
+      ScopedLock lock(version_mutex_);
+      version_ = version;
+    } else {
+      std::cerr << "Invalid argument in " << CHANGES_PATH << " reply: " << val << "\n";
+      return;
     }
 
-    if (object_proxy) {
-      object_proxy->set_attrs(val[1]);
+    if (val.is_list()) {
+      if (val.size() > 1 && val[1].is_list()) {
+        apply_changes(val[1]);
+      } else {
+        // changes are too old
+        sync_children();
+      }
     }
   } else {
     // Find target
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/scale_real.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace oscit {
+
+void ScaleReal::scale(const Real *source, Real *target, size_t count) const {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  // Real is a double: process two values per instruction.
+  const __m128d source_min = _mm_set1_pd(source_min_);
+  const __m128d target_min = _mm_set1_pd(target_min_);
+  const __m128d factor     = _mm_set1_pd(scale_);
+  const __m128d low        = _mm_set1_pd(low_);
+  const __m128d high       = _mm_set1_pd(high_);
+
+  for (; i + 2 <= count; i += 2) {
+    __m128d val = _mm_loadu_pd(source + i);
+    val = _mm_add_pd(target_min, _mm_mul_pd(_mm_sub_pd(val, source_min), factor));
+    val = _mm_min_pd(_mm_max_pd(val, low), high);
+    _mm_storeu_pd(target + i, val);
+  }
+#endif
+
+  for (; i < count; ++i) {
+    target[i] = scale(source[i]);
+  }
+}
+
+}  // oscit
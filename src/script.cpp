@@ -42,11 +42,15 @@ namespace oscit {
 
 #define ONE_SECOND 1000.0
 
-Script::Script() : script_ok_(false), script_mod_time_(0), reload_every_(1), next_reload_(0), current_time_(0) {}
+Script::Script() : script_ok_(false), script_mod_time_(0), reload_every_(1), next_reload_(0), current_time_(0),
+                   watcher_(NULL) {}
 
-Script::~Script() {}
+Script::~Script() {
+  delete watcher_;
+}
 
 const Value Script::script(const Value &val) {
+  ScopedLock lock(script_mutex_);
   if (val.is_string()) {
     script_ = val.str();
     Value res = save_script();
@@ -68,16 +72,24 @@ const Value Script::script(const Value &val) {
 
 const Value Script::file(const Value &val) {
   if (val.is_string()) {
+    // Stop without lock: the watcher might be waiting for the lock.
+    stop_watching_script();
+
+    ScopedLock lock(script_mutex_);
     script_file_  = val.str();
+    if (watcher_ && script_file_ != "") watcher_->watch(script_file_);
     return load_script_from_file(true);
   }
+  ScopedLock lock(script_mutex_);
   return Value(script_file_);
 }
 
 const Value Script::reload(const Value &val) {
+  ScopedLock lock(script_mutex_);
   if (val.is_real()) {
     reload_every_ = val.r > 0 ? val.r : 0;
     set_next_reload();
+    if (watcher_) watcher_->set_poll_interval(reload_every_ * ONE_SECOND);
   }
   return Value(reload_every_);
 }
@@ -88,8 +100,31 @@ void Script::inspect(Value *hash) {
   hash->set("reload", reload_every_);
 }
 
+void Script::watch_script_file() {
+  ScopedLock lock(script_mutex_);
+  if (watcher_) return;
+  watcher_ = new TFileWatcher<Script, &Script::script_file_changed>(this);
+  watcher_->set_poll_interval(reload_every_ * ONE_SECOND);
+  if (script_file_ != "") watcher_->watch(script_file_);
+}
+
+void Script::stop_watching_script() {
+  // Do not lock: the watcher might be waiting for the lock.
+  if (watcher_) watcher_->stop();
+}
+
+void Script::script_file_changed() {
+  ScopedLock lock(script_mutex_);
+  // The watcher knows the file changed: do not rely on the (one second)
+  // modification time resolution.
+  script_mod_time_ = 0;
+  load_script_from_file(false);
+}
+
 const Value Script::reload_script(time_t current_time) {
+  ScopedLock lock(script_mutex_);
   current_time_ = current_time;
+  if (watcher_) return gNilValue; // reloaded by the watcher
   if ( !next_reload_ || (next_reload_ > current_time_) ) {
     return gNilValue;
   }
@@ -125,6 +160,12 @@ const Value Script::load_script_from_file(bool is_new) {
     oss << in.rdbuf();
   in.close();
 
+  if (!is_new && script_ok_ && oss.str() == script_) {
+    // same content (saved by 'script')
+    set_next_reload();
+    return Value(script_file_);
+  }
+
   script_ = oss.str();
 
   Value res = eval_script();
@@ -0,0 +1,266 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/send_queue.h"
+
+#include <string.h> // memcpy
+
+#include <algorithm> // find
+#include <sstream>
+#include <vector>
+
+namespace oscit {
+
+/** Name used in stats ("host:port").
+ */
+static std::string peer_name(const Location &location) {
+  std::ostringstream name;
+  name << location.name();
+  if (location.port() != Location::NO_PORT) name << ":" << location.port();
+  return name.str();
+}
+
+SendPacket::SendPacket(const char *data, size_t size)
+    : data_(new char[size]),
+      size_(size) {
+  memcpy(data_, data, size);
+}
+
+SendQueue::SendQueue(size_t depth)
+    : peers_(SEND_QUEUE_HASH_SIZE),
+      sending_(NULL),
+      max_depth_(depth),
+      pending_(0),
+      dropped_(0),
+      sent_(0),
+      should_run_(true) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&cond_, NULL);
+  thread_.start_thread<SendQueue, &SendQueue::run>(this);
+}
+
+SendQueue::~SendQueue() {
+  stop();
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void SendQueue::push(const std::list<Location> &locations, SendPacket *packet) {
+  pthread_mutex_lock(&mutex_);
+    if (should_run_) {
+      Peer *peer;
+      std::list<Location>::const_iterator it, end = locations.end();
+      for (it = locations.begin(); it != end; ++it) {
+        if (!peers_.get(*it, &peer)) {
+          peer = new Peer(*it);
+          peers_.set(*it, peer);
+        }
+        push(peer, packet);
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void SendQueue::push(const Location &location, SendPacket *packet) {
+  std::list<Location> locations;
+  locations.push_back(location);
+  push(locations, packet);
+}
+
+void SendQueue::push(Peer *peer, SendPacket *packet) {
+  if (peer->packets_.size() >= max_depth_) {
+    // drop oldest
+    peer->packets_.front()->release();
+    peer->packets_.pop_front();
+    ++peer->dropped_;
+    ++dropped_;
+    --pending_;
+  }
+
+  packet->retain();
+  peer->packets_.push_back(packet);
+  ++pending_;
+  if (peer->packets_.size() > peer->max_depth_) peer->max_depth_ = peer->packets_.size();
+
+  if (!peer->ready_) {
+    peer->ready_ = true;
+    ready_.push_back(peer);
+    pthread_cond_signal(&cond_);
+  }
+}
+
+void SendQueue::remove(const Location &location) {
+  pthread_mutex_lock(&mutex_);
+    Peer *peer;
+    if (peers_.get(location, &peer)) {
+      peers_.remove(location);
+      if (peer == sending_) {
+        // deleted by the sender
+        clear(peer);
+        peer->removed_ = true;
+      } else {
+        if (peer->ready_) {
+          ready_.erase(std::find(ready_.begin(), ready_.end(), peer));
+        }
+        destroy(peer);
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void SendQueue::clear(Peer *peer) {
+  std::deque<SendPacket*>::iterator it, end = peer->packets_.end();
+  for (it = peer->packets_.begin(); it != end; ++it) {
+    (*it)->release();
+  }
+  pending_ -= peer->packets_.size();
+  peer->packets_.clear();
+}
+
+void SendQueue::destroy(Peer *peer) {
+  clear(peer);
+  delete peer;
+}
+
+void SendQueue::stop() {
+  pthread_mutex_lock(&mutex_);
+    bool running = should_run_;
+    should_run_ = false;
+    pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+
+  if (!running) return;
+  thread_.join();
+
+  pthread_mutex_lock(&mutex_);
+    Peer *peer;
+    std::list<Location>::const_iterator it, end = peers_.end();
+    for (it = peers_.begin(); it != end; ++it) {
+      if (peers_.get(*it, &peer)) destroy(peer);
+    }
+    peers_.clear();
+    ready_.clear();
+  pthread_mutex_unlock(&mutex_);
+}
+
+size_t SendQueue::pending() {
+  pthread_mutex_lock(&mutex_);
+    size_t count = pending_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+size_t SendQueue::depth(const Location &location) {
+  size_t count = 0;
+  pthread_mutex_lock(&mutex_);
+    Peer *peer;
+    if (peers_.get(location, &peer)) count = peer->packets_.size();
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+size_t SendQueue::dropped_count() {
+  pthread_mutex_lock(&mutex_);
+    size_t count = dropped_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+size_t SendQueue::sent_count() {
+  pthread_mutex_lock(&mutex_);
+    size_t count = sent_;
+  pthread_mutex_unlock(&mutex_);
+  return count;
+}
+
+const Value SendQueue::stats() {
+  Value res;
+  HashValue observers;
+  pthread_mutex_lock(&mutex_);
+    res.set("pending", (Real)pending_);
+    res.set("dropped", (Real)dropped_);
+    res.set("sent", (Real)sent_);
+    res.set("max_depth", (Real)max_depth_);
+
+    Peer *peer;
+    std::list<Location>::const_iterator it, end = peers_.end();
+    for (it = peers_.begin(); it != end; ++it) {
+      if (!peers_.get(*it, &peer)) continue;
+      Value metrics;
+      metrics.set("depth", (Real)peer->packets_.size());
+      metrics.set("max_depth", (Real)peer->max_depth_);
+      metrics.set("dropped", (Real)peer->dropped_);
+      metrics.set("sent", (Real)peer->sent_);
+      observers.set(peer_name(*it), metrics);
+    }
+  pthread_mutex_unlock(&mutex_);
+  res.set("observers", observers);
+  return res;
+}
+
+void SendQueue::run(Thread *runner) {
+  runner->thread_ready();
+
+  pthread_mutex_lock(&mutex_);
+    while (should_run_) {
+      if (ready_.empty()) {
+        pthread_cond_wait(&cond_, &mutex_);
+        continue;
+      }
+
+      Peer *peer = ready_.front();
+      ready_.pop_front();
+      SendPacket *packet = peer->packets_.front();
+      peer->packets_.pop_front();
+      --pending_;
+      sending_ = peer;
+
+      pthread_mutex_unlock(&mutex_);
+        send(peer->location_, *packet);
+        packet->release();
+      pthread_mutex_lock(&mutex_);
+
+      sending_ = NULL;
+      ++sent_;
+      if (peer->removed_) {
+        delete peer;
+      } else {
+        ++peer->sent_;
+        if (peer->packets_.empty()) {
+          peer->ready_ = false;
+        } else {
+          // next observer first
+          ready_.push_back(peer);
+        }
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+}  // oscit
@@ -0,0 +1,272 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/signal.h"
+
+#include <pthread.h>
+
+namespace oscit {
+
+static pthread_key_t  sender_key;
+static pthread_once_t sender_key_once = PTHREAD_ONCE_INIT;
+
+/** Writers waiting for senders (all signals). Senders must not use the
+ * signal once they are done so the condition cannot live in the signal.
+ * Waits are rare (disconnect during a send in another thread).
+ */
+static pthread_mutex_t sWaitMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sWaitCond  = PTHREAD_COND_INITIALIZER;
+static volatile int32_t sWaitingWriters = 0;
+
+static void create_sender_key() {
+  pthread_key_create(&sender_key, NULL);
+}
+
+Signal::Sender::Sender(Signal *signal) : signal_(signal) {
+  pthread_once(&sender_key_once, create_sender_key);
+  previous_ = (Sender*)pthread_getspecific(sender_key);
+  pthread_setspecific(sender_key, this);
+
+  epoch_ = signal_->epoch_;
+  signal_->senders_[epoch_].increment();
+  // writers must see the increment before we read the array
+  __sync_synchronize();
+  callbacks_ = signal_->callbacks_;
+}
+
+Signal::Sender::~Sender() {
+  pthread_setspecific(sender_key, previous_);
+  // make sure we are done with the array before releasing it
+  __sync_synchronize();
+  signal_->senders_[epoch_].decrement();
+  // the signal can be deleted from now on
+  __sync_synchronize();
+  if (sWaitingWriters) {
+    pthread_mutex_lock(&sWaitMutex);
+      pthread_cond_broadcast(&sWaitCond);
+    pthread_mutex_unlock(&sWaitMutex);
+  }
+}
+
+void Signal::send_once(const Value &val) {
+  // Keeps writers from reclaiming the array while we use it.
+  Sender sender(this);
+  CallbackArray *callbacks;
+  std::vector<SignalCallback*> removed;
+
+  { ScopedLock lock(write_mutex_);
+    callbacks = callbacks_;
+    if (!callbacks) return;
+
+    for (size_t i = 0; i < callbacks->size_; ++i) {
+      if (callbacks->connections_[i].callback_) {
+        removed.push_back(callbacks->connections_[i].callback_);
+      }
+    }
+    publish(NULL);
+    // queued callbacks must not receive values anymore
+    if (!removed.empty()) wait_for_senders();
+  }
+  retire_callbacks(removed);
+
+  Connection *it  = callbacks->connections_;
+  Connection *end = it + callbacks->size_;
+  for(; it != end; ++it) {
+    it->receiver_->disconnect_signal(this);
+    (*it->direct_function_)(it->direct_data_, val);
+  }
+}
+
+Signal::Connection Signal::build_connection(Observer *receiver, signal_method_t function, void *data, SignalCallback *callback) {
+  DeliveryQueue *queue = receiver->delivery_queue();
+  if (!queue) return Connection(receiver, function, data, callback);
+
+  QueuedCallback *queued = new QueuedCallback(receiver, queue, function, data, callback);
+  Connection connection(receiver, &QueuedCallback::push, queued, queued);
+  connection.direct_function_ = function;
+  connection.direct_data_     = data;
+  return connection;
+}
+
+void Signal::add_connection(const Connection &connection) {
+  ScopedLock lock(write_mutex_);
+  CallbackArray *current = callbacks_;
+  size_t size = current ? current->size_ : 0;
+
+  CallbackArray *callbacks = new CallbackArray(size + 1);
+  for (size_t i = 0; i < size; ++i) {
+    callbacks->connections_[i] = current->connections_[i];
+  }
+  callbacks->connections_[size] = connection;
+
+  publish(callbacks);
+  reclaim();
+}
+
+void Signal::disconnect_observer(Observer *observer) {
+  std::vector<SignalCallback*> removed;
+
+  { ScopedLock lock(write_mutex_);
+    CallbackArray *current = callbacks_;
+    if (!current) return;
+
+    size_t keep = 0;
+    for (size_t i = 0; i < current->size_; ++i) {
+      if (current->connections_[i].receiver_ != observer) ++keep;
+    }
+    if (keep == current->size_) return;
+
+    CallbackArray *callbacks = keep ? new CallbackArray(keep) : NULL;
+    size_t j = 0;
+    for (size_t i = 0; i < current->size_; ++i) {
+      Connection &connection = current->connections_[i];
+      if (connection.receiver_ != observer) {
+        callbacks->connections_[j++] = connection;
+      } else if (connection.callback_) {
+        removed.push_back(connection.callback_);
+      }
+    }
+
+    publish(callbacks);
+    // The observer might be deleted when we return: wait for other threads
+    // to stop using it.
+    wait_for_senders();
+    reclaim();
+  }
+  retire_callbacks(removed);
+}
+
+void Signal::disconnect_all() {
+  std::vector<SignalCallback*> removed;
+
+  { ScopedLock lock(write_mutex_);
+    CallbackArray *current = callbacks_;
+
+    if (current) {
+      for (size_t i = 0; i < current->size_; ++i) {
+        Connection &connection = current->connections_[i];
+        connection.receiver_->disconnect_signal(this);
+        if (connection.callback_) {
+          removed.push_back(connection.callback_);
+        }
+      }
+      publish(NULL);
+    }
+
+    wait_for_senders();
+    reclaim();
+  }
+  retire_callbacks(removed);
+}
+
+void Signal::publish(CallbackArray *callbacks) {
+  CallbackArray *current = callbacks_;
+  // the array must be complete before it is visible
+  __sync_synchronize();
+  callbacks_ = callbacks;
+  // senders must see the new array before we check for readers
+  __sync_synchronize();
+  if (current) retired_arrays_.push_back(current);
+}
+
+void Signal::wait_for_senders() {
+  // A sender can read the epoch just before we flip it and be counted in
+  // the new epoch: flipping twice covers all the senders that could have
+  // read the previous array.
+  for (int i = 0; i < 2; ++i) {
+    int epoch = epoch_;
+    epoch_ = epoch ^ 1;
+    __sync_synchronize();
+    wait_for_epoch(epoch);
+  }
+}
+
+void Signal::wait_for_epoch(int epoch) {
+  int32_t own = (int32_t)own_senders(epoch);
+  if (senders_[epoch].count() <= own) return;
+
+  pthread_mutex_lock(&sWaitMutex);
+    ++sWaitingWriters;
+    __sync_synchronize();
+    while (senders_[epoch].count() > own) {
+      pthread_cond_wait(&sWaitCond, &sWaitMutex);
+    }
+    --sWaitingWriters;
+  pthread_mutex_unlock(&sWaitMutex);
+}
+
+void Signal::retire_callbacks(std::vector<SignalCallback*> &callbacks) {
+  if (callbacks.empty()) return;
+
+  // Detaching waits for a callback running in the observer's thread: this
+  // callback could call back into the signal so we must not hold write_mutex_.
+  std::vector<SignalCallback*>::iterator it, end = callbacks.end();
+  for (it = callbacks.begin(); it != end; ++it) {
+    (*it)->detach();
+  }
+
+  ScopedLock lock(write_mutex_);
+  retired_callbacks_.insert(retired_callbacks_.end(), callbacks.begin(), callbacks.end());
+  reclaim();
+}
+
+void Signal::reclaim() {
+  if (retired_arrays_.empty() && retired_callbacks_.empty()) return;
+
+  // other threads might still use the arrays. If we are called from within
+  // 'send', the arrays are still in use in this thread.
+  if (senders_[0].count() > 0 || senders_[1].count() > 0) return;
+
+  free_retired();
+}
+
+void Signal::free_retired() {
+  std::vector<CallbackArray*>::iterator it, end = retired_arrays_.end();
+  for (it = retired_arrays_.begin(); it != end; ++it) {
+    delete *it;
+  }
+  retired_arrays_.clear();
+
+  std::vector<SignalCallback*>::iterator cit, cend = retired_callbacks_.end();
+  for (cit = retired_callbacks_.begin(); cit != cend; ++cit) {
+    delete *cit;
+  }
+  retired_callbacks_.clear();
+}
+
+size_t Signal::own_senders(int epoch) {
+  pthread_once(&sender_key_once, create_sender_key);
+  size_t count = 0;
+  for (Sender *sender = (Sender*)pthread_getspecific(sender_key); sender; sender = sender->previous_) {
+    if (sender->signal_ == this && sender->epoch_ == epoch) ++count;
+  }
+  return count;
+}
+
+} // oscit
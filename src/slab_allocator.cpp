@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/slab_allocator.h"
+
+#include <new> // operator new
+
+namespace oscit {
+
+#define SLAB_ALLOCATOR_CLASS_COUNT (SLAB_ALLOCATOR_MAX_SIZE / SLAB_ALLOCATOR_GRANULARITY)
+
+static pthread_once_t sSizeClassesOnce = PTHREAD_ONCE_INIT;
+
+/** Shared allocators (never deleted so that objects can be freed during
+ * static destruction).
+ */
+static SlabAllocator *sSizeClasses[SLAB_ALLOCATOR_CLASS_COUNT];
+
+static void create_size_classes() {
+  for (size_t i = 0; i < SLAB_ALLOCATOR_CLASS_COUNT; ++i) {
+    sSizeClasses[i] = new SlabAllocator((i + 1) * SLAB_ALLOCATOR_GRANULARITY);
+  }
+}
+
+SlabAllocator::SlabAllocator(size_t block_size, size_t slab_size)
+    : free_list_(NULL),
+      next_(NULL),
+      end_(NULL),
+      used_(0) {
+  // blocks must hold the free list pointer and keep its alignment
+  if (block_size < sizeof(void*)) block_size = sizeof(void*);
+  block_size_ = (block_size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+  blocks_per_slab_ = slab_size / block_size_;
+  if (blocks_per_slab_ == 0) blocks_per_slab_ = 1;
+}
+
+SlabAllocator::~SlabAllocator() {
+  std::vector<char*>::iterator it, end = slabs_.end();
+  for (it = slabs_.begin(); it != end; ++it) {
+    ::operator delete(*it);
+  }
+}
+
+void *SlabAllocator::alloc() {
+  ScopedLock lock(mutex_);
+  void *ptr;
+  if (free_list_) {
+    ptr = free_list_;
+    free_list_ = *(void**)free_list_;
+  } else {
+    if (next_ == end_) {
+      next_ = (char*)::operator new(block_size_ * blocks_per_slab_);
+      end_  = next_ + block_size_ * blocks_per_slab_;
+      slabs_.push_back(next_);
+    }
+    ptr = next_;
+    next_ += block_size_;
+  }
+  ++used_;
+  return ptr;
+}
+
+void SlabAllocator::free(void *ptr) {
+  if (!ptr) return;
+  ScopedLock lock(mutex_);
+  *(void**)ptr = free_list_;
+  free_list_ = ptr;
+  --used_;
+}
+
+size_t SlabAllocator::used() {
+  ScopedLock lock(mutex_);
+  return used_;
+}
+
+size_t SlabAllocator::slab_count() {
+  ScopedLock lock(mutex_);
+  return slabs_.size();
+}
+
+SlabAllocator *SlabAllocator::size_class(size_t size) {
+  if (size == 0 || size > SLAB_ALLOCATOR_MAX_SIZE) return NULL;
+  pthread_once(&sSizeClassesOnce, create_size_classes);
+  return sSizeClasses[(size - 1) / SLAB_ALLOCATOR_GRANULARITY];
+}
+
+void *SlabAllocator::allocate(size_t size) {
+  SlabAllocator *allocator = size_class(size);
+  return allocator ? allocator->alloc() : ::operator new(size);
+}
+
+void SlabAllocator::deallocate(void *ptr, size_t size) {
+  SlabAllocator *allocator = size_class(size);
+  if (allocator) {
+    allocator->free(ptr);
+  } else {
+    ::operator delete(ptr);
+  }
+}
+
+}  // oscit
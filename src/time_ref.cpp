@@ -29,31 +29,91 @@
 
 #include "oscit/time_ref.h"
 
-#include <sys/timeb.h> // ftime
+#include <pthread.h>
+#include <time.h>     // clock_gettime, nanosleep
+
+#ifdef __macosx__
+#include <mach/mach_time.h> // mach_absolute_time
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define OSCIT_HAS_RDTSC
+#endif
 
 namespace oscit {
-struct TimeRef::TimeRefData : public timeb {};
 
-TimeRef::TimeRef() {
-  reference_ = new TimeRefData;
-  ftime(reference_);
+/** Number of [ns] during which we count cycles to calibrate the fast clock.
+ */
+#define FAST_CLOCK_CALIBRATION_NS 5000000
+
+#ifdef __macosx__
+static mach_timebase_info_data_t sTimebase;
+static pthread_once_t sTimebaseOnce = PTHREAD_ONCE_INIT;
+
+static void init_timebase() {
+  mach_timebase_info(&sTimebase);
 }
 
-TimeRef::~TimeRef() {
-  delete reference_;
+int64_t TimeRef::now() {
+  pthread_once(&sTimebaseOnce, init_timebase);
+  return (int64_t)(mach_absolute_time() * sTimebase.numer / sTimebase.denom);
+}
+#else
+int64_t TimeRef::now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+#endif
+
+#ifdef OSCIT_HAS_RDTSC
+static inline uint64_t read_cycle_counter() {
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
 }
 
-/** Get current real time in [ms] since the time ref object was created.
+/** Cycle counter value and monotonic time when calibration was done.
  */
-time_t TimeRef::elapsed() {
-  TimeRefData t;
-  /* FIXME: Use clock_gettime instead of ftime.
-
-  int clock_gettime(clockid_t clock_id, struct timespec *tp);
-  int clock_getres(clockid_t clock_id, struct timespec *res);
-  */
-  ftime(&t);
-  return ((t.time - reference_->time) * 1000) + t.millitm - reference_->millitm;
+static uint64_t sCyclesOrigin;
+static int64_t  sNsOrigin;
+
+/** Number of [ns] per cycle.
+ */
+static double   sNsPerCycle;
+
+static pthread_once_t sCalibrationOnce = PTHREAD_ONCE_INIT;
+
+static void calibrate_cycle_counter() {
+  struct timespec sleeper;
+  sleeper.tv_sec  = 0;
+  sleeper.tv_nsec = FAST_CLOCK_CALIBRATION_NS;
+
+  int64_t  start_ns     = TimeRef::now();
+  uint64_t start_cycles = read_cycle_counter();
+  nanosleep(&sleeper, NULL);
+  int64_t  end_ns       = TimeRef::now();
+  uint64_t end_cycles   = read_cycle_counter();
+
+  if (end_cycles > start_cycles) {
+    sNsPerCycle = (double)(end_ns - start_ns) / (double)(end_cycles - start_cycles);
+  } else {
+    // counter not usable (virtualized, stopped...)
+    sNsPerCycle = 0;
+  }
+  sCyclesOrigin = end_cycles;
+  sNsOrigin     = end_ns;
+}
+
+int64_t TimeRef::fast_now() {
+  pthread_once(&sCalibrationOnce, calibrate_cycle_counter);
+  if (sNsPerCycle == 0) return now();
+  return sNsOrigin + (int64_t)((double)(read_cycle_counter() - sCyclesOrigin) * sNsPerCycle);
+}
+#else
+int64_t TimeRef::fast_now() {
+  return now();
 }
+#endif
 
 } // oscit
\ No newline at end of file
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/timer_stats.h"
+
+namespace oscit {
+
+void TimerStats::reset() {
+  fire_count_     = 0;
+  skipped_count_  = 0;
+  total_lateness_ = 0;
+  max_lateness_   = 0;
+  total_duration_ = 0;
+  max_duration_   = 0;
+  max_jitter_     = 0;
+  last_lateness_  = 0;
+  for (size_t i = 0; i < TIMER_STATS_BUCKETS; ++i) {
+    lateness_histogram_[i] = 0;
+    duration_histogram_[i] = 0;
+  }
+}
+
+void TimerStats::record(int64_t lateness, int64_t duration) {
+  // an event cannot run early but the clocks could disagree by a few ns
+  if (lateness < 0) lateness = 0;
+
+  if (fire_count_) {
+    int64_t jitter = lateness - last_lateness_;
+    if (jitter < 0) jitter = -jitter;
+    if (jitter > max_jitter_) max_jitter_ = jitter;
+  }
+  last_lateness_ = lateness;
+
+  ++fire_count_;
+  total_lateness_ += lateness;
+  total_duration_ += duration;
+  if (lateness > max_lateness_) max_lateness_ = lateness;
+  if (duration > max_duration_) max_duration_ = duration;
+
+  ++lateness_histogram_[bucket_for(lateness)];
+  ++duration_histogram_[bucket_for(duration)];
+}
+
+size_t TimerStats::bucket_for(int64_t ns) {
+  int64_t limit = TIMER_STATS_FIRST_BUCKET_NS;
+  size_t bucket = 0;
+  while (ns >= limit && bucket < TIMER_STATS_BUCKETS - 1) {
+    limit <<= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+Real TimerStats::bucket_limit(size_t bucket) {
+  if (bucket >= TIMER_STATS_BUCKETS - 1) return -1;
+  return ((int64_t)TIMER_STATS_FIRST_BUCKET_NS << bucket) / 1000000.0;
+}
+
+const Value TimerStats::to_value() const {
+  Value res;
+  Value buckets, lateness, duration;
+  for (size_t i = 0; i < TIMER_STATS_BUCKETS - 1; ++i) {
+    buckets.push_back(bucket_limit(i));
+  }
+
+  for (size_t i = 0; i < TIMER_STATS_BUCKETS; ++i) {
+    lateness.push_back((Real)lateness_histogram_[i]);
+    duration.push_back((Real)duration_histogram_[i]);
+  }
+
+  res.set("count", (Real)fire_count_);
+  res.set("skipped", (Real)skipped_count_);
+  res.set("mean_lateness", mean_lateness());
+  res.set("max_lateness", max_lateness());
+  res.set("mean_duration", mean_duration());
+  res.set("max_duration", max_duration());
+  res.set("max_jitter", max_jitter());
+  res.set("buckets", buckets);
+  res.set("lateness", lateness);
+  res.set("duration", duration);
+  return res;
+}
+
+} // oscit
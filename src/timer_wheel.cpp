@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/timer_wheel.h"
+
+#include <errno.h>
+#include <time.h>
+
+namespace oscit {
+
+#define ROOT_SIZE  (1 << TIMER_WHEEL_ROOT_BITS)
+#define ROOT_MASK  (ROOT_SIZE - 1)
+#define LEVEL_SIZE (1 << TIMER_WHEEL_LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SIZE - 1)
+
+/** Number of bits to shift a tick to get the slot index in the given upper level.
+ */
+#define LEVEL_SHIFT(level) (TIMER_WHEEL_ROOT_BITS + (level) * TIMER_WHEEL_LEVEL_BITS)
+
+void EventList::push_back(TimerEvent *event) {
+  event->list_ = this;
+  event->next_ = NULL;
+  event->prev_ = tail_;
+  if (tail_) {
+    tail_->next_ = event;
+  } else {
+    head_ = event;
+  }
+  tail_ = event;
+}
+
+void EventList::remove(TimerEvent *event) {
+  if (event->prev_) {
+    event->prev_->next_ = event->next_;
+  } else {
+    head_ = event->next_;
+  }
+  if (event->next_) {
+    event->next_->prev_ = event->prev_;
+  } else {
+    tail_ = event->prev_;
+  }
+  event->list_ = NULL;
+  event->next_ = NULL;
+  event->prev_ = NULL;
+}
+
+static pthread_once_t sSharedOnce = PTHREAD_ONCE_INIT;
+static TimerWheel *sSharedWheel = NULL;
+
+static void create_shared_wheel() {
+  sSharedWheel = new TimerWheel();
+}
+
+TimerWheel *TimerWheel::shared() {
+  pthread_once(&sSharedOnce, create_shared_wheel);
+  return sSharedWheel;
+}
+
+TimerWheel::TimerWheel(size_t worker_count)
+    : current_tick_(TimeRef::now() >> TIMER_WHEEL_TICK_SHIFT),
+      waiting_count_(0),
+      event_count_(0),
+      planned_wake_(-1),
+      should_run_(true) {
+  pthread_mutex_init(&mutex_, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+#ifndef __macosx__
+  // timed waits use the monotonic clock (see wait_until)
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+  pthread_cond_init(&wheel_cond_, &attr);
+  pthread_cond_init(&work_cond_, NULL);
+  pthread_cond_init(&done_cond_, NULL);
+  pthread_condattr_destroy(&attr);
+
+  if (worker_count == 0) worker_count = 1;
+  for (size_t i = 0; i < worker_count; ++i) {
+    Thread *worker = new Thread;
+    workers_.push_back(worker);
+    worker->start_thread<TimerWheel, &TimerWheel::run_worker>(this);
+  }
+
+  wheel_thread_.start_thread<TimerWheel, &TimerWheel::run_wheel>(this);
+}
+
+TimerWheel::~TimerWheel() {
+  pthread_mutex_lock(&mutex_);
+    should_run_ = false;
+    pthread_cond_broadcast(&wheel_cond_);
+    pthread_cond_broadcast(&work_cond_);
+  pthread_mutex_unlock(&mutex_);
+
+  wheel_thread_.join();
+
+  // forget about remaining events
+  pthread_mutex_lock(&mutex_);
+    TimerEvent *event;
+    while ((event = ready_.pop_front())) {
+      event->state_ = TimerEvent::Idle;
+      event->wheel_ = NULL;
+    }
+
+    for (size_t i = 0; i < ROOT_SIZE; ++i) {
+      while ((event = root_[i].pop_front())) {
+        event->state_ = TimerEvent::Idle;
+        event->wheel_ = NULL;
+      }
+    }
+
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+      for (size_t i = 0; i < LEVEL_SIZE; ++i) {
+        while ((event = levels_[level][i].pop_front())) {
+          event->state_ = TimerEvent::Idle;
+          event->wheel_ = NULL;
+        }
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+
+  std::vector<Thread*>::iterator it, end = workers_.end();
+  for (it = workers_.begin(); it != end; ++it) {
+    (*it)->join();
+    delete *it;
+  }
+
+  pthread_cond_destroy(&done_cond_);
+  pthread_cond_destroy(&work_cond_);
+  pthread_cond_destroy(&wheel_cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void TimerWheel::schedule_at(TimerEvent *event, int64_t time, int64_t interval, bool periodic) {
+  pthread_mutex_lock(&mutex_);
+    if (event->state_ == TimerEvent::Running && !pthread_equal(event->runner_, pthread_self())) {
+      // wait for the callback to finish so that the event is not
+      // executed concurrently.
+      while (event->state_ == TimerEvent::Running) {
+        pthread_cond_wait(&done_cond_, &mutex_);
+      }
+    }
+
+    if (event->state_ == TimerEvent::Waiting || event->state_ == TimerEvent::Ready) {
+      unlink(event);
+    } else if (event->state_ == TimerEvent::Idle) {
+      ++event_count_;
+    }
+
+    event->wheel_     = this;
+    event->fire_at_   = time;
+    event->interval_  = clamp_interval(interval, periodic);
+    event->periodic_  = periodic;
+    event->cancelled_ = false;
+
+    if (event->state_ == TimerEvent::Running) {
+      // Restarted from its own callback: the event is added back to
+      // the wheel when the callback returns.
+      event->rescheduled_ = true;
+    } else {
+      sync_tick(TimeRef::now());
+      add_to_wheel(event);
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void TimerWheel::set_interval(TimerEvent *event, Real interval) {
+  pthread_mutex_lock(&mutex_);
+    if (event->state_ == TimerEvent::Idle || !event->periodic_) {
+      pthread_mutex_unlock(&mutex_);
+      return;
+    }
+
+    int64_t new_interval = clamp_interval(ms_to_ns(interval), true);
+
+    if (event->state_ == TimerEvent::Waiting) {
+      // fire_at_ holds the next fire: move back to the last logical fire.
+      int64_t last_fire = event->fire_at_ - event->interval_;
+      int64_t now = TimeRef::now();
+      event->interval_ = new_interval;
+      event->fire_at_  = last_fire + new_interval;
+      unlink(event);
+      skip_missed(event, now);
+      sync_tick(now);
+      add_to_wheel(event);
+    } else {
+      // Ready or Running: fire_at_ holds the logical time of the current
+      // call, the new interval is used to compute the next one.
+      event->interval_ = new_interval;
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void TimerWheel::cancel(TimerEvent *event) {
+  pthread_mutex_lock(&mutex_);
+    if (event->wheel_ == this) {
+      if (event->state_ == TimerEvent::Running) {
+        event->cancelled_ = true;
+        event->rescheduled_ = false;
+        if (!pthread_equal(event->runner_, pthread_self())) {
+          while (event->state_ == TimerEvent::Running) {
+            pthread_cond_wait(&done_cond_, &mutex_);
+          }
+        }
+      } else if (event->state_ != TimerEvent::Idle) {
+        unlink(event);
+        event->state_ = TimerEvent::Idle;
+        event->wheel_ = NULL;
+        --event_count_;
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void TimerWheel::add_to_wheel(TimerEvent *event) {
+  int64_t expires = event->fire_at_ >> TIMER_WHEEL_TICK_SHIFT;
+  int64_t delta   = expires - current_tick_;
+  EventList *slot = NULL;
+
+  if (delta < ROOT_SIZE) {
+    // events in the past fire on the current tick
+    if (delta < 0) expires = current_tick_;
+    slot = &root_[expires & ROOT_MASK];
+  } else {
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+      if (delta < ((int64_t)1 << LEVEL_SHIFT(level + 1))) {
+        slot = &levels_[level][(expires >> LEVEL_SHIFT(level)) & LEVEL_MASK];
+        break;
+      }
+    }
+
+    if (!slot) {
+      // Beyond the wheel's range: park in the last level. The event will
+      // cascade back with its real fire time.
+      size_t level = TIMER_WHEEL_LEVELS - 1;
+      expires = current_tick_ + ((int64_t)1 << LEVEL_SHIFT(level + 1)) - 1;
+      slot = &levels_[level][(expires >> LEVEL_SHIFT(level)) & LEVEL_MASK];
+    }
+  }
+
+  slot->push_back(event);
+  event->state_ = TimerEvent::Waiting;
+  ++waiting_count_;
+
+  int64_t wake = event->fire_at_;
+  if (planned_wake_ < 0 || wake < planned_wake_) {
+    pthread_cond_signal(&wheel_cond_);
+  }
+}
+
+void TimerWheel::unlink(TimerEvent *event) {
+  if (event->state_ == TimerEvent::Waiting) --waiting_count_;
+  if (event->list_) event->list_->remove(event);
+}
+
+size_t TimerWheel::cascade(size_t level) {
+  size_t index = (current_tick_ >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+  EventList &slot = levels_[level][index];
+  TimerEvent *event;
+
+  while ((event = slot.pop_front())) {
+    --waiting_count_;
+    add_to_wheel(event);
+  }
+  return index;
+}
+
+void TimerWheel::advance(int64_t now) {
+  int64_t now_tick = now >> TIMER_WHEEL_TICK_SHIFT;
+  bool has_ready = false;
+
+  if (waiting_count_ == 0) {
+    if (now_tick > current_tick_) current_tick_ = now_tick;
+    return;
+  }
+
+  while (true) {
+    EventList &slot = root_[current_tick_ & ROOT_MASK];
+    TimerEvent *event = slot.head_;
+    while (event) {
+      TimerEvent *next = event->next_;
+      if (event->fire_at_ <= now) {
+        slot.remove(event);
+        --waiting_count_;
+        event->state_ = TimerEvent::Ready;
+        ready_.push_back(event);
+        has_ready = true;
+      }
+      event = next;
+    }
+
+    if (current_tick_ >= now_tick) break;
+
+    ++current_tick_;
+    if ((current_tick_ & ROOT_MASK) == 0) {
+      // cascade upper levels
+      for (size_t level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        if (cascade(level) != 0) break;
+      }
+    }
+  }
+
+  if (has_ready) pthread_cond_broadcast(&work_cond_);
+}
+
+int64_t TimerWheel::next_wake() {
+  if (waiting_count_ == 0) return -1;
+
+  int64_t tick = current_tick_;
+  while (true) {
+    EventList &slot = root_[tick & ROOT_MASK];
+    if (!slot.empty()) {
+      int64_t wake = slot.head_->fire_at_;
+      for (TimerEvent *event = slot.head_->next_; event; event = event->next_) {
+        if (event->fire_at_ < wake) wake = event->fire_at_;
+      }
+      return wake;
+    }
+
+    ++tick;
+    if ((tick & ROOT_MASK) == 0) {
+      // we need to cascade
+      return tick << TIMER_WHEEL_TICK_SHIFT;
+    }
+  }
+}
+
+void TimerWheel::wait_until(pthread_cond_t *cond, int64_t time) {
+#ifdef __macosx__
+  int64_t delay = time - TimeRef::now();
+  if (delay <= 0) return;
+  struct timespec wait;
+  wait.tv_sec  = delay / 1000000000;
+  wait.tv_nsec = delay % 1000000000;
+  pthread_cond_timedwait_relative_np(cond, &mutex_, &wait);
+#else
+  struct timespec wait;
+  wait.tv_sec  = time / 1000000000;
+  wait.tv_nsec = time % 1000000000;
+  pthread_cond_timedwait(cond, &mutex_, &wait);
+#endif
+}
+
+void TimerWheel::run_wheel(Thread *runner) {
+  runner->high_priority();
+  runner->thread_ready();
+
+  pthread_mutex_lock(&mutex_);
+    while (should_run_) {
+      advance(TimeRef::now());
+
+      int64_t now = TimeRef::now();
+      planned_wake_ = next_wake();
+      if (planned_wake_ < 0) {
+        // idle: wake up from time to time in case a signal was missed
+        planned_wake_ = now + ms_to_ns(TIMER_WHEEL_IDLE_WAIT);
+      }
+      if (planned_wake_ > now) {
+        wait_until(&wheel_cond_, planned_wake_);
+      }
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void TimerWheel::run_worker(Thread *runner) {
+  runner->high_priority();
+  runner->thread_ready();
+
+  pthread_mutex_lock(&mutex_);
+    while (should_run_) {
+      TimerEvent *event = ready_.pop_front();
+      if (!event) {
+        pthread_cond_wait(&work_cond_, &mutex_);
+        continue;
+      }
+
+      event->state_  = TimerEvent::Running;
+      event->runner_ = pthread_self();
+      // fire_at_ can change if the event is restarted from the callback
+      int64_t logical_time = event->fire_at_;
+
+      pthread_mutex_unlock(&mutex_);
+        int64_t start = TimeRef::now();
+        event->trigger();
+        int64_t end = TimeRef::now();
+      pthread_mutex_lock(&mutex_);
+
+      event->stats_.record(start - logical_time, end - start);
+
+      if (event->state_ != TimerEvent::Running) {
+        // should never happen
+        continue;
+      }
+
+      if (event->cancelled_) {
+        // cancelled during the callback (even if it was restarted before)
+        event->rescheduled_ = false;
+        event->state_ = TimerEvent::Idle;
+        event->wheel_ = NULL;
+        --event_count_;
+      } else if (event->rescheduled_) {
+        event->rescheduled_ = false;
+        sync_tick(end);
+        add_to_wheel(event);
+      } else if (event->periodic_) {
+        // drift free: anchor on logical fire time
+        event->fire_at_ += event->interval_;
+        event->stats_.record_skipped(skip_missed(event, end));
+        sync_tick(end);
+        add_to_wheel(event);
+      } else {
+        event->state_ = TimerEvent::Idle;
+        event->wheel_ = NULL;
+        --event_count_;
+      }
+      pthread_cond_broadcast(&done_cond_);
+    }
+  pthread_mutex_unlock(&mutex_);
+}
+
+} // oscit
@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "oscit/tree_journal.h"
+
+#include <stdio.h>   // snprintf
+#include <stdlib.h>  // strtoul, strtoull
+#include <time.h>    // time
+#include <unistd.h>  // getpid
+
+namespace oscit {
+
+/** Journals created by this process (makes epochs unique in a process).
+ */
+static volatile uint32_t sJournalCount = 0;
+
+/** Epoch of a new journal: different from the previous instances of the tree
+ * (in this process or before a restart).
+ */
+static uint32_t next_epoch() {
+  uint32_t epoch = (uint32_t)time(NULL) * 2654435761u;
+  epoch ^= (uint32_t)getpid() << 16;
+  return epoch ^ __sync_add_and_fetch(&sJournalCount, 1);
+}
+
+TreeJournal::TreeJournal(size_t capacity)
+    : changes_(capacity > 0 ? capacity : 1),
+      structural_count_(0),
+      dropped_(0),
+      version_(0),
+      epoch_(next_epoch()) {}
+
+uint64_t TreeJournal::record(Operation operation, const std::string &path, const Value &value) {
+  ScopedLock lock(mutex_);
+  ++version_;
+
+  // the previous value of the path is replaced (update) or useless (remove)
+  std::map<std::string, uint64_t>::iterator previous = update_versions_.find(path);
+  if (previous != update_versions_.end() && (operation == Update || operation == Remove)) {
+    updates_.erase(previous->second);
+    update_versions_.erase(previous);
+  }
+
+  if (operation == Update) {
+    Change &change = updates_[version_];
+    change.operation_ = operation;
+    change.path_ = path;
+    change.value_ = value;
+    change.version_ = version_;
+    update_versions_[path] = version_;
+    if (updates_.size() > changes_.size()) {
+      // too many paths: drop the oldest update
+      remove_update(updates_.begin()->first);
+    }
+  } else {
+    Change &change = changes_[structural_count_ % changes_.size()];
+    if (structural_count_ >= changes_.size() && change.version_ > dropped_) {
+      dropped_ = change.version_;
+    }
+    change.operation_ = operation;
+    change.path_ = path;
+    change.value_ = value;
+    change.version_ = version_;
+    ++structural_count_;
+  }
+  return version_;
+}
+
+void TreeJournal::remove_update(uint64_t version) {
+  std::map<uint64_t, Change>::iterator it = updates_.find(version);
+  if (it == updates_.end()) return;
+  update_versions_.erase(it->second.path_);
+  updates_.erase(it);
+  if (version > dropped_) dropped_ = version;
+}
+
+uint64_t TreeJournal::version() {
+  ScopedLock lock(mutex_);
+  return version_;
+}
+
+bool TreeJournal::changes_since(uint64_t since, size_t max, Value *changes, uint64_t *reached) {
+  ScopedLock lock(mutex_);
+  *reached = since;
+  if (since > version_ || since < dropped_) return false;
+
+  if (!changes->is_list()) changes->set_type(LIST_VALUE);
+
+  // merge the structural changes and the value updates by version
+  size_t size = changes_.size();
+  uint64_t first = structural_count_ > size ? structural_count_ - size : 0;
+  uint64_t n = first;
+  while (n < structural_count_ && changes_[n % size].version_ <= since) ++n;
+  std::map<uint64_t, Change>::const_iterator update = updates_.upper_bound(since);
+
+  for (size_t count = 0; count < max; ++count) {
+    const Change *change;
+    if (n < structural_count_ &&
+        (update == updates_.end() || changes_[n % size].version_ < update->first)) {
+      change = &changes_[n % size];
+      ++n;
+    } else if (update != updates_.end()) {
+      change = &update->second;
+      ++update;
+    } else {
+      // no more changes
+      *reached = version_;
+      return true;
+    }
+    push_change(*change, changes);
+    *reached = change->version_;
+  }
+
+  if (n == structural_count_ && update == updates_.end()) *reached = version_;
+  return true;
+}
+
+void TreeJournal::push_change(const Change &change, Value *changes) {
+  changes->push_back(operation_name(change.operation_));
+  changes->push_back(change.path_);
+  changes->push_back(change.value_.is_empty() ? gNilValue : change.value_);
+}
+
+const char *TreeJournal::operation_name(Operation operation) {
+  switch (operation) {
+    case Adopt:
+      return "adopt";
+    case Remove:
+      return "remove";
+    case Attrs:
+      return "attrs";
+    default:
+      return "value";
+  }
+}
+
+const Value TreeJournal::version_value(uint64_t version) const {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%08x:%llu", epoch_, (unsigned long long)version);
+  return Value(buffer);
+}
+
+bool TreeJournal::version_from_value(const Value &value, uint64_t *version) const {
+  if (!value.is_string()) return false;
+  const char *str = value.c_str();
+  char *end;
+  unsigned long epoch = strtoul(str, &end, 16);
+  if (end == str || *end != ':' || epoch != epoch_) return false;
+
+  str = end + 1;
+  unsigned long long v = strtoull(str, &end, 10);
+  if (end == str || *end != '\0') return false;
+  *version = v;
+  return true;
+}
+
+} // oscit
@@ -53,15 +53,16 @@ std::ostream &operator<<(std::ostream &out_stream, const Url &url) {
   return out_stream;
 }
 
-void Url::rebuild_full_url() {
-  std::ostringstream os(std::ostringstream::out);
-  os << *this;
-  full_url_ = os.str();
+const std::string Url::build_str() const {
+  std::string url;
+  url.reserve(location_.protocol().size() + location_.name_.size() + path_.size() + 24);
+  location_.append_to(&url);
+  return url.append(path_);
 }
 
 ///////////////// ====== URL PARSER ========= /////////////
 
-#line 129 "/Users/gaspard/git/oscit/src/url.rl"
+#line 130 "/Users/gaspard/git/oscit/src/url.rl"
 
 
 // transition table
@@ -148,11 +149,10 @@ static const int url_error = 0;
 static const int url_en_main = 1;
 
 
-#line 133 "/Users/gaspard/git/oscit/src/url.rl"
+#line 134 "/Users/gaspard/git/oscit/src/url.rl"
 
 /** This is a crude JSON parser. */
 void Url::parse(const char *url) {
-  full_url_ = url;
   std::string str_buf;
   // =============== Ragel job ==============
 
@@ -161,14 +161,14 @@ void Url::parse(const char *url) {
   const char * pe = url + strlen(p) + 1;
 
   
-#line 165 "/Users/gaspard/git/oscit/src/url.cpp"
+#line 164 "/Users/gaspard/git/oscit/src/url.cpp"
 	{
 	cs = url_start;
 	}
 
 #line 145 "/Users/gaspard/git/oscit/src/url.rl"
   
-#line 172 "/Users/gaspard/git/oscit/src/url.cpp"
+#line 171 "/Users/gaspard/git/oscit/src/url.cpp"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -243,25 +243,25 @@ _match:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 64 "/Users/gaspard/git/oscit/src/url.rl"
+#line 65 "/Users/gaspard/git/oscit/src/url.rl"
 	{
     DEBUG(printf("%c-",(*p)));
     if ((*p)) str_buf.append(&(*p), 1); /* append */
   }
 	break;
 	case 1:
-#line 69 "/Users/gaspard/git/oscit/src/url.rl"
+#line 70 "/Users/gaspard/git/oscit/src/url.rl"
 	{
-    location_.protocol_ = str_buf;
+    location_.protocol_id_ = Location::intern_protocol(str_buf);
     str_buf = "";
-    DEBUG(printf("[protocol %s\n]", location_.protocol_.c_str()));
+    DEBUG(printf("[protocol %s\n]", location_.protocol().c_str()));
   }
 	break;
 	case 2:
-#line 75 "/Users/gaspard/git/oscit/src/url.rl"
+#line 76 "/Users/gaspard/git/oscit/src/url.rl"
 	{
-    if (location_.protocol_ == "") {
-      location_.protocol_ = DEFAULT_PROTOCOL;
+    if (location_.protocol_id_ == Location::NO_PROTOCOL) {
+      location_.protocol_id_ = Location::DEFAULT_PROTOCOL_ID;
     }
     location_.name_ = str_buf;
     location_.reference_by_hostname_ = true;
@@ -270,10 +270,10 @@ _match:
   }
 	break;
 	case 3:
-#line 85 "/Users/gaspard/git/oscit/src/url.rl"
+#line 86 "/Users/gaspard/git/oscit/src/url.rl"
 	{
-    if (location_.protocol_ == "") {
-      location_.protocol_ = DEFAULT_PROTOCOL;
+    if (location_.protocol_id_ == Location::NO_PROTOCOL) {
+      location_.protocol_id_ = Location::DEFAULT_PROTOCOL_ID;
     }
     location_.name_ = str_buf;
     location_.reference_by_hostname_ = false;
@@ -282,7 +282,7 @@ _match:
   }
 	break;
 	case 4:
-#line 95 "/Users/gaspard/git/oscit/src/url.rl"
+#line 96 "/Users/gaspard/git/oscit/src/url.rl"
 	{
     location_.port_ = atoi(str_buf.c_str());
     str_buf = "";
@@ -290,14 +290,14 @@ _match:
   }
 	break;
 	case 5:
-#line 101 "/Users/gaspard/git/oscit/src/url.rl"
+#line 102 "/Users/gaspard/git/oscit/src/url.rl"
 	{
     path_ = str_buf;
     str_buf = "";
     DEBUG(printf("[path %s\n]", path_.c_str()));
   }
 	break;
-#line 301 "/Users/gaspard/git/oscit/src/url.cpp"
+#line 300 "/Users/gaspard/git/oscit/src/url.cpp"
 		}
 	}
 
@@ -311,6 +311,10 @@ _again:
 	}
 
 #line 146 "/Users/gaspard/git/oscit/src/url.rl"
+  if (cs < url_first_final) {
+    // not a url we understand: keep it as is (see str)
+    raw_url_ = url;
+  }
 }
 
 } // oscit
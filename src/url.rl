@@ -51,10 +51,11 @@ std::ostream &operator<<(std::ostream &out_stream, const Url &url) {
   return out_stream;
 }
 
-void Url::rebuild_full_url() {
-  std::ostringstream os(std::ostringstream::out);
-  os << *this;
-  full_url_ = os.str();
+const std::string Url::build_str() const {
+  std::string url;
+  url.reserve(location_.protocol().size() + location_.name_.size() + path_.size() + 24);
+  location_.append_to(&url);
+  return url.append(path_);
 }
 
 ///////////////// ====== URL PARSER ========= /////////////
@@ -67,14 +68,14 @@ void Url::rebuild_full_url() {
   }
 
   action set_protocol {
-    location_.protocol_ = str_buf;
+    location_.protocol_id_ = Location::intern_protocol(str_buf);
     str_buf = "";
-    DEBUG(printf("[protocol %s\n]", location_.protocol_.c_str()));
+    DEBUG(printf("[protocol %s\n]", location_.protocol().c_str()));
   }
 
   action set_hostname {
-    if (location_.protocol_ == "") {
-      location_.protocol_ = DEFAULT_PROTOCOL;
+    if (location_.protocol_id_ == Location::NO_PROTOCOL) {
+      location_.protocol_id_ = Location::DEFAULT_PROTOCOL_ID;
     }
     location_.name_ = str_buf;
     location_.reference_by_hostname_ = true;
@@ -83,8 +84,8 @@ void Url::rebuild_full_url() {
   }
 
   action set_service_name {
-    if (location_.protocol_ == "") {
-      location_.protocol_ = DEFAULT_PROTOCOL;
+    if (location_.protocol_id_ == Location::NO_PROTOCOL) {
+      location_.protocol_id_ = Location::DEFAULT_PROTOCOL_ID;
     }
     location_.name_ = str_buf;
     location_.reference_by_hostname_ = false;
@@ -133,7 +134,6 @@ void Url::rebuild_full_url() {
 
 /** This is a crude JSON parser. */
 void Url::parse(const char *url) {
-  full_url_ = url;
   std::string str_buf;
   // =============== Ragel job ==============
 
@@ -143,6 +143,10 @@ void Url::parse(const char *url) {
 
   %% write init;
   %% write exec;
+  if (cs < url_first_final) {
+    // not a url we understand: keep it as is (see str)
+    raw_url_ = url;
+  }
 }
 
 } // oscit
@@ -126,7 +126,7 @@ void Value::to_stream(std::ostream &out_stream, bool lazy) const {
       out_stream << "\"Matrix " << matrix_->rows << "x" << matrix_->cols << "\"";
       break;
     case MIDI_VALUE:
-      out_stream << midi_message_->to_json();
+      out_stream << midi_message().to_json();
       break;
     case LIST_VALUE:
       sz = size();
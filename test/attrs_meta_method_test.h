@@ -60,6 +60,21 @@ public:
     assert_equal(NOT_FOUND_ERROR, res.error_code());
   }
 
+  void test_list_of_paths( void ) {
+    Root root;
+    root.adopt(new DummyObject("foo", 4.25));
+    root.adopt(new DummyObject2("bar", "yuv"));
+
+    Value res = root.call(ATTRS_PATH, JsonValue("[\"/foo\", \"/bar\", \"/blah\"]"));
+    assert_equal(6, res.size());
+    assert_equal("/foo", res[0].str());
+    assert_equal("range", res[1][Oscit::TYPE][Oscit::NAME].str());
+    assert_equal("/bar", res[2].str());
+    assert_equal("Set color mode.", res[3][Oscit::INFO].str());
+    assert_equal("/blah", res[4].str());
+    assert_equal(NOT_FOUND_ERROR, res[5].error_code());
+  }
+
   void test_select_type( void ) {
     Root root;
     root.adopt(new DummyObject2("foo", "yuv"));
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/root.h"
+#include "oscit/changes_meta_method.h"
+
+class ChangesMetaMethodTest : public TestHelper
+{
+public:
+  void test_should_return_version( void ) {
+    Root root;
+    Value version = root.call(CHANGES_PATH);
+    assert_true(version.is_string());
+    root.adopt(new Object("a"));
+    Value res = root.call(CHANGES_PATH, version);
+    assert_equal("[\"adopt\", \"/a\", {\"@info\":\"Container.\"}]", res[1].to_json());
+    assert_equal(res[0].str(), root.call(CHANGES_PATH).str());
+  }
+
+  void test_should_record_changes( void ) {
+    Root root;
+    Object *a = root.adopt(new Object("a"));
+    root.adopt(new Object("b"));
+    Value version = root.call(CHANGES_PATH);
+
+    a->set(JsonValue("{\"@foo\":\"bar\"}"));
+    root.notify_observers(REPLY_PATH, JsonValue("[\"/b\", 3]"));
+    root.notify_observers(REPLY_PATH, JsonValue("[\"/.info\", \"meta\"]"));
+    delete a;
+
+    Value res = root.call(CHANGES_PATH, version);
+    assert_equal("[\"attrs\", \"/a\", {\"@info\":\"Container.\", \"@foo\":\"bar\"}, \"value\", \"/b\", 3, \"remove\", \"/a\", null]", res[1].to_json());
+    // next page is empty
+    res = root.call(CHANGES_PATH, res[0]);
+    assert_equal(0, res[1].size());
+  }
+
+  void test_should_page_changes( void ) {
+    Root root;
+    Value version = root.call(CHANGES_PATH);
+    for (int i = 0; i < CHANGES_PAGE_SIZE + 2; ++i) {
+      notify_value(&root, i);
+    }
+
+    Value res = root.call(CHANGES_PATH, version);
+    assert_equal(3 * CHANGES_PAGE_SIZE, res[1].size());
+    res = root.call(CHANGES_PATH, res[0]);
+    assert_equal(6, res[1].size());
+  }
+
+  void test_should_ask_for_full_sync_on_old_version( void ) {
+    Root root;
+    Value version = root.call(CHANGES_PATH);
+    for (int i = 0; i < TREE_JOURNAL_SIZE + 1; ++i) {
+      notify_value(&root, i);
+    }
+
+    Value res = root.call(CHANGES_PATH, version);
+    assert_equal(root.call(CHANGES_PATH).str(), res[0].str());
+    assert_true(res[1].is_nil());
+  }
+
+  void should_coalesce_value_updates( void ) {
+    Root root;
+    Value version = root.call(CHANGES_PATH);
+    for (int i = 0; i < TREE_JOURNAL_SIZE + 1; ++i) {
+      root.notify_observers(REPLY_PATH, JsonValue("[\"/b\", 3]"));
+    }
+    root.notify_observers(REPLY_PATH, JsonValue("[\"/b\", 4]"));
+
+    Value res = root.call(CHANGES_PATH, version);
+    assert_equal("[\"value\", \"/b\", 4]", res[1].to_json());
+  }
+
+  void should_ask_for_full_sync_on_another_tree_version( void ) {
+    Root root;
+    Root other;
+    root.adopt(new Object("a"));
+    Value res = root.call(CHANGES_PATH, other.call(CHANGES_PATH));
+    assert_equal(root.call(CHANGES_PATH).str(), res[0].str());
+    assert_true(res[1].is_nil());
+  }
+
+private:
+  static void notify_value(Root *root, int i) {
+    std::ostringstream path;
+    path << "/b" << i;
+    Value reply(path.str());
+    reply.push_back(3.0);
+    root->notify_observers(REPLY_PATH, reply);
+  }
+};
@@ -39,6 +39,27 @@
 #include <sstream>
 
 namespace oscit {
+class SleepTask : public StrandTask {
+public:
+  virtual void run() {
+    Thread::millisleep(20);
+  }
+};
+
+/** Meta method streaming its reply (only receives reals).
+ */
+class StreamingMethod : public Object {
+public:
+  StreamingMethod(const char *name) : Object(name, Oscit::real_io("Streams its reply.")) {}
+
+  virtual bool trigger_stream(const Value &val, ReplyStream *stream) {
+    stream->begin(Value(url()));
+    stream->push_back(val);
+    stream->close();
+    return true;
+  }
+};
+
 class CommandTest : public TestHelper
 {
 public:
@@ -161,6 +182,42 @@ public:
     assert_equal("unknown.host", cmd.observers().front().name());
   }
 
+  void should_renew_observers_on_any_message( void ) {
+    Logger logger;
+    CommandLogger cmd(&logger);
+    cmd.observer_leases().set_ttl(30);
+    cmd.receive(Url("dummy://unknown.host:4560/.register"), gNilValue);
+    millisleep(20);
+    cmd.receive(Url("dummy://unknown.host:4560/.reply"), gNilValue);
+    millisleep(20);
+    assert_equal(1, cmd.observers().size());
+    millisleep(30);
+    assert_equal(0, cmd.observers().size());
+    assert_equal(1, cmd.observer_leases().expired_count());
+  }
+
+  void should_register_subscriptions( void ) {
+    Logger logger;
+    CommandLogger cmd(&logger);
+    cmd.receive(Url("dummy://unknown.host:4560/.register"), JsonValue("[4561, \"/synth\"]"));
+    cmd.receive(Url("dummy://other.host:4560/.register"), gNilValue);
+    assert_equal(2, cmd.observers().size());
+
+    std::list<Location> locations;
+    cmd.observers_of(REPLY_PATH, JsonValue("[\"/synth/cutoff\", 5]"), &locations);
+    assert_equal(2, locations.size());
+    assert_equal(4561, locations.back().port());
+
+    locations.clear();
+    cmd.observers_of(REPLY_PATH, JsonValue("[\"/mixer\", 5]"), &locations);
+    assert_equal(1, locations.size());
+
+    // meta notifications go to all observers
+    locations.clear();
+    cmd.observers_of(REPLY_PATH, JsonValue("[\"/.attr\", [\"/mixer\", 1]]"), &locations);
+    assert_equal(2, locations.size());
+  }
+
   void should_handle_reply_messages( void ) {
     Logger logger;
     CommandLogger cmd("dummy", &logger);
@@ -185,6 +242,69 @@ public:
     assert_equal("[dummy: notify /flop 5]", logger.str());
   }
 
+  void should_reply_from_strand( void ) {
+    Logger logger;
+    Strand strand;
+    Root root;
+    CommandLogger *cmd = root.adopt_command(new CommandLogger(&logger), false);
+    DummyObject *foo = root.adopt(new DummyObject("foo", 4.5));
+    foo->set_strand(&strand);
+    logger.str("");
+
+    cmd->receive(Url("dummy://unknown.host:4560/foo"), Value(3.0));
+    strand.wait();
+    assert_equal("[dummy: notify /.reply [\"/foo\", 3]]", logger.str());
+    assert_equal(3.0, foo->real());
+  }
+
+  void should_reply_from_strand_before_clear( void ) {
+    Logger logger;
+    Strand strand;
+    Root root;
+    CommandLogger *cmd = root.adopt_command(new CommandLogger(&logger), false);
+    DummyObject *foo = root.adopt(new DummyObject("foo", 4.5));
+    foo->set_strand(&strand);
+    // keep the strand busy
+    strand.post(new SleepTask);
+    logger.str("");
+
+    cmd->receive(Url("dummy://unknown.host:4560/foo"), Value(3.0));
+    root.clear();
+    assert_equal("[dummy: notify /.reply [\"/foo\", 3]]", logger.str());
+  }
+
+  void should_complete_calls_with_call_replies( void ) {
+    Logger logger;
+    CommandLogger cmd(&logger);
+    Location remote(Location::LOOPBACK, 4560);
+    RemoteCall *call = new RemoteCall;
+    uint32_t id = cmd.remote_calls().start(remote, call);
+    Value reply(Value("/foo").push_back(1.5).push_back((Real)id));
+
+    // a notification that happens to look like a reply
+    cmd.receive(Url(remote, REPLY_PATH), reply);
+    assert_false(call->is_done());
+
+    cmd.receive(Url(remote, CALL_REPLY_PATH), reply);
+    assert_equal(1.5, call->result().r);
+    call->release();
+  }
+
+  void should_check_streamed_calls( void ) {
+    Logger logger;
+    Root root;
+    CommandLogger *cmd = root.adopt_command(new CommandLogger(&logger), false);
+    root.adopt(new StreamingMethod(".stream"));
+    logger.str("");
+
+    cmd->receive(Url("dummy://unknown.host:4560/.stream"), Value(1.5));
+    assert_equal("[dummy: send dummy://unknown.host:4560 /.reply [\"/.stream\", [\"/.stream\", [1.5]]]]", logger.str());
+
+    logger.str("");
+    cmd->receive(Url("dummy://unknown.host:4560/.stream"), Value("bad"));
+    assert_true(logger.str().find("/.error") != std::string::npos);
+  }
+
   void test_receive_meta_should_not_notify_observers( void ) {
     Logger logger;
     Root root;
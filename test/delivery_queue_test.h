@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/delivery_queue.h"
+
+static void delivery_queue_test_log(void *data, const Value &val) {
+  *((std::ostringstream*)data) << val;
+}
+
+class DeliveryQueueTest : public TestHelper
+{
+public:
+  void test_push_and_drain( void ) {
+    std::ostringstream out;
+    DeliveryQueue queue;
+    DeliveryQueue::Slot a(&queue, delivery_queue_test_log, &out);
+    DeliveryQueue::Slot b(&queue, delivery_queue_test_log, &out);
+
+    queue.push(&a, Value(1.0));
+    queue.push(&b, Value(2.0));
+    assert_equal(2, queue.depth());
+    assert_equal(2, queue.drain());
+    assert_equal("12", out.str());
+    assert_equal(0, queue.depth());
+    assert_equal(2, queue.max_depth());
+    assert_equal(2, queue.delivered_count());
+  }
+
+  void test_coalesce( void ) {
+    std::ostringstream out;
+    DeliveryQueue queue;
+    DeliveryQueue::Slot a(&queue, delivery_queue_test_log, &out);
+
+    queue.push(&a, Value(1.0));
+    queue.push(&a, Value(2.0));
+    queue.push(&a, Value(3.0));
+    assert_equal(1, queue.depth());
+    assert_equal(2, queue.coalesced_count());
+    queue.drain();
+    assert_equal("3", out.str());
+  }
+
+  void test_drop_when_full( void ) {
+    std::ostringstream out;
+    DeliveryQueue queue(1);
+    DeliveryQueue::Slot a(&queue, delivery_queue_test_log, &out);
+    DeliveryQueue::Slot b(&queue, delivery_queue_test_log, &out);
+
+    queue.push(&a, Value(1.0));
+    queue.push(&b, Value(2.0));
+    assert_equal(1, queue.depth());
+    assert_equal(1, queue.dropped_count());
+    queue.drain();
+    assert_equal("1", out.str());
+  }
+
+  void test_detach( void ) {
+    std::ostringstream out;
+    DeliveryQueue queue;
+    DeliveryQueue::Slot a(&queue, delivery_queue_test_log, &out);
+    DeliveryQueue::Slot b(&queue, delivery_queue_test_log, &out);
+
+    queue.push(&a, Value(1.0));
+    queue.push(&b, Value(2.0));
+    queue.detach(&a);
+    assert_equal(1, queue.depth());
+    assert_true(a.queue_ == NULL);
+    queue.drain();
+    assert_equal("2", out.str());
+  }
+
+  void test_stats( void ) {
+    DeliveryQueue queue(10);
+    std::ostringstream out;
+    DeliveryQueue::Slot a(&queue, delivery_queue_test_log, &out);
+    queue.push(&a, Value(1.0));
+    Value stats = queue.stats();
+    assert_equal(1.0, stats["depth"].r);
+    assert_equal(10.0, stats["capacity"].r);
+    assert_equal(0.0, stats["dropped"].r);
+  }
+
+  void test_wait_timeout( void ) {
+    DeliveryQueue queue;
+    TimeRef time_ref;
+    assert_false(queue.wait(5));
+    assert_true(time_ref.elapsed_us() >= 5000);
+  }
+
+  void test_wait_returns_when_value_is_pushed( void ) {
+    DeliveryQueue queue;
+    std::ostringstream out;
+    DeliveryQueue::Slot a(&queue, delivery_queue_test_log, &out);
+    queue.push(&a, Value(1.0));
+    TimeRef time_ref;
+    assert_true(queue.wait(50));
+    assert_true(time_ref.elapsed_us() < 50000);
+  }
+};
@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/executor.h"
+#include "oscit/mutex.h"
+#include "oscit/time_ref.h"
+
+class ExecutorTest : public TestHelper
+{
+public:
+  /** Sleeps and records the largest number of tasks running at the same time.
+   */
+  class SleepTask : public StrandTask {
+  public:
+    SleepTask(ExecutorTest *test, const char *name, Real sleep = 0)
+        : test_(test), name_(name), sleep_(sleep) {}
+
+    virtual void run() {
+      test_->start(name_);
+      if (sleep_) millisleep(sleep_);
+      test_->stop();
+    }
+
+    ExecutorTest *test_;
+    const char *name_;
+    Real sleep_;
+  };
+
+  void setUp() {
+    log_.str("");
+    running_ = 0;
+    max_running_ = 0;
+    ran_ = 0;
+  }
+
+  void test_post_runs_tasks_in_order( void ) {
+    Executor executor(4);
+    Strand strand(&executor);
+    strand.post(new SleepTask(this, "a", 5));
+    strand.post(new SleepTask(this, "b"));
+    strand.post(new SleepTask(this, "c"));
+    strand.wait();
+    assert_equal("[a][b][c]", log());
+    assert_equal(1, max_running_);
+    assert_equal(0, strand.pending());
+  }
+
+  void test_strands_run_in_parallel( void ) {
+    Executor executor(2);
+    Strand one(&executor);
+    Strand two(&executor);
+    int64_t start = TimeRef::now();
+    one.post(new SleepTask(this, "a", 30));
+    two.post(new SleepTask(this, "b", 30));
+    one.wait();
+    two.wait();
+    assert_true((TimeRef::now() - start) / 1000000 < 55);
+    assert_equal(2, max_running_);
+  }
+
+  void test_run_in_calling_thread_if_idle( void ) {
+    Executor executor(1);
+    Strand strand(&executor);
+    ThreadTask task(this, &strand);
+    strand.run(&task);
+    assert_true(task.in_strand_);
+    assert_true(pthread_equal(task.thread_, pthread_self()));
+    assert_false(strand.running_in_this_thread());
+  }
+
+  void test_run_waits_for_posted_tasks( void ) {
+    Executor executor(1);
+    Strand strand(&executor);
+    strand.post(new SleepTask(this, "a", 20));
+    millisleep(5);
+    SleepTask task(this, "b");
+    strand.run(&task);
+    assert_equal("[a][b]", log());
+    assert_equal(1, max_running_);
+  }
+
+  void test_nested_run( void ) {
+    Executor executor(1);
+    Strand strand(&executor);
+    NestedTask task(this, &strand);
+    strand.post(new NestedTask(this, &strand));
+    strand.wait();
+    strand.run(&task);
+    assert_equal("[a][a]", log());
+  }
+
+  void test_workers_do_not_wait_for_busy_strands( void ) {
+    Executor executor(2);
+    Strand one(&executor);
+    Strand two(&executor);
+    CrossTask *a = new CrossTask(this, &two);
+    CrossTask *b = new CrossTask(this, &one);
+    one.post(a);
+    two.post(b);
+    one.wait();
+    two.wait();
+    // each strand was busy when the other one called it
+    assert_equal(0, ran_);
+    assert_false(Executor::in_worker());
+  }
+
+  void start(const char *name) {
+    ScopedLock lock(mutex_);
+    log_ << "[" << name << "]";
+    if (++running_ > max_running_) max_running_ = running_;
+  }
+
+  void stop() {
+    ScopedLock lock(mutex_);
+    --running_;
+  }
+
+private:
+  class ThreadTask : public StrandTask {
+  public:
+    ThreadTask(ExecutorTest *test, Strand *strand) : strand_(strand), in_strand_(false) {}
+
+    virtual void run() {
+      thread_ = pthread_self();
+      in_strand_ = strand_->running_in_this_thread();
+    }
+
+    Strand *strand_;
+    pthread_t thread_;
+    bool in_strand_;
+  };
+
+  /** Runs another task in the same strand from within the strand.
+   */
+  class NestedTask : public StrandTask {
+  public:
+    NestedTask(ExecutorTest *test, Strand *strand) : test_(test), strand_(strand) {}
+
+    virtual void run() {
+      SleepTask task(test_, "a");
+      strand_->run(&task);
+    }
+
+    ExecutorTest *test_;
+    Strand *strand_;
+  };
+
+  /** Calls 'run' on another strand while it is busy.
+   */
+  class CrossTask : public StrandTask {
+  public:
+    CrossTask(ExecutorTest *test, Strand *other) : test_(test), other_(other) {}
+
+    virtual void run() {
+      SleepTask task(test_, "x");
+      millisleep(10);
+      if (other_->run(&task)) {
+        ScopedLock lock(test_->mutex_);
+        ++test_->ran_;
+      }
+      // still busy when the other strand calls
+      millisleep(20);
+    }
+
+    ExecutorTest *test_;
+    Strand *other_;
+  };
+
+  std::string log() {
+    ScopedLock lock(mutex_);
+    std::string res = log_.str();
+    log_.str("");
+    return res;
+  }
+
+  Mutex mutex_;
+  std::ostringstream log_;
+  int running_;
+  int max_running_;
+
+  /** Cross calls that ran (see CrossTask).
+   */
+  int ran_;
+};
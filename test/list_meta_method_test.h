@@ -59,14 +59,15 @@ public:
     Value res = reply[1];
     
     assert_true(res.is_list());
-    assert_equal(7, res.size());
+    assert_equal(8, res.size());
     assert_equal(Url(ERROR_PATH).name(), res[0].str());
     assert_equal(Url(INFO_PATH).name(), res[1].str());
     assert_equal(Url(LIST_PATH).name(), res[2].str());
     assert_equal(Url(LIST_WITH_ATTRIBUTES_PATH).name(), res[3].str());
     assert_equal(Url(ATTRS_PATH).name(), res[4].str());
     assert_equal(Url(TREE_PATH).name(), res[5].str());
-    assert_equal("Nikolaus/", res[6].str());
+    assert_equal(Url(CHANGES_PATH).name(), res[6].str());
+    assert_equal("Nikolaus/", res[7].str());
     
     reply = root.call(LIST_PATH, Value("/Nikolaus"));
     assert_equal("/Nikolaus", reply[0].str());
@@ -65,6 +65,15 @@ public:
     assert_equal(hashId("fsf"), v.type_id());
   }
 
+  void test_push_back_should_update_type_id( void ) {
+    Value v(1.0);
+    v.push_back("two");
+    assert_equal(hashId("fs"), v.type_id());
+    v.push_back(Value(3.0).push_back(4.0));
+    assert_equal("fs[ff]", v.type_tag());
+    assert_equal(hashId("fs[ff]"), v.type_id());
+  }
+
   void test_empty_list_is_nil( void ) {
     ListValue v;
     assert_true(v.is_list());
@@ -51,7 +51,7 @@ public:
     Value res = root.list_with_attributes();
     // .error, .info, etc
     //
-    assert_equal("sHsHsHsHsHsHsHsH", res.type_tag());
+    assert_equal("sHsHsHsHsHsHsHsHsH", res.type_tag());
     assert_equal("\".error\"", res[0].to_json());
     assert_equal("\".info\"", res[2].to_json());
   }
@@ -67,7 +67,7 @@ public:
     assert_equal("", reply[0].str());
     res = reply[1];
     assert_true(res.is_list());
-    assert_equal(2 * 7, res.size()); // 7 methods, 7 keys
+    assert_equal(2 * 8, res.size()); // 8 methods, 8 keys
 
     assert_equal(Url(ERROR_PATH).name(), res[0].str());
     assert_equal(Url(INFO_PATH).name(), res[2].str());
@@ -75,7 +75,8 @@ public:
     assert_equal(Url(LIST_WITH_ATTRIBUTES_PATH).name(), res[6].str());
     assert_equal(Url(ATTRS_PATH).name(), res[8].str());
     assert_equal(Url(TREE_PATH).name(), res[10].str());
-    assert_equal("monitor/", res[12].str());
+    assert_equal(Url(CHANGES_PATH).name(), res[12].str());
+    assert_equal("monitor/", res[14].str());
 
     reply = root.call(LIST_WITH_ATTRIBUTES_PATH, Value("/monitor"));
     assert_equal("/monitor", reply[0].str());
@@ -63,4 +63,22 @@ public:
     assert_true( loc1 == loc3);
   }
 
+  void test_equal_operator_with_ip( void ) {
+    Location loc1("oscit", 167772167, 45);
+    Location loc2("oscit", 167772168, 45);
+    Location loc3("oscit", "10.0.0.7", 46);
+    Location loc4("oscit", 167772167, 45);
+    assert_false(loc1 == loc2);
+    assert_true( loc1 == loc4);
+    // compare names built from the ip
+    assert_true( loc1 == loc3);
+    assert_equal("10.0.0.7", loc1.name());
+  }
+
+  void test_name_from_ip( void ) {
+    assert_equal("10.0.0.7", Location::name_from_ip((10<<24) + 7));
+    assert_equal("255.100.99.0", Location::name_from_ip((255UL<<24) + (100<<16) + (99<<8)));
+    assert_equal("127.0.0.1", Location(Location::LOOPBACK, 7000).name());
+  }
+
 };
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/map_curve.h"
+
+#include <math.h>
+
+class MapCurveTest : public TestHelper
+{
+public:
+  void test_exp_should_be_geometric( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("exp", 0, 1, 20, 20000, &curve, &error));
+    assert_equal(MapCurve::Exp, curve.type());
+    TS_ASSERT_DELTA(20.0, curve.scale(0), 0.0001);
+    TS_ASSERT_DELTA(sqrt(20.0 * 20000.0), curve.scale(0.5), 0.01);
+    TS_ASSERT_DELTA(200.0, curve.scale(1.0 / 3), 0.01);
+    TS_ASSERT_DELTA(20000.0, curve.scale(1), 0.0001);
+  }
+
+  void test_exp_should_clip( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("exp", 0, 1, 20, 20000, &curve, &error));
+    TS_ASSERT_DELTA(20.0, curve.scale(-3), 0.0001);
+    TS_ASSERT_DELTA(20000.0, curve.scale(4), 0.0001);
+  }
+
+  void test_exp_with_zero_in_range_needs_parameter( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_false(MapCurve::parse("exp", 0, 1, 0, 1, &curve, &error));
+    assert_true(MapCurve::parse("exp(2)", 0, 1, 0, 1, &curve, &error));
+    TS_ASSERT_DELTA((exp(1.0) - 1) / (exp(2.0) - 1), curve.scale(0.5), 0.0001);
+  }
+
+  void test_log_should_invert_exp( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("log", 20, 20000, 0, 1, &curve, &error));
+    TS_ASSERT_DELTA(0.5, curve.scale(sqrt(20.0 * 20000.0)), 0.0001);
+    TS_ASSERT_DELTA(1.0 / 3, curve.scale(200), 0.0001);
+  }
+
+  void test_pow( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("pow(2)", 0, 1, 0, 100, &curve, &error));
+    TS_ASSERT_DELTA(25.0, curve.scale(0.5), 0.001);
+    TS_ASSERT_DELTA(1.0, curve.scale(0.1), 0.001);
+    assert_false(MapCurve::parse("pow(0)", 0, 1, 0, 100, &curve, &error));
+    assert_false(MapCurve::parse("pow", 0, 1, 0, 100, &curve, &error));
+  }
+
+  void test_table_should_interpolate( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("table(0, 0.1, 0.3, 1)", 0, 3, 0, 100, &curve, &error));
+    TS_ASSERT_DELTA(10.0, curve.scale(1), 0.0001);
+    TS_ASSERT_DELTA(20.0, curve.scale(1.5), 0.0001);
+    TS_ASSERT_DELTA(65.0, curve.scale(2.5), 0.0001);
+  }
+
+  void test_table_should_be_monotonic( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_false(MapCurve::parse("table(0, 0.5, 0.2, 1)", 0, 1, 0, 1, &curve, &error));
+    assert_false(MapCurve::parse("table(0, 2)", 0, 1, 0, 1, &curve, &error));
+    assert_false(MapCurve::parse("table(0.5)", 0, 1, 0, 1, &curve, &error));
+    assert_true(MapCurve::parse("table(1, 0.5, 0)", 0, 1, 0, 1, &curve, &error));
+    TS_ASSERT_DELTA(0.75, curve.scale(0.25), 0.0001);
+  }
+
+  void test_invalid_definitions( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_false(MapCurve::parse("sin", 0, 1, 0, 1, &curve, &error));
+    assert_equal("Unknown curve 'sin' !", error);
+    assert_false(MapCurve::parse("table(0, 1", 0, 1, 0, 1, &curve, &error));
+    assert_false(MapCurve::parse("table(0, a)", 0, 1, 0, 1, &curve, &error));
+  }
+
+  void test_inverse( void ) {
+    const char *definitions[] = {"lin", "exp", "pow(3)", "pow(0.5)", "table(0, 0.1, 0.3, 1)", "table(1, 0.2, 0)"};
+    for (size_t i = 0; i < sizeof(definitions) / sizeof(const char *); ++i) {
+      MapCurve curve;
+      std::string error;
+      assert_true(MapCurve::parse(definitions[i], 0, 10, 20, 20000, &curve, &error));
+      MapCurve inverse = curve.inverse();
+      for (Real x = 0.5; x < 10; x += 1.5) {
+        TS_ASSERT_DELTA(x, inverse.scale(curve.scale(x)), 0.01);
+      }
+    }
+  }
+
+  void test_steep_curves_should_not_use_lut( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("exp", 0, 1, 20, 20000, &curve, &error));
+    assert_true(curve.uses_lut());
+    assert_false(curve.inverse().uses_lut());
+    assert_true(MapCurve::parse("pow(0.5)", 0, 1, 0, 1, &curve, &error));
+    assert_false(curve.uses_lut());
+  }
+
+  void test_scale_array( void ) {
+    MapCurve curve;
+    std::string error;
+    assert_true(MapCurve::parse("pow(2)", 0, 1, 0, 100, &curve, &error));
+    Real values[] = {-1, 0.5, 1, 2};
+    curve.scale(values, values, 4);
+    TS_ASSERT_DELTA(0.0, values[0], 0.001);
+    TS_ASSERT_DELTA(25.0, values[1], 0.001);
+    TS_ASSERT_DELTA(100.0, values[2], 0.001);
+    TS_ASSERT_DELTA(100.0, values[3], 0.001);
+  }
+};
@@ -82,4 +82,240 @@ public:
     assert_equal("/m/tempo", target);
     assert_equal(240.0, value);
   }
-};
\ No newline at end of file
+
+  void test_map_returns_target_by_reference( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/slider1/1 [0,1] --> /m/tempo [60,240]")));
+    const std::string *target = NULL;
+    const std::string *again  = NULL;
+    Real value;
+    assert_true(mapper.map("/slider1/1", 0.5, &target, &value));
+    assert_true(mapper.map("/slider1/1", 1.0, &again, &value));
+    assert_equal("/m/tempo", *target);
+    assert_true(target == again);
+  }
+
+  void test_map_list( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/bank [0,1] --> /mixer [0,100]")));
+    std::vector<Mapper::Target> targets;
+    Value list;
+    list.push_back(0.0).push_back(0.5).push_back(2.0);
+    assert_equal(1, mapper.map("/bank", list, &targets));
+    assert_equal("/mixer", *targets[0].url_);
+    assert_equal("[0, 50, 100]", targets[0].value_.to_json());
+  }
+
+  void test_map_elements_to_several_targets( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string(
+      "/pad[0] [0,1] --> /synth/cutoff [20,2000]\n"
+      "/pad[1] [0,1] --> /synth/res [0,10]\n"
+      "/pad[0..1] [0,1] --> /view/xy [0,100]\n")));
+    std::vector<Mapper::Target> targets;
+    Value pad;
+    pad.push_back(0.5).push_back(0.25);
+    assert_equal(3, mapper.map("/pad", pad, &targets));
+    assert_equal("/synth/cutoff", *targets[0].url_);
+    assert_equal(1010.0, targets[0].value_.r);
+    assert_equal("/synth/res", *targets[1].url_);
+    assert_equal(2.5, targets[1].value_.r);
+    assert_equal("/view/xy", *targets[2].url_);
+    assert_equal("[50, 25]", targets[2].value_.to_json());
+  }
+
+  void test_map_range_larger_then_values( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/bank[2..15] [0,1] --> /mixer [0,10]")));
+    std::vector<Mapper::Target> targets;
+    Value bank;
+    bank.push_back(0.0).push_back(0.1).push_back(0.2).push_back(0.3);
+    assert_equal(1, mapper.map("/bank", bank, &targets));
+    assert_equal("[2, 3]", targets[0].value_.to_json());
+
+    targets.clear();
+    assert_equal(0, mapper.map("/bank", Value(0.5), &targets));
+  }
+
+  void test_map_large_list( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/bank [0,127] --> /mixer [0,1]")));
+    std::vector<Mapper::Target> targets;
+    Value bank;
+    for (int i = 0; i < 128; ++i) bank.push_back((Real)i);
+    assert_equal(1, mapper.map("/bank", bank, &targets));
+    assert_equal(128, targets[0].value_.size());
+    assert_equal(1.0, targets[0].value_[127].r);
+  }
+
+  void test_invalid_selector( void ) {
+    Mapper mapper;
+    assert_false(mapper.parse(std::string("/pad[a] [0,1] --> /synth/cutoff [20,2000]")));
+    assert_false(mapper.parse(std::string("/pad[3..1] [0,1] --> /synth/cutoff [20,2000]")));
+  }
+
+  void test_reparse_does_not_duplicate_rules( void ) {
+    Mapper mapper;
+    std::string script("/pad[0] [0,1] --> /a [0,1]\n/pad[1] [0,1] --> /b [0,1]");
+    assert_true(mapper.parse(script));
+    assert_true(mapper.parse(script));
+    std::vector<Mapper::Target> targets;
+    Value pad;
+    pad.push_back(0.5).push_back(0.25);
+    assert_equal(2, mapper.map("/pad", pad, &targets));
+  }
+
+  void test_reverse_map_only_without_selector( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/pad[0] [0,1] --> /a [0,10]\n/bank [0,1] --> /b [0,10]")));
+    std::string target;
+    Real value;
+    assert_false(mapper.reverse_map("/a", 5, &target, &value));
+    assert_true(mapper.reverse_map("/b", 5, &target, &value));
+    assert_equal("/bank", target);
+    assert_equal(0.5, value);
+  }
+  void test_map_with_curve( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/knob [0,1] --> /synth/freq [20,20000] exp\n/fader [0,1] --> /gain [0,100] pow(2)")));
+    std::string target;
+    Real value;
+    assert_true(mapper.map("/knob", 1.0 / 3, &target, &value));
+    assert_equal("/synth/freq", target);
+    TS_ASSERT_DELTA(200.0, value, 0.01);
+    assert_true(mapper.map("/fader", 0.5, &target, &value));
+    TS_ASSERT_DELTA(25.0, value, 0.001);
+  }
+
+  void test_reverse_map_with_curve( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("# knob ] log\n/knob [0,1] --> /synth/freq [20,20000] exp  \n"
+                                         "/slide [0,3] --> /mix [0,100]  table(0, 0.1, 0.3, 1)")));
+    std::string target;
+    Real value;
+    assert_true(mapper.reverse_map("/synth/freq", 2000, &target, &value));
+    assert_equal("/knob", target);
+    TS_ASSERT_DELTA(2.0 / 3, value, 0.0001);
+    assert_true(mapper.reverse_map("/mix", 20, &target, &value));
+    assert_equal("/slide", target);
+    TS_ASSERT_DELTA(1.5, value, 0.001);
+  }
+
+  void test_map_list_with_curve( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/bank[0..1] [0,1] --> /gains [0,100] pow(2)")));
+    std::vector<Mapper::Target> targets;
+    Value bank;
+    bank.push_back(0.5).push_back(1.0);
+    assert_equal(1, mapper.map("/bank", bank, &targets));
+    TS_ASSERT_DELTA(25.0, targets[0].value_[0].r, 0.001);
+    TS_ASSERT_DELTA(100.0, targets[0].value_[1].r, 0.001);
+  }
+
+  void test_curve_followed_by_comment( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/knob [0,1] --> /synth/freq [20,20000] exp # log would sound wrong\n"
+                                         "/fader [0,1] --> /gain [0,100] pow(2)# (not 3) ]\n"
+                                         "/slide [0,1] --> /mix [0,1] # linear\n")));
+    std::string target;
+    Real value;
+    assert_true(mapper.map("/knob", 1.0 / 3, &target, &value));
+    TS_ASSERT_DELTA(200.0, value, 0.01);
+    assert_true(mapper.map("/fader", 0.5, &target, &value));
+    TS_ASSERT_DELTA(25.0, value, 0.001);
+    assert_true(mapper.map("/slide", 0.25, &target, &value));
+    assert_equal(0.25, value);
+  }
+
+  void test_invalid_curve( void ) {
+    Mapper mapper;
+    assert_false(mapper.parse(std::string("/knob [0,1] --> /synth/freq [20,20000] sin")));
+    assert_equal("Unknown curve 'sin' !", mapper.error());
+    assert_false(mapper.parse(std::string("/knob [0,1] --> /synth/gain [0,1] exp")));
+  }
+  void test_map_pattern( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/ctrl/{n} [0,127] --> /synth/voice{n}/gain [0,1]")));
+    assert_equal(1, mapper.pattern_count());
+    std::string target;
+    Real value;
+    assert_true(mapper.map("/ctrl/12", 127, &target, &value));
+    assert_equal("/synth/voice12/gain", target);
+    assert_equal(1.0, value);
+    assert_true(mapper.map("/ctrl/3", 0, &target, &value));
+    assert_equal("/synth/voice3/gain", target);
+    assert_false(mapper.map("/ctrl/x", 0, &target, &value));
+    assert_false(mapper.map("/ctrl/3/foo", 0, &target, &value));
+    assert_false(mapper.map("/ctrl/", 0, &target, &value));
+  }
+
+  void test_exact_match_before_pattern( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/ctrl/{n} [0,1] --> /voice/{n} [0,10]\n/ctrl/7 [0,1] --> /master [0,100]")));
+    std::string target;
+    Real value;
+    assert_true(mapper.map("/ctrl/7", 0.5, &target, &value));
+    assert_equal("/master", target);
+    assert_equal(50.0, value);
+    assert_true(mapper.map("/ctrl/6", 0.5, &target, &value));
+    assert_equal("/voice/6", target);
+    assert_equal(5.0, value);
+  }
+
+  void test_most_specific_pattern( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/{a}/x/{b} [0,1] --> /generic/{a}/{b} [0,1]\n"
+                                         "/mix/{bus}/{ch} [0,1] --> /mixer/{ch}/bus{bus} [0,1]")));
+    std::string target;
+    Real value;
+    assert_true(mapper.map("/mix/2/14", 0.5, &target, &value));
+    assert_equal("/mixer/14/bus2", target);
+    assert_true(mapper.map("/5/x/6", 0.5, &target, &value));
+    assert_equal("/generic/5/6", target);
+  }
+
+  void test_map_list_with_pattern( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/pad{n}[0] [0,1] --> /voice{n}/cutoff [0,100]\n/pad{n}[1] [0,1] --> /voice{n}/res [0,10]")));
+    std::vector<Mapper::Target> targets;
+    Value pad;
+    pad.push_back(0.5).push_back(0.25);
+    assert_equal(2, mapper.map("/pad4", pad, &targets));
+    assert_true(targets[0].url_ == NULL);
+    assert_equal("/voice4/cutoff", targets[0].url());
+    assert_equal(50.0, targets[0].value_.r);
+    assert_equal("/voice4/res", targets[1].url());
+    assert_equal(2.5, targets[1].value_.r);
+  }
+
+  void test_reverse_map_pattern( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/ctrl/{n} [0,127] --> /synth/voice{n}/gain [0,1]\n/all/{n} [0,1] --> /master [0,1]")));
+    std::string target;
+    Real value;
+    assert_true(mapper.reverse_map("/synth/voice5/gain", 0.5, &target, &value));
+    assert_equal("/ctrl/5", target);
+    assert_equal(63.5, value);
+    // capture missing in target: no reverse mapping
+    assert_false(mapper.reverse_map("/master", 0.5, &target, &value));
+  }
+
+  void test_redefine_pattern( void ) {
+    Mapper mapper;
+    assert_true(mapper.parse(std::string("/ctrl/{n} [0,1] --> /a{n} [0,1]\n/ctrl/{n} [0,1] --> /b{n} [0,1]")));
+    assert_equal(1, mapper.pattern_count());
+    std::string target;
+    Real value;
+    assert_true(mapper.map("/ctrl/1", 0.5, &target, &value));
+    assert_equal("/b1", target);
+  }
+
+  void test_invalid_pattern( void ) {
+    Mapper mapper;
+    assert_false(mapper.parse(std::string("/ctrl/{n [0,1] --> /a [0,1]")));
+    assert_false(mapper.parse(std::string("/ctrl/{} [0,1] --> /a [0,1]")));
+    assert_false(mapper.parse(std::string("/ctrl/{a}{b} [0,1] --> /a [0,1]")));
+    assert_false(mapper.parse(std::string("/ctrl/{n} [0,1] --> /voice{m} [0,1]")));
+    assert_equal("Unknown capture '{m}' in '/voice{m}' !", mapper.error());
+  }
+};
@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/midi_scheduler.h"
+#include "oscit/mutex.h"
+#include "oscit/time_ref.h"
+
+class MidiSchedulerTest : public TestHelper
+{
+public:
+  void setUp() {
+    log_.str("");
+    note_on_ = 0;
+    note_off_ = 0;
+  }
+
+  void test_send_now( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    MidiMessage msg;
+    msg.set_as_ctrl(4, 100, 2);
+    assert_true(scheduler.schedule(msg));
+    millisleep(10);
+    assert_equal("[177, 4, 100]", log());
+  }
+
+  void test_send_after_wait( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    MidiMessage msg;
+    msg.set_as_ctrl(4, 100, 1, 30);
+    assert_true(scheduler.schedule(msg));
+    millisleep(15);
+    assert_equal("", log());
+    assert_equal(1, scheduler.pending());
+    millisleep(30);
+    assert_equal("[176, 4, 100]", log());
+  }
+
+  void test_note_off_from_length( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    MidiMessage msg;
+    msg.set_as_note(60, 80, 30, 1);
+    assert_true(scheduler.schedule(msg));
+    millisleep(15);
+    assert_equal("[144, 60, 80]", log());
+    millisleep(30);
+    assert_equal("[128, 60, 80]", log());
+    assert_equal(0, scheduler.pending());
+  }
+
+  void test_order_of_events( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    MidiMessage msg;
+    int64_t now = TimeRef::now();
+    msg.set_as_ctrl(3, 3);
+    scheduler.schedule_at(msg, now + 30000000);
+    msg.set_as_ctrl(1, 1);
+    scheduler.schedule_at(msg, now + 10000000);
+    msg.set_as_ctrl(2, 2);
+    scheduler.schedule_at(msg, now + 10000000);
+    millisleep(50);
+    assert_equal("[176, 1, 1][176, 2, 2][176, 3, 3]", log());
+  }
+
+  void test_overlapping_notes_release_with_last( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    MidiMessage msg;
+    msg.set_as_note(60, 80, 40, 1);
+    scheduler.schedule(msg);
+    msg.set_as_note(60, 90, 40, 1, 20);
+    scheduler.schedule(msg);
+    millisleep(50);
+    // first NoteOff is ignored
+    assert_equal("[144, 60, 80][144, 60, 90]", log());
+    millisleep(30);
+    assert_equal("[128, 60, 90]", log());
+  }
+
+  void test_many_overlapping_notes( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this, 8192);
+    MidiMessage msg;
+    for (int i = 0; i < 3000; ++i) {
+      msg.set_as_note(i % 128, 80, 10 + i % 20, 1 + i % 16, i % 10);
+      assert_true(scheduler.schedule(msg));
+    }
+    millisleep(100);
+    assert_equal(0, scheduler.pending());
+    assert_equal(3000, note_on_);
+    // one NoteOff per channel and key
+    assert_equal(128, note_off_);
+  }
+
+  void test_full_scheduler_drops( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this, 3);
+    MidiMessage msg;
+    msg.set_as_note(60, 80, 1000, 1, 1000);
+    assert_true(scheduler.schedule(msg));
+    assert_false(scheduler.schedule(msg));
+    assert_equal(1, scheduler.dropped());
+  }
+
+  void test_all_notes_off( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    MidiMessage msg;
+    msg.set_as_note(60, 80, 1000, 3);
+    scheduler.schedule(msg);
+    msg.set_as_note(62, 80, 1000, 3, 500);
+    scheduler.schedule(msg);
+    millisleep(10);
+    assert_equal("[146, 60, 80]", log());
+    scheduler.all_notes_off();
+    assert_equal(0, scheduler.pending());
+    assert_equal("[130, 60, 0]", log());
+  }
+
+  void test_stop_releases_notes( void ) {
+    {
+      TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+      MidiMessage msg;
+      msg.set_as_note(60, 80, 1000, 1);
+      scheduler.schedule(msg);
+      millisleep(10);
+    }
+    assert_equal("[144, 60, 80][128, 60, 0]", log());
+  }
+
+  void test_long_messages( void ) {
+    TMidiScheduler<MidiSchedulerTest, &MidiSchedulerTest::receive> scheduler(this);
+    std::vector<unsigned char> sysex;
+    sysex.push_back(0xf0);
+    sysex.push_back(1);
+    sysex.push_back(2);
+    sysex.push_back(3);
+    sysex.push_back(0xf7);
+    MidiMessage msg;
+    msg.set(sysex);
+    assert_true(scheduler.schedule(msg));
+    millisleep(10);
+    assert_equal("[240, 1, 2, 3, 247]", log());
+  }
+
+  void receive(const MidiMessage &msg) {
+    ScopedLock lock(mutex_);
+    const unsigned char *data = msg.data();
+    if ((data[0] & 0xf0) == NoteOn) {
+      ++note_on_;
+    } else if ((data[0] & 0xf0) == NoteOff) {
+      ++note_off_;
+    }
+    if (note_on_ + note_off_ > 100) return;
+    log_ << "[";
+    for (size_t i = 0; i < msg.size(); ++i) {
+      if (i) log_ << ", ";
+      log_ << (int)data[i];
+    }
+    log_ << "]";
+  }
+
+private:
+  std::string log() {
+    ScopedLock lock(mutex_);
+    std::string res = log_.str();
+    log_.str("");
+    return res;
+  }
+
+  Mutex mutex_;
+  std::ostringstream log_;
+  int note_on_;
+  int note_off_;
+};
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/values.h"
+#include "oscit/midi_stream.h"
+
+class MidiStreamTest : public TestHelper
+{
+public:
+  void test_encode_decode_note( void ) {
+    Value note;
+    note.set_as_note(60, 80, 400, 4, 50);
+    std::string stream;
+    assert_true(MidiStream::encode(note, &stream));
+    // flags, wait, status, note, velocity, length (2 bytes)
+    assert_equal(7, stream.size());
+
+    Value res;
+    assert_true(decode(stream, &res));
+    assert_true(res.is_midi());
+    assert_equal(note, res);
+    assert_equal(50, res.midi_message().wait());
+    assert_equal(400, res.midi_message().length());
+  }
+
+  void test_encode_decode_sysex( void ) {
+    std::vector<unsigned char> sysex(300, 0x12);
+    sysex[0] = 0xf0;
+    sysex[299] = 0xf7;
+    MidiMessage msg;
+    msg.set(sysex);
+    msg.set_length(0);
+    Value value(msg);
+    std::string stream;
+    assert_true(MidiStream::encode(value, &stream));
+    assert_equal(301, stream.size());
+
+    Value res;
+    assert_true(decode(stream, &res));
+    assert_true(res.is_midi());
+    assert_equal(300, res.midi_message().size());
+    assert_equal(value, res);
+  }
+
+  void test_running_status( void ) {
+    Value batch;
+    MidiMessage msg;
+    for (int i = 0; i < 100; ++i) {
+      msg.set_as_ctrl(7, i, 1);
+      batch.push_back(MidiValue(msg));
+    }
+    std::string stream;
+    assert_true(MidiStream::encode(batch, &stream));
+    // flags + status + 100 x 2 data bytes
+    assert_equal(1 + 1 + 200, stream.size());
+
+    Value res;
+    assert_true(decode(stream, &res));
+    assert_true(res.is_list());
+    assert_equal(100, res.size());
+    assert_equal(batch, res);
+  }
+
+  void test_mixed_messages( void ) {
+    Value batch;
+    MidiMessage msg;
+    msg.set_as_ctrl(7, 100, 2, 10);
+    batch.push_back(MidiValue(msg));
+    unsigned char tick = ClockTick;
+    msg.set(&tick, 1, 20);
+    batch.push_back(MidiValue(msg));
+    msg.set_as_ctrl(8, 101, 2, 30);
+    batch.push_back(MidiValue(msg));
+    unsigned char sysex[] = {0xf0, 0x01, 0x02, 0xf7};
+    msg.set(sysex, 4, 40);
+    batch.push_back(MidiValue(msg));
+    msg.set_as_ctrl(9, 102, 2, 50);
+    batch.push_back(MidiValue(msg));
+    unsigned char program[] = {0xc2, 0x05};
+    msg.set(program, 2, 60);
+    batch.push_back(MidiValue(msg));
+
+    std::string stream;
+    assert_true(MidiStream::encode(batch, &stream));
+    Value res;
+    assert_true(decode(stream, &res));
+    assert_equal(6, res.size());
+    assert_equal(batch, res);
+    assert_equal(2, res[5].midi_message().size());
+    assert_equal(40, res[3].midi_message().wait());
+  }
+
+  void test_single_element_list( void ) {
+    Value batch;
+    MidiMessage msg;
+    msg.set_as_ctrl(7, 100);
+    batch.set_type(LIST_VALUE);
+    batch.push_back(MidiValue(msg));
+    assert_true(batch.is_list());
+
+    std::string stream;
+    assert_true(MidiStream::encode(batch, &stream));
+    Value res;
+    assert_true(decode(stream, &res));
+    assert_true(res.is_list());
+    assert_equal(1, res.size());
+
+    assert_true(MidiStream::encode(batch, &stream, false));
+    assert_true(decode(stream, &res));
+    assert_true(res.is_midi());
+  }
+
+  void test_encode_other_values( void ) {
+    std::string stream;
+    assert_false(MidiStream::encode(Value(1.0), &stream));
+    assert_false(MidiStream::encode(JsonValue("[1, 2]"), &stream));
+    assert_false(MidiStream::is_midi_list(Value(1.0)));
+  }
+
+  void test_decode_invalid( void ) {
+    Value res;
+    // running status without status
+    assert_false(decode(std::string("\0\x07\x10", 3), &res));
+    // missing data byte
+    assert_false(decode(std::string("\0\xb0\x07", 3), &res));
+    // unterminated SysEx
+    assert_false(decode(std::string("\0\xf0\x01\x02", 4), &res));
+    // missing wait
+    assert_false(decode(std::string("\x01", 1), &res));
+    // bad wait
+    assert_false(decode(std::string("\x01\xff\xff\xff\xff\x01", 6), &res));
+    assert_false(decode(std::string(""), &res));
+  }
+
+private:
+  bool decode(const std::string &stream, Value *res) {
+    return MidiStream::decode((const unsigned char*)stream.data(), stream.size(), res);
+  }
+};
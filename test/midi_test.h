@@ -143,4 +143,77 @@ public:
     MidiMessage m;
     assert_equal("MidiMessage +1:C3(80), 0/500", m.to_s());
   }
+
+  void test_inline_data( void ) {
+    MidiMessage m;
+    m.set_as_ctrl(19, 45, 3);
+    assert_equal(3, m.size());
+    assert_false(m.is_long());
+    assert_equal(0xb2, m.data()[0]);
+    assert_equal(CtrlChange, m.type());
+    // 16 bytes on 64 bit systems
+    assert_true(sizeof(MidiMessage) <= sizeof(void*) + 8);
+  }
+
+  void test_sysex( void ) {
+    unsigned char sysex[] = {0xf0, 0x43, 0x12, 0x00, 0x01, 0xf7};
+    MidiMessage m;
+    assert_true(m.set(sysex, 6, 20));
+    assert_equal(6, m.size());
+    assert_true(m.is_long());
+    assert_equal(0xf0, m.type());
+    assert_equal(20, m.wait());
+
+    MidiMessage m2(m);
+    assert_true(m2.data() != m.data());
+    assert_true(m2 == m);
+
+    m2.set(sysex, 4);
+    assert_false(m2.is_long());
+    assert_equal(4, m2.size());
+    assert_false(m2 == m);
+
+    m = m2;
+    assert_false(m.is_long());
+    assert_true(m2 == m);
+  }
+
+  void test_set_from_own_data( void ) {
+    unsigned char sysex[] = {0xf0, 0x43, 0x12, 0x00, 0x01, 0x02, 0x03, 0xf7};
+    MidiMessage m;
+    assert_true(m.set(sysex, 8));
+    // shrink to a shorter SysEx read from our own heap block
+    assert_true(m.set(m.data() + 1, 6));
+    assert_true(m.is_long());
+    assert_equal(6, m.size());
+    assert_equal(0x43, m.data()[0]);
+    assert_equal(0x03, m.data()[5]);
+    // back to inline storage
+    assert_true(m.set(m.data() + 2, 3));
+    assert_false(m.is_long());
+    assert_equal(3, m.size());
+    assert_equal(0x00, m.data()[0]);
+    assert_equal(0x02, m.data()[2]);
+  }
+
+  void test_type_from_status( void ) {
+    MidiMessage m(0x95, 60, 0);
+    assert_equal(NoteOn, m.type());
+    assert_equal(6, m.channel());
+    m.note_on_to_off();
+    assert_equal(NoteOff, m.type());
+    assert_equal(6, m.channel());
+    m.set_type(CtrlChange);
+    assert_equal(CtrlChange, m.type());
+    assert_equal(6, m.channel());
+    m.set_type(ClockTick);
+    assert_equal(ClockTick, m.type());
+  }
+
+  void test_length_limit( void ) {
+    MidiMessage m;
+    m.set_length(100000000);
+    assert_equal(MIDI_MESSAGE_MAX_LENGTH, m.length());
+  }
 };
+
@@ -48,9 +48,9 @@ public:
     assert_false(v.is_matrix());
     assert_true (v.is_midi());
 
-    MidiMessage *msg = v.midi_message_;
+    MidiMessage msg = v.midi_message();
 
-    assert_equal(NoteOn, msg->type());
+    assert_equal(NoteOn, msg.type());
 
     assert_equal("m", v.type_tag());
     assert_equal(MIDI_MESSAGE_TYPE_TAG_ID, v.type_id());
@@ -71,18 +71,18 @@ public:
     Value v('m');
 
     assert_true(v.is_midi());
-    assert_equal(NoteOn, v.midi_message_->type());
+    assert_equal(NoteOn, v.midi_message().type());
   }
 
   void test_create_with_TypeTag( void ) {
     Value v(TypeTag("m"));
 
     assert_true(v.is_midi());
-    assert_equal(NoteOn, v.midi_message_->type());
+    assert_equal(NoteOn, v.midi_message().type());
   }
 
 
-  void test_share( void ) {
+  void test_copy( void ) {
     Value v(TypeTag("m"));
     v.set_as_note(45, 78, 1000);
 
@@ -90,12 +90,12 @@ public:
     Value v3;
 
     assert_true(v2.is_midi());
-    assert_equal(45, v2.midi_message_->note());
+    assert_equal(45, v2.midi_message().note());
 
-    v.midi_message_->set_note(60);
+    v.set_as_note(60, 78, 1000);
 
-    // change in v changes v2
-    assert_equal(60, v2.midi_message_->note());
+    // midi messages are copied
+    assert_equal(45, v2.midi_message().note());
 
     assert_true(v3.is_empty());
 
@@ -103,12 +103,55 @@ public:
 
     assert_true(v3.is_midi());
 
-    assert_equal(60, v3.midi_message_->note());
+    assert_equal(60, v3.midi_message().note());
 
-    v.midi_message_->set_note(80);
+    v.set_as_note(80, 78, 1000);
 
-    // change in v changes v3
-    assert_equal(80, v3.midi_message_->note());
+    assert_equal(60, v3.midi_message().note());
+  }
+
+  void test_copy_sysex( void ) {
+    std::vector<unsigned char> sysex(20, 7);
+    sysex[0]  = 0xf0;
+    sysex[19] = 0xf7;
+    MidiMessage m;
+    m.set(sysex);
+    Value v(m);
+    Value v2(v);
+    assert_equal(20, v2.midi_message().size());
+    assert_true(v2.midi_message().is_long());
+    assert_true(v.sysex_ != v2.sysex_);
+    assert_equal(v, v2);
+    v2.set_as_note(60);
+    assert_false(v2.midi_message().is_long());
+    assert_equal(NoteOn, v2.midi_message().type());
+    // self assignment
+    v = v;
+    assert_equal(0xf7, v.midi_message().data()[19]);
+  }
+
+  void test_value_size( void ) {
+    // only SysEx messages are kept out of line
+    assert_true(sizeof(Value) <= 16);
+  }
+
+  void test_note_is_stored_inline( void ) {
+    Value v;
+    v.set_as_note(61, 70, 300, 2, 10);
+    assert_equal(0x91, v.midi_.bytes[0]);
+    assert_equal(61,   v.midi_.bytes[1]);
+    assert_equal(70,   v.midi_.bytes[2]);
+    assert_equal(10,   v.midi_.wait);
+    Value v2(v);
+    assert_equal(300, v2.midi_message().length());
+    assert_equal(v, v2);
+  }
+
+  void test_set_same_value( void ) {
+    Value v;
+    v.set_as_note(45);
+    v.set(v.midi_message());
+    assert_equal(45, v.midi_message().note());
   }
 
   void test_set( void ) {
@@ -119,17 +162,17 @@ public:
     assert_true(v.is_empty());
     v.set(m);
     assert_true(v.is_midi());
-    assert_equal(32, v.midi_message_->note());
+    assert_equal(32, v.midi_message().note());
     m.set_note(60);
     // was copied
-    assert_equal(32, v.midi_message_->note());
+    assert_equal(32, v.midi_message().note());
   }
 
   void test_set_type_tag( void ) {
     Value v;
     v.set_type_tag("m");
     assert_true(v.is_midi());
-    assert_equal(NoteOn, v.midi_message_->type());
+    assert_equal(NoteOn, v.midi_message().type());
   }
 
   void test_set_type( void ) {
@@ -137,7 +180,7 @@ public:
 
     v.set_type(MIDI_VALUE);
     assert_true(v.is_midi());
-    assert_equal(NoteOn, v.midi_message_->type());
+    assert_equal(NoteOn, v.midi_message().type());
   }
 
   void test_to_json( void ) {
@@ -153,11 +196,11 @@ public:
   void test_from_json( void ) {
     Value v(Json("{\"=m\":[147, 60, 80, 400]}"));
     assert_true(v.is_midi());
-    assert_equal(NoteOn, v.midi_message_->type());
-    assert_equal(60,  v.midi_message_->note());
-    assert_equal(4,   v.midi_message_->channel());
-    assert_equal(80,  v.midi_message_->velocity());
-    assert_equal(400, v.midi_message_->length());
+    assert_equal(NoteOn, v.midi_message().type());
+    assert_equal(60,  v.midi_message().note());
+    assert_equal(4,   v.midi_message().channel());
+    assert_equal(80,  v.midi_message().velocity());
+    assert_equal(400, v.midi_message().length());
   }
 
   void test_can_receive( void ) {
@@ -57,13 +57,19 @@ public:
 
   virtual void listen() {
     log("listen");
-    thread_ready();
+    bool ready = false;
     while (should_run()) {
       lock();
         log(".");
       unlock();
+      if (!ready) {
+        // first loop logged: tests can check "[osc: listen][osc: .]"
+        thread_ready();
+        ready = true;
+      }
       millisleep(20);
     }
+    if (!ready) thread_ready();
   }
 
   virtual void notify_observers(const char *path, const Value &val) {
@@ -96,7 +102,7 @@ public:
     return res;
   }
 
-  const std::list<Location> &observers() const {
+  std::list<Location> observers() {
     return Command::observers();
   }
 
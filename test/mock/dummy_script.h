@@ -36,6 +36,10 @@
 class DummyScript : public Script {
 public:
   DummyScript() {}
+
+  virtual ~DummyScript() {
+    stop_watching_script();
+  }
   
   virtual const Value eval_script() {
     size_t pos = script_.find("compilation error");
@@ -48,6 +52,10 @@ public:
   void reload_script(time_t current_time) {
     this->Script::reload_script(current_time);
   }
+
+  void watch_script_file() {
+    this->Script::watch_script_file();
+  }
 };
 
 #endif // OSCIT_TEST_MOCK_DUMMY_SCRIPT_H_
\ No newline at end of file
@@ -60,7 +60,7 @@ public:
     }
   }
 
-  time_t latency() const {
+  Real latency() const {
     return latency_;
   }
 
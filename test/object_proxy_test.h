@@ -89,8 +89,10 @@ public:
     CommandLogger cmd("osc", &logger);
     RootProxy *proxy = cmd.adopt_proxy(new RootProxy(Location("osc", "funky synth")));
     ObjectProxyLogger *obj = proxy->adopt(new ObjectProxyLogger("seven", Oscit::range_io("the sky is blue", 0.0, 2000.0), &logger));
+    proxy->flush_queries();
     logger.str("");
     obj->sync_children();
+    proxy->flush_queries();
     assert_equal("[osc: send osc://\"funky synth\" /.list_att \"/seven\"]", logger.str());
   }
 
@@ -98,11 +100,40 @@ public:
     Logger logger;
     CommandLogger cmd("osc", &logger);
     RootProxy *proxy = cmd.adopt_proxy(new RootProxy(Location("osc", "funky synth")));
+    proxy->flush_queries();
     logger.str("");
     proxy->adopt(new ObjectProxy("seven", gNilValue));
+    proxy->flush_queries();
     assert_equal("[osc: send osc://\"funky synth\" /.attr \"/seven\"]", logger.str());
   }
 
+  void test_should_batch_queries( void ) {
+    Logger logger;
+    CommandLogger cmd("osc", &logger);
+    RootProxy *proxy = cmd.adopt_proxy(new RootProxy(Location("osc", "funky synth")));
+    proxy->flush_queries();
+    logger.str("");
+    proxy->adopt(new ObjectProxy("one", gNilValue));
+    proxy->adopt(new ObjectProxy("two", gNilValue));
+    assert_equal("", logger.str());
+    // sent after ROOT_PROXY_BATCH_WINDOW
+    millisleep(ROOT_PROXY_BATCH_WINDOW + 20);
+    assert_equal("[osc: send osc://\"funky synth\" /.attr [\"/one\", \"/two\"]]", logger.str());
+  }
+
+  void test_should_send_full_pages_of_queries( void ) {
+    Logger logger;
+    CommandLogger cmd("osc", &logger);
+    RootProxy *proxy = cmd.adopt_proxy(new RootProxy(Location("osc", "funky synth")));
+    proxy->flush_queries();
+    logger.str("");
+    for (int i = 0; i < ROOT_PROXY_BATCH_SIZE; ++i) {
+      proxy->query(ATTRS_PATH, "/foo");
+    }
+    // does not wait for the window
+    assert_true(logger.str().find("/.attr [\"/foo\", ") != std::string::npos);
+  }
+
   void test_new_object_with_type_should_try_to_find_initial_value( void ) {
     Logger logger;
     CommandLogger cmd("osc", &logger);
@@ -244,6 +244,41 @@ public:
     assert_equal("[\"one\", \"two\", \"last\", \"last2\"]", base.list().to_json());
   }
 
+  void test_get_child_in_large_container( void ) {
+    Object base("base");
+    ObjectHandle handle;
+    Object *children[40];
+    char name[10];
+    // past OBJECT_CHILDREN_INDEX_THRESHOLD
+    for (int i = 0; i < 40; ++i) {
+      snprintf(name, 10, "x%i", i);
+      children[i] = base.adopt(new Object(name));
+    }
+    assert_equal(40, base.children_count());
+    assert_true(base.get_child("x0", &handle));
+    assert_equal("base/x0", handle->url());
+    assert_true(base.get_child("x39", &handle));
+
+    // names stay unique
+    Object *dup = base.adopt(new Object("x12"));
+    assert_equal("x12-1", dup->name());
+
+    // rename
+    dup->set_name("foo");
+    assert_false(base.get_child("x12-1", &handle));
+    assert_true(base.get_child("foo", &handle));
+    assert_equal("base/foo", handle->url());
+
+    // remove
+    children[5]->release();
+    assert_false(base.get_child("x5", &handle));
+    assert_equal(40, base.children_count());
+    assert_true(base.get_child(4, &handle));
+    assert_equal("x4", handle->name());
+    assert_true(base.get_child(5, &handle));
+    assert_equal("x6", handle->name());
+  }
+
   void test_to_hash_should_list_children( void ) {
     Object base("base");
     base.adopt(new DummyObject("legs", 100));
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/observer_leases.h"
+
+class ObserverLeasesTest : public TestHelper
+{
+public:
+  void test_renew( void ) {
+    ObserverLeases leases;
+    assert_true(leases.renew(Location("oscit", "one")));
+    assert_true(leases.renew(Location("oscit", "two")));
+    assert_false(leases.renew(Location("oscit", "one")));
+    assert_equal(2, leases.count());
+    assert_equal("one", leases.observers().front().name());
+  }
+
+  void test_touch( void ) {
+    ObserverLeases leases;
+    assert_false(leases.touch(Location("oscit", "one")));
+    assert_equal(0, leases.count());
+    leases.renew(Location("oscit", "one"));
+    assert_true(leases.touch(Location("oscit", "one")));
+  }
+
+  void test_remove( void ) {
+    ObserverLeases leases;
+    leases.renew(Location("oscit", "one"));
+    leases.remove(Location("oscit", "one"));
+    assert_equal(0, leases.count());
+  }
+
+  void test_evict_after_failed_sends( void ) {
+    ObserverLeases leases(OBSERVER_LEASE_TTL, 2);
+    Location one("oscit", "one");
+    leases.renew(one);
+    assert_false(leases.send_failed(one));
+    // traffic from the observer clears failures
+    leases.renew(one);
+    assert_false(leases.send_failed(one));
+    assert_true(leases.send_failed(one));
+    assert_equal(0, leases.count());
+    assert_equal(1, leases.evicted_count());
+    // unknown
+    assert_false(leases.send_failed(one));
+  }
+
+  void test_subscribe( void ) {
+    ObserverLeases leases;
+    Location all("oscit", "all");
+    Location synth("oscit", "synth");
+    std::vector<std::string> prefixes;
+    prefixes.push_back("/synth/");
+    prefixes.push_back("/synth/voice1");
+    leases.renew(all);
+    assert_true(leases.subscribe(synth, prefixes));
+
+    std::list<Location> observers;
+    leases.observers_of("/synth/voice1/gain", &observers);
+    assert_equal(2, observers.size());
+    assert_equal("all", observers.front().name());
+    assert_equal("synth", observers.back().name());
+
+    observers.clear();
+    leases.observers_of("/synthesis", &observers);
+    assert_equal(1, observers.size());
+
+    // "/" is for all paths
+    prefixes.clear();
+    prefixes.push_back("/");
+    assert_false(leases.subscribe(synth, prefixes));
+    observers.clear();
+    leases.observers_of("/mixer", &observers);
+    assert_equal(2, observers.size());
+  }
+
+  void test_remove_subscriber( void ) {
+    ObserverLeases leases;
+    Location synth("oscit", "synth");
+    std::vector<std::string> prefixes;
+    prefixes.push_back("/synth");
+    leases.subscribe(synth, prefixes);
+    leases.remove(synth);
+    std::list<Location> observers;
+    leases.observers_of("/synth", &observers);
+    assert_equal(0, observers.size());
+    assert_equal(0, leases.count());
+  }
+
+  void test_expire( void ) {
+    ObserverLeases leases(30);
+    leases.renew(Location("oscit", "one"));
+    leases.renew(Location("oscit", "two"));
+    millisleep(15);
+    leases.renew(Location("oscit", "two"));
+    millisleep(25);
+    // one expired, two renewed
+    assert_equal(1, leases.count());
+    assert_equal("two", leases.observers().front().name());
+    assert_equal(1, leases.expired_count());
+    millisleep(30);
+    assert_equal(0, leases.count());
+    assert_equal(2, leases.expired_count());
+    assert_equal(0, leases.evicted_count());
+  }
+
+  void test_set_ttl( void ) {
+    ObserverLeases leases;
+    leases.set_ttl(20);
+    leases.renew(Location("oscit", "one"));
+    millisleep(40);
+    assert_equal(0, leases.count());
+  }
+
+  void test_on_remove( void ) {
+    ObserverLeases leases(20, 1);
+    removed_.clear();
+    leases.set_on_remove(record_removed, this);
+    leases.renew(Location("oscit", "one"));
+    leases.renew(Location("oscit", "two"));
+    leases.renew(Location("oscit", "three"));
+    leases.remove(Location("oscit", "one"));
+    leases.send_failed(Location("oscit", "two"));
+    millisleep(40);
+    assert_equal("one,two,three,", removed_);
+
+    leases.set_on_remove(NULL, NULL);
+    leases.renew(Location("oscit", "four"));
+    leases.remove(Location("oscit", "four"));
+    assert_equal("one,two,three,", removed_);
+  }
+
+private:
+  static void record_removed(void *data, const Location &location) {
+    ((ObserverLeasesTest*)data)->removed_.append(location.name()).append(",");
+  }
+
+  std::string removed_;
+};
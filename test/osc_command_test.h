@@ -32,6 +32,7 @@
 #include "mock/object_logger.h"
 #include "oscit/list_meta_method.h"
 #include "oscit/list_with_attributes_meta_method.h"
+#include "oscit/tree_meta_method.h"
 
 #include "mock/dummy_object.h"
 #include "mock/osc_command_logger.h"
@@ -44,7 +45,8 @@ class OscCommandTest : public TestHelper
     SENDER_PORT   = 7015
   };
 
-  OscCommandTest() : remote_end_point_(Location::LOOPBACK, RECEIVER_PORT) {
+  OscCommandTest() : remote_end_point_(Location::LOOPBACK, RECEIVER_PORT),
+                     remote_location_("osc", Location::LOOPBACK, RECEIVER_PORT) {
     remote_.adopt_command(new OscCommandLogger(RECEIVER_PORT, "receiver", &reply_));
 
     sender_ = local_.adopt_command(new OscCommandLogger(SENDER_PORT, "sender", &reply_));
@@ -147,6 +149,47 @@ class OscCommandTest : public TestHelper
     assert_equal("[\"/foo\", {\"=m\":[147, 67, 100, 100]}]\n", reply());
   }
 
+  void test_send_receive_midi_type_tag( void ) {
+    DummyObject * foo = remote_.adopt(new DummyObject("foo", "{\"=m\":[147, 60, 80, 400]}", Oscit::midi_io("Info")));
+
+    Value ctrl;
+    ctrl.set_as_ctrl(7, 100, 2);
+    send("/foo", ctrl);
+    assert_equal("{\"=m\":[177, 7, 100, 0]}", foo->value_.to_json());
+    assert_equal("[\"/foo\", {\"=m\":[177, 7, 100, 0]}]\n", reply());
+  }
+
+  void test_send_receive_sysex( void ) {
+    DummyObject * foo = remote_.adopt(new DummyObject("foo", "{\"=m\":[147, 60, 80, 400]}", Oscit::midi_io("Info")));
+
+    unsigned char sysex[] = {0xf0, 0x43, 0x12, 0x00, 0x01, 0x02, 0xf7};
+    MidiMessage msg;
+    msg.set(sysex, 7);
+    send("/foo", MidiValue(msg));
+    assert_equal("{\"=m\":[240, 67, 18, 0, 1, 2, 247, 0]}", foo->value_.to_json());
+  }
+
+  void test_send_receive_midi_batch( void ) {
+    DummyObject * foo = remote_.adopt(new DummyObject("foo", "null", Oscit::any_io("Info")));
+
+    Value batch;
+    MidiMessage msg;
+    for (int i = 0; i < 3; ++i) {
+      msg.set_as_ctrl(7, 100 + i, 1, i * 10);
+      batch.push_back(MidiValue(msg));
+    }
+    send("/foo", batch);
+    assert_equal("[{\"=m\":[176, 7, 100, 0]}, {\"=m\":[176, 7, 101, 0]}, {\"=m\":[176, 7, 102, 0]}]", foo->value_.to_json());
+    assert_equal(20, foo->value_[2].midi_message().wait());
+
+    // nested list
+    Value nested;
+    nested.set_type(LIST_VALUE);
+    nested.push_back(batch);
+    send("/foo", nested);
+    assert_equal("[[{\"=m\":[176, 7, 100, 0]}, {\"=m\":[176, 7, 101, 0]}, {\"=m\":[176, 7, 102, 0]}]]", foo->value_.to_json());
+  }
+
   // ================================================================= Any
   void test_send_receive_any( void ) {
     DummyObject * foo = remote_.adopt(new DummyObject("foo", "null", Oscit::any_io("Info")));
@@ -165,6 +208,44 @@ class OscCommandTest : public TestHelper
     assert_equal("[\"/foo\", [1.5, -3.2, \"bar\", [\"a\", \"b\", [1, 2]]]]\n", reply());
   }
 
+  // ================================================================= call_async
+  void test_call_async_should_receive_reply( void ) {
+    DummyObject * foo = remote_.adopt(new DummyObject("foo", 1.25));
+
+    RemoteCall *call = local_.call_async(Url(remote_location_, "/foo"), Value(3.5));
+    assert_equal(3.5, call->wait().r);
+    assert_equal(3.5, foo->real());
+    call->release();
+  }
+
+  void test_call_async_should_pipeline_requests( void ) {
+    remote_.adopt(new DummyObject("foo", 1.25));
+    remote_.adopt(new DummyObject("bar", 2.5));
+
+    RemoteCall *foo = local_.call_async(Url(remote_location_, "/foo"), gNilValue);
+    RemoteCall *bar = local_.call_async(Url(remote_location_, "/bar"), gNilValue);
+    assert_equal(2.5, bar->wait().r);
+    assert_equal(1.25, foo->wait().r);
+    assert_equal(0, sender_->remote_calls().pending());
+    foo->release();
+    bar->release();
+  }
+
+  void test_call_async_should_receive_error( void ) {
+    RemoteCall *call = local_.call_async(Url(remote_location_, "/missing"), gNilValue);
+    Value res = call->wait();
+    assert_true(res.is_error());
+    assert_equal(NOT_FOUND_ERROR, res.error_code());
+    call->release();
+  }
+
+  void test_call_async_should_time_out( void ) {
+    // nobody listening
+    RemoteCall *call = local_.call_async(Url(Location("osc", Location::LOOPBACK, 7019), "/foo"), gNilValue, 30);
+    assert_equal(REQUEST_TIMEOUT_ERROR, call->wait().error_code());
+    call->release();
+  }
+
   // ================================================================= /.list meta method
 
   void test_send_receive_list_meta_method( void ) {
@@ -187,6 +268,64 @@ class OscCommandTest : public TestHelper
     assert_equal("[\"/.list\", [\"/monitor\", []]]\n", reply());
   }
 
+  void test_send_receive_tree_in_chunks( void ) {
+    // remote_ objects are cleared before each run
+    remote_.adopt(new TreeMetaMethod(Url(TREE_PATH).name()));
+    Object * tmp = remote_.adopt(new Object("bank"));
+    std::ostringstream name;
+    for (int i = 0; i < TREE_CHUNK_SIZE + 2; ++i) {
+      name.str("");
+      name << "v" << i;
+      tmp->adopt(new Object(name.str()));
+    }
+
+    send(TREE_PATH, "/bank");
+    millisleep(20);
+    std::string replies = reply();
+    // two chunks, the first one ends with 'true'
+    assert_equal(0, replies.find("[\"/.tree\", [\"/bank\", [\"v0\", "));
+    assert_true(replies.find("], true]]\n[\"/.tree\", [\"/bank\", [\"v128\", \"v129\"]]]\n") != std::string::npos);
+  }
+
+  void test_adopt_tree_notifies_observers_in_pages( void ) {
+    // about 20 KB of urls: more than an OSC packet
+    Object *patch = new Object("patch");
+    std::ostringstream name;
+    for (int i = 0; i < 400; ++i) {
+      name.str("");
+      name << "a_long_name_that_fills_the_osc_buffer_" << i;
+      patch->adopt(new Object(name.str()));
+    }
+    // sender_ is an observer of remote_
+    sender_->clear_replies();
+    remote_.adopt_tree(patch);
+    std::string replies = reply();
+    size_t page_count = 0;
+    for (size_t pos = replies.find("[\"/.attr\", "); pos != std::string::npos;
+         pos = replies.find("[\"/.attr\", ", pos + 1)) {
+      ++page_count;
+    }
+    assert_true(page_count > 1);
+    assert_equal(0, replies.find("[\"/.attr\", [\"/patch\", null, \"/patch/a_long_name_that_fills_the_osc_buffer_0\", null, "));
+    assert_true(replies.find("\"/patch/a_long_name_that_fills_the_osc_buffer_399\", null]]\n") != std::string::npos);
+  }
+
+  void test_expired_observers_leave_the_send_queue( void ) {
+    Root root;
+    OscCommand *cmd = root.adopt_command(new OscCommand(7021));
+    Location observer("osc", Location::LOOPBACK, 7099);
+    cmd->observer_leases().set_ttl(20);
+    cmd->observer_leases().renew(observer);
+    cmd->notify_observers("/foo", Value(1.0));
+    assert_true(cmd->send_queue_stats()["observers"]["127.0.0.1:7099"].is_hash());
+
+    millisleep(40);
+    assert_equal(0, cmd->observer_leases().count());
+    Value stats(cmd->send_queue_stats());
+    assert_equal(0.0, stats["pending"].r);
+    assert_equal("{}", stats["observers"].to_json());
+  }
+
   void test_send_receive_list_with_attributes( void ) {
     // remote_ objects are cleared before each run
     remote_.adopt(new ListWithOscitsMetaMethod(Url(LIST_WITH_ATTRIBUTES_PATH).name()));
@@ -222,6 +361,7 @@ class OscCommandTest : public TestHelper
 
   Logger logger_;
   Location remote_end_point_;
+  Location remote_location_;
   Logger reply_;
   Root remote_;
   Root local_;
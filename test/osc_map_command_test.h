@@ -71,6 +71,44 @@ class OscMapCommandTest : public TestHelper
     assert_equal("0.5\n", slider_one());
   }
 
+  void test_received_list_should_map_to_several_targets( void ) {
+    DummyObject * cutoff = app1_.adopt(new DummyObject("cutoff", 1.0));
+    DummyObject * res    = app1_.adopt(new DummyObject("res", 1.0));
+    Value reply = map_cmd_->script(Value("/pad[0] [0,1] --> /cutoff [10,20]\n/pad[1] [0,1] --> /res [0,100]"));
+    assert_false(reply.is_error());
+    Value pad;
+    pad.push_back(0.5).push_back(0.25);
+    send("/pad", pad);
+    assert_equal(15.0, cutoff->real());
+    assert_equal(25.0, res->real());
+  }
+
+  void test_script_file_change_should_swap_mappings( void ) {
+    DummyObject * foo = app1_.adopt(new DummyObject("foo", 1.0));
+    std::string map_file(fixture_path("osc_map_command_test.map"));
+    std::ofstream out(map_file.c_str(), std::ios::out);
+      out << "/slider/1 [0,1] --> /foo [10,20]";
+    out.close();
+
+    Value res = map_cmd_->file(Value(map_file));
+    assert_false(res.is_error());
+    send("/slider/1", 0.5);
+    assert_equal(15.0, foo->real());
+    assert_equal("0.5\n", slider_one());
+
+    out.open(map_file.c_str(), std::ios::out);
+      out << "/slider/1 [0,1] --> /foo [0,100]";
+    out.close();
+    millisleep(200);
+
+    send("/slider/1", 0.5);
+    assert_equal(50.0, foo->real());
+    assert_equal("0.5\n", slider_one());
+
+    map_cmd_->file(Value(""));
+    remove(map_file.c_str());
+  }
+
   void test_notifications_should_reverse_map( void ) {
     app1_.adopt(new DummyObject("foo", 1.0));
     Value res = map_cmd_->script(Value("/slider/1 [0,1] --> /foo [10,20]"));
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include "test_helper.h"
+#include "oscit/remote_call.h"
+
+class RemoteCallTest : public TestHelper
+{
+public:
+  RemoteCallTest() : remote_(Location::LOOPBACK, 7020) {}
+
+  void test_complete( void ) {
+    RemoteCalls calls;
+    RemoteCall *call = new RemoteCall;
+    uint32_t id = calls.start(remote_, call);
+    assert_equal(1, calls.pending());
+    assert_false(call->is_done());
+
+    assert_true(calls.complete(remote_, id, Value(1.5)));
+    assert_true(call->is_done());
+    assert_equal(1.5, call->wait().r);
+    assert_equal(0, calls.pending());
+    // late reply
+    assert_false(calls.complete(remote_, id, Value(2.0)));
+    call->release();
+  }
+
+  void test_ignore_reply_from_other_port( void ) {
+    RemoteCalls calls;
+    RemoteCall *call = new RemoteCall;
+    uint32_t id = calls.start(remote_, call);
+    assert_false(calls.complete(Location(Location::LOOPBACK, 7021), id, Value(1.5)));
+    assert_false(call->is_done());
+    call->release();
+  }
+
+  void test_ignore_reply_from_other_host( void ) {
+    RemoteCalls calls;
+    RemoteCall *call = new RemoteCall;
+    uint32_t id = calls.start(remote_, call);
+    // same port on another host
+    assert_false(calls.complete(Location((10<<24) + 7, 7020), id, Value(1.5)));
+    assert_false(call->is_done());
+    assert_true(calls.complete(Location("osc", Location::LOOPBACK, 7020), id, Value(1.5)));
+    call->release();
+  }
+
+  void test_many_calls_in_flight( void ) {
+    RemoteCalls calls;
+    RemoteCall *first  = new RemoteCall;
+    RemoteCall *second = new RemoteCall;
+    uint32_t first_id  = calls.start(remote_, first);
+    uint32_t second_id = calls.start(remote_, second);
+    assert_false(first_id == second_id);
+    assert_equal(2, calls.pending());
+
+    // replies out of order
+    calls.complete(remote_, second_id, Value("two"));
+    calls.complete(remote_, first_id, Value("one"));
+    assert_equal("one", first->result().str());
+    assert_equal("two", second->result().str());
+    first->release();
+    second->release();
+  }
+
+  void test_timeout( void ) {
+    RemoteCalls calls;
+    RemoteCall *call = new RemoteCall;
+    calls.start(remote_, call, 20);
+    Value res = call->wait();
+    assert_true(res.is_error());
+    assert_equal(REQUEST_TIMEOUT_ERROR, res.error_code());
+    assert_equal(0, calls.pending());
+    assert_equal(1, calls.timeout_count());
+    call->release();
+  }
+
+  void test_fail( void ) {
+    RemoteCalls calls;
+    RemoteCall *call = new RemoteCall;
+    uint32_t id = calls.start(remote_, call);
+    assert_true(calls.fail(id, ErrorValue(NOT_FOUND_ERROR, "gone")));
+    assert_equal(NOT_FOUND_ERROR, call->result().error_code());
+    call->release();
+  }
+
+  void test_callback( void ) {
+    RemoteCalls calls;
+    TRemoteCall<RemoteCallTest, &RemoteCallTest::done> *call =
+      new TRemoteCall<RemoteCallTest, &RemoteCallTest::done>(this);
+    uint32_t id = calls.start(remote_, call);
+    calls.complete(remote_, id, Value(3.0));
+    assert_equal("3", result_.to_json());
+    call->release();
+  }
+
+  void test_delete_completes_pending_calls( void ) {
+    RemoteCall *call = new RemoteCall;
+    { RemoteCalls calls;
+      calls.start(remote_, call);
+    }
+    assert_true(call->is_done());
+    assert_true(call->result().is_error());
+    call->release();
+  }
+
+  void done(const Value &result) {
+    result_ = result;
+  }
+
+private:
+  Location remote_;
+  Value result_;
+};
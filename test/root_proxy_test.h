@@ -46,8 +46,68 @@ public:
     CommandLogger *cmd = root.adopt_command(new CommandLogger("oscit", &logger));
     assert_equal("[oscit: listen][oscit: .]", logger.str());
     logger.str("");
-    cmd->adopt_proxy(factory.build_and_init_root_proxy(location));
-    assert_equal("[factory: build_root_proxy oscit://\"my place\"][oscit: send oscit://\"my place\" /.register null][oscit: send oscit://\"my place\" /.list_att \"\"]", logger.str());
+    RootProxy *proxy = cmd->adopt_proxy(factory.build_and_init_root_proxy(location));
+    // queries are sent after ROOT_PROXY_BATCH_WINDOW
+    proxy->flush_queries();
+    assert_equal("[factory: build_root_proxy oscit://\"my place\"][oscit: send oscit://\"my place\" /.register null][oscit: send oscit://\"my place\" /.changes null][oscit: send oscit://\"my place\" /.list_att \"\"]", logger.str());
+  }
+
+  void should_only_fetch_changes_when_connected_again( void ) {
+    Root root;
+    Logger logger;
+    ProxyFactoryLogger factory("factory", &logger);
+    Location location("oscit", "my place");
+    CommandLogger *cmd = root.adopt_command(new CommandLogger("oscit", &logger));
+    RootProxy *proxy = cmd->adopt_proxy(factory.build_and_init_root_proxy(location));
+    proxy->flush_queries();
+    proxy->handle_reply(std::string(CHANGES_PATH), Value("42"));
+
+    proxy->detach();
+    logger.str("");
+    cmd->adopt_proxy(proxy);
+    proxy->flush_queries();
+    assert_equal("[oscit: send oscit://\"my place\" /.register null][oscit: send oscit://\"my place\" /.changes \"42\"]", logger.str());
+  }
+
+  void should_renew_registration_before_the_lease_expires( void ) {
+    Root root;
+    Logger logger;
+    ProxyFactoryLogger factory("factory", &logger);
+    Location location("oscit", "my place");
+    CommandLogger *cmd = root.adopt_command(new CommandLogger("oscit", &logger));
+    RootProxy *proxy = factory.build_and_init_root_proxy(location);
+    // remote with a short lease
+    proxy->set_register_interval(20);
+    cmd->adopt_proxy(proxy);
+    Thread::millisleep(75);
+    // stop renewals while we read the log
+    proxy->set_register_interval(100000);
+
+    std::string log(logger.str());
+    size_t count = 0;
+    for (size_t pos = log.find("/.register"); pos != std::string::npos; pos = log.find("/.register", pos + 1)) {
+      ++count;
+    }
+    // first registration + renewals
+    assert_true(count >= 3);
+  }
+
+  void should_fetch_changes_while_connected( void ) {
+    Root root;
+    Logger logger;
+    ProxyFactoryLogger factory("factory", &logger);
+    Location location("oscit", "my place");
+    CommandLogger *cmd = root.adopt_command(new CommandLogger("oscit", &logger));
+    RootProxy *proxy = factory.build_and_init_root_proxy(location);
+    proxy->set_register_interval(20);
+    cmd->adopt_proxy(proxy);
+    proxy->handle_reply(std::string(CHANGES_PATH), Value("4f2a01c3:42"));
+    logger.str("");
+    Thread::millisleep(35);
+    proxy->set_register_interval(100000);
+
+    // renewals keep our version recent
+    assert_true(logger.str().find("/.changes \"4f2a01c3:42\"") != std::string::npos);
   }
 
   void test_route_reply_messages_to_object_proxies( void ) {
@@ -87,4 +147,65 @@ public:
     assert_equal(object->type(), gNilValue);
     assert_equal("", logger.str());
   }
+
+  void should_set_attributes_from_aggregated_attrs_reply( void ) {
+    RootProxy proxy(Location("osc", "funky synth"));
+    Logger logger;
+    ProxyFactoryLogger factory("factory", &logger);
+    proxy.set_proxy_factory(&factory);
+
+    Value reply(std::string("/one"));
+    reply.push_back(Oscit::range_io("one", 0.0, 1.0));
+    reply.push_back(std::string("/two"));
+    reply.push_back(Oscit::range_io("two", 0.0, 5.0));
+    proxy.handle_reply(std::string(ATTRS_PATH), reply);
+
+    ObjectHandle object;
+    assert_true(proxy.get_object_at("/one", &object));
+    assert_equal("one", object->attributes()[Oscit::INFO].str());
+    object = NULL;
+    assert_true(proxy.get_object_at("/two", &object));
+    assert_equal("two", object->attributes()[Oscit::INFO].str());
+  }
+
+  void should_build_children_from_aggregated_list_with_attributes_reply( void ) {
+    RootProxy proxy(Location("osc", "funky synth"));
+    Logger logger;
+    ProxyFactoryLogger factory("factory", &logger);
+    proxy.set_proxy_factory(&factory);
+    proxy.adopt(new ObjectProxy("one", Oscit::range_io("one", 0.0, 1.0)));
+    proxy.adopt(new ObjectProxy("two", Oscit::range_io("two", 0.0, 1.0)));
+
+    proxy.handle_reply(std::string(LIST_WITH_ATTRIBUTES_PATH),
+      JsonValue("[\"/one\", [\"a\", {}], \"/two\", [\"b\", {}]]"));
+
+    ObjectHandle object;
+    assert_true(proxy.get_object_at("/one/a", &object));
+    object = NULL;
+    assert_true(proxy.get_object_at("/two/b", &object));
+  }
+
+  void should_apply_changes_from_journal_reply( void ) {
+    RootProxy proxy(Location("osc", "funky synth"));
+    Logger logger;
+    ProxyFactoryLogger factory("factory", &logger);
+    proxy.set_proxy_factory(&factory);
+    proxy.adopt(new ObjectProxy("one", Oscit::range_io("one", 0.0, 1.0)));
+    proxy.adopt(new ObjectProxy("two", Oscit::range_io("two", 0.0, 1.0)));
+
+    Value changes;
+    changes.set_type(LIST_VALUE);
+    changes.push_back("adopt").push_back("/one/a").push_back(Oscit::range_io("a", 0.0, 1.0));
+    changes.push_back("attrs").push_back("/two").push_back(Oscit::range_io("deux", 0.0, 5.0));
+    changes.push_back("remove").push_back("/one").push_back(gNilValue);
+    Value reply("43");
+    reply.push_back(changes);
+    proxy.handle_reply(std::string(CHANGES_PATH), reply);
+
+    ObjectHandle object;
+    assert_false(proxy.get_object_at("/one", &object));
+    assert_false(proxy.get_object_at("/one/a", &object));
+    assert_true(proxy.get_object_at("/two", &object));
+    assert_equal("deux", object->attributes()[Oscit::INFO].str());
+  }
 };
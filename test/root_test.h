@@ -35,6 +35,53 @@
 #include "mock/object_logger.h"
 #include "mock/command_logger.h"
 
+/** Command with a slow 'send' logging its destruction.
+ */
+class SlowCommandLogger : public CommandLogger {
+public:
+  SlowCommandLogger(std::ostringstream *stream) : CommandLogger("slow", stream) {}
+
+  ~SlowCommandLogger() {
+    log("deleted");
+  }
+
+  virtual void send_message(const Location &remote_endpoint, const char *path, const Value &val) {
+    millisleep(30);
+    CommandLogger::send_message(remote_endpoint, path, val);
+  }
+};
+
+/** Calls an object from a strand task.
+ */
+class RootCallTask : public StrandTask {
+public:
+  RootCallTask(Root *root, const char *path, Value *result)
+      : root_(root), path_(path), result_(result) {}
+
+  virtual void run() {
+    *result_ = root_->call(path_, Value(5.0));
+  }
+
+  Root *root_;
+  const char *path_;
+  Value *result_;
+};
+
+/** Keeps a strand busy.
+ */
+class BusyTask : public StrandTask {
+public:
+  virtual void run() {
+    Thread::millisleep(30);
+  }
+};
+
+static void send_to_slow_command(Thread *runner) {
+  Root *root = (Root*)runner->parameter_;
+  runner->thread_ready();
+  root->send(Location("slow", "this place"), "/foo", gNilValue);
+}
+
 class RootTest : public TestHelper
 {
 public:
@@ -277,6 +324,76 @@ public:
     assert_equal("[one: send osc://\"some place\" /foo/bar null]", logger.str());
   }
 
+  void should_forget_unregistered_commands( void ) {
+    Root root;
+    Logger logger;
+    CommandLogger *osc = root.adopt_command(new CommandLogger("osc", &logger), false);
+    root.adopt_command(new CommandLogger("http", &logger), false);
+    assert_equal((Command*)osc, root.command_for_protocol("osc"));
+    delete osc;
+    assert_equal((Command*)NULL, root.command_for_protocol("osc"));
+    logger.str("");
+    root.send(Location("http", "this place"), "/foo/bar", gNilValue);
+    assert_equal("[http: send http://\"this place\" /foo/bar null]", logger.str());
+    // can adopt a new command for the protocol
+    assert_true(root.adopt_command(new CommandLogger("osc", &logger), false) != NULL);
+  }
+
+  void should_call_objects_in_their_strand( void ) {
+    Strand strand;
+    Root root;
+    DummyObject *foo = root.adopt(new DummyObject("foo", 1.0));
+    DummyObject *bar = foo->adopt(new DummyObject("bar", 2.0));
+    foo->set_strand(&strand);
+    assert_equal(&strand, bar->strand());
+    assert_equal((Strand*)NULL, root.strand());
+
+    assert_equal(3.0, root.call("/foo/bar", Value(3.0)).r);
+    assert_true(root.post("/foo/bar", Value(4.0)));
+    strand.wait();
+    assert_equal(4.0, bar->real());
+    assert_false(root.post("/baz", Value(4.0)));
+
+    // moved out of the subtree
+    DummyObject *baz = root.adopt(new DummyObject("baz", 1.0));
+    baz->adopt(bar);
+    assert_equal((Strand*)NULL, bar->strand());
+  }
+
+  void should_return_an_error_when_a_call_is_posted( void ) {
+    Executor executor(2);
+    Strand one(&executor);
+    Strand two(&executor);
+    Root root;
+    DummyObject *foo = root.adopt(new DummyObject("foo", 1.0));
+    foo->set_strand(&two);
+    Value result;
+
+    two.post(new BusyTask);
+    millisleep(10);
+    one.post(new RootCallTask(&root, "/foo", &result));
+    one.wait();
+    // 'two' was busy: the call was posted
+    assert_true(result.is_error());
+    assert_equal(ACCEPTED_ERROR, result.error_code());
+    assert_equal("posted, result unavailable", result.error_message());
+    two.wait();
+    assert_equal(5.0, foo->real());
+  }
+
+  void should_wait_for_sends_before_deleting_commands( void ) {
+    Root root;
+    Logger logger;
+    root.adopt_command(new SlowCommandLogger(&logger), false);
+    Thread runner;
+    runner.start_thread(send_to_slow_command, &root);
+    millisleep(10);
+    // the sender is inside the command
+    root.clear();
+    assert_equal("[slow: send slow://\"this place\" /foo null][slow: deleted]", logger.str());
+    runner.join();
+  }
+
   void test_named_root( void ) {
     Root root("gaia");
     ObjectHandle object;
@@ -300,7 +417,7 @@ public:
     root.adopt(new DummyObject("tint", 45.0, Oscit::range_io("This is a slider from 1 to 127.", 1, 127)));
     Value res = root.list_with_attributes();
     // .error, .info, etc are ignored (current value -- type mismatch)
-    assert_equal("sHsHsHsHsHsHsHsH", res.type_tag());
+    assert_equal("sHsHsHsHsHsHsHsHsH", res.type_tag());
     assert_equal(".error", res[0].str());
     assert_equal(".info", res[2].str());
   }
@@ -349,6 +466,36 @@ public:
     assert_equal("[observer: \"/foo/bar\"]", logger.str());
   }
 
+  void should_register_adopted_tree( void ) {
+    Root root(false);
+    Logger logger;
+    ObserverLogger observer("observer", &logger);
+    root.on_register_connect(std::string("/patch/b/c"), &observer, &ObserverLogger::event);
+    root.adopt_command(new CommandLogger(&logger), false);
+
+    Object *patch = new Object("patch");
+    Object *b = patch->adopt(new Object("b"));
+    b->adopt(new Object("c"));
+    patch->adopt(new Object("d"));
+    assert_equal("", logger.str());
+
+    root.adopt_tree(patch);
+    // one notification
+    assert_equal("[observer: \"/patch/b/c\"][dummy: notify /.reply [\"/.attr\", [\"/patch\", null, \"/patch/b\", null, \"/patch/b/c\", null, \"/patch/d\", null]]]", logger.str());
+
+    ObjectHandle handle;
+    assert_true(root.get_object_at("/patch/b/c", &handle));
+    assert_equal("/patch/b/c", handle->url());
+    handle = NULL;
+    assert_true(root.get_object_at("/patch/d", &handle));
+    handle = NULL;
+
+    // moving the tree unregisters old urls
+    patch->set_name("other");
+    assert_false(root.get_object_at("/patch/b/c", &handle));
+    assert_true(root.get_object_at("/other/b/c", &handle));
+  }
+
   void should_expose_files_as_views( void ) {
     Root root(false);
     Value error;
@@ -46,4 +46,27 @@ public:
     assert_equal(0.0, mapper.scale(0));
     assert_equal(1.0, mapper.scale(100));
   }
-};
\ No newline at end of file
+
+  void test_map_inverted_target_should_clip( void ) {
+    ScaleReal mapper(0, 1, 10, 0);
+    assert_equal(7.5, mapper.scale(0.25));
+    assert_equal(10.0, mapper.scale(-1));
+    assert_equal(0.0, mapper.scale(2));
+  }
+
+  void test_scale_array( void ) {
+    ScaleReal mapper(1, 3, 0, 1);
+    Real source[] = {-12, 1, 2, 3, 100};
+    Real target[5];
+    mapper.scale(source, target, 5);
+    assert_equal(0.0, target[0]);
+    assert_equal(0.0, target[1]);
+    assert_equal(0.5, target[2]);
+    assert_equal(1.0, target[3]);
+    assert_equal(1.0, target[4]);
+
+    // in place
+    mapper.scale(source, source, 5);
+    assert_equal(0.5, source[2]);
+  }
+};
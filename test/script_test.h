@@ -171,6 +171,52 @@ public:
     remove(reload_file.c_str());
   }
 
+  void test_watched_file_should_reload( void ) {
+    DummyScript script;
+    std::string watched_file(fixture_path("script_test_watched.txt"));
+    std::ofstream out(watched_file.c_str(), std::ios::out);
+      out << "First version.";
+    out.close();
+
+    script.watch_script_file();
+    script.file(Value(watched_file));
+    assert_equal("First version.", script.script(gNilValue).str());
+
+    out.open(watched_file.c_str(), std::ios::out);
+      out << "Second version.";
+    out.close();
+    millisleep(200);
+    // no call to reload_script
+    assert_true(script.script_ok());
+    assert_equal("Second version.", script.script(gNilValue).str());
+
+    // replace file
+    std::string tmp_file(fixture_path("script_test_watched.tmp"));
+    out.open(tmp_file.c_str(), std::ios::out);
+      out << "Third version.";
+    out.close();
+    rename(tmp_file.c_str(), watched_file.c_str());
+    millisleep(200);
+    assert_equal("Third version.", script.script(gNilValue).str());
+
+    remove(watched_file.c_str());
+  }
+
+  void test_watched_file_should_save( void ) {
+    DummyScript script;
+    std::string watched_file(fixture_path("script_test_watched.txt"));
+    script.watch_script_file();
+    script.file(Value(watched_file));
+    assert_false(script.script_ok());
+
+    assert_equal("Saved content.", script.script(Value("Saved content.")).str());
+    millisleep(100);
+    assert_true(script.script_ok());
+    assert_equal("Saved content.", script.script(gNilValue).str());
+
+    remove(watched_file.c_str());
+  }
+
   void test_inspect( void ) {
     DummyScript script;
     std::string new_file(fixture_path("script_test_new_file.txt"));
@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/send_queue.h"
+#include "oscit/mutex.h"
+
+class SendQueueTest : public TestHelper
+{
+public:
+  void setUp() {
+    log_.str("");
+  }
+
+  void test_send_to_all( void ) {
+    TSendQueue<SendQueueTest, &SendQueueTest::receive> queue(this);
+    std::list<Location> locations;
+    locations.push_back(Location("oscit", "one"));
+    locations.push_back(Location("oscit", "two"));
+    SendPacket *packet = new SendPacket("a", 1);
+    queue.push(locations, packet);
+    packet->release();
+    millisleep(10);
+    assert_equal("[one:a][two:a]", log());
+    assert_equal(2, queue.sent_count());
+    assert_equal(0, queue.pending());
+  }
+
+  void test_serve_observers_in_turn( void ) {
+    TSendQueue<SendQueueTest, &SendQueueTest::receive> queue(this);
+    Location one("oscit", "one");
+    Location two("oscit", "two");
+    block_.lock();
+      push(&queue, one, "a");
+      millisleep(10); // sender blocked on 'a'
+      push(&queue, one, "b");
+      push(&queue, one, "c");
+      push(&queue, two, "d");
+      assert_equal(2, queue.depth(one));
+    block_.unlock();
+    millisleep(10);
+    // 'one' was being served when 'd' was pushed
+    assert_equal("[one:a][two:d][one:b][one:c]", log());
+  }
+
+  void test_drop_oldest( void ) {
+    TSendQueue<SendQueueTest, &SendQueueTest::receive> queue(this, 2);
+    Location one("oscit", "one");
+    Location two("oscit", "two");
+    block_.lock();
+      push(&queue, one, "a");
+      millisleep(10);
+      push(&queue, one, "b");
+      push(&queue, one, "c");
+      push(&queue, one, "d");
+      push(&queue, two, "e");
+      assert_equal(3, queue.pending());
+      assert_equal(1, queue.dropped_count());
+      Value stats(queue.stats());
+      assert_equal(2.0, stats["observers"]["one"]["depth"].r);
+      assert_equal(1.0, stats["observers"]["one"]["dropped"].r);
+      assert_equal(0.0, stats["observers"]["two"]["dropped"].r);
+    block_.unlock();
+    millisleep(10);
+    assert_equal("[one:a][two:e][one:c][one:d]", log());
+  }
+
+  void test_stats_name( void ) {
+    TSendQueue<SendQueueTest, &SendQueueTest::receive> queue(this);
+    block_.lock();
+      push(&queue, Location("oscit", "one", 7010), "a");
+      Value stats(queue.stats());
+      assert_true(stats["observers"]["one:7010"].is_hash());
+    block_.unlock();
+  }
+
+  void test_remove( void ) {
+    TSendQueue<SendQueueTest, &SendQueueTest::receive> queue(this);
+    Location one("oscit", "one");
+    block_.lock();
+      push(&queue, one, "a");
+      millisleep(10);
+      push(&queue, one, "b");
+      // removed while sending 'a'
+      queue.remove(one);
+      assert_equal(0, queue.pending());
+    block_.unlock();
+    millisleep(10);
+    assert_equal("[one:a]", log());
+    assert_equal(0, queue.depth(one));
+  }
+
+  void receive(const Location &location, const SendPacket &packet) {
+    ScopedLock block(block_);
+    ScopedLock lock(mutex_);
+    log_ << "[" << location.name() << ":" << std::string(packet.data(), packet.size()) << "]";
+  }
+
+private:
+  void push(SendQueue *queue, const Location &location, const char *data) {
+    SendPacket *packet = new SendPacket(data, strlen(data));
+    queue->push(location, packet);
+    packet->release();
+  }
+
+  std::string log() {
+    ScopedLock lock(mutex_);
+    std::string res = log_.str();
+    log_.str("");
+    return res;
+  }
+
+  Mutex block_;
+  Mutex mutex_;
+  std::ostringstream log_;
+};
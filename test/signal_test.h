@@ -31,6 +31,7 @@
 #include "test_helper.h"
 
 #include "oscit/signal.h"
+#include "oscit/thread.h"
 
 // BT is for BoostTest in case you wonder...
 class SenderBT {
@@ -42,6 +43,95 @@ public:
   Signal some_signal_;
 };
 
+class CountingObserver : public Observer {
+public:
+  CountingObserver() : count_(0) {}
+
+  void count(const Value &val) {
+    count_.increment();
+  }
+
+  AtomicCounter count_;
+};
+
+/** Observer taking some time in its callback so that sends from several
+ * threads overlap.
+ */
+class SlowObserver : public Observer {
+public:
+  void count(const Value &val) {
+    Thread::millisleep(0.5);
+    count_.increment();
+  }
+
+  AtomicCounter count_;
+};
+
+class SendingThread {
+public:
+  SendingThread(Signal *signal) : signal_(signal) {
+    thread_.start_thread<SendingThread, &SendingThread::run>(this, NULL);
+  }
+
+  ~SendingThread() {
+    thread_.quit();
+    thread_.join();
+  }
+
+  void run(Thread *runner) {
+    runner->thread_ready();
+    Value val(1.0);
+    while (runner->should_run()) {
+      signal_->send(val);
+    }
+  }
+
+  Signal *signal_;
+  Thread thread_;
+};
+
+/** Observer connecting another observer to the signal from its callback
+ * (runs in the delivery thread).
+ */
+class ReconnectingObserver : public Observer {
+public:
+  ReconnectingObserver(Signal *signal) : signal_(signal), started_(0) {}
+
+  void reconnect(const Value &val) {
+    started_.increment();
+    Thread::millisleep(5);
+    signal_->connect(&other_, &CountingObserver::count);
+  }
+
+  Signal *signal_;
+  AtomicCounter started_;
+  CountingObserver other_;
+};
+
+/** Deliver the values queued for an observer.
+ */
+class DeliveryThread {
+public:
+  DeliveryThread(Observer *observer) : observer_(observer) {
+    thread_.start_thread<DeliveryThread, &DeliveryThread::run>(this, NULL);
+  }
+
+  ~DeliveryThread() {
+    thread_.quit();
+    thread_.join();
+  }
+
+  void run(Thread *runner) {
+    runner->thread_ready();
+    while (runner->should_run()) {
+      if (observer_->delivery_queue()->wait(2)) observer_->deliver_pending();
+    }
+  }
+
+  Observer *observer_;
+  Thread thread_;
+};
+
 //
 ///** The goal of this test is to make sure boost compiles and behaves as expected (and we
 // * understand how to use it).
@@ -92,5 +182,174 @@ public:
 
     assert_equal("[a: \"message B\"][a: deleted]", oss.str());
   }
+
+  void test_connect_compile_time_method( void ) {
+    SenderBT root;
+    Logger oss;
+    ObserverLogger observer("a", &oss);
+
+    root.some_signal_.connect<ObserverLogger, &ObserverLogger::event>(&observer);
+    assert_equal(1, root.some_signal_.connection_count());
+
+    root.message("hello");
+    root.some_signal_.disconnect(&observer);
+    root.message("nobody");
+
+    assert_equal("[a: \"hello\"]", oss.str());
+    assert_equal(0, root.some_signal_.connection_count());
+  }
+
+  void test_receiver_deletes_itself_during_send( void ) {
+    SenderBT root;
+    Logger oss;
+    ObserverLogger *a = new ObserverLogger("a", &oss);
+    ObserverLogger b("b", &oss);
+
+    root.some_signal_.connect(a, &ObserverLogger::delete_this);
+    root.some_signal_.connect(&b, &ObserverLogger::event);
+
+    root.message("one");
+    assert_equal(1, root.some_signal_.connection_count());
+    root.message("two");
+
+    assert_equal("[a: deleting][a: deleted][b: \"one\"][b: \"two\"]", oss.str());
+  }
+
+  void test_disconnect_while_sending_in_other_thread( void ) {
+    Signal signal;
+    SendingThread sender(&signal);
+
+    for (int i = 0; i < 50; ++i) {
+      CountingObserver *observer = new CountingObserver;
+      signal.connect(observer, &CountingObserver::count);
+      millisleep(0.2);
+      delete observer;
+      // the observer is not reachable anymore: if the signal was still
+      // using it, we would crash here.
+    }
+
+    CountingObserver observer;
+    signal.connect<CountingObserver, &CountingObserver::count>(&observer);
+    millisleep(5);
+    signal.disconnect(&observer);
+    int32_t count = observer.count_.count();
+    assert_true(count > 0);
+    millisleep(2);
+    assert_equal(count, observer.count_.count());
+  }
+
+  void test_disconnect_does_not_wait_for_new_senders( void ) {
+    Signal signal;
+    SlowObserver observer;
+    signal.connect<SlowObserver, &SlowObserver::count>(&observer);
+    // there is always a sender in progress
+    SendingThread sender1(&signal);
+    SendingThread sender2(&signal);
+    SendingThread sender3(&signal);
+    millisleep(5);
+
+    TimeRef clock;
+    CountingObserver other;
+    signal.connect(&other, &CountingObserver::count);
+    signal.disconnect(&other);
+    signal.disconnect(&observer);
+    assert_true(clock.elapsed_us() < 50000);
+    assert_equal(0, signal.connection_count());
+  }
+
+  void test_async_delivery( void ) {
+    SenderBT root;
+    Logger oss;
+    ObserverLogger observer("a", &oss);
+    observer.set_async_delivery();
+
+    root.some_signal_.connect(&observer, &ObserverLogger::event);
+    root.message("one");
+    // nothing delivered yet
+    assert_equal("", oss.str());
+    assert_equal(1, observer.delivery_queue()->depth());
+
+    assert_equal(1, observer.deliver_pending());
+    assert_equal("[a: \"one\"]", oss.str());
+    assert_equal(0, observer.delivery_queue()->depth());
+  }
+
+  void test_async_delivery_coalesces_values( void ) {
+    SenderBT root;
+    SenderBT other;
+    Logger oss;
+    ObserverLogger observer("a", &oss);
+    observer.set_async_delivery();
+
+    root.some_signal_.connect(&observer, &ObserverLogger::event);
+    other.some_signal_.connect<ObserverLogger, &ObserverLogger::event>(&observer);
+    root.message("one");
+    other.message("x");
+    root.message("two");
+    root.message("three");
+
+    assert_equal(2, observer.delivery_queue()->depth());
+    assert_equal(2, observer.delivery_queue()->coalesced_count());
+    assert_equal(2, observer.deliver_pending());
+    assert_equal("[a: \"three\"][a: \"x\"]", oss.str());
+  }
+
+  void test_async_disconnect_removes_pending( void ) {
+    SenderBT root;
+    Logger oss;
+    ObserverLogger observer("a", &oss);
+    observer.set_async_delivery();
+
+    root.some_signal_.connect(&observer, &ObserverLogger::event);
+    root.message("one");
+    root.some_signal_.disconnect(&observer);
+    assert_equal(0, observer.delivery_queue()->depth());
+    assert_equal(0, observer.deliver_pending());
+    assert_equal("", oss.str());
+  }
+
+  void test_async_send_once_is_synchronous( void ) {
+    SenderBT root;
+    Logger oss;
+    ObserverLogger observer("a", &oss);
+    observer.set_async_delivery();
+
+    root.some_signal_.connect(&observer, &ObserverLogger::event);
+    root.some_signal_.send_once(Value("bye"));
+    assert_equal("[a: \"bye\"]", oss.str());
+    assert_equal(0, observer.delivery_queue()->depth());
+    assert_equal(0, root.some_signal_.connection_count());
+  }
+
+  void test_async_disconnect_while_callback_uses_signal( void ) {
+    Signal signal;
+    ReconnectingObserver observer(&signal);
+    observer.set_async_delivery();
+    signal.connect(&observer, &ReconnectingObserver::reconnect);
+
+    DeliveryThread delivery(&observer);
+    signal.send(Value(1.0));
+    while (observer.started_.count() == 0) millisleep(0.5);
+    // waits for the callback, which connects to the signal
+    signal.disconnect(&observer);
+    assert_equal(1, signal.connection_count());
+  }
+
+  void test_async_delivery_from_other_thread( void ) {
+    Signal signal;
+    CountingObserver observer;
+    observer.set_async_delivery();
+    signal.connect(&observer, &CountingObserver::count);
+
+    { SendingThread sender(&signal);
+      // the sending thread never calls the observer
+      millisleep(5);
+      assert_equal(0, observer.count_.count());
+      assert_true(observer.delivery_queue()->wait(10));
+      assert_true(observer.deliver_pending() > 0);
+    }
+    assert_true(observer.count_.count() > 0);
+    assert_true(observer.delivery_queue()->coalesced_count() > 0);
+  }
 };
 
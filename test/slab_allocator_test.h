@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/slab_allocator.h"
+
+class SlabAllocatorTest : public TestHelper
+{
+public:
+  void test_alloc_free( void ) {
+    SlabAllocator allocator(40, 400);
+    assert_equal(40, allocator.block_size());
+    char *a = (char*)allocator.alloc();
+    char *b = (char*)allocator.alloc();
+    assert_equal(40, b - a);
+    assert_equal(2, allocator.used());
+    assert_equal(1, allocator.slab_count());
+
+    allocator.free(a);
+    assert_equal(1, allocator.used());
+    // reuse freed block
+    assert_equal((void*)a, allocator.alloc());
+  }
+
+  void test_new_slab( void ) {
+    SlabAllocator allocator(32, 320);
+    for (int i = 0; i < 10; ++i) allocator.alloc();
+    assert_equal(1, allocator.slab_count());
+    allocator.alloc();
+    assert_equal(2, allocator.slab_count());
+    assert_equal(11, allocator.used());
+  }
+
+  void test_alignment( void ) {
+    SlabAllocator allocator(3);
+    assert_equal(sizeof(void*), allocator.block_size());
+  }
+
+  void test_shared_size_classes( void ) {
+    void *a = SlabAllocator::allocate(100);
+    void *b = SlabAllocator::allocate(SLAB_ALLOCATOR_MAX_SIZE + 1);
+    memset(a, 0, 100);
+    memset(b, 0, SLAB_ALLOCATOR_MAX_SIZE + 1);
+    SlabAllocator::deallocate(a, 100);
+    SlabAllocator::deallocate(b, SLAB_ALLOCATOR_MAX_SIZE + 1);
+    // same size class
+    assert_equal(a, SlabAllocator::allocate(112));
+    SlabAllocator::deallocate(a, 112);
+  }
+
+  void test_objects( void ) {
+    Object *a = new Object("a");
+    Object *b = new Object("b");
+    assert_equal("a", a->name());
+    a->release();
+    b->release();
+  }
+};
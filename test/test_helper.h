@@ -32,6 +32,7 @@
 #include <cxxtest/TestSuite.h>
 #include "oscit/oscit.h"
 #include "oscit/thread.h"
+#include "oscit/time_ref.h"
 #include "oscit/file.h"
 #include <ostream>
 
@@ -39,6 +40,14 @@ using namespace oscit;
 
 #define TEST_FIXTURES_PATH "../test/fixtures"
 
+/** Maximal lateness of the test thread in a timing scenario [ms].
+ */
+#define TEST_SLEEP_TOLERANCE 1.5
+
+/** Number of times a timing scenario is run if the test thread is late.
+ */
+#define TEST_SCENARIO_ATTEMPTS 5
+
 #define assert_equal(x,y) _assert_equal(__FILE__,__LINE__,#y,x,y)
 #define assert_true(e) _TS_ASSERT(__FILE__,__LINE__,e)
 #define assert_false(e) _TS_ASSERT(__FILE__,__LINE__,!(e))
@@ -48,7 +57,7 @@ using namespace oscit;
 class TestHelper : public CxxTest::TestSuite
 {
 public:
-  TestHelper() : saved_content_(10) {}
+  TestHelper() : scenario_late_(false), saved_content_(10) {}
 
 protected:
 
@@ -109,6 +118,45 @@ protected:
     Thread::millisleep(microseconds);
   }
 
+  /** Start the clock of a timing scenario (see sleep_until).
+   */
+  void start_scenario() {
+    scenario_late_ = false;
+    scenario_clock_.reset();
+  }
+
+  /** Sleep until 'ms' after the start of the scenario. Sleeps are anchored on
+   * the start so that they do not add up. If the thread wakes up more than
+   * 'tolerance' [ms] too late (loaded machine), the scenario is marked as late.
+   */
+  void sleep_until(Real ms, Real tolerance = TEST_SLEEP_TOLERANCE) {
+    Real remaining = ms - scenario_clock_.elapsed_us() / 1000.0;
+    if (remaining > 0) millisleep(remaining);
+    if (scenario_clock_.elapsed_us() / 1000.0 > ms + tolerance) scenario_late_ = true;
+  }
+
+  /** Sleep for 'ms' and mark the scenario as late if the thread wakes up
+   * too late (used in callbacks).
+   */
+  void timed_sleep(Real ms, Real tolerance = TEST_SLEEP_TOLERANCE) {
+    TimeRef clock;
+    millisleep(ms);
+    if (clock.elapsed_us() / 1000.0 > ms + tolerance) scenario_late_ = true;
+  }
+
+  /** Mark the scenario as late (the code under test could not run on time).
+   */
+  void mark_scenario_late() {
+    scenario_late_ = true;
+  }
+
+  /** Returns true if the scenario was late and should be run again (counts
+   * cannot be checked if the test thread did not run on time).
+   */
+  bool retry_late_scenario(int *attempts) {
+    return scenario_late_ && ++(*attempts) < TEST_SCENARIO_ATTEMPTS;
+  }
+
 
   //// file related helpers
   std::string fixture_path(const char *path) {
@@ -141,6 +189,14 @@ protected:
   }
 
 private:
+  /** Set when the test thread (or a callback) did not run on time.
+   */
+  bool scenario_late_;
+
+  /** Clock of the current timing scenario.
+   */
+  TimeRef scenario_clock_;
+
   THash<std::string, std::string> saved_content_;
 };
 
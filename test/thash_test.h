@@ -144,6 +144,34 @@ public:
     assert_equal("my", keys->front());
   }
 
+  void test_remove_with_collisions( void ) {
+    // single bucket: all elements collide
+    THash<std::string, std::string> hash(1);
+    std::string res;
+    hash.set(std::string("a"), std::string("1"));
+    hash.set(std::string("b"), std::string("2"));
+    hash.set(std::string("c"), std::string("3"));
+
+    hash.remove(std::string("a")); // moves 'b' up in the table
+    hash.remove(std::string("c"));
+    assert_equal(1, hash.keys().size());
+    assert_equal("b", hash.keys().front());
+    hash.remove(std::string("b"));
+    assert_true(hash.empty());
+    assert_false(hash.get("b", &res));
+  }
+
+  void test_empty_hash( void ) {
+    THash<std::string, std::string> hash(10);
+    std::string res;
+    assert_false(hash.get("a", &res));
+    assert_false(hash.has_key("a"));
+    hash.remove(std::string("a"));
+    hash.clear();
+    THash<std::string, std::string> hash2(hash);
+    assert_true(hash2.empty());
+  }
+
   void test_clear( void ) {
     THash<std::string, std::string> hash(10);
     std::string res;
@@ -43,5 +43,40 @@ public:
     millisleep(30);
     assert_true( time_ref.elapsed() >= 30);
   }
+
+  void test_elapsed_us( void ) {
+    TimeRef time_ref;
+    millisleep(1.5);
+    int64_t us = time_ref.elapsed_us();
+    assert_true( us >= 1500);
+    assert_true( us < 30000);
+  }
+
+  void test_elapsed_ns( void ) {
+    TimeRef time_ref;
+    millisleep(0.5);
+    assert_true( time_ref.elapsed_ns() >= 500000);
+  }
+
+  void test_reset( void ) {
+    TimeRef time_ref;
+    millisleep(20);
+    time_ref.reset();
+    assert_true( time_ref.elapsed() < 2);
+  }
+
+  void test_now_is_monotonic( void ) {
+    int64_t a = TimeRef::now();
+    int64_t b = TimeRef::now();
+    assert_true( b >= a);
+  }
+
+  void test_fast_now_follows_now( void ) {
+    int64_t start = TimeRef::fast_now();
+    millisleep(10);
+    int64_t duration = TimeRef::fast_now() - start;
+    assert_true( duration >= 9000000);
+    assert_true( duration < 50000000);
+  }
 };
 
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/timer_stats.h"
+
+class TimerStatsTest : public TestHelper
+{
+public:
+  void test_bucket_for( void ) {
+    assert_equal(0,  TimerStats::bucket_for(0));
+    assert_equal(0,  TimerStats::bucket_for(15999));
+    assert_equal(1,  TimerStats::bucket_for(16000));
+    assert_equal(2,  TimerStats::bucket_for(40000));
+    assert_equal(TIMER_STATS_BUCKETS - 1, TimerStats::bucket_for(1000000000));
+  }
+
+  void test_record( void ) {
+    TimerStats stats;
+    stats.record(1000000, 2000000); // 1ms late, 2ms callback
+    stats.record(3000000, 0);
+    stats.record_skipped(2);
+
+    assert_equal(2, stats.fire_count());
+    assert_equal(2, stats.skipped_count());
+    assert_equal(3.0, stats.max_lateness());
+    assert_equal(2.0, stats.mean_lateness());
+    assert_equal(2.0, stats.max_duration());
+    assert_equal(1.0, stats.mean_duration());
+    assert_equal(2.0, stats.max_jitter());
+    assert_equal(1, stats.lateness_histogram(TimerStats::bucket_for(1000000)));
+    assert_equal(1, stats.duration_histogram(0));
+  }
+
+  void test_reset( void ) {
+    TimerStats stats;
+    stats.record(1000000, 2000000);
+    stats.record_skipped(3);
+    stats.reset();
+    assert_equal(0, stats.fire_count());
+    assert_equal(0, stats.skipped_count());
+    assert_equal(0.0, stats.max_duration());
+    assert_equal(0, stats.duration_histogram(TimerStats::bucket_for(2000000)));
+  }
+
+  void test_to_value( void ) {
+    TimerStats stats;
+    stats.record(1000000, 2000000);
+    Value res = stats.to_value();
+    assert_true(res.is_hash());
+    assert_equal(1.0, res["count"].r);
+    assert_equal(0.0, res["skipped"].r);
+    assert_equal(1.0, res["max_lateness"].r);
+    assert_equal(2.0, res["max_duration"].r);
+    assert_equal(TIMER_STATS_BUCKETS,     res["lateness"].size());
+    assert_equal(TIMER_STATS_BUCKETS - 1, res["buckets"].size());
+    assert_equal(0.016, res["buckets"][0].r);
+  }
+};
@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/timer_wheel.h"
+#include "oscit/timer.h"
+
+class TimerWheelTest : public TestHelper
+{
+public:
+  void setUp() {
+    counter_ = 0;
+  }
+
+  void test_schedule_once( void ) {
+    int attempts = 0, before, fired, after;
+    bool scheduled;
+    do {
+      setUp();
+      TimerWheel wheel;
+      TTimerEvent<TimerWheelTest, &TimerWheelTest::loop> event(this);
+      start_scenario();
+      wheel.schedule_once(&event, 10);
+      assert_true(event.is_scheduled());
+      sleep_until(5);
+      before = counter_;
+      sleep_until(15);
+      fired = counter_;
+      scheduled = event.is_scheduled();
+      sleep_until(35);
+      after = counter_;
+      wheel.cancel(&event);
+    } while (retry_late_scenario(&attempts));
+    assert_equal(0, before);
+    assert_equal(1, fired);
+    assert_false(scheduled);
+    assert_equal(1, after);
+  }
+
+  void test_schedule_periodic( void ) {
+    int attempts = 0, fired, after_cancel;
+    do {
+      setUp();
+      TimerWheel wheel;
+      TTimerEvent<TimerWheelTest, &TimerWheelTest::loop> event(this);
+      start_scenario();
+      wheel.schedule(&event, 10);
+      sleep_until(35); // 0 .. 10 .. 20 .. 30
+      wheel.cancel(&event);
+      fired = counter_;
+      sleep_until(55);
+      after_cancel = counter_;
+    } while (retry_late_scenario(&attempts));
+    assert_equal(4, fired);
+    assert_equal(4, after_cancel);
+  }
+
+  void test_cancel_before_fire( void ) {
+    TimerWheel wheel;
+    TTimerEvent<TimerWheelTest, &TimerWheelTest::loop> event(this);
+    wheel.schedule_once(&event, 10);
+    assert_equal(1, wheel.event_count());
+    wheel.cancel(&event);
+    assert_equal(0, wheel.event_count());
+    millisleep(20);
+    assert_equal(0, counter_);
+  }
+
+  void test_long_delay_cascades( void ) {
+    int attempts = 0, before;
+    do {
+      setUp();
+      TimerWheel wheel;
+      TTimerEvent<TimerWheelTest, &TimerWheelTest::loop> event(this);
+      start_scenario();
+      // beyond the root wheel (256 ticks of ~131us = ~33ms)
+      wheel.schedule_once(&event, 60);
+      sleep_until(50);
+      before = counter_;
+      sleep_until(70);
+      wheel.cancel(&event);
+    } while (retry_late_scenario(&attempts));
+    assert_equal(0, before);
+    assert_equal(1, counter_);
+  }
+
+  void test_schedule_after_idle_wheel( void ) {
+    int attempts = 0;
+    do {
+      setUp();
+      TimerWheel wheel;
+      TTimerEvent<TimerWheelTest, &TimerWheelTest::loop> event(this);
+      // let the wheel's current tick get old
+      millisleep(50);
+      start_scenario();
+      wheel.schedule_once(&event, 1);
+      sleep_until(5);
+      wheel.cancel(&event);
+    } while (retry_late_scenario(&attempts));
+    assert_equal(1, counter_);
+  }
+
+  void test_zero_interval_fires_once_per_tick( void ) {
+    TimerWheel wheel;
+    TTimerEvent<TimerWheelTest, &TimerWheelTest::loop> event(this);
+    TimeRef clock;
+    wheel.schedule(&event, 0);
+    millisleep(10);
+    wheel.cancel(&event);
+    // ~131us per tick
+    assert_true(counter_ <= (clock.elapsed_us() >> (TIMER_WHEEL_TICK_SHIFT - 10)) + 1);
+  }
+
+  void test_cancel_after_restart_in_callback( void ) {
+    TimerWheel wheel;
+    TTimerEvent<TimerWheelTest, &TimerWheelTest::restart_and_cancel> event(this);
+    wheel_ = &wheel;
+    event_ = &event;
+    wheel.schedule_once(&event, 1);
+    millisleep(20);
+    assert_equal(1, counter_);
+    assert_false(event.is_scheduled());
+    assert_equal(0, wheel.event_count());
+  }
+
+  void test_many_timers_share_the_wheel( void ) {
+    int attempts = 0, count;
+    do {
+      setUp();
+      TimerWheel wheel;
+      std::vector<Timer<TimerWheelTest, &TimerWheelTest::loop> *> timers;
+      for (int i = 0; i < 100; ++i) {
+        timers.push_back(new Timer<TimerWheelTest, &TimerWheelTest::loop>(this, 10, &wheel));
+      }
+
+      start_scenario();
+      for (int i = 0; i < 100; ++i) {
+        timers[i]->start();
+      }
+      count = wheel.event_count();
+
+      sleep_until(25); // 0 .. 10 .. 20
+
+      for (int i = 0; i < 100; ++i) {
+        delete timers[i];
+      }
+      assert_equal(0, wheel.event_count());
+    } while (retry_late_scenario(&attempts));
+    assert_equal(100, count);
+    assert_equal(300, counter_);
+  }
+
+  void loop() {
+    ScopedLock lock(mutex_);
+    ++counter_;
+  }
+
+  void restart_and_cancel() {
+    loop();
+    wheel_->schedule_once(event_, 1);
+    wheel_->cancel(event_);
+  }
+
+private:
+  Mutex mutex_;
+  TimerWheel *wheel_;
+  TimerEvent *event_;
+  int counter_;
+};
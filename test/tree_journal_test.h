@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+   This file is part of the OSCIT library (http://rubyk.org/liboscit)
+   Copyright (c) 2007-2010 by Gaspard Bucher - Buma (http://teti.ch).
+
+  ------------------------------------------------------------------------------
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "test_helper.h"
+#include "oscit/tree_journal.h"
+
+class TreeJournalTest : public TestHelper
+{
+public:
+  void test_record_should_increment_version( void ) {
+    TreeJournal journal;
+    assert_equal(0, journal.version());
+    assert_equal(1, journal.record(TreeJournal::Adopt, "/a", HashValue()));
+    assert_equal(2, journal.record(TreeJournal::Update, "/a", Value(3.0)));
+    assert_equal(2, journal.version());
+  }
+
+  void test_changes_since( void ) {
+    TreeJournal journal;
+    journal.record(TreeJournal::Adopt, "/a", Value("x"));
+    journal.record(TreeJournal::Adopt, "/b", Value("y"));
+    journal.record(TreeJournal::Update, "/a", Value(3.0));
+    journal.record(TreeJournal::Remove, "/b", gNilValue);
+
+    Value changes;
+    uint64_t reached;
+    assert_true(journal.changes_since(1, 10, &changes, &reached));
+    assert_equal(4, reached);
+    assert_equal("[\"adopt\", \"/b\", \"y\", \"value\", \"/a\", 3, \"remove\", \"/b\", null]", changes.to_json());
+
+    changes.set_type(LIST_VALUE);
+    assert_true(journal.changes_since(4, 10, &changes, &reached));
+    assert_equal(4, reached);
+    assert_equal(0, changes.size());
+  }
+
+  void test_changes_since_should_page( void ) {
+    TreeJournal journal;
+    for (int i = 0; i < 5; ++i) journal.record(TreeJournal::Update, path(i), Value((Real)i));
+
+    Value changes;
+    uint64_t reached;
+    assert_true(journal.changes_since(0, 2, &changes, &reached));
+    assert_equal(2, reached);
+    assert_equal("[\"value\", \"/a0\", 0, \"value\", \"/a1\", 1]", changes.to_json());
+  }
+
+  void test_should_coalesce_value_updates( void ) {
+    TreeJournal journal(4);
+    journal.record(TreeJournal::Adopt, "/a", Value("x"));
+    for (int i = 0; i < 10; ++i) journal.record(TreeJournal::Update, "/a", Value((Real)i));
+    journal.record(TreeJournal::Update, "/b", Value(1.0));
+
+    Value changes;
+    uint64_t reached;
+    // only the latest value of each path is kept: nothing was dropped
+    assert_true(journal.changes_since(0, 10, &changes, &reached));
+    assert_equal(12, reached);
+    assert_equal("[\"adopt\", \"/a\", \"x\", \"value\", \"/a\", 9, \"value\", \"/b\", 1]", changes.to_json());
+
+    // a mirror between two updates of /a gets the latest value
+    changes.set_type(LIST_VALUE);
+    assert_true(journal.changes_since(5, 10, &changes, &reached));
+    assert_equal("[\"value\", \"/a\", 9, \"value\", \"/b\", 1]", changes.to_json());
+
+    // removing a path forgets its value
+    journal.record(TreeJournal::Remove, "/a", gNilValue);
+    changes.set_type(LIST_VALUE);
+    assert_true(journal.changes_since(5, 10, &changes, &reached));
+    assert_equal("[\"value\", \"/b\", 1, \"remove\", \"/a\", null]", changes.to_json());
+  }
+
+  void test_changes_since_should_fail_on_overflow( void ) {
+    TreeJournal journal(4);
+    for (int i = 0; i < 6; ++i) journal.record(TreeJournal::Update, path(i), Value((Real)i));
+
+    Value changes;
+    uint64_t reached;
+    assert_false(journal.changes_since(1, 10, &changes, &reached));
+    assert_true(journal.changes_since(2, 10, &changes, &reached));
+    assert_equal(6, reached);
+    assert_equal("[\"value\", \"/a2\", 2, \"value\", \"/a3\", 3, \"value\", \"/a4\", 4, \"value\", \"/a5\", 5]", changes.to_json());
+  }
+
+  void test_changes_since_should_fail_on_structural_overflow( void ) {
+    TreeJournal journal(2);
+    journal.record(TreeJournal::Adopt, "/a", Value("x"));
+    journal.record(TreeJournal::Adopt, "/b", Value("y"));
+    journal.record(TreeJournal::Update, "/a", Value(1.0));
+    journal.record(TreeJournal::Adopt, "/c", Value("z"));
+
+    Value changes;
+    uint64_t reached;
+    assert_false(journal.changes_since(0, 10, &changes, &reached));
+    assert_true(journal.changes_since(1, 10, &changes, &reached));
+    assert_equal(4, reached);
+    assert_equal("[\"adopt\", \"/b\", \"y\", \"value\", \"/a\", 1, \"adopt\", \"/c\", \"z\"]", changes.to_json());
+  }
+
+  void test_changes_since_should_fail_on_unknown_version( void ) {
+    TreeJournal journal;
+    journal.record(TreeJournal::Update, "/a", Value(1.0));
+
+    Value changes;
+    uint64_t reached;
+    assert_false(journal.changes_since(7, 10, &changes, &reached));
+  }
+
+  void test_version_value( void ) {
+    TreeJournal journal;
+    uint64_t version;
+    Value value = journal.version_value(12345678901234ULL);
+    assert_equal(":12345678901234", value.str().substr(8));
+    assert_true(journal.version_from_value(value, &version));
+    assert_true(version == 12345678901234ULL);
+    assert_false(journal.version_from_value(Value(12.0), &version));
+    assert_false(journal.version_from_value(Value("12"), &version));
+    assert_false(journal.version_from_value(Value(value.str().append("a")), &version));
+    assert_false(journal.version_from_value(gNilValue, &version));
+  }
+
+  void test_should_reject_versions_of_another_journal( void ) {
+    TreeJournal journal;
+    TreeJournal other;
+    uint64_t version;
+    assert_true(journal.version_value(3).str() != other.version_value(3).str());
+    assert_false(journal.version_from_value(other.version_value(3), &version));
+  }
+
+private:
+  static std::string path(int i) {
+    std::ostringstream os;
+    os << "/a" << i;
+    return os.str();
+  }
+};
@@ -29,8 +29,39 @@
 
 #include "test_helper.h"
 #include "oscit/root.h"
+#include "oscit/reply_stream.h"
+#include "oscit/list_with_attributes_meta_method.h"
+#include "oscit/tree_meta_method.h"
 #include "mock/dummy_object.h"
 
+/** Collects the chunks of a streamed reply.
+ */
+class ReplyStreamLogger : public ReplyStream {
+public:
+  std::vector<Value> replies_;
+
+protected:
+  virtual void send_reply(const Value &reply, bool last) {
+    replies_.push_back(reply);
+  }
+};
+
+/** Adopts a new child in an object on each chunk.
+ */
+class AdoptingReplyStream : public ReplyStreamLogger {
+public:
+  explicit AdoptingReplyStream(Object *parent) : parent_(parent) {}
+
+protected:
+  virtual void send_reply(const Value &reply, bool last) {
+    ReplyStreamLogger::send_reply(reply, last);
+    parent_->adopt(new Object("added"));
+  }
+
+private:
+  Object *parent_;
+};
+
 class TreeMetaMethodTest : public TestHelper
 {
 public:
@@ -57,8 +88,8 @@ public:
     res = root.call(TREE_PATH, Value(""));
     assert_equal("", res[0].str());
     res = res[1];
-    assert_equal(13, res.size());
-    assert_equal("[\".error\", \".info\", \".list\", \".list_att\", \".attr\", \".tree\", \"Nikolaus\", \"Nikolaus/Jacob\", \"Nikolaus/Nikolaus\", \"Nikolaus/Johann\", \"Nikolaus/Johann/Nicolaus\", \"Nikolaus/Johann/Daniel\", \"Nikolaus/Johann/Johann\"]", res.to_json());
+    assert_equal(14, res.size());
+    assert_equal("[\".error\", \".info\", \".list\", \".list_att\", \".attr\", \".tree\", \".changes\", \"Nikolaus\", \"Nikolaus/Jacob\", \"Nikolaus/Nikolaus\", \"Nikolaus/Johann\", \"Nikolaus/Johann/Nicolaus\", \"Nikolaus/Johann/Daniel\", \"Nikolaus/Johann/Johann\"]", res.to_json());
 
     res = root.call(TREE_PATH, Value("/Nikolaus"));
     assert_equal("/Nikolaus", res[0].str());
@@ -87,6 +118,128 @@ public:
     assert_equal(0, res.size());
   }
 
+  void test_stream_tree_in_chunks( void ) {
+    Root root;
+    Object *tmp = root.adopt(new Object("bank"));
+    std::ostringstream name;
+    for (int i = 0; i < TREE_CHUNK_SIZE; ++i) {
+      name.str("");
+      name << "v" << i;
+      tmp->adopt(new Object(name.str()))->adopt(new Object("gain"));
+    }
+
+    ObjectHandle tree;
+    assert_true(root.get_object_at(TREE_PATH, &tree));
+    ReplyStreamLogger stream;
+    assert_true(tree->trigger_stream(Value("/bank"), &stream));
+    assert_equal(3, stream.replies_.size());
+    assert_equal("/bank", stream.replies_[0][0].str());
+    assert_equal(TREE_CHUNK_SIZE, stream.replies_[0][1].size());
+    assert_true(stream.replies_[0][2].is_true());
+    assert_equal("v0", stream.replies_[0][1][0].str());
+    assert_equal("v0/gain", stream.replies_[0][1][1].str());
+    // last chunk
+    assert_equal(2, stream.replies_[2].size());
+    assert_equal(0, stream.replies_[2][1].size());
+
+    // unknown path: replied by 'trigger'
+    ReplyStreamLogger missing;
+    assert_false(tree->trigger_stream(Value("/foo"), &missing));
+    assert_equal(0, missing.replies_.size());
+  }
+
+  void test_stream_sends_chunks_as_soon_as_full( void ) {
+    ReplyStreamLogger stream;
+    stream.begin(Value("/bank"), 2);
+    stream.push_back(Value("a"));
+    assert_equal(0, stream.replies_.size());
+    stream.push_back(Value("b"));
+    // at most one chunk is buffered
+    assert_equal(1, stream.replies_.size());
+    assert_equal(1, stream.chunk_count());
+    stream.push_back(Value("c"));
+    assert_equal(1, stream.replies_.size());
+    stream.close();
+    assert_equal(2, stream.replies_.size());
+    assert_equal("[\"/bank\", [\"a\", \"b\"], true]", stream.replies_[0].to_json());
+    assert_equal("[\"/bank\", [\"c\"]]", stream.replies_[1].to_json());
+  }
+
+  void test_stream_does_not_hold_locks_while_sending( void ) {
+    Root root;
+    Object *tmp = root.adopt(new Object("bank"));
+    std::ostringstream name;
+    for (int i = 0; i < TREE_CHUNK_SIZE; ++i) {
+      name.str("");
+      name << "v" << i;
+      tmp->adopt(new Object(name.str()))->adopt(new Object("gain"));
+    }
+
+    ObjectHandle tree;
+    assert_true(root.get_object_at(TREE_PATH, &tree));
+    // adopts in the walked objects on each chunk (would dead lock if the
+    // children locks were held)
+    AdoptingReplyStream stream(tmp);
+    assert_true(tree->trigger_stream(Value("/bank"), &stream));
+    assert_equal(3, stream.replies_.size());
+    assert_equal(TREE_CHUNK_SIZE + 3, tmp->list().size());
+  }
+
+  void test_stream_list_with_attributes_in_chunks( void ) {
+    Root root;
+    Object *tmp = root.adopt(new Object("bank"));
+    std::ostringstream name;
+    for (int i = 0; i < LIST_WITH_ATTRIBUTES_CHUNK_SIZE + 1; ++i) {
+      name.str("");
+      name << "v" << i;
+      tmp->adopt(new Object(name.str()));
+    }
+
+    ObjectHandle list;
+    assert_true(root.get_object_at(LIST_WITH_ATTRIBUTES_PATH, &list));
+    ReplyStreamLogger stream;
+    assert_true(list->trigger_stream(Value("/bank"), &stream));
+    assert_equal(2, stream.replies_.size());
+    assert_equal(2 * LIST_WITH_ATTRIBUTES_CHUNK_SIZE, stream.replies_[0][1].size());
+    assert_equal("v16", stream.replies_[1][1][0].str());
+    assert_true(stream.replies_[1][1][1].is_hash());
+  }
+
+  void test_batched_list_with_attributes_in_pages( void ) {
+    Root root;
+    ListValue paths;
+    std::ostringstream name;
+    for (int i = 0; i < 32; ++i) {
+      name.str("");
+      name << "bank" << i;
+      Object *tmp = root.adopt(new Object(name.str()));
+      paths.push_back(tmp->url());
+      for (int j = 0; j < 8; ++j) {
+        name.str("");
+        name << "v" << j;
+        tmp->adopt(new DummyObject(name.str().c_str(), 1.0, Oscit::range_io("Voice gain.", 0, 1)));
+      }
+    }
+    // one big reply would not fit in an OSC packet
+    assert_true(Root::osc_size(root.call(LIST_WITH_ATTRIBUTES_PATH, paths)) > ATTRS_PAGE_BYTES);
+
+    ObjectHandle list;
+    assert_true(root.get_object_at(LIST_WITH_ATTRIBUTES_PATH, &list));
+    ReplyStreamLogger stream;
+    assert_true(list->trigger_stream(paths, &stream));
+    assert_true(stream.replies_.size() > 1);
+    size_t count = 0;
+    for (size_t i = 0; i < stream.replies_.size(); ++i) {
+      const Value &page = stream.replies_[i];
+      assert_true(Root::osc_size(page) <= ATTRS_PAGE_BYTES);
+      for (size_t j = 0; j < page.size(); j += 2, ++count) {
+        assert_equal(paths[count].str(), page[j].str());
+        assert_equal(2 * 8, page[j + 1].size());
+      }
+    }
+    assert_equal(32, count);
+  }
+
   void test_tree_with_nil( void ) {
     Root root(Oscit::no_io("This is the root node."));
     Value res;
@@ -171,6 +171,17 @@ public:
     assert_equal("/this/is/a/path", url.path());
   }
 
+  void test_ip_url_str( void ) {
+    Url url((10<<24)+4, 1432, "/this/is/a/path");
+    assert_equal("oscit://10.0.0.4:1432/this/is/a/path", url.str());
+    Url parent;
+    assert_true(url.get_parent_url(&parent));
+    assert_equal("oscit://10.0.0.4:1432/this/is/a", parent.str());
+    assert_true(Url("oscit://10.0.0.4:1432/this/is/a/path") == url);
+    assert_true(Url((10<<24)+4, 1432, "/this/is/a/path") == url);
+    assert_false(Url((10<<24)+5, 1432, "/this/is/a/path") == url);
+  }
+
   void test_is_meta( void ) {
     Url meta_url("oscit://\"foobar\"/.list");
     Url url("oscit://\"foobar\"/list");